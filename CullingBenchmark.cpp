@@ -0,0 +1,85 @@
+//
+// Created by andyroiiid on 12/27/2022.
+//
+
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <limits>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Debug.h"
+#include "FrustumCulling.h"
+#include "SceneBvh.h"
+
+// Culls a random field of objects with every supported kernel and prints the throughput.
+int main() {
+    constexpr uint32_t numObjects = 1 << 20;
+    constexpr int numRepeats = 50;
+
+    std::mt19937 random(42); // NOLINT(cert-msc51-cpp)
+    std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+    std::uniform_real_distribution<float> size(0.5f, 4.0f);
+
+    CullingBounds bounds;
+    bounds.Reserve(numObjects);
+    SceneBvh bvh;
+    for (uint32_t i = 0; i < numObjects; i++) {
+        const glm::vec3 center{position(random), position(random) * 0.1f, position(random)};
+        const glm::vec3 extent{size(random), size(random), size(random)};
+        bounds.Add(center, extent, glm::length(extent));
+        bvh.Insert(center - extent, center + extent, i);
+    }
+
+    const auto buildStart = std::chrono::high_resolution_clock::now();
+    bvh.Build();
+    bvh.Refit();
+    const auto buildEnd = std::chrono::high_resolution_clock::now();
+    DebugInfo("BVH build: {:.3f} ms", std::chrono::duration<double>(buildEnd - buildStart).count() * 1000.0);
+
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 4000.0f);
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 50.0f, -200.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const Frustum frustum(projection * view);
+
+    std::vector<uint32_t> reference(numObjects);
+    const uint32_t referenceCount = CullBounds(bounds, frustum, reference.data(), CullingIsa::Scalar);
+    DebugInfo("{} objects, {} visible", numObjects, referenceCount);
+
+    std::vector<uint32_t> visibleIndices(numObjects);
+    for (CullingIsa isa: {CullingIsa::Scalar, CullingIsa::Sse, CullingIsa::Avx2, CullingIsa::Avx512, CullingIsa::Neon}) {
+        if (!IsCullingIsaSupported(isa)) {
+            DebugInfo("{:>8}: not supported", GetCullingIsaName(isa));
+            continue;
+        }
+
+        // keep the fastest run to filter out scheduling noise
+        double bestSeconds = std::numeric_limits<double>::max();
+        uint32_t numVisible = 0;
+        for (int i = 0; i < numRepeats; i++) {
+            const auto start = std::chrono::high_resolution_clock::now();
+            numVisible = CullBounds(bounds, frustum, visibleIndices.data(), isa);
+            const auto end = std::chrono::high_resolution_clock::now();
+            bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(end - start).count());
+        }
+
+        const bool matches = numVisible == referenceCount && std::equal(reference.begin(), reference.begin() + referenceCount, visibleIndices.begin());
+        DebugCheck(matches, "{} results differ from the scalar kernel", GetCullingIsaName(isa));
+        DebugInfo("{:>8}: {:.3f} ms, {:.3f} objects/ns", GetCullingIsaName(isa), bestSeconds * 1000.0, numObjects / (bestSeconds * 1e9));
+    }
+
+    // the radius is the length of the extent, so the kernels above only test boxes like the BVH does
+    double bestSeconds = std::numeric_limits<double>::max();
+    uint32_t numVisible = 0;
+    for (int i = 0; i < numRepeats; i++) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        numVisible = bvh.QueryFrustum(frustum, visibleIndices.data());
+        const auto end = std::chrono::high_resolution_clock::now();
+        bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(end - start).count());
+    }
+    std::sort(visibleIndices.begin(), visibleIndices.begin() + numVisible);
+    const bool matches = numVisible == referenceCount && std::equal(reference.begin(), reference.begin() + referenceCount, visibleIndices.begin());
+    DebugCheck(matches, "BVH results differ from the scalar kernel");
+    DebugInfo("{:>8}: {:.3f} ms, {:.3f} objects/ns", "BVH", bestSeconds * 1000.0, numObjects / (bestSeconds * 1e9));
+
+    return 0;
+}
@@ -4,6 +4,21 @@
 
 #include "Files.h"
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+
+#include <Windows.h>
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#endif
+
 std::string ReadFile(const std::string &filename) {
     FILE *file = nullptr;
 
@@ -33,3 +48,120 @@ std::string ReadFile(const std::string &filename) {
 
     return buffer;
 }
+
+bool WriteFile(const std::string &filename, const void *data, size_t size) {
+    FILE *file = nullptr;
+
+    if (fopen_s(&file, filename.c_str(), "wb")) {
+        return false;
+    }
+
+    const bool succeeded = fwrite(data, 1, size, file) == size;
+
+    return fclose(file) == 0 && succeeded;
+}
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string &filename) {
+    HANDLE file = CreateFileA(
+            filename.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    m_file = file;
+
+    LARGE_INTEGER size;
+    // empty files can not be mapped
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        Release();
+        return;
+    }
+
+    m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == nullptr) {
+        Release();
+        return;
+    }
+
+    m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (m_data == nullptr) {
+        Release();
+        return;
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+}
+
+void MappedFile::Release() {
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+    }
+    if (m_file) {
+        CloseHandle(m_file);
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+    m_mapping = nullptr;
+    m_file = nullptr;
+}
+
+void MappedFile::Swap(MappedFile &other) noexcept {
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_file, other.m_file);
+    std::swap(m_mapping, other.m_mapping);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &filename) {
+    const int file = open(filename.c_str(), O_RDONLY);
+    if (file < 0) {
+        return;
+    }
+
+    struct stat status{};
+    // empty files can not be mapped
+    if (fstat(file, &status) != 0 || status.st_size == 0) {
+        close(file);
+        return;
+    }
+
+    void *data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    // the mapping keeps its own reference to the file
+    close(file);
+    if (data == MAP_FAILED) {
+        return;
+    }
+    (void) madvise(data, status.st_size, MADV_SEQUENTIAL);
+
+    m_data = data;
+    m_size = status.st_size;
+}
+
+void MappedFile::Release() {
+    if (m_data) {
+        munmap(const_cast<void *>(m_data), m_size);
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+}
+
+void MappedFile::Swap(MappedFile &other) noexcept {
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+}
+
+#endif
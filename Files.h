@@ -7,3 +7,51 @@
 #include <string>
 
 std::string ReadFile(const std::string &filename);
+
+bool WriteFile(const std::string &filename, const void *data, size_t size);
+
+// Read only memory mapping of a whole file, the view is page aligned.
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string &filename);
+
+    ~MappedFile() {
+        Release();
+    }
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept {
+        Swap(other);
+    }
+
+    MappedFile &operator=(MappedFile &&other) noexcept {
+        if (this != &other) {
+            Release();
+            Swap(other);
+        }
+        return *this;
+    }
+
+    void Release();
+
+    void Swap(MappedFile &other) noexcept;
+
+    [[nodiscard]] bool IsValid() const { return m_data != nullptr; }
+
+    [[nodiscard]] const void *GetData() const { return m_data; }
+
+    [[nodiscard]] size_t GetSize() const { return m_size; }
+
+private:
+    const void *m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void *m_file = nullptr;
+    void *m_mapping = nullptr;
+#endif
+};
@@ -0,0 +1,51 @@
+//
+// Created by andyroiiid on 12/26/2022.
+//
+
+#include "Frustum.h"
+
+#include <glm/geometric.hpp>
+
+static glm::vec4 NormalizePlane(const glm::vec4 &plane) {
+    return plane / glm::length(glm::vec3(plane));
+}
+
+Frustum::Frustum(const glm::mat4 &viewProjection) {
+    // glm matrices are column major, m[column][row]
+    const glm::vec4 row0{viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]};
+    const glm::vec4 row1{viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]};
+    const glm::vec4 row2{viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]};
+    const glm::vec4 row3{viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]};
+
+    Planes[0] = NormalizePlane(row3 + row0);
+    Planes[1] = NormalizePlane(row3 - row0);
+    Planes[2] = NormalizePlane(row3 + row1);
+    Planes[3] = NormalizePlane(row3 - row1);
+    // clip space depth is [0, w]
+    Planes[4] = NormalizePlane(row2);
+    Planes[5] = NormalizePlane(row3 - row2);
+}
+
+bool Frustum::IntersectsSphere(const glm::vec3 &center, float radius) const {
+    for (const glm::vec4 &plane: Planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::IntersectsAabb(const glm::vec3 &min, const glm::vec3 &max) const {
+    for (const glm::vec4 &plane: Planes) {
+        // the corner furthest along the plane normal
+        const glm::vec3 positive{
+                plane.x >= 0.0f ? max.x : min.x,
+                plane.y >= 0.0f ? max.y : min.y,
+                plane.z >= 0.0f ? max.z : min.z
+        };
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,24 @@
+//
+// Created by andyroiiid on 12/26/2022.
+//
+
+#pragma once
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+struct Frustum {
+    // left, right, bottom, top, near, far
+    // xyz is the normalized normal pointing inside, w is the distance so that dot(xyz, p) + w >= 0 is inside
+    glm::vec4 Planes[6];
+
+    Frustum() = default;
+
+    // extracts the planes of a GLM_FORCE_DEPTH_ZERO_TO_ONE projection * view matrix
+    explicit Frustum(const glm::mat4 &viewProjection);
+
+    [[nodiscard]] bool IntersectsSphere(const glm::vec3 &center, float radius) const;
+
+    [[nodiscard]] bool IntersectsAabb(const glm::vec3 &min, const glm::vec3 &max) const;
+};
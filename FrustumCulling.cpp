@@ -0,0 +1,383 @@
+//
+// Created by andyroiiid on 12/27/2022.
+//
+
+#include "FrustumCulling.h"
+
+#include <limits>
+#include <glm/geometric.hpp>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define CULLING_X86
+
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+
+#include <intrin.h>
+
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define CULLING_NEON
+
+#include <arm_neon.h>
+
+#endif
+
+// MSVC compiles any intrinsic without extra flags, GCC and Clang need per function targets
+#if defined(__GNUC__) || defined(__clang__)
+#define CULLING_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CULLING_TARGET(isa)
+#endif
+
+void CullingBounds::Clear() {
+    m_count = 0;
+    m_centerX.clear();
+    m_centerY.clear();
+    m_centerZ.clear();
+    m_extentX.clear();
+    m_extentY.clear();
+    m_extentZ.clear();
+    m_radius.clear();
+}
+
+void CullingBounds::Reserve(uint32_t count) {
+    const uint32_t paddedCount = (count + Padding - 1) / Padding * Padding;
+    m_centerX.reserve(paddedCount);
+    m_centerY.reserve(paddedCount);
+    m_centerZ.reserve(paddedCount);
+    m_extentX.reserve(paddedCount);
+    m_extentY.reserve(paddedCount);
+    m_extentZ.reserve(paddedCount);
+    m_radius.reserve(paddedCount);
+}
+
+uint32_t CullingBounds::Add(const glm::vec3 &center, const glm::vec3 &extent, float radius) {
+    const uint32_t index = m_count++;
+    if (index == m_radius.size()) {
+        // NaN never passes the plane tests, so padding is never visible
+        const uint32_t paddedCount = index + Padding;
+        constexpr float nan = std::numeric_limits<float>::quiet_NaN();
+        m_centerX.resize(paddedCount, nan);
+        m_centerY.resize(paddedCount, nan);
+        m_centerZ.resize(paddedCount, nan);
+        m_extentX.resize(paddedCount, nan);
+        m_extentY.resize(paddedCount, nan);
+        m_extentZ.resize(paddedCount, nan);
+        m_radius.resize(paddedCount, nan);
+    }
+    Set(index, center, extent, radius);
+    return index;
+}
+
+uint32_t CullingBounds::AddAabb(const glm::vec3 &min, const glm::vec3 &max) {
+    const glm::vec3 extent = (max - min) * 0.5f;
+    return Add((min + max) * 0.5f, extent, glm::length(extent));
+}
+
+void CullingBounds::Set(uint32_t index, const glm::vec3 &center, const glm::vec3 &extent, float radius) {
+    m_centerX[index] = center.x;
+    m_centerY[index] = center.y;
+    m_centerZ[index] = center.z;
+    m_extentX[index] = extent.x;
+    m_extentY[index] = extent.y;
+    m_extentZ[index] = extent.z;
+    m_radius[index] = radius;
+}
+
+const char *GetCullingIsaName(CullingIsa isa) {
+    switch (isa) {
+    case CullingIsa::Scalar:
+        return "Scalar";
+    case CullingIsa::Sse:
+        return "SSE";
+    case CullingIsa::Avx2:
+        return "AVX2";
+    case CullingIsa::Avx512:
+        return "AVX-512";
+    case CullingIsa::Neon:
+        return "NEON";
+    default:
+        return "Unknown";
+    }
+}
+
+#ifdef CULLING_X86
+
+static bool CpuSupportsAvx2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave || !fma || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+static bool CpuSupportsAvx512() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    // XMM, YMM, opmask and ZMM state must all be enabled by the OS
+    if (!osxsave || (_xgetbv(0) & 0xE6) != 0xE6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 16)) != 0;
+#else
+    return __builtin_cpu_supports("avx512f");
+#endif
+}
+
+#endif
+
+bool IsCullingIsaSupported(CullingIsa isa) {
+    switch (isa) {
+    case CullingIsa::Scalar:
+        return true;
+#ifdef CULLING_X86
+    case CullingIsa::Sse:
+        return true;
+    case CullingIsa::Avx2:
+        return CpuSupportsAvx2();
+    case CullingIsa::Avx512:
+        return CpuSupportsAvx512();
+#endif
+#ifdef CULLING_NEON
+    case CullingIsa::Neon:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+CullingIsa GetBestCullingIsa() {
+    static const CullingIsa bestIsa = [] {
+        for (CullingIsa isa: {CullingIsa::Avx512, CullingIsa::Avx2, CullingIsa::Sse, CullingIsa::Neon}) {
+            if (IsCullingIsaSupported(isa)) {
+                return isa;
+            }
+        }
+        return CullingIsa::Scalar;
+    }();
+    return bestIsa;
+}
+
+// the per plane values every kernel needs
+struct CullingPlane {
+    float NormalX, NormalY, NormalZ, Distance;
+    float AbsNormalX, AbsNormalY, AbsNormalZ;
+};
+
+static void GetCullingPlanes(const Frustum &frustum, CullingPlane planes[6]) {
+    for (int i = 0; i < 6; i++) {
+        const glm::vec4 &plane = frustum.Planes[i];
+        planes[i] = {plane.x, plane.y, plane.z, plane.w, std::abs(plane.x), std::abs(plane.y), std::abs(plane.z)};
+    }
+}
+
+static inline uint32_t CountTrailingZeros(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// appends base + i for every set bit i of mask
+static inline uint32_t CompactMask(uint32_t mask, uint32_t base, uint32_t *visibleIndices, uint32_t numVisible) {
+    while (mask) {
+        visibleIndices[numVisible++] = base + CountTrailingZeros(mask);
+        mask &= mask - 1;
+    }
+    return numVisible;
+}
+
+// An object is outside of a plane when distance(center) < -min(radius, projected box extent).
+// Both the box and the sphere contain the object, so the smaller projected radius is still conservative.
+static uint32_t CullScalar(const CullingBounds &bounds, const CullingPlane planes[6], uint32_t *visibleIndices) {
+    const float *centerX = bounds.GetCenterX();
+    const float *centerY = bounds.GetCenterY();
+    const float *centerZ = bounds.GetCenterZ();
+    const float *extentX = bounds.GetExtentX();
+    const float *extentY = bounds.GetExtentY();
+    const float *extentZ = bounds.GetExtentZ();
+    const float *radius = bounds.GetRadius();
+
+    uint32_t numVisible = 0;
+    const uint32_t count = bounds.GetCount();
+    for (uint32_t i = 0; i < count; i++) {
+        bool visible = true;
+        for (int p = 0; p < 6 && visible; p++) {
+            const CullingPlane &plane = planes[p];
+            const float distance = plane.NormalX * centerX[i] + plane.NormalY * centerY[i] + plane.NormalZ * centerZ[i] + plane.Distance;
+            const float extent = plane.AbsNormalX * extentX[i] + plane.AbsNormalY * extentY[i] + plane.AbsNormalZ * extentZ[i];
+            visible = distance + std::min(extent, radius[i]) >= 0.0f;
+        }
+        if (visible) {
+            visibleIndices[numVisible++] = i;
+        }
+    }
+    return numVisible;
+}
+
+#ifdef CULLING_X86
+
+static uint32_t CullSse(const CullingBounds &bounds, const CullingPlane planes[6], uint32_t *visibleIndices) {
+    uint32_t numVisible = 0;
+    const uint32_t paddedCount = bounds.GetPaddedCount();
+    for (uint32_t i = 0; i < paddedCount; i += 4) {
+        const __m128 centerX = _mm_loadu_ps(bounds.GetCenterX() + i);
+        const __m128 centerY = _mm_loadu_ps(bounds.GetCenterY() + i);
+        const __m128 centerZ = _mm_loadu_ps(bounds.GetCenterZ() + i);
+        const __m128 extentX = _mm_loadu_ps(bounds.GetExtentX() + i);
+        const __m128 extentY = _mm_loadu_ps(bounds.GetExtentY() + i);
+        const __m128 extentZ = _mm_loadu_ps(bounds.GetExtentZ() + i);
+        const __m128 radius = _mm_loadu_ps(bounds.GetRadius() + i);
+
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            const CullingPlane &plane = planes[p];
+            __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.NormalX), centerX), _mm_set1_ps(plane.Distance));
+            distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.NormalY), centerY), distance);
+            distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.NormalZ), centerZ), distance);
+            __m128 extent = _mm_mul_ps(_mm_set1_ps(plane.AbsNormalX), extentX);
+            extent = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.AbsNormalY), extentY), extent);
+            extent = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.AbsNormalZ), extentZ), extent);
+            const __m128 inside = _mm_cmpge_ps(_mm_add_ps(distance, _mm_min_ps(extent, radius)), _mm_setzero_ps());
+            visible = _mm_and_ps(visible, inside);
+        }
+        numVisible = CompactMask(_mm_movemask_ps(visible), i, visibleIndices, numVisible);
+    }
+    return numVisible;
+}
+
+CULLING_TARGET("avx2,fma")
+static uint32_t CullAvx2(const CullingBounds &bounds, const CullingPlane planes[6], uint32_t *visibleIndices) {
+    uint32_t numVisible = 0;
+    const uint32_t paddedCount = bounds.GetPaddedCount();
+    for (uint32_t i = 0; i < paddedCount; i += 8) {
+        const __m256 centerX = _mm256_loadu_ps(bounds.GetCenterX() + i);
+        const __m256 centerY = _mm256_loadu_ps(bounds.GetCenterY() + i);
+        const __m256 centerZ = _mm256_loadu_ps(bounds.GetCenterZ() + i);
+        const __m256 extentX = _mm256_loadu_ps(bounds.GetExtentX() + i);
+        const __m256 extentY = _mm256_loadu_ps(bounds.GetExtentY() + i);
+        const __m256 extentZ = _mm256_loadu_ps(bounds.GetExtentZ() + i);
+        const __m256 radius = _mm256_loadu_ps(bounds.GetRadius() + i);
+
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            const CullingPlane &plane = planes[p];
+            __m256 distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.NormalX), centerX, _mm256_set1_ps(plane.Distance));
+            distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.NormalY), centerY, distance);
+            distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.NormalZ), centerZ, distance);
+            __m256 extent = _mm256_mul_ps(_mm256_set1_ps(plane.AbsNormalX), extentX);
+            extent = _mm256_fmadd_ps(_mm256_set1_ps(plane.AbsNormalY), extentY, extent);
+            extent = _mm256_fmadd_ps(_mm256_set1_ps(plane.AbsNormalZ), extentZ, extent);
+            const __m256 inside = _mm256_cmp_ps(_mm256_add_ps(distance, _mm256_min_ps(extent, radius)), _mm256_setzero_ps(), _CMP_GE_OQ);
+            visible = _mm256_and_ps(visible, inside);
+        }
+        numVisible = CompactMask(_mm256_movemask_ps(visible), i, visibleIndices, numVisible);
+    }
+    return numVisible;
+}
+
+CULLING_TARGET("avx512f")
+static uint32_t CullAvx512(const CullingBounds &bounds, const CullingPlane planes[6], uint32_t *visibleIndices) {
+    uint32_t numVisible = 0;
+    const uint32_t paddedCount = bounds.GetPaddedCount();
+    for (uint32_t i = 0; i < paddedCount; i += 16) {
+        const __m512 centerX = _mm512_loadu_ps(bounds.GetCenterX() + i);
+        const __m512 centerY = _mm512_loadu_ps(bounds.GetCenterY() + i);
+        const __m512 centerZ = _mm512_loadu_ps(bounds.GetCenterZ() + i);
+        const __m512 extentX = _mm512_loadu_ps(bounds.GetExtentX() + i);
+        const __m512 extentY = _mm512_loadu_ps(bounds.GetExtentY() + i);
+        const __m512 extentZ = _mm512_loadu_ps(bounds.GetExtentZ() + i);
+        const __m512 radius = _mm512_loadu_ps(bounds.GetRadius() + i);
+
+        __mmask16 visible = 0xFFFF;
+        for (int p = 0; p < 6; p++) {
+            const CullingPlane &plane = planes[p];
+            __m512 distance = _mm512_fmadd_ps(_mm512_set1_ps(plane.NormalX), centerX, _mm512_set1_ps(plane.Distance));
+            distance = _mm512_fmadd_ps(_mm512_set1_ps(plane.NormalY), centerY, distance);
+            distance = _mm512_fmadd_ps(_mm512_set1_ps(plane.NormalZ), centerZ, distance);
+            __m512 extent = _mm512_mul_ps(_mm512_set1_ps(plane.AbsNormalX), extentX);
+            extent = _mm512_fmadd_ps(_mm512_set1_ps(plane.AbsNormalY), extentY, extent);
+            extent = _mm512_fmadd_ps(_mm512_set1_ps(plane.AbsNormalZ), extentZ, extent);
+            visible = _mm512_mask_cmp_ps_mask(visible, _mm512_add_ps(distance, _mm512_min_ps(extent, radius)), _mm512_setzero_ps(), _CMP_GE_OQ);
+        }
+        numVisible = CompactMask(visible, i, visibleIndices, numVisible);
+    }
+    return numVisible;
+}
+
+#endif
+
+#ifdef CULLING_NEON
+
+static uint32_t CullNeon(const CullingBounds &bounds, const CullingPlane planes[6], uint32_t *visibleIndices) {
+    static const uint32_t laneBits[4] = {1, 2, 4, 8};
+    const uint32x4_t laneMask = vld1q_u32(laneBits);
+
+    uint32_t numVisible = 0;
+    const uint32_t paddedCount = bounds.GetPaddedCount();
+    for (uint32_t i = 0; i < paddedCount; i += 4) {
+        const float32x4_t centerX = vld1q_f32(bounds.GetCenterX() + i);
+        const float32x4_t centerY = vld1q_f32(bounds.GetCenterY() + i);
+        const float32x4_t centerZ = vld1q_f32(bounds.GetCenterZ() + i);
+        const float32x4_t extentX = vld1q_f32(bounds.GetExtentX() + i);
+        const float32x4_t extentY = vld1q_f32(bounds.GetExtentY() + i);
+        const float32x4_t extentZ = vld1q_f32(bounds.GetExtentZ() + i);
+        const float32x4_t radius = vld1q_f32(bounds.GetRadius() + i);
+
+        uint32x4_t visible = vdupq_n_u32(0xFFFFFFFF);
+        for (int p = 0; p < 6; p++) {
+            const CullingPlane &plane = planes[p];
+            float32x4_t distance = vfmaq_n_f32(vdupq_n_f32(plane.Distance), centerX, plane.NormalX);
+            distance = vfmaq_n_f32(distance, centerY, plane.NormalY);
+            distance = vfmaq_n_f32(distance, centerZ, plane.NormalZ);
+            float32x4_t extent = vmulq_n_f32(extentX, plane.AbsNormalX);
+            extent = vfmaq_n_f32(extent, extentY, plane.AbsNormalY);
+            extent = vfmaq_n_f32(extent, extentZ, plane.AbsNormalZ);
+            const uint32x4_t inside = vcgeq_f32(vaddq_f32(distance, vminq_f32(extent, radius)), vdupq_n_f32(0.0f));
+            visible = vandq_u32(visible, inside);
+        }
+        numVisible = CompactMask(vaddvq_u32(vandq_u32(visible, laneMask)), i, visibleIndices, numVisible);
+    }
+    return numVisible;
+}
+
+#endif
+
+uint32_t CullBounds(const CullingBounds &bounds, const Frustum &frustum, uint32_t *visibleIndices, CullingIsa isa) {
+    CullingPlane planes[6];
+    GetCullingPlanes(frustum, planes);
+
+    switch (isa) {
+#ifdef CULLING_X86
+    case CullingIsa::Sse:
+        return CullSse(bounds, planes, visibleIndices);
+    case CullingIsa::Avx2:
+        return CullAvx2(bounds, planes, visibleIndices);
+    case CullingIsa::Avx512:
+        return CullAvx512(bounds, planes, visibleIndices);
+#endif
+#ifdef CULLING_NEON
+    case CullingIsa::Neon:
+        return CullNeon(bounds, planes, visibleIndices);
+#endif
+    default:
+        return CullScalar(bounds, planes, visibleIndices);
+    }
+}
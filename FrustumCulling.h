@@ -0,0 +1,81 @@
+//
+// Created by andyroiiid on 12/27/2022.
+//
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "Frustum.h"
+
+// Structure of arrays bounding volumes for CPU culling.
+// Every object has both a box (center + half extent) and a sphere (same center + radius),
+// it is culled when either of them is outside, so pass radius = length(extent) for box only objects
+// and extent = vec3(radius) for sphere only objects.
+// The arrays are padded with NaN to a multiple of Padding so that the SIMD kernels need no tail loop.
+class CullingBounds {
+public:
+    static constexpr uint32_t Padding = 16;
+
+    void Clear();
+
+    void Reserve(uint32_t count);
+
+    uint32_t Add(const glm::vec3 &center, const glm::vec3 &extent, float radius);
+
+    uint32_t AddSphere(const glm::vec3 &center, float radius) {
+        return Add(center, glm::vec3(radius), radius);
+    }
+
+    uint32_t AddAabb(const glm::vec3 &min, const glm::vec3 &max);
+
+    void Set(uint32_t index, const glm::vec3 &center, const glm::vec3 &extent, float radius);
+
+    [[nodiscard]] uint32_t GetCount() const { return m_count; }
+
+    [[nodiscard]] uint32_t GetPaddedCount() const { return static_cast<uint32_t>(m_radius.size()); }
+
+    [[nodiscard]] const float *GetCenterX() const { return m_centerX.data(); }
+
+    [[nodiscard]] const float *GetCenterY() const { return m_centerY.data(); }
+
+    [[nodiscard]] const float *GetCenterZ() const { return m_centerZ.data(); }
+
+    [[nodiscard]] const float *GetExtentX() const { return m_extentX.data(); }
+
+    [[nodiscard]] const float *GetExtentY() const { return m_extentY.data(); }
+
+    [[nodiscard]] const float *GetExtentZ() const { return m_extentZ.data(); }
+
+    [[nodiscard]] const float *GetRadius() const { return m_radius.data(); }
+
+private:
+    uint32_t m_count = 0;
+    std::vector<float> m_centerX;
+    std::vector<float> m_centerY;
+    std::vector<float> m_centerZ;
+    std::vector<float> m_extentX;
+    std::vector<float> m_extentY;
+    std::vector<float> m_extentZ;
+    std::vector<float> m_radius;
+};
+
+enum class CullingIsa {
+    Scalar,
+    Sse,
+    Avx2,
+    Avx512,
+    Neon
+};
+
+const char *GetCullingIsaName(CullingIsa isa);
+
+bool IsCullingIsaSupported(CullingIsa isa);
+
+// detected once at startup
+CullingIsa GetBestCullingIsa();
+
+// Writes the indices of the objects that intersect the frustum in ascending order and returns how many there are.
+// visibleIndices must have room for bounds.GetCount() entries.
+uint32_t CullBounds(const CullingBounds &bounds, const Frustum &frustum, uint32_t *visibleIndices, CullingIsa isa = GetBestCullingIsa());
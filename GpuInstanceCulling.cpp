@@ -0,0 +1,421 @@
+//
+// Created by andyroiiid on 12/26/2022.
+//
+
+#include "GpuInstanceCulling.h"
+
+#include "Debug.h"
+
+struct GpuObjectData {
+    glm::vec4 BoundingSphere;
+    uint32_t MeshIndex;
+    float ErrorScale;
+    uint32_t Padding[2];
+};
+
+struct GpuMeshData {
+    uint32_t FirstDrawSlot;
+    uint32_t LodCount;
+    float DrawDistance;
+    uint32_t Padding;
+    glm::vec4 LodErrors;
+};
+
+struct CullingConstantsData {
+    glm::vec4 FrustumPlanes[6];
+    glm::vec3 CameraPosition;
+    uint32_t ObjectCount;
+    float ProjectionScale;
+    float ErrorThreshold;
+    float Hysteresis;
+};
+
+GpuInstanceCulling::GpuInstanceCulling(VulkanBase *device)
+        : m_device(device) {
+    CreateDescriptorSetLayout();
+    CreatePipeline();
+}
+
+void GpuInstanceCulling::CreateDescriptorSetLayout() {
+    m_descriptorSetLayout = VulkanDescriptorSetLayout(
+            m_device,
+            {
+                    {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+                    {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+                    {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+                    {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+                    {4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+                    {5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+                    {6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT}
+            }
+    );
+}
+
+void GpuInstanceCulling::CreatePipeline() {
+    VulkanComputePipelineCreateInfo pipelineCreateInfo{};
+    pipelineCreateInfo.Device = m_device;
+    pipelineCreateInfo.DescriptorSetLayouts = {m_descriptorSetLayout.Get()};
+    pipelineCreateInfo.PushConstantSize = sizeof(CullingConstantsData);
+    pipelineCreateInfo.Source = R"GLSL(
+#version 450 core
+
+layout (local_size_x_id = 0, local_size_y_id = 1, local_size_z_id = 2) in;
+
+struct Instance {
+    mat4 Model;
+    vec4 Color;
+};
+
+struct Object {
+    vec4 BoundingSphere;
+    uint MeshIndex;
+    float ErrorScale;
+};
+
+struct Mesh {
+    uint FirstDrawSlot;
+    uint LodCount;
+    float DrawDistance;
+    vec4 LodErrors;
+};
+
+struct DrawCommand {
+    uint IndexCount;
+    uint InstanceCount;
+    uint FirstIndex;
+    int VertexOffset;
+    uint FirstInstance;
+};
+
+layout (std430, set = 0, binding = 0) readonly buffer Instances {
+    Instance uInstances[];
+};
+
+layout (std430, set = 0, binding = 1) readonly buffer Objects {
+    Object uObjects[];
+};
+
+layout (std430, set = 0, binding = 2) readonly buffer Meshes {
+    Mesh uMeshes[];
+};
+
+layout (std430, set = 0, binding = 3) readonly buffer DrawSlotBases {
+    uint uDrawSlotBases[];
+};
+
+layout (std430, set = 0, binding = 4) buffer DrawCommands {
+    DrawCommand uDrawCommands[];
+};
+
+layout (std430, set = 0, binding = 5) writeonly buffer VisibleInstances {
+    Instance uVisibleInstances[];
+};
+
+layout (std430, set = 0, binding = 6) buffer LodStates {
+    uint uLodStates[];
+};
+
+layout (push_constant) uniform CullingConstantsData
+{
+    vec4 uFrustumPlanes[6];
+    vec3 uCameraPosition;
+    uint uObjectCount;
+    float uProjectionScale;
+    float uErrorThreshold;
+    float uHysteresis;
+};
+
+void main()
+{
+    uint objectIndex = gl_GlobalInvocationID.x;
+    if (objectIndex >= uObjectCount) {
+        return;
+    }
+
+    Object object = uObjects[objectIndex];
+    vec3 center = object.BoundingSphere.xyz;
+    float radius = object.BoundingSphere.w;
+    for (int i = 0; i < 6; i++) {
+        if (dot(uFrustumPlanes[i].xyz, center) + uFrustumPlanes[i].w < -radius) {
+            return;
+        }
+    }
+
+    Mesh mesh = uMeshes[object.MeshIndex];
+    float distance = max(length(center - uCameraPosition) - radius, 0.0);
+    if (distance > mesh.DrawDistance) {
+        return;
+    }
+
+    // same as SelectLod in MeshLod.cpp
+    float pixelsPerUnit = uProjectionScale * object.ErrorScale / max(distance, 1e-4);
+    uint previousLod = uLodStates[objectIndex];
+    uint lod = 0;
+    while (lod + 1 < mesh.LodCount) {
+        float threshold = lod + 1 > previousLod ? uErrorThreshold * (1 - uHysteresis) : uErrorThreshold;
+        if (mesh.LodErrors[lod + 1] * pixelsPerUnit > threshold) {
+            break;
+        }
+        lod++;
+    }
+    uLodStates[objectIndex] = lod;
+
+    uint drawSlot = mesh.FirstDrawSlot + lod;
+    uint visibleIndex = atomicAdd(uDrawCommands[drawSlot].InstanceCount, 1);
+    uVisibleInstances[uDrawSlotBases[drawSlot] + visibleIndex] = uInstances[objectIndex];
+}
+)GLSL";
+    pipelineCreateInfo.LocalSize[0] = 256;
+    m_pipeline = VulkanComputePipeline(pipelineCreateInfo);
+}
+
+void GpuInstanceCulling::SetScene(
+        const std::vector<GpuCullingMesh> &meshes,
+        const std::vector<GpuCullingObject> &objects,
+        const std::vector<InstanceBase> &instances
+) {
+    ReleaseScene();
+
+    DebugCheckCritical(objects.size() == instances.size(), "GPU culling needs one object per instance.");
+    if (objects.empty()) {
+        return;
+    }
+
+    // every LOD of a mesh gets a draw slot that can hold all instances of that mesh
+    std::vector<uint32_t> instancesPerMesh(meshes.size(), 0);
+    for (const GpuCullingObject &object: objects) {
+        instancesPerMesh[object.MeshIndex]++;
+    }
+
+    const bool firstInstanceSupported = m_device->GetEnabledFeatures().drawIndirectFirstInstance;
+    std::vector<GpuMeshData> meshData;
+    std::vector<VkDrawIndexedIndirectCommand> drawCommands;
+    uint32_t visibleInstanceCapacity = 0;
+    for (size_t i = 0; i < meshes.size(); i++) {
+        const GpuCullingMesh &mesh = meshes[i];
+        DebugCheckCritical(
+                !mesh.Lods.empty() && mesh.Lods.size() <= MaxLods && mesh.Lods.size() == mesh.LodErrors.size(),
+                "Invalid LODs for GPU culling mesh {}.", i
+        );
+
+        GpuMeshData &data = meshData.emplace_back();
+        data.FirstDrawSlot = drawCommands.size();
+        data.LodCount = mesh.Lods.size();
+        data.DrawDistance = mesh.DrawDistance;
+        for (uint32_t lod = 0; lod < data.LodCount; lod++) {
+            data.LodErrors[static_cast<int>(lod)] = mesh.LodErrors[lod];
+
+            m_drawSlotBases.push_back(visibleInstanceCapacity);
+            VkDrawIndexedIndirectCommand &command = drawCommands.emplace_back();
+            command.indexCount = mesh.Lods[lod].IndexCount;
+            command.instanceCount = 0;
+            command.firstIndex = mesh.Lods[lod].FirstIndex;
+            command.vertexOffset = mesh.Lods[lod].VertexOffset;
+            // without drawIndirectFirstInstance the instance buffer is offset per draw instead
+            command.firstInstance = firstInstanceSupported ? visibleInstanceCapacity : 0;
+            visibleInstanceCapacity += instancesPerMesh[i];
+        }
+    }
+
+    std::vector<GpuObjectData> objectData;
+    objectData.reserve(objects.size());
+    for (const GpuCullingObject &object: objects) {
+        GpuObjectData &data = objectData.emplace_back();
+        data.BoundingSphere = object.BoundingSphere;
+        data.MeshIndex = object.MeshIndex;
+        data.ErrorScale = object.ErrorScale;
+    }
+
+    m_objectCount = objects.size();
+    m_drawSlotCount = drawCommands.size();
+
+    m_instanceBuffer = m_device->CreateBufferWithData(
+            instances.size() * sizeof(InstanceBase), instances.data(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+    );
+    m_objectBuffer = m_device->CreateBufferWithData(
+            objectData.size() * sizeof(GpuObjectData), objectData.data(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+    );
+    m_meshBuffer = m_device->CreateBufferWithData(
+            meshData.size() * sizeof(GpuMeshData), meshData.data(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+    );
+    m_drawSlotBaseBuffer = m_device->CreateBufferWithData(
+            m_drawSlotBases.size() * sizeof(uint32_t), m_drawSlotBases.data(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+    );
+    m_drawCommandTemplateBuffer = m_device->CreateBufferWithData(
+            drawCommands.size() * sizeof(VkDrawIndexedIndirectCommand), drawCommands.data(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+    );
+    const std::vector<uint32_t> lodStates(m_objectCount, 0);
+    m_lodStateBuffer = m_device->CreateBufferWithData(
+            lodStates.size() * sizeof(uint32_t), lodStates.data(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+    );
+
+    m_bufferingObjects.resize(m_device->GetNumBuffering());
+    for (BufferingObjects &bufferingObjects: m_bufferingObjects) {
+        bufferingObjects.DrawCommandBuffer = m_device->CreateBuffer(
+                drawCommands.size() * sizeof(VkDrawIndexedIndirectCommand),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                0,
+                VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
+        );
+        bufferingObjects.VisibleInstanceBuffer = m_device->CreateBuffer(
+                visibleInstanceCapacity * sizeof(InstanceBase),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                0,
+                VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
+        );
+        bufferingObjects.DescriptorSet = m_descriptorSetLayout.AllocateDescriptorSet();
+
+        const VkBuffer buffers[] = {
+                m_instanceBuffer.Get(),
+                m_objectBuffer.Get(),
+                m_meshBuffer.Get(),
+                m_drawSlotBaseBuffer.Get(),
+                bufferingObjects.DrawCommandBuffer.Get(),
+                bufferingObjects.VisibleInstanceBuffer.Get(),
+                m_lodStateBuffer.Get()
+        };
+        for (uint32_t binding = 0; binding < 7; binding++) {
+            VkDescriptorBufferInfo bufferInfo{};
+            bufferInfo.buffer = buffers[binding];
+            bufferInfo.offset = 0;
+            bufferInfo.range = VK_WHOLE_SIZE;
+
+            VkWriteDescriptorSet writeDescriptorSet{};
+            writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writeDescriptorSet.dstSet = bufferingObjects.DescriptorSet;
+            writeDescriptorSet.dstBinding = binding;
+            writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writeDescriptorSet.descriptorCount = 1;
+            writeDescriptorSet.pBufferInfo = &bufferInfo;
+
+            m_device->WriteDescriptorSet(writeDescriptorSet);
+        }
+    }
+}
+
+void GpuInstanceCulling::Cull(VkCommandBuffer commandBuffer, uint32_t bufferingIndex, const Frustum &frustum, const glm::vec3 &cameraPosition, const LodSelection &lodSelection) {
+    if (m_objectCount == 0) {
+        return;
+    }
+
+    BufferingObjects &bufferingObjects = m_bufferingObjects[bufferingIndex];
+
+    // reset instance counts
+    VkBufferCopy copy{};
+    copy.srcOffset = 0;
+    copy.dstOffset = 0;
+    copy.size = m_drawSlotCount * sizeof(VkDrawIndexedIndirectCommand);
+    vkCmdCopyBuffer(commandBuffer, m_drawCommandTemplateBuffer.Get(), bufferingObjects.DrawCommandBuffer.Get(), 1, &copy);
+    CmdBufferBarrier(
+            commandBuffer,
+            bufferingObjects.DrawCommandBuffer.Get(),
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+    );
+    // last frame's LOD choices
+    CmdBufferBarrier(
+            commandBuffer,
+            m_lodStateBuffer.Get(),
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+    );
+
+    CullingConstantsData constantsData{};
+    for (int i = 0; i < 6; i++) {
+        constantsData.FrustumPlanes[i] = frustum.Planes[i];
+    }
+    constantsData.CameraPosition = cameraPosition;
+    constantsData.ObjectCount = m_objectCount;
+    constantsData.ProjectionScale = lodSelection.ProjectionScale;
+    constantsData.ErrorThreshold = lodSelection.ErrorThreshold;
+    constantsData.Hysteresis = lodSelection.Hysteresis;
+
+    m_pipeline.Bind(commandBuffer);
+    m_pipeline.BindDescriptorSet(commandBuffer, bufferingObjects.DescriptorSet, 0);
+    m_pipeline.PushConstants(commandBuffer, constantsData);
+    m_pipeline.DispatchForSize(commandBuffer, m_objectCount);
+
+    CmdBufferBarrier(
+            commandBuffer,
+            bufferingObjects.DrawCommandBuffer.Get(),
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+            VK_ACCESS_INDIRECT_COMMAND_READ_BIT
+    );
+    CmdBufferBarrier(
+            commandBuffer,
+            bufferingObjects.VisibleInstanceBuffer.Get(),
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT
+    );
+}
+
+void GpuInstanceCulling::Draw(VkCommandBuffer commandBuffer, uint32_t bufferingIndex, VulkanMesh &mesh) {
+    if (m_objectCount == 0) {
+        return;
+    }
+
+    BufferingObjects &bufferingObjects = m_bufferingObjects[bufferingIndex];
+
+    if (m_device->GetEnabledFeatures().drawIndirectFirstInstance) {
+        mesh.BindInstanced(commandBuffer, bufferingObjects.VisibleInstanceBuffer.Get());
+        m_device->CmdDrawIndexedIndirect(commandBuffer, bufferingObjects.DrawCommandBuffer.Get(), 0, m_drawSlotCount);
+        return;
+    }
+
+    for (uint32_t drawSlot = 0; drawSlot < m_drawSlotCount; drawSlot++) {
+        mesh.BindInstanced(commandBuffer, bufferingObjects.VisibleInstanceBuffer.Get(), m_drawSlotBases[drawSlot] * sizeof(InstanceBase));
+        m_device->CmdDrawIndexedIndirect(commandBuffer, bufferingObjects.DrawCommandBuffer.Get(), drawSlot * sizeof(VkDrawIndexedIndirectCommand), 1);
+    }
+}
+
+void GpuInstanceCulling::ReleaseScene() {
+    for (BufferingObjects &bufferingObjects: m_bufferingObjects) {
+        m_device->FreeDescriptorSet(bufferingObjects.DescriptorSet);
+    }
+    m_bufferingObjects.clear();
+
+    m_objectCount = 0;
+    m_drawSlotCount = 0;
+    m_drawSlotBases.clear();
+
+    m_instanceBuffer = {};
+    m_objectBuffer = {};
+    m_meshBuffer = {};
+    m_drawSlotBaseBuffer = {};
+    m_drawCommandTemplateBuffer = {};
+    m_lodStateBuffer = {};
+}
+
+void GpuInstanceCulling::Release() {
+    if (m_device) {
+        ReleaseScene();
+    }
+
+    m_device = nullptr;
+    m_pipeline = {};
+    m_descriptorSetLayout = {};
+}
+
+void GpuInstanceCulling::Swap(GpuInstanceCulling &other) noexcept {
+    std::swap(m_device, other.m_device);
+    std::swap(m_descriptorSetLayout, other.m_descriptorSetLayout);
+    std::swap(m_pipeline, other.m_pipeline);
+    std::swap(m_objectCount, other.m_objectCount);
+    std::swap(m_drawSlotCount, other.m_drawSlotCount);
+    std::swap(m_drawSlotBases, other.m_drawSlotBases);
+    std::swap(m_instanceBuffer, other.m_instanceBuffer);
+    std::swap(m_objectBuffer, other.m_objectBuffer);
+    std::swap(m_meshBuffer, other.m_meshBuffer);
+    std::swap(m_drawSlotBaseBuffer, other.m_drawSlotBaseBuffer);
+    std::swap(m_drawCommandTemplateBuffer, other.m_drawCommandTemplateBuffer);
+    std::swap(m_lodStateBuffer, other.m_lodStateBuffer);
+    std::swap(m_bufferingObjects, other.m_bufferingObjects);
+}
@@ -0,0 +1,111 @@
+//
+// Created by andyroiiid on 12/26/2022.
+//
+
+#pragma once
+
+#include "VulkanBase.h"
+#include "VulkanMesh.h"
+#include "VulkanDescriptorSetLayout.h"
+#include "VulkanComputePipeline.h"
+#include "VertexBase.h"
+#include "Frustum.h"
+#include "MeshLod.h"
+
+struct GpuCullingMesh {
+    // finest first, at most GpuInstanceCulling::MaxLods
+    std::vector<VulkanSubMesh> Lods;
+    // geometric error of every LOD in mesh units, see MeshLod
+    std::vector<float> LodErrors;
+    // instances further than this from the camera are culled
+    float DrawDistance = 4000.0f;
+};
+
+struct GpuCullingObject {
+    // world space center and radius
+    glm::vec4 BoundingSphere;
+    uint32_t MeshIndex;
+    // uniform scale of the instance, converts the mesh LOD errors to world units
+    float ErrorScale = 1.0f;
+};
+
+// Frustum culls and LOD selects every instance in a compute pass.
+// The LOD comes from the projected screen space error, the LOD of every instance is kept on the GPU for hysteresis.
+// Survivors are appended to per LOD indirect commands with atomics and compacted into an instance buffer
+// that is bound to vertex binding 1, so the CPU only records one dispatch and one indirect batch per frame.
+class GpuInstanceCulling {
+public:
+    static constexpr uint32_t MaxLods = 4;
+
+    GpuInstanceCulling() = default;
+
+    explicit GpuInstanceCulling(VulkanBase *device);
+
+    ~GpuInstanceCulling() {
+        Release();
+    }
+
+    GpuInstanceCulling(const GpuInstanceCulling &) = delete;
+
+    GpuInstanceCulling &operator=(const GpuInstanceCulling &) = delete;
+
+    GpuInstanceCulling(GpuInstanceCulling &&other) noexcept {
+        Swap(other);
+    }
+
+    GpuInstanceCulling &operator=(GpuInstanceCulling &&other) noexcept {
+        if (this != &other) {
+            Release();
+            Swap(other);
+        }
+        return *this;
+    }
+
+    void Release();
+
+    void Swap(GpuInstanceCulling &other) noexcept;
+
+    // objects[i] is the bounding volume of instances[i], the device must be idle
+    void SetScene(
+            const std::vector<GpuCullingMesh> &meshes,
+            const std::vector<GpuCullingObject> &objects,
+            const std::vector<InstanceBase> &instances
+    );
+
+    // must be recorded outside of a render pass
+    void Cull(VkCommandBuffer commandBuffer, uint32_t bufferingIndex, const Frustum &frustum, const glm::vec3 &cameraPosition, const LodSelection &lodSelection);
+
+    // the graphics pipeline must already be bound, binds the mesh and the culled instances
+    void Draw(VkCommandBuffer commandBuffer, uint32_t bufferingIndex, VulkanMesh &mesh);
+
+private:
+    void CreateDescriptorSetLayout();
+
+    void CreatePipeline();
+
+    void ReleaseScene();
+
+    VulkanBase *m_device = nullptr;
+
+    VulkanDescriptorSetLayout m_descriptorSetLayout;
+    VulkanComputePipeline m_pipeline;
+
+    uint32_t m_objectCount = 0;
+    uint32_t m_drawSlotCount = 0;
+    std::vector<uint32_t> m_drawSlotBases;
+
+    VulkanBuffer m_instanceBuffer;
+    VulkanBuffer m_objectBuffer;
+    VulkanBuffer m_meshBuffer;
+    VulkanBuffer m_drawSlotBaseBuffer;
+    VulkanBuffer m_drawCommandTemplateBuffer;
+    // the LOD picked for every instance last frame, shared by all buffering slots
+    VulkanBuffer m_lodStateBuffer;
+
+    struct BufferingObjects {
+        VulkanBuffer DrawCommandBuffer;
+        VulkanBuffer VisibleInstanceBuffer;
+        VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+    };
+    std::vector<BufferingObjects> m_bufferingObjects;
+};
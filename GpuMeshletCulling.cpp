@@ -0,0 +1,385 @@
+//
+// Created by andyroiiid on 12/28/2022.
+//
+
+#include "GpuMeshletCulling.h"
+
+#include "Debug.h"
+
+struct GpuMeshletData {
+    glm::vec4 BoundingSphere;
+    glm::vec4 Cone;
+    uint32_t FirstIndex;
+    uint32_t IndexCount;
+    int32_t VertexOffset;
+    uint32_t Padding;
+};
+
+struct GpuClusterData {
+    uint32_t InstanceIndex;
+    uint32_t MeshletIndex;
+};
+
+static constexpr uint32_t CullingFlagCompact = 1;
+static constexpr uint32_t CullingFlagFirstInstance = 2;
+
+struct MeshletCullingConstantsData {
+    glm::vec4 FrustumPlanes[6];
+    glm::vec3 CameraPosition;
+    uint32_t ClusterCount;
+    uint32_t Flags;
+};
+
+GpuMeshletCulling::GpuMeshletCulling(VulkanBase *device)
+        : m_device(device) {
+    // compaction writes draws to arbitrary slots, so the instance has to come from firstInstance
+    m_compact = m_device->GetEnabledVulkan12Features().drawIndirectCount && m_device->GetEnabledFeatures().drawIndirectFirstInstance;
+    CreateDescriptorSetLayout();
+    CreatePipeline();
+}
+
+void GpuMeshletCulling::CreateDescriptorSetLayout() {
+    m_descriptorSetLayout = VulkanDescriptorSetLayout(
+            m_device,
+            {
+                    {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+                    {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+                    {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+                    {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+                    {4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT}
+            }
+    );
+}
+
+void GpuMeshletCulling::CreatePipeline() {
+    VulkanComputePipelineCreateInfo pipelineCreateInfo{};
+    pipelineCreateInfo.Device = m_device;
+    pipelineCreateInfo.DescriptorSetLayouts = {m_descriptorSetLayout.Get()};
+    pipelineCreateInfo.PushConstantSize = sizeof(MeshletCullingConstantsData);
+    pipelineCreateInfo.Source = R"GLSL(
+#version 450 core
+
+layout (local_size_x_id = 0, local_size_y_id = 1, local_size_z_id = 2) in;
+
+struct Instance {
+    mat4 Model;
+    vec4 Color;
+};
+
+struct Meshlet {
+    vec4 BoundingSphere;
+    vec4 Cone;
+    uint FirstIndex;
+    uint IndexCount;
+    int VertexOffset;
+};
+
+struct Cluster {
+    uint InstanceIndex;
+    uint MeshletIndex;
+};
+
+struct DrawCommand {
+    uint IndexCount;
+    uint InstanceCount;
+    uint FirstIndex;
+    int VertexOffset;
+    uint FirstInstance;
+};
+
+layout (std430, set = 0, binding = 0) readonly buffer Instances {
+    Instance uInstances[];
+};
+
+layout (std430, set = 0, binding = 1) readonly buffer Meshlets {
+    Meshlet uMeshlets[];
+};
+
+layout (std430, set = 0, binding = 2) readonly buffer Clusters {
+    Cluster uClusters[];
+};
+
+layout (std430, set = 0, binding = 3) writeonly buffer DrawCommands {
+    DrawCommand uDrawCommands[];
+};
+
+layout (std430, set = 0, binding = 4) buffer DrawCount {
+    uint uDrawCount;
+};
+
+layout (push_constant) uniform MeshletCullingConstantsData
+{
+    vec4 uFrustumPlanes[6];
+    vec3 uCameraPosition;
+    uint uClusterCount;
+    uint uFlags;
+};
+
+const uint FLAG_COMPACT = 1;
+const uint FLAG_FIRST_INSTANCE = 2;
+
+void main()
+{
+    uint clusterIndex = gl_GlobalInvocationID.x;
+    if (clusterIndex >= uClusterCount) {
+        return;
+    }
+
+    Cluster cluster = uClusters[clusterIndex];
+    Meshlet meshlet = uMeshlets[cluster.MeshletIndex];
+    mat4 model = uInstances[cluster.InstanceIndex].Model;
+
+    vec3 center = (model * vec4(meshlet.BoundingSphere.xyz, 1)).xyz;
+    float scale = max(length(model[0].xyz), max(length(model[1].xyz), length(model[2].xyz)));
+    float radius = meshlet.BoundingSphere.w * scale;
+
+    bool visible = true;
+    for (int i = 0; i < 6; i++) {
+        visible = visible && dot(uFrustumPlanes[i].xyz, center) + uFrustumPlanes[i].w >= -radius;
+    }
+
+    // a cutoff of 1 marks meshlets whose normals are spread too wide to cull
+    if (visible && meshlet.Cone.w < 1) {
+        vec3 axis = normalize(mat3(model) * meshlet.Cone.xyz);
+        vec3 view = center - uCameraPosition;
+        visible = dot(view, axis) < meshlet.Cone.w * length(view) + radius;
+    }
+
+    DrawCommand command;
+    command.IndexCount = meshlet.IndexCount;
+    command.InstanceCount = visible ? 1 : 0;
+    command.FirstIndex = meshlet.FirstIndex;
+    command.VertexOffset = meshlet.VertexOffset;
+    // without drawIndirectFirstInstance the instance buffer is offset per object instead
+    command.FirstInstance = (uFlags & FLAG_FIRST_INSTANCE) != 0 ? cluster.InstanceIndex : 0;
+
+    if ((uFlags & FLAG_COMPACT) == 0) {
+        uDrawCommands[clusterIndex] = command;
+    } else if (visible) {
+        uDrawCommands[atomicAdd(uDrawCount, 1)] = command;
+    }
+}
+)GLSL";
+    pipelineCreateInfo.LocalSize[0] = 256;
+    m_pipeline = VulkanComputePipeline(pipelineCreateInfo);
+}
+
+void GpuMeshletCulling::SetScene(
+        const std::vector<Meshlet> &meshlets,
+        int32_t vertexOffset,
+        const std::vector<GpuMeshletObject> &objects,
+        const std::vector<InstanceBase> &instances
+) {
+    ReleaseScene();
+
+    DebugCheckCritical(objects.size() == instances.size(), "Meshlet culling needs one object per instance.");
+
+    std::vector<GpuClusterData> clusterData;
+    m_objectClusterOffsets.reserve(objects.size() + 1);
+    for (size_t i = 0; i < objects.size(); i++) {
+        const GpuMeshletObject &object = objects[i];
+        DebugCheckCritical(object.FirstMeshlet + object.MeshletCount <= meshlets.size(), "Meshlet range of object {} is out of bounds.", i);
+
+        m_objectClusterOffsets.push_back(clusterData.size());
+        for (uint32_t j = 0; j < object.MeshletCount; j++) {
+            clusterData.push_back({static_cast<uint32_t>(i), object.FirstMeshlet + j});
+        }
+    }
+    m_objectClusterOffsets.push_back(clusterData.size());
+
+    m_clusterCount = clusterData.size();
+    if (m_clusterCount == 0) {
+        return;
+    }
+
+    std::vector<GpuMeshletData> meshletData;
+    meshletData.reserve(meshlets.size());
+    for (const Meshlet &meshlet: meshlets) {
+        GpuMeshletData &data = meshletData.emplace_back();
+        data.BoundingSphere = glm::vec4(meshlet.Center, meshlet.Radius);
+        data.Cone = glm::vec4(meshlet.ConeAxis, meshlet.ConeCutoff);
+        data.FirstIndex = meshlet.FirstIndex;
+        data.IndexCount = meshlet.IndexCount;
+        data.VertexOffset = vertexOffset;
+    }
+
+    m_instanceBuffer = m_device->CreateBufferWithData(
+            instances.size() * sizeof(InstanceBase), instances.data(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+    );
+    m_meshletBuffer = m_device->CreateBufferWithData(
+            meshletData.size() * sizeof(GpuMeshletData), meshletData.data(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+    );
+    m_clusterBuffer = m_device->CreateBufferWithData(
+            clusterData.size() * sizeof(GpuClusterData), clusterData.data(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+    );
+
+    m_bufferingObjects.resize(m_device->GetNumBuffering());
+    for (BufferingObjects &bufferingObjects: m_bufferingObjects) {
+        bufferingObjects.DrawCommandBuffer = m_device->CreateBuffer(
+                m_clusterCount * sizeof(VkDrawIndexedIndirectCommand),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                0,
+                VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
+        );
+        bufferingObjects.DrawCountBuffer = m_device->CreateBuffer(
+                sizeof(uint32_t),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                0,
+                VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
+        );
+        bufferingObjects.DescriptorSet = m_descriptorSetLayout.AllocateDescriptorSet();
+
+        const VkBuffer buffers[] = {
+                m_instanceBuffer.Get(),
+                m_meshletBuffer.Get(),
+                m_clusterBuffer.Get(),
+                bufferingObjects.DrawCommandBuffer.Get(),
+                bufferingObjects.DrawCountBuffer.Get()
+        };
+        for (uint32_t binding = 0; binding < 5; binding++) {
+            VkDescriptorBufferInfo bufferInfo{};
+            bufferInfo.buffer = buffers[binding];
+            bufferInfo.offset = 0;
+            bufferInfo.range = VK_WHOLE_SIZE;
+
+            VkWriteDescriptorSet writeDescriptorSet{};
+            writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writeDescriptorSet.dstSet = bufferingObjects.DescriptorSet;
+            writeDescriptorSet.dstBinding = binding;
+            writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writeDescriptorSet.descriptorCount = 1;
+            writeDescriptorSet.pBufferInfo = &bufferInfo;
+
+            m_device->WriteDescriptorSet(writeDescriptorSet);
+        }
+    }
+}
+
+void GpuMeshletCulling::Cull(VkCommandBuffer commandBuffer, uint32_t bufferingIndex, const Frustum &frustum, const glm::vec3 &cameraPosition) {
+    if (m_clusterCount == 0) {
+        return;
+    }
+
+    BufferingObjects &bufferingObjects = m_bufferingObjects[bufferingIndex];
+
+    if (m_compact) {
+        vkCmdFillBuffer(commandBuffer, bufferingObjects.DrawCountBuffer.Get(), 0, sizeof(uint32_t), 0);
+        CmdBufferBarrier(
+                commandBuffer,
+                bufferingObjects.DrawCountBuffer.Get(),
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+        );
+    }
+
+    MeshletCullingConstantsData constantsData{};
+    for (int i = 0; i < 6; i++) {
+        constantsData.FrustumPlanes[i] = frustum.Planes[i];
+    }
+    constantsData.CameraPosition = cameraPosition;
+    constantsData.ClusterCount = m_clusterCount;
+    constantsData.Flags = 0;
+    if (m_compact) {
+        constantsData.Flags |= CullingFlagCompact;
+    }
+    if (m_device->GetEnabledFeatures().drawIndirectFirstInstance) {
+        constantsData.Flags |= CullingFlagFirstInstance;
+    }
+
+    m_pipeline.Bind(commandBuffer);
+    m_pipeline.BindDescriptorSet(commandBuffer, bufferingObjects.DescriptorSet, 0);
+    m_pipeline.PushConstants(commandBuffer, constantsData);
+    m_pipeline.DispatchForSize(commandBuffer, m_clusterCount);
+
+    CmdBufferBarrier(
+            commandBuffer,
+            bufferingObjects.DrawCommandBuffer.Get(),
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+            VK_ACCESS_INDIRECT_COMMAND_READ_BIT
+    );
+    if (m_compact) {
+        CmdBufferBarrier(
+                commandBuffer,
+                bufferingObjects.DrawCountBuffer.Get(),
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                VK_ACCESS_INDIRECT_COMMAND_READ_BIT
+        );
+    }
+}
+
+void GpuMeshletCulling::Draw(VkCommandBuffer commandBuffer, uint32_t bufferingIndex, VulkanMesh &mesh) {
+    if (m_clusterCount == 0) {
+        return;
+    }
+
+    BufferingObjects &bufferingObjects = m_bufferingObjects[bufferingIndex];
+
+    if (m_compact) {
+        mesh.BindInstanced(commandBuffer, m_instanceBuffer.Get());
+        m_device->CmdDrawIndexedIndirect(
+                commandBuffer,
+                bufferingObjects.DrawCommandBuffer.Get(), 0, m_clusterCount,
+                bufferingObjects.DrawCountBuffer.Get(), 0
+        );
+        return;
+    }
+
+    if (m_device->GetEnabledFeatures().drawIndirectFirstInstance) {
+        mesh.BindInstanced(commandBuffer, m_instanceBuffer.Get());
+        m_device->CmdDrawIndexedIndirect(commandBuffer, bufferingObjects.DrawCommandBuffer.Get(), 0, m_clusterCount);
+        return;
+    }
+
+    for (size_t object = 0; object + 1 < m_objectClusterOffsets.size(); object++) {
+        const uint32_t firstCluster = m_objectClusterOffsets[object];
+        const uint32_t clusterCount = m_objectClusterOffsets[object + 1] - firstCluster;
+        if (clusterCount == 0) {
+            continue;
+        }
+        mesh.BindInstanced(commandBuffer, m_instanceBuffer.Get(), object * sizeof(InstanceBase));
+        m_device->CmdDrawIndexedIndirect(commandBuffer, bufferingObjects.DrawCommandBuffer.Get(), firstCluster * sizeof(VkDrawIndexedIndirectCommand), clusterCount);
+    }
+}
+
+void GpuMeshletCulling::ReleaseScene() {
+    for (BufferingObjects &bufferingObjects: m_bufferingObjects) {
+        m_device->FreeDescriptorSet(bufferingObjects.DescriptorSet);
+    }
+    m_bufferingObjects.clear();
+
+    m_clusterCount = 0;
+    m_objectClusterOffsets.clear();
+
+    m_instanceBuffer = {};
+    m_meshletBuffer = {};
+    m_clusterBuffer = {};
+}
+
+void GpuMeshletCulling::Release() {
+    if (m_device) {
+        ReleaseScene();
+    }
+
+    m_device = nullptr;
+    m_pipeline = {};
+    m_descriptorSetLayout = {};
+}
+
+void GpuMeshletCulling::Swap(GpuMeshletCulling &other) noexcept {
+    std::swap(m_device, other.m_device);
+    std::swap(m_descriptorSetLayout, other.m_descriptorSetLayout);
+    std::swap(m_pipeline, other.m_pipeline);
+    std::swap(m_compact, other.m_compact);
+    std::swap(m_clusterCount, other.m_clusterCount);
+    std::swap(m_objectClusterOffsets, other.m_objectClusterOffsets);
+    std::swap(m_instanceBuffer, other.m_instanceBuffer);
+    std::swap(m_meshletBuffer, other.m_meshletBuffer);
+    std::swap(m_clusterBuffer, other.m_clusterBuffer);
+    std::swap(m_bufferingObjects, other.m_bufferingObjects);
+}
@@ -0,0 +1,99 @@
+//
+// Created by andyroiiid on 12/28/2022.
+//
+
+#pragma once
+
+#include "VulkanBase.h"
+#include "VulkanMesh.h"
+#include "VulkanDescriptorSetLayout.h"
+#include "VulkanComputePipeline.h"
+#include "VertexBase.h"
+#include "MeshletBuilder.h"
+#include "Frustum.h"
+
+// the meshlets of one instance, ranges into the meshlet list passed to GpuMeshletCulling::SetScene
+struct GpuMeshletObject {
+    uint32_t FirstMeshlet;
+    uint32_t MeshletCount;
+};
+
+// Frustum and normal cone culls every (instance, meshlet) cluster in a compute pass and writes one indexed indirect draw per cluster.
+// With drawIndirectCount the visible draws are compacted and counted on the GPU,
+// otherwise every cluster keeps its own slot and culled ones get an instance count of 0.
+// Instance transforms may rotate, translate and scale uniformly, the normal cone is not valid under non-uniform scale.
+class GpuMeshletCulling {
+public:
+    GpuMeshletCulling() = default;
+
+    explicit GpuMeshletCulling(VulkanBase *device);
+
+    ~GpuMeshletCulling() {
+        Release();
+    }
+
+    GpuMeshletCulling(const GpuMeshletCulling &) = delete;
+
+    GpuMeshletCulling &operator=(const GpuMeshletCulling &) = delete;
+
+    GpuMeshletCulling(GpuMeshletCulling &&other) noexcept {
+        Swap(other);
+    }
+
+    GpuMeshletCulling &operator=(GpuMeshletCulling &&other) noexcept {
+        if (this != &other) {
+            Release();
+            Swap(other);
+        }
+        return *this;
+    }
+
+    void Release();
+
+    void Swap(GpuMeshletCulling &other) noexcept;
+
+    // Meshlet::FirstIndex must already be relative to the index buffer of the mesh passed to Draw,
+    // vertexOffset is added to every draw, objects[i] belongs to instances[i], the device must be idle
+    void SetScene(
+            const std::vector<Meshlet> &meshlets,
+            int32_t vertexOffset,
+            const std::vector<GpuMeshletObject> &objects,
+            const std::vector<InstanceBase> &instances
+    );
+
+    // must be recorded outside of a render pass
+    void Cull(VkCommandBuffer commandBuffer, uint32_t bufferingIndex, const Frustum &frustum, const glm::vec3 &cameraPosition);
+
+    // the graphics pipeline must already be bound, binds the mesh and the instances
+    void Draw(VkCommandBuffer commandBuffer, uint32_t bufferingIndex, VulkanMesh &mesh);
+
+    [[nodiscard]] uint32_t GetClusterCount() const { return m_clusterCount; }
+
+private:
+    void CreateDescriptorSetLayout();
+
+    void CreatePipeline();
+
+    void ReleaseScene();
+
+    VulkanBase *m_device = nullptr;
+
+    VulkanDescriptorSetLayout m_descriptorSetLayout;
+    VulkanComputePipeline m_pipeline;
+
+    bool m_compact = false;
+    uint32_t m_clusterCount = 0;
+    // the clusters of object i are [m_objectClusterOffsets[i], m_objectClusterOffsets[i + 1])
+    std::vector<uint32_t> m_objectClusterOffsets;
+
+    VulkanBuffer m_instanceBuffer;
+    VulkanBuffer m_meshletBuffer;
+    VulkanBuffer m_clusterBuffer;
+
+    struct BufferingObjects {
+        VulkanBuffer DrawCommandBuffer;
+        VulkanBuffer DrawCountBuffer;
+        VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+    };
+    std::vector<BufferingObjects> m_bufferingObjects;
+};
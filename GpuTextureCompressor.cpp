@@ -0,0 +1,498 @@
+//
+// Created by andyroiiid on 1/3/2023.
+//
+
+#include "GpuTextureCompressor.h"
+
+#include <string>
+
+#include "Debug.h"
+#include "TextureFile.h"
+#include "VulkanTexture.h"
+
+struct CompressConstantsData {
+    int32_t Lod;
+    uint32_t BlocksX;
+    uint32_t BlocksY;
+    // where the mip starts in the block buffer
+    uint32_t FirstWord;
+};
+
+struct GpuCompressorFormat {
+    VkFormat Format;
+    const char *Encoder;
+    uint32_t BlockWords;
+};
+
+// same order as m_pipelines
+static constexpr GpuCompressorFormat GpuCompressorFormats[]{
+        {VK_FORMAT_BC1_RGB_UNORM_BLOCK, "EncodeBc1", 2},
+        {VK_FORMAT_BC5_UNORM_BLOCK,     "EncodeBc5", 4},
+        {VK_FORMAT_BC7_UNORM_BLOCK,     "EncodeBc7", 4},
+};
+
+static int FindGpuCompressorFormat(VkFormat format) {
+    for (int i = 0; i < 3; i++) {
+        if (GpuCompressorFormats[i].Format == format) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// compiled once per format with ENCODE_BLOCK and BLOCK_WORDS defined in front of it
+static const char *CompressorShaderSource = R"GLSL(
+layout (local_size_x_id = 0, local_size_y_id = 1, local_size_z_id = 2) in;
+
+layout (set = 0, binding = 0) uniform sampler2D uSource;
+
+layout (std430, set = 0, binding = 1) writeonly buffer Blocks {
+    uint uBlocks[];
+};
+
+layout (push_constant) uniform CompressConstantsData
+{
+    int uLod;
+    uint uBlocksX;
+    uint uBlocksY;
+    uint uFirstWord;
+};
+
+// 0 to 255 per channel
+vec4 texels[16];
+vec4 palette[16];
+uint indices[16];
+vec4 endpoint0;
+vec4 endpoint1;
+// the block is written from its lowest bit up
+uint words[4];
+uint bitPosition;
+
+void LoadTexels(uvec2 block) {
+    // edge blocks repeat the last row and column
+    ivec2 lastTexel = textureSize(uSource, uLod) - 1;
+    for (int i = 0; i < 16; i++) {
+        ivec2 coord = min(ivec2(block) * 4 + ivec2(i & 3, i >> 2), lastTexel);
+        texels[i] = floor(texelFetch(uSource, coord, uLod) * 255.0 + 0.5);
+    }
+}
+
+// value must fit in count bits
+void PutBits(uint value, uint count) {
+    uint word = bitPosition >> 5;
+    uint shift = bitPosition & 31u;
+    words[word] |= value << shift;
+    if (shift + count > 32u) {
+        words[word + 1u] |= value >> (32u - shift);
+    }
+    bitPosition += count;
+}
+
+// per channel minimum and maximum inset by 1/16 of the range,
+// channels that fall as the widest channel rises get their endpoints swapped
+void FindEndpoints(vec4 channelMask) {
+    vec4 minColor = texels[0];
+    vec4 maxColor = texels[0];
+    vec4 mean = vec4(0.0);
+    for (int i = 0; i < 16; i++) {
+        minColor = min(minColor, texels[i]);
+        maxColor = max(maxColor, texels[i]);
+        mean += texels[i];
+    }
+    mean /= 16.0;
+
+    vec4 range = (maxColor - minColor) * channelMask;
+    int widest = 0;
+    for (int channel = 1; channel < 4; channel++) {
+        if (range[channel] > range[widest]) {
+            widest = channel;
+        }
+    }
+    vec4 covariance = vec4(0.0);
+    for (int i = 0; i < 16; i++) {
+        covariance += (texels[i] - mean) * (texels[i][widest] - mean[widest]);
+    }
+
+    vec4 inset = (maxColor - minColor) / 16.0;
+    endpoint0 = minColor + inset;
+    endpoint1 = maxColor - inset;
+    for (int channel = 0; channel < 4; channel++) {
+        if (covariance[channel] < 0.0) {
+            float swapped = endpoint0[channel];
+            endpoint0[channel] = endpoint1[channel];
+            endpoint1[channel] = swapped;
+        }
+    }
+}
+
+// the closest of the first numColors palette entries over the masked channels, ties keep the lower index
+void FindIndices(uint numColors, vec4 channelMask) {
+    for (int i = 0; i < 16; i++) {
+        float bestError = 1e30;
+        uint bestIndex = 0u;
+        for (uint color = 0u; color < numColors; color++) {
+            vec4 difference = (texels[i] - palette[color]) * channelMask;
+            float error = dot(difference, difference);
+            if (error < bestError) {
+                bestError = error;
+                bestIndex = color;
+            }
+        }
+        indices[i] = bestIndex;
+    }
+}
+
+uint QuantizeRgb565(vec4 color) {
+    vec4 quantized = floor(clamp(color, 0.0, 255.0) * vec4(31.0, 63.0, 31.0, 0.0) / 255.0 + 0.5);
+    return uint(quantized.x) << 11 | uint(quantized.y) << 5 | uint(quantized.z);
+}
+
+vec4 ExpandRgb565(uint color) {
+    uint r = color >> 11 & 31u;
+    uint g = color >> 5 & 63u;
+    uint b = color & 31u;
+    return vec4(float(r << 3 | r >> 2), float(g << 2 | g >> 4), float(b << 3 | b >> 2), 0.0);
+}
+
+void EncodeBc1() {
+    vec4 channelMask = vec4(1.0, 1.0, 1.0, 0.0);
+    FindEndpoints(channelMask);
+    uint color0 = QuantizeRgb565(endpoint0);
+    uint color1 = QuantizeRgb565(endpoint1);
+    // color0 > color1 selects the 4 color mode, equal colors fall back to the 3 color mode where index 0 is still color0
+    if (color0 < color1) {
+        uint swapped = color0;
+        color0 = color1;
+        color1 = swapped;
+    }
+
+    palette[0] = ExpandRgb565(color0);
+    palette[1] = ExpandRgb565(color1);
+    palette[2] = palette[0] + (palette[1] - palette[0]) * (1.0 / 3.0);
+    palette[3] = palette[0] + (palette[1] - palette[0]) * (2.0 / 3.0);
+    FindIndices(color0 == color1 ? 1u : 4u, channelMask);
+
+    PutBits(color0, 16u);
+    PutBits(color1, 16u);
+    for (int i = 0; i < 16; i++) {
+        PutBits(indices[i], 2u);
+    }
+}
+
+void EncodeBc4(int channel) {
+    float minValue = 255.0;
+    float maxValue = 0.0;
+    for (int i = 0; i < 16; i++) {
+        minValue = min(minValue, texels[i][channel]);
+        maxValue = max(maxValue, texels[i][channel]);
+    }
+
+    // red0 > red1 selects the 8 value mode, equal values fall back to the 6 value mode where index 0 is still red0
+    uint red0 = uint(maxValue);
+    uint red1 = uint(minValue);
+    palette[0] = vec4(float(red0));
+    palette[1] = vec4(float(red1));
+    for (uint i = 2u; i < 8u; i++) {
+        palette[i] = vec4(float(((8u - i) * red0 + (i - 1u) * red1) / 7u));
+    }
+    vec4 channelMask = vec4(0.0);
+    channelMask[channel] = 1.0;
+    FindIndices(red0 == red1 ? 1u : 8u, channelMask);
+
+    PutBits(red0, 8u);
+    PutBits(red1, 8u);
+    for (int i = 0; i < 16; i++) {
+        PutBits(indices[i], 3u);
+    }
+}
+
+void EncodeBc5() {
+    EncodeBc4(0);
+    EncodeBc4(1);
+}
+
+uint quantizedPBit;
+
+// 7 bit channels, the p-bit whose rounding lands closer to the endpoint is left in quantizedPBit
+vec4 QuantizeBc7Endpoint(vec4 endpoint) {
+    vec4 even = clamp(floor(endpoint * 0.5 + 0.5), 0.0, 127.0);
+    vec4 odd = clamp(floor((endpoint - 1.0) * 0.5 + 0.5), 0.0, 127.0);
+    vec4 evenError = endpoint - even * 2.0;
+    vec4 oddError = endpoint - (odd * 2.0 + 1.0);
+    bool useOdd = dot(oddError, oddError) < dot(evenError, evenError);
+    quantizedPBit = useOdd ? 1u : 0u;
+    return useOdd ? odd : even;
+}
+
+// mode 6, one RGBA endpoint pair with 4 bit indices
+void EncodeBc7() {
+    vec4 channelMask = vec4(1.0);
+    FindEndpoints(channelMask);
+    vec4 quantized0 = QuantizeBc7Endpoint(endpoint0);
+    uint pBit0 = quantizedPBit;
+    vec4 quantized1 = QuantizeBc7Endpoint(endpoint1);
+    uint pBit1 = quantizedPBit;
+
+    vec4 value0 = quantized0 * 2.0 + float(pBit0);
+    vec4 value1 = quantized1 * 2.0 + float(pBit1);
+    for (uint i = 0u; i < 16u; i++) {
+        // the 4 bit index weights are round(i * 64 / 15)
+        float weight = floor(float(i) * 64.0 / 15.0 + 0.5);
+        palette[i] = floor(((64.0 - weight) * value0 + weight * value1 + 32.0) / 64.0);
+    }
+    FindIndices(16u, channelMask);
+
+    // the first index is stored without its top bit, so it must be below 8
+    if (indices[0] >= 8u) {
+        vec4 swappedEndpoint = quantized0;
+        quantized0 = quantized1;
+        quantized1 = swappedEndpoint;
+        uint swappedPBit = pBit0;
+        pBit0 = pBit1;
+        pBit1 = swappedPBit;
+        for (int i = 0; i < 16; i++) {
+            indices[i] = 15u - indices[i];
+        }
+    }
+
+    PutBits(1u << 6, 7u);
+    for (int channel = 0; channel < 4; channel++) {
+        PutBits(uint(quantized0[channel]), 7u);
+        PutBits(uint(quantized1[channel]), 7u);
+    }
+    PutBits(pBit0, 1u);
+    PutBits(pBit1, 1u);
+    PutBits(indices[0], 3u);
+    for (int i = 1; i < 16; i++) {
+        PutBits(indices[i], 4u);
+    }
+}
+
+void main()
+{
+    uvec2 block = gl_GlobalInvocationID.xy;
+    if (block.x >= uBlocksX || block.y >= uBlocksY) {
+        return;
+    }
+
+    LoadTexels(block);
+    for (int i = 0; i < 4; i++) {
+        words[i] = 0u;
+    }
+    bitPosition = 0u;
+    ENCODE_BLOCK();
+
+    uint firstWord = uFirstWord + (block.y * uBlocksX + block.x) * BLOCK_WORDS;
+    for (uint i = 0u; i < BLOCK_WORDS; i++) {
+        uBlocks[firstWord + i] = words[i];
+    }
+}
+)GLSL";
+
+GpuTextureCompressor::GpuTextureCompressor(VulkanBase *device)
+        : m_device(device) {
+    CreateDescriptorSetLayout();
+    CreatePipelines();
+    CreateSampler();
+}
+
+void GpuTextureCompressor::CreateDescriptorSetLayout() {
+    m_descriptorSetLayout = VulkanDescriptorSetLayout(
+            m_device,
+            {
+                    {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT},
+                    {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         VK_SHADER_STAGE_COMPUTE_BIT}
+            }
+    );
+}
+
+void GpuTextureCompressor::CreatePipelines() {
+    for (int i = 0; i < 3; i++) {
+        const GpuCompressorFormat &format = GpuCompressorFormats[i];
+        const std::string source = std::string("#version 450 core\n") +
+                                   "#define ENCODE_BLOCK " + format.Encoder + "\n" +
+                                   "#define BLOCK_WORDS " + std::to_string(format.BlockWords) + "u\n" +
+                                   CompressorShaderSource;
+
+        VulkanComputePipelineCreateInfo pipelineCreateInfo{};
+        pipelineCreateInfo.Device = m_device;
+        pipelineCreateInfo.DescriptorSetLayouts = {m_descriptorSetLayout.Get()};
+        pipelineCreateInfo.PushConstantSize = sizeof(CompressConstantsData);
+        pipelineCreateInfo.Source = source.c_str();
+        pipelineCreateInfo.LocalSize[0] = 8;
+        pipelineCreateInfo.LocalSize[1] = 8;
+        m_pipelines[i] = VulkanComputePipeline(pipelineCreateInfo);
+    }
+}
+
+void GpuTextureCompressor::CreateSampler() {
+    // only read with texelFetch
+    VkSamplerCreateInfo samplerCreateInfo{};
+    samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+    samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+    samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
+    m_sampler = m_device->GetSampler(samplerCreateInfo);
+}
+
+void GpuTextureCompressor::Release() {
+    m_device = nullptr;
+    m_descriptorSetLayout = {};
+    for (VulkanComputePipeline &pipeline: m_pipelines) {
+        pipeline = {};
+    }
+    m_sampler = VK_NULL_HANDLE;
+}
+
+void GpuTextureCompressor::Swap(GpuTextureCompressor &other) noexcept {
+    std::swap(m_device, other.m_device);
+    std::swap(m_descriptorSetLayout, other.m_descriptorSetLayout);
+    std::swap(m_pipelines, other.m_pipelines);
+    std::swap(m_sampler, other.m_sampler);
+}
+
+bool GpuTextureCompressor::CanCompress(VkFormat format) const {
+    return m_device && FindGpuCompressorFormat(format) >= 0 && VulkanTexture::IsFormatSupported(m_device, format);
+}
+
+VulkanImage GpuTextureCompressor::Compress(const VulkanImage &source, const VkExtent2D &extent, VkFormat format) {
+    DebugCheckCritical(CanCompress(format), "Texture format {} can't be compressed on the GPU.", static_cast<int>(format));
+    const GpuCompressorFormat &compressorFormat = GpuCompressorFormats[FindGpuCompressorFormat(format)];
+    VulkanComputePipeline &pipeline = m_pipelines[FindGpuCompressorFormat(format)];
+
+    TextureFormatInfo info;
+    GetTextureFormatInfo(format, info);
+
+    // mips are packed one after another, the copies read them back from the same offsets
+    const uint32_t mipLevels = source.GetMipLevels();
+    std::vector<CompressConstantsData> dispatches(mipLevels);
+    std::vector<VkBufferImageCopy> imageCopies(mipLevels);
+    VkDeviceSize blocksSize = 0;
+    for (uint32_t level = 0; level < mipLevels; level++) {
+        const uint32_t width = std::max(extent.width >> level, 1u);
+        const uint32_t height = std::max(extent.height >> level, 1u);
+
+        CompressConstantsData &dispatch = dispatches[level];
+        dispatch.Lod = static_cast<int32_t>(level);
+        dispatch.BlocksX = (width + 3) / 4;
+        dispatch.BlocksY = (height + 3) / 4;
+        dispatch.FirstWord = static_cast<uint32_t>(blocksSize / sizeof(uint32_t));
+
+        VkBufferImageCopy &imageCopy = imageCopies[level];
+        imageCopy.bufferOffset = blocksSize;
+        VkImageSubresourceLayers &subresourceLayers = imageCopy.imageSubresource;
+        subresourceLayers.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        subresourceLayers.mipLevel = level;
+        subresourceLayers.baseArrayLayer = 0;
+        subresourceLayers.layerCount = 1;
+        imageCopy.imageExtent = {width, height, 1};
+
+        blocksSize += GetTextureMipSize(info, width, height);
+    }
+
+    VulkanBuffer blockBuffer = m_device->CreateBuffer(
+            blocksSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            0,
+            VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
+    );
+    VulkanImage image = m_device->CreateImage2D(
+            format,
+            extent,
+            VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            0,
+            VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+            mipLevels
+    );
+
+    VkImageViewCreateInfo imageViewCreateInfo{};
+    imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    imageViewCreateInfo.image = source.Get();
+    imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    imageViewCreateInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+    VkImageSubresourceRange &subresourceRange = imageViewCreateInfo.subresourceRange;
+    subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    subresourceRange.baseMipLevel = 0;
+    subresourceRange.levelCount = mipLevels;
+    subresourceRange.baseArrayLayer = 0;
+    subresourceRange.layerCount = 1;
+    VkImageView sourceView = m_device->CreateImageView(imageViewCreateInfo);
+
+    VkDescriptorSet descriptorSet = m_descriptorSetLayout.AllocateDescriptorSet();
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.sampler = m_sampler;
+    imageInfo.imageView = sourceView;
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = blockBuffer.Get();
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+    VkWriteDescriptorSet writeDescriptorSets[2]{};
+    writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeDescriptorSets[0].dstSet = descriptorSet;
+    writeDescriptorSets[0].dstBinding = 0;
+    writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writeDescriptorSets[0].descriptorCount = 1;
+    writeDescriptorSets[0].pImageInfo = &imageInfo;
+    writeDescriptorSets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeDescriptorSets[1].dstSet = descriptorSet;
+    writeDescriptorSets[1].dstBinding = 1;
+    writeDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writeDescriptorSets[1].descriptorCount = 1;
+    writeDescriptorSets[1].pBufferInfo = &bufferInfo;
+    for (const VkWriteDescriptorSet &writeDescriptorSet: writeDescriptorSets) {
+        m_device->WriteDescriptorSet(writeDescriptorSet);
+    }
+
+    m_device->ImmediateSubmit([&](VkCommandBuffer cmd) {
+        // the source was last written by an earlier submission, maybe by a transfer
+        CmdImageBarrier(
+                cmd, source.Get(),
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_WRITE_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT
+        );
+
+        pipeline.Bind(cmd);
+        pipeline.BindDescriptorSet(cmd, descriptorSet, 0);
+        for (const CompressConstantsData &dispatch: dispatches) {
+            pipeline.PushConstants(cmd, dispatch);
+            pipeline.DispatchForSize(cmd, dispatch.BlocksX, dispatch.BlocksY);
+        }
+
+        CmdBufferBarrier(
+                cmd,
+                blockBuffer.Get(),
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_ACCESS_TRANSFER_READ_BIT
+        );
+        CmdImageBarrier(
+                cmd, image.Get(),
+                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT
+        );
+        vkCmdCopyBufferToImage(cmd, blockBuffer.Get(), image.Get(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, imageCopies.size(), imageCopies.data());
+        CmdImageBarrier(
+                cmd, image.Get(),
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT
+        );
+    });
+
+    m_device->FreeDescriptorSet(descriptorSet);
+    m_device->DestroyImageView(sourceView);
+
+    DebugVerbose(
+            "Compressed {}x{} texture with {} mips on the GPU, {} blocks in {} bytes.",
+            extent.width, extent.height, mipLevels, blocksSize / info.BlockSize, blocksSize
+    );
+    return image;
+}
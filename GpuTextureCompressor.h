@@ -0,0 +1,66 @@
+//
+// Created by andyroiiid on 1/3/2023.
+//
+
+#pragma once
+
+#include "VulkanBase.h"
+#include "VulkanDescriptorSetLayout.h"
+#include "VulkanComputePipeline.h"
+
+// Block compresses RGBA8 images that only exist at runtime in compute shaders, one invocation per 4x4 block.
+// The encoders follow the fast preset of TextureCompressor: bounding box endpoints and the closest palette entry,
+// BC7 only uses mode 6. Every mip is encoded into a storage buffer and copied into a new block compressed image,
+// since block compressed formats rarely support storage usage themselves.
+class GpuTextureCompressor {
+public:
+    GpuTextureCompressor() = default;
+
+    explicit GpuTextureCompressor(VulkanBase *device);
+
+    ~GpuTextureCompressor() {
+        Release();
+    }
+
+    GpuTextureCompressor(const GpuTextureCompressor &) = delete;
+
+    GpuTextureCompressor &operator=(const GpuTextureCompressor &) = delete;
+
+    GpuTextureCompressor(GpuTextureCompressor &&other) noexcept {
+        Swap(other);
+    }
+
+    GpuTextureCompressor &operator=(GpuTextureCompressor &&other) noexcept {
+        if (this != &other) {
+            Release();
+            Swap(other);
+        }
+        return *this;
+    }
+
+    void Release();
+
+    void Swap(GpuTextureCompressor &other) noexcept;
+
+    // BC1 RGB, BC5 and BC7 UNORM when the device can sample them
+    [[nodiscard]] bool CanCompress(VkFormat format) const;
+
+    // Encodes every mip of an R8G8B8A8_UNORM image in SHADER_READ_ONLY_OPTIMAL layout and waits for the GPU,
+    // the returned image has the same mips and is in SHADER_READ_ONLY_OPTIMAL layout.
+    VulkanImage Compress(const VulkanImage &source, const VkExtent2D &extent, VkFormat format);
+
+private:
+    void CreateDescriptorSetLayout();
+
+    void CreatePipelines();
+
+    void CreateSampler();
+
+    VulkanBase *m_device = nullptr;
+
+    VulkanDescriptorSetLayout m_descriptorSetLayout;
+    // BC1, BC5 and BC7
+    VulkanComputePipeline m_pipelines[3];
+    // owned by the device
+    VkSampler m_sampler = VK_NULL_HANDLE;
+};
@@ -0,0 +1,114 @@
+//
+// Created by andyroiiid on 1/3/2023.
+//
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <vector>
+
+#include <stb_image.h>
+
+#include "Debug.h"
+#include "Files.h"
+#include "ImageFile.h"
+#include "PngDecoder.h"
+
+// Decodes every PNG and JPEG of a corpus with stbi_load_from_memory and with DecodeImage and prints megapixels per second,
+// and whether DecodeImage took the PNG fast path or fell back to stb_image.
+// The arguments are images or directories searched recursively, without arguments the working directory is the corpus.
+int main(int argc, char *argv[]) {
+    constexpr int numRepeats = 5;
+
+    std::vector<std::filesystem::path> corpus;
+    std::vector<std::filesystem::path> roots;
+    for (int i = 1; i < argc; i++) {
+        roots.emplace_back(argv[i]);
+    }
+    if (roots.empty()) {
+        roots.emplace_back(".");
+    }
+    for (const std::filesystem::path &root: roots) {
+        if (!std::filesystem::is_directory(root)) {
+            corpus.push_back(root);
+            continue;
+        }
+        for (const auto &entry: std::filesystem::recursive_directory_iterator(root)) {
+            std::string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) {
+                return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            });
+            if (entry.is_regular_file() && (extension == ".png" || extension == ".jpg" || extension == ".jpeg")) {
+                corpus.push_back(entry.path());
+            }
+        }
+    }
+
+    uint32_t numImages = 0;
+    uint32_t numFastPath = 0;
+    double totalPixels = 0.0;
+    double totalStbSeconds = 0.0;
+    double totalDecodeSeconds = 0.0;
+    for (const std::filesystem::path &path: corpus) {
+        const std::string filename = path.string();
+        const MappedFile file(filename);
+        uint32_t width = 0, height = 0;
+        if (!file.IsValid() || !GetImageSize(file.GetData(), file.GetSize(), width, height)) {
+            DebugWarning("Skipping {}, it is not an image.", filename);
+            continue;
+        }
+        const size_t size = static_cast<size_t>(width) * height * 4;
+
+        // keep the fastest run to filter out scheduling noise
+        double stbSeconds = std::numeric_limits<double>::max();
+        std::vector<uint8_t> expected(size);
+        for (int i = 0; i < numRepeats; i++) {
+            const auto start = std::chrono::high_resolution_clock::now();
+            int x = 0, y = 0;
+            stbi_uc *decoded = stbi_load_from_memory(static_cast<const stbi_uc *>(file.GetData()), static_cast<int>(file.GetSize()), &x, &y, nullptr, STBI_rgb_alpha);
+            const auto end = std::chrono::high_resolution_clock::now();
+            stbSeconds = std::min(stbSeconds, std::chrono::duration<double>(end - start).count());
+            if (decoded) {
+                memcpy(expected.data(), decoded, size);
+            }
+            stbi_image_free(decoded);
+        }
+
+        // DecodeImage only falls back to stb_image when DecodePng fails
+        std::vector<uint8_t> pixels(size);
+        const bool fastPath = DecodePng(file.GetData(), file.GetSize(), pixels.data(), width, height);
+
+        double decodeSeconds = std::numeric_limits<double>::max();
+        bool decoded = false;
+        for (int i = 0; i < numRepeats; i++) {
+            const auto start = std::chrono::high_resolution_clock::now();
+            decoded = DecodeImage(file.GetData(), file.GetSize(), pixels.data(), width, height);
+            const auto end = std::chrono::high_resolution_clock::now();
+            decodeSeconds = std::min(decodeSeconds, std::chrono::duration<double>(end - start).count());
+        }
+
+        const double megapixels = static_cast<double>(width) * height / 1e6;
+        DebugInfo(
+                "{} {}x{}: stb_image {:7.2f} MP/s, DecodeImage {:7.2f} MP/s, {:.2f}x, {}{}",
+                filename, width, height, megapixels / stbSeconds, megapixels / decodeSeconds, stbSeconds / decodeSeconds,
+                fastPath ? "PNG fast path" : "stb_image fallback",
+                decoded && pixels == expected ? "" : ", OUTPUT DIFFERS"
+        );
+        numImages++;
+        numFastPath += fastPath;
+        totalPixels += megapixels;
+        totalStbSeconds += stbSeconds;
+        totalDecodeSeconds += decodeSeconds;
+    }
+
+    if (totalPixels > 0.0) {
+        DebugInfo(
+                "{} images, {} on the PNG fast path, {:.2f} MP: stb_image {:7.2f} MP/s, DecodeImage {:7.2f} MP/s, {:.2f}x",
+                numImages, numFastPath, totalPixels, totalPixels / totalStbSeconds, totalPixels / totalDecodeSeconds, totalStbSeconds / totalDecodeSeconds
+        );
+    }
+    return 0;
+}
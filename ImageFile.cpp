@@ -4,27 +4,119 @@
 
 #include "ImageFile.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// DecodeImage hands its destination to the decoders as the allocation of the decoded image,
+// every decoder allocates the final RGBA8 image as one block of exactly its size.
+struct DecodeTarget {
+    void *Pixels = nullptr;
+    size_t Size = 0;
+    bool Allocated = false;
+};
+
+static thread_local DecodeTarget decodeTarget;
+
+static void *DecodeMalloc(size_t size) {
+    if (decodeTarget.Pixels && !decodeTarget.Allocated && size == decodeTarget.Size) {
+        decodeTarget.Allocated = true;
+        return decodeTarget.Pixels;
+    }
+    return malloc(size);
+}
+
+static void *DecodeRealloc(void *pointer, size_t oldSize, size_t newSize) {
+    if (pointer == nullptr || pointer != decodeTarget.Pixels) {
+        return realloc(pointer, newSize);
+    }
+    // a block that outgrew the destination moves to the heap
+    void *newPointer = malloc(newSize);
+    if (newPointer) {
+        memcpy(newPointer, pointer, std::min(oldSize, newSize));
+        decodeTarget.Allocated = false;
+    }
+    return newPointer;
+}
+
+static void DecodeFree(void *pointer) {
+    if (pointer && pointer == decodeTarget.Pixels) {
+        decodeTarget.Allocated = false;
+        return;
+    }
+    free(pointer);
+}
+
+#define STBI_MALLOC(size) DecodeMalloc(size)
+#define STBI_REALLOC_SIZED(pointer, oldSize, newSize) DecodeRealloc(pointer, oldSize, newSize)
+#define STBI_FREE(pointer) DecodeFree(pointer)
 #define STB_IMAGE_IMPLEMENTATION
 
+// stb_image uses SSE2 on x86 by itself, NEON has to be asked for
+#if defined(_M_ARM64) || defined(__aarch64__)
+#define STBI_NEON
+#endif
+
 #include <stb_image.h>
 
 #include "Files.h"
+#include "PngDecoder.h"
+
+bool GetImageSize(const void *data, size_t size, uint32_t &width, uint32_t &height) {
+    int x = 0, y = 0, components = 0;
+    if (!stbi_info_from_memory(static_cast<const stbi_uc *>(data), static_cast<int>(size), &x, &y, &components)) {
+        return false;
+    }
+    width = x;
+    height = y;
+    return true;
+}
+
+bool DecodeImage(const void *data, size_t size, void *pixels, uint32_t width, uint32_t height) {
+    // the common PNGs take the fast path, everything else goes through stb_image
+    if (DecodePng(data, size, pixels, width, height)) {
+        return true;
+    }
+
+    decodeTarget = {pixels, static_cast<size_t>(width) * height * 4, false};
+    int x = 0, y = 0;
+    stbi_uc *decoded = stbi_load_from_memory(static_cast<const stbi_uc *>(data), static_cast<int>(size), &x, &y, nullptr, STBI_rgb_alpha);
+    const DecodeTarget target = decodeTarget;
+    decodeTarget = {};
+
+    if (decoded == nullptr) {
+        return false;
+    }
+    const bool valid = static_cast<uint32_t>(x) == width && static_cast<uint32_t>(y) == height;
+    // the decoder used a temporary block of the same size for something else, the image is on the heap
+    if (valid && decoded != pixels) {
+        memcpy(pixels, decoded, target.Size);
+    }
+    if (decoded != pixels) {
+        stbi_image_free(decoded);
+    }
+    return valid;
+}
 
 ImageFile::ImageFile(const std::string &filename) {
-    stbi_set_flip_vertically_on_load(true);
-
-    std::string bytes = ReadFile(filename);
-    int width = 0, height = 0;
-    m_data = stbi_load_from_memory(
-            reinterpret_cast<const stbi_uc *>(bytes.data()),
-            static_cast<int>(bytes.length()),
-            &width,
-            &height,
-            nullptr,
-            STBI_rgb_alpha
-    );
+    const MappedFile file(filename);
+    if (!file.IsValid()) {
+        return;
+    }
+
+    uint32_t width = 0, height = 0;
+    if (!GetImageSize(file.GetData(), file.GetSize(), width, height)) {
+        return;
+    }
+    // freed by stbi_image_free like the blocks stb_image allocates
+    auto *pixels = static_cast<unsigned char *>(malloc(static_cast<size_t>(width) * height * 4));
+    if (pixels == nullptr || !DecodeImage(file.GetData(), file.GetSize(), pixels, width, height)) {
+        free(pixels);
+        return;
+    }
     m_width = width;
     m_height = height;
+    m_data = pixels;
 }
 
 void ImageFile::Release() {
@@ -4,8 +4,17 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 
+// Width and height of an encoded image without decoding it.
+bool GetImageSize(const void *data, size_t size, uint32_t &width, uint32_t &height);
+
+// Decodes straight into pixels, which holds the width x height RGBA8 texels GetImageSize reported, rows from top to bottom.
+// The decoders read back what they wrote, so pixels should be cached memory. Safe to call on any thread.
+bool DecodeImage(const void *data, size_t size, void *pixels, uint32_t width, uint32_t height);
+
+// RGBA8 pixels decoded from a memory mapped file, rows from top to bottom.
 class ImageFile {
 public:
     ImageFile() = default;
@@ -0,0 +1,277 @@
+//
+// Created by andyroiiid on 12/31/2022.
+//
+
+#include "Json.h"
+
+#include <cstdlib>
+#include <cstring>
+
+static const JsonValue NullValue;
+
+bool JsonValue::Has(const std::string &key) const {
+    for (const auto &[name, value]: m_object) {
+        if (name == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const JsonValue &JsonValue::operator[](size_t index) const {
+    return m_type == Type::Array && index < m_array.size() ? m_array[index] : NullValue;
+}
+
+const JsonValue &JsonValue::operator[](const std::string &key) const {
+    for (const auto &[name, value]: m_object) {
+        if (name == key) {
+            return value;
+        }
+    }
+    return NullValue;
+}
+
+class JsonParser {
+public:
+    JsonParser(const char *text, size_t length)
+            : m_current(text), m_end(text + length) {}
+
+    bool ParseDocument(JsonValue &value) {
+        if (!ParseValue(value, 0)) {
+            return false;
+        }
+        SkipWhitespace();
+        return m_current == m_end;
+    }
+
+private:
+    // deeper documents are rejected instead of overflowing the stack
+    static constexpr int MaxDepth = 256;
+
+    void SkipWhitespace() {
+        while (m_current < m_end && (*m_current == ' ' || *m_current == '\t' || *m_current == '\n' || *m_current == '\r')) {
+            m_current++;
+        }
+    }
+
+    bool Consume(char c) {
+        SkipWhitespace();
+        if (m_current < m_end && *m_current == c) {
+            m_current++;
+            return true;
+        }
+        return false;
+    }
+
+    bool ConsumeLiteral(const char *literal) {
+        const size_t length = strlen(literal);
+        if (static_cast<size_t>(m_end - m_current) < length || memcmp(m_current, literal, length) != 0) {
+            return false;
+        }
+        m_current += length;
+        return true;
+    }
+
+    bool ParseValue(JsonValue &value, int depth) {
+        if (depth > MaxDepth) {
+            return false;
+        }
+
+        SkipWhitespace();
+        if (m_current == m_end) {
+            return false;
+        }
+
+        switch (*m_current) {
+            case '{':
+                return ParseObject(value, depth);
+            case '[':
+                return ParseArray(value, depth);
+            case '"':
+                value.m_type = JsonValue::Type::String;
+                return ParseString(value.m_string);
+            case 't':
+                value.m_type = JsonValue::Type::Bool;
+                value.m_bool = true;
+                return ConsumeLiteral("true");
+            case 'f':
+                value.m_type = JsonValue::Type::Bool;
+                value.m_bool = false;
+                return ConsumeLiteral("false");
+            case 'n':
+                value.m_type = JsonValue::Type::Null;
+                return ConsumeLiteral("null");
+            default:
+                return ParseNumber(value);
+        }
+    }
+
+    bool ParseObject(JsonValue &value, int depth) {
+        value.m_type = JsonValue::Type::Object;
+        m_current++;
+        if (Consume('}')) {
+            return true;
+        }
+        do {
+            SkipWhitespace();
+            auto &[name, member] = value.m_object.emplace_back();
+            if (!ParseString(name) || !Consume(':') || !ParseValue(member, depth + 1)) {
+                return false;
+            }
+        } while (Consume(','));
+        return Consume('}');
+    }
+
+    bool ParseArray(JsonValue &value, int depth) {
+        value.m_type = JsonValue::Type::Array;
+        m_current++;
+        if (Consume(']')) {
+            return true;
+        }
+        do {
+            if (!ParseValue(value.m_array.emplace_back(), depth + 1)) {
+                return false;
+            }
+        } while (Consume(','));
+        return Consume(']');
+    }
+
+    bool ParseNumber(JsonValue &value) {
+        // strtod needs a terminated string, numbers are short so copy the candidate characters
+        char buffer[64];
+        size_t length = 0;
+        while (m_current + length < m_end && length < sizeof(buffer) - 1 && strchr("+-0123456789.eE", m_current[length])) {
+            buffer[length] = m_current[length];
+            length++;
+        }
+        buffer[length] = '\0';
+
+        char *end = nullptr;
+        value.m_number = strtod(buffer, &end);
+        if (length == 0 || end != buffer + length) {
+            return false;
+        }
+        value.m_type = JsonValue::Type::Number;
+        m_current += length;
+        return true;
+    }
+
+    static void AppendUtf8(std::string &string, uint32_t codePoint) {
+        if (codePoint < 0x80) {
+            string += static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            string += static_cast<char>(0xC0 | (codePoint >> 6));
+            string += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else if (codePoint < 0x10000) {
+            string += static_cast<char>(0xE0 | (codePoint >> 12));
+            string += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            string += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else {
+            string += static_cast<char>(0xF0 | (codePoint >> 18));
+            string += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            string += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            string += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    bool ParseHex4(uint32_t &codePoint) {
+        if (m_end - m_current < 4) {
+            return false;
+        }
+        codePoint = 0;
+        for (int i = 0; i < 4; i++) {
+            const char c = *m_current++;
+            codePoint <<= 4;
+            if (c >= '0' && c <= '9') {
+                codePoint |= c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                codePoint |= c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                codePoint |= c - 'A' + 10;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool ParseString(std::string &string) {
+        if (m_current == m_end || *m_current != '"') {
+            return false;
+        }
+        m_current++;
+
+        for (;;) {
+            // copy runs without escapes in one go
+            const char *runStart = m_current;
+            while (m_current < m_end && *m_current != '"' && *m_current != '\\') {
+                m_current++;
+            }
+            string.append(runStart, m_current);
+            if (m_current == m_end) {
+                return false;
+            }
+            if (*m_current++ == '"') {
+                return true;
+            }
+
+            if (m_current == m_end) {
+                return false;
+            }
+            const char escape = *m_current++;
+            switch (escape) {
+                case '"':
+                case '\\':
+                case '/':
+                    string += escape;
+                    break;
+                case 'b':
+                    string += '\b';
+                    break;
+                case 'f':
+                    string += '\f';
+                    break;
+                case 'n':
+                    string += '\n';
+                    break;
+                case 'r':
+                    string += '\r';
+                    break;
+                case 't':
+                    string += '\t';
+                    break;
+                case 'u': {
+                    uint32_t codePoint;
+                    if (!ParseHex4(codePoint)) {
+                        return false;
+                    }
+                    // surrogate pair
+                    if (codePoint >= 0xD800 && codePoint < 0xDC00) {
+                        uint32_t low;
+                        if (!ConsumeLiteral("\\u") || !ParseHex4(low) || low < 0xDC00 || low >= 0xE000) {
+                            return false;
+                        }
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    AppendUtf8(string, codePoint);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+    }
+
+    const char *m_current;
+    const char *m_end;
+};
+
+bool ParseJson(const char *text, size_t length, JsonValue &value) {
+    value = {};
+    JsonParser parser(text, length);
+    if (!parser.ParseDocument(value)) {
+        value = {};
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,65 @@
+//
+// Created by andyroiiid on 12/31/2022.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+
+// Minimal read only JSON document, enough for glTF.
+// Looking up a missing key or index returns a shared null value, so lookups can be chained.
+class JsonValue {
+public:
+    enum class Type {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+
+    [[nodiscard]] Type GetType() const { return m_type; }
+
+    [[nodiscard]] bool IsNull() const { return m_type == Type::Null; }
+
+    [[nodiscard]] bool IsNumber() const { return m_type == Type::Number; }
+
+    [[nodiscard]] bool IsString() const { return m_type == Type::String; }
+
+    [[nodiscard]] bool IsArray() const { return m_type == Type::Array; }
+
+    [[nodiscard]] bool IsObject() const { return m_type == Type::Object; }
+
+    [[nodiscard]] bool GetBool(bool defaultValue = false) const { return m_type == Type::Bool ? m_bool : defaultValue; }
+
+    [[nodiscard]] double GetNumber(double defaultValue = 0.0) const { return m_type == Type::Number ? m_number : defaultValue; }
+
+    [[nodiscard]] const std::string &GetString() const { return m_string; }
+
+    // number of array elements or object members
+    [[nodiscard]] size_t GetSize() const { return m_type == Type::Array ? m_array.size() : m_object.size(); }
+
+    [[nodiscard]] bool Has(const std::string &key) const;
+
+    const JsonValue &operator[](size_t index) const;
+
+    const JsonValue &operator[](const std::string &key) const;
+
+    [[nodiscard]] const std::vector<std::pair<std::string, JsonValue>> &GetMembers() const { return m_object; }
+
+private:
+    friend class JsonParser;
+
+    Type m_type = Type::Null;
+    bool m_bool = false;
+    double m_number = 0.0;
+    std::string m_string;
+    std::vector<JsonValue> m_array;
+    std::vector<std::pair<std::string, JsonValue>> m_object;
+};
+
+// returns false and leaves value null on a syntax error
+bool ParseJson(const char *text, size_t length, JsonValue &value);
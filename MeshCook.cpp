@@ -0,0 +1,143 @@
+//
+// Created by andyroiiid on 12/30/2022.
+//
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+#include "Debug.h"
+#include "MeshFile.h"
+#include "MeshUtilities.h"
+#include "ModelImporter.h"
+
+static void PrintUsage() {
+    DebugInfo("usage: MeshCook <output.mesh> <box|sphere|model.obj|model.gltf|model.glb> [--segments n] [--rings n] [--lods n] [--no-meshlets] [--no-optimize]");
+}
+
+// the whole argument has to be a number, std::stoul would throw
+static bool ParseUint32(const char *text, uint32_t &value) {
+    const char *end = text + strlen(text);
+    const auto [pointer, error] = std::from_chars(text, end, value);
+    return error == std::errc() && pointer == end;
+}
+
+// Converts a source mesh into a .mesh file with its LOD chain and meshlets.
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        PrintUsage();
+        return 1;
+    }
+
+    const std::string outputFilename = argv[1];
+    const std::string source = argv[2];
+    uint32_t segments = 64;
+    uint32_t rings = 32;
+    uint32_t maxLods = 4;
+    bool buildMeshlets = true;
+    bool optimize = true;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--segments") == 0 && i + 1 < argc) {
+            const char *text = argv[++i];
+            if (!DebugCheck(ParseUint32(text, segments), "--segments expects a number, got {}.", text)) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--rings") == 0 && i + 1 < argc) {
+            const char *text = argv[++i];
+            if (!DebugCheck(ParseUint32(text, rings), "--rings expects a number, got {}.", text)) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--lods") == 0 && i + 1 < argc) {
+            const char *text = argv[++i];
+            if (!DebugCheck(ParseUint32(text, maxLods), "--lods expects a number, got {}.", text)) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--no-meshlets") == 0) {
+            buildMeshlets = false;
+        } else if (strcmp(argv[i], "--no-optimize") == 0) {
+            optimize = false;
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    auto logStage = [startTime](const char *stage) {
+        const auto now = std::chrono::high_resolution_clock::now();
+        DebugInfo("{:>10}: {:.2f} ms", stage, std::chrono::duration<double, std::milli>(now - startTime).count());
+    };
+
+    std::vector<VertexBase> vertices;
+    std::vector<uint32_t> indices;
+    if (source == "box") {
+        AppendBoxVertices(vertices, indices, glm::vec3{-1.0f}, glm::vec3{1.0f});
+    } else if (source == "sphere") {
+        AppendSphereVertices(vertices, indices, glm::vec3{0.0f}, 1.0f, segments, rings);
+    } else if (source.find('.') != std::string::npos) {
+        ThreadPool threadPool;
+        std::vector<ImportedMesh> meshes;
+        ImportTimings timings;
+        if (!ImportModel(source, threadPool, meshes, &timings, optimize)) {
+            DebugError("Failed to import {}.", source);
+            return 1;
+        }
+        DebugInfo(
+                "import {} meshes on {} threads: read {:.2f} ms, parse {:.2f} ms, convert {:.2f} ms, optimize {:.2f} ms",
+                meshes.size(), threadPool.GetNumThreads(), timings.Read, timings.Parse, timings.Convert, timings.Optimize
+        );
+
+        // a .mesh file holds a single mesh, every imported mesh is merged into it
+        for (const ImportedMesh &mesh: meshes) {
+            const auto baseVertex = static_cast<uint32_t>(vertices.size());
+            vertices.insert(vertices.end(), mesh.Vertices.begin(), mesh.Vertices.end());
+            for (uint32_t index: mesh.Indices) {
+                indices.push_back(baseVertex + index);
+            }
+        }
+        if (!DebugCheck(!indices.empty(), "{} has no triangles.", source)) {
+            return 1;
+        }
+    } else {
+        DebugError("Unknown mesh source {}.", source);
+        return 1;
+    }
+    const bool indicesValid = std::all_of(indices.begin(), indices.end(), [&vertices](uint32_t index) { return index < vertices.size(); });
+    if (!DebugCheck(indicesValid, "{} has indices out of range of its {} vertices.", source, vertices.size())) {
+        return 1;
+    }
+    logStage("source");
+
+    MeshFileData data;
+    BuildLodChain(vertices.data(), vertices.size(), indices.data(), indices.size(), data.Lods, data.Indices, maxLods);
+    logStage("lods");
+
+    // meshlets are built over LOD 0 and appended to the same index stream
+    if (buildMeshlets) {
+        const MeshLod &lod0 = data.Lods[0];
+        const std::vector<uint32_t> lod0Indices(data.Indices.begin() + lod0.FirstIndex, data.Indices.begin() + lod0.FirstIndex + lod0.IndexCount);
+        std::vector<uint32_t> meshletIndices;
+        BuildMeshlets(vertices.data(), vertices.size(), lod0Indices.data(), lod0Indices.size(), data.Meshlets, meshletIndices);
+        const auto meshletIndexBase = static_cast<uint32_t>(data.Indices.size());
+        for (Meshlet &meshlet: data.Meshlets) {
+            meshlet.FirstIndex += meshletIndexBase;
+        }
+        data.Indices.insert(data.Indices.end(), meshletIndices.begin(), meshletIndices.end());
+        logStage("meshlets");
+    }
+
+    data.Vertices = std::move(vertices);
+    if (!WriteMeshFile(outputFilename, data)) {
+        DebugError("Failed to write {}.", outputFilename);
+        return 1;
+    }
+    logStage("write");
+
+    DebugInfo(
+            "{}: {} vertices, {} indices, {} LODs, {} meshlets",
+            outputFilename, data.Vertices.size(), data.Indices.size(), data.Lods.size(), data.Meshlets.size()
+    );
+    return 0;
+}
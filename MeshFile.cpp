@@ -0,0 +1,193 @@
+//
+// Created by andyroiiid on 12/30/2022.
+//
+
+#include "MeshFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <glm/common.hpp>
+
+#include "Debug.h"
+
+static constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ull;
+static constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4Full;
+static constexpr uint64_t Prime3 = 0x165667B19E3779F9ull;
+
+static inline uint64_t RotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t MixLane(uint64_t lane, uint64_t value) {
+    return RotateLeft(lane + value * Prime2, 31) * Prime1;
+}
+
+static inline uint64_t ReadUint64(const uint8_t *data) {
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+// Four independent multiply-rotate lanes over 32 byte blocks (the xxHash64 round),
+// fast enough that validating a mapped file is not slower than reading it from disk.
+uint64_t ComputeMeshFileChecksum(const void *data, size_t size) {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    uint64_t lanes[4] = {Prime1 + Prime2, Prime2, 0, 0 - Prime1};
+
+    size_t offset = 0;
+    for (; offset + 32 <= size; offset += 32) {
+        lanes[0] = MixLane(lanes[0], ReadUint64(bytes + offset));
+        lanes[1] = MixLane(lanes[1], ReadUint64(bytes + offset + 8));
+        lanes[2] = MixLane(lanes[2], ReadUint64(bytes + offset + 16));
+        lanes[3] = MixLane(lanes[3], ReadUint64(bytes + offset + 24));
+    }
+
+    uint64_t hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+    hash += size;
+    for (; offset < size; offset++) {
+        hash = RotateLeft(hash ^ (bytes[offset] * Prime3), 11) * Prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= Prime2;
+    hash ^= hash >> 29;
+    hash *= Prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+static uint64_t AlignUp(uint64_t value) {
+    return (value + MeshFileAlignment - 1) / MeshFileAlignment * MeshFileAlignment;
+}
+
+bool WriteMeshFile(const std::string &filename, const MeshFileData &data) {
+    // the GPU reads whatever vertex an index points at, so a broken mesh never makes it into a file
+    for (size_t i = 0; i < data.Indices.size(); i++) {
+        if (!DebugCheck(data.Indices[i] < data.Vertices.size(), "Index {} of {} is {}, the mesh has {} vertices.", i, filename, data.Indices[i], data.Vertices.size())) {
+            return false;
+        }
+    }
+
+    MeshFileHeader header{};
+    header.Magic = MeshFileMagic;
+    header.Version = MeshFileVersion;
+    header.HeaderSize = sizeof(MeshFileHeader);
+    header.VertexSize = sizeof(VertexBase);
+    header.VertexCount = data.Vertices.size();
+    header.IndexCount = data.Indices.size();
+    header.LodCount = data.Lods.size();
+    header.MeshletCount = data.Meshlets.size();
+
+    glm::vec3 boundsMin{std::numeric_limits<float>::max()};
+    glm::vec3 boundsMax{-std::numeric_limits<float>::max()};
+    for (const VertexBase &vertex: data.Vertices) {
+        boundsMin = glm::min(boundsMin, vertex.Position);
+        boundsMax = glm::max(boundsMax, vertex.Position);
+    }
+    for (int i = 0; i < 3; i++) {
+        header.BoundsMin[i] = boundsMin[i];
+        header.BoundsMax[i] = boundsMax[i];
+    }
+
+    uint64_t offset = AlignUp(sizeof(MeshFileHeader));
+    auto placeStream = [&offset](MeshFileStream &stream, uint64_t size) {
+        stream.Offset = offset;
+        stream.Size = size;
+        offset = AlignUp(offset + size);
+    };
+    placeStream(header.Vertices, data.Vertices.size() * sizeof(VertexBase));
+    placeStream(header.Indices, data.Indices.size() * sizeof(uint32_t));
+    placeStream(header.Lods, data.Lods.size() * sizeof(MeshLod));
+    placeStream(header.Meshlets, data.Meshlets.size() * sizeof(Meshlet));
+    header.FileSize = offset;
+
+    // padding stays zero so the checksum is deterministic
+    std::vector<uint8_t> bytes(header.FileSize, 0);
+    memcpy(bytes.data() + header.Vertices.Offset, data.Vertices.data(), header.Vertices.Size);
+    memcpy(bytes.data() + header.Indices.Offset, data.Indices.data(), header.Indices.Size);
+    memcpy(bytes.data() + header.Lods.Offset, data.Lods.data(), header.Lods.Size);
+    memcpy(bytes.data() + header.Meshlets.Offset, data.Meshlets.data(), header.Meshlets.Size);
+    header.Checksum = ComputeMeshFileChecksum(bytes.data() + sizeof(MeshFileHeader), bytes.size() - sizeof(MeshFileHeader));
+    memcpy(bytes.data(), &header, sizeof(MeshFileHeader));
+
+    return WriteFile(filename, bytes.data(), bytes.size());
+}
+
+static bool IsStreamValid(const MeshFileStream &stream, uint64_t expectedSize, uint64_t fileSize) {
+    return stream.Size == expectedSize && stream.Offset % MeshFileAlignment == 0 && stream.Offset <= fileSize && stream.Size <= fileSize - stream.Offset;
+}
+
+MeshFile::MeshFile(const std::string &filename, bool validateChecksum) {
+    MappedFile file(filename);
+    if (!DebugCheck(file.IsValid(), "Failed to map mesh file {}.", filename)) {
+        return;
+    }
+
+    const size_t fileSize = file.GetSize();
+    const auto *header = static_cast<const MeshFileHeader *>(file.GetData());
+    const bool headerValid = fileSize >= sizeof(MeshFileHeader) &&
+                             header->Magic == MeshFileMagic &&
+                             header->Version == MeshFileVersion &&
+                             header->HeaderSize == sizeof(MeshFileHeader) &&
+                             header->VertexSize == sizeof(VertexBase) &&
+                             header->FileSize == fileSize;
+    if (!DebugCheck(headerValid, "{} is not a version {} mesh file.", filename, MeshFileVersion)) {
+        return;
+    }
+
+    const bool streamsValid = IsStreamValid(header->Vertices, uint64_t(header->VertexCount) * sizeof(VertexBase), fileSize) &&
+                              IsStreamValid(header->Indices, uint64_t(header->IndexCount) * sizeof(uint32_t), fileSize) &&
+                              IsStreamValid(header->Lods, uint64_t(header->LodCount) * sizeof(MeshLod), fileSize) &&
+                              IsStreamValid(header->Meshlets, uint64_t(header->MeshletCount) * sizeof(Meshlet), fileSize);
+    if (!DebugCheck(streamsValid, "Mesh file {} has invalid streams.", filename)) {
+        return;
+    }
+
+    // index ranges are checked even without the checksum, they are cheap and a bad one would read past the buffers
+    const auto *lods = reinterpret_cast<const MeshLod *>(static_cast<const uint8_t *>(file.GetData()) + header->Lods.Offset);
+    const auto *meshlets = reinterpret_cast<const Meshlet *>(static_cast<const uint8_t *>(file.GetData()) + header->Meshlets.Offset);
+    bool rangesValid = true;
+    for (uint32_t i = 0; i < header->LodCount; i++) {
+        rangesValid = rangesValid && lods[i].FirstIndex <= header->IndexCount && lods[i].IndexCount <= header->IndexCount - lods[i].FirstIndex;
+    }
+    for (uint32_t i = 0; i < header->MeshletCount; i++) {
+        rangesValid = rangesValid && meshlets[i].FirstIndex <= header->IndexCount && meshlets[i].IndexCount <= header->IndexCount - meshlets[i].FirstIndex;
+    }
+    if (!DebugCheck(rangesValid, "Mesh file {} has invalid index ranges.", filename)) {
+        return;
+    }
+
+    // so are the indices themselves, the GPU would fetch vertices past the end of the buffer
+    const auto *indices = reinterpret_cast<const uint32_t *>(static_cast<const uint8_t *>(file.GetData()) + header->Indices.Offset);
+    uint32_t maxIndex = 0;
+    for (uint32_t i = 0; i < header->IndexCount; i++) {
+        maxIndex = std::max(maxIndex, indices[i]);
+    }
+    if (!DebugCheck(
+            header->IndexCount == 0 || maxIndex < header->VertexCount,
+            "Mesh file {} has index {}, but only {} vertices.", filename, maxIndex, header->VertexCount
+    )) {
+        return;
+    }
+
+    if (validateChecksum) {
+        const uint64_t checksum = ComputeMeshFileChecksum(header + 1, fileSize - sizeof(MeshFileHeader));
+        if (!DebugCheck(checksum == header->Checksum, "Mesh file {} is corrupted.", filename)) {
+            return;
+        }
+    }
+
+    m_file = std::move(file);
+    m_header = header;
+}
+
+void MeshFile::Release() {
+    m_file = {};
+    m_header = nullptr;
+}
+
+void MeshFile::Swap(MeshFile &other) noexcept {
+    std::swap(m_file, other.m_file);
+    std::swap(m_header, other.m_header);
+}
@@ -0,0 +1,128 @@
+//
+// Created by andyroiiid on 12/30/2022.
+//
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "Files.h"
+#include "VertexBase.h"
+#include "MeshLod.h"
+#include "MeshletBuilder.h"
+
+// On disk layout of a .mesh file, little endian, version 1:
+// MeshFileHeader, then the vertex, index, LOD and meshlet streams, each at a MeshFileAlignment aligned offset.
+// Every stream is a raw array of the in memory type, so a mapped file is used in place without parsing.
+// The index stream holds every LOD and the meshlet index ranges, MeshLod and Meshlet index into it.
+static constexpr uint32_t MeshFileMagic = 0x4853454D; // "MESH"
+static constexpr uint32_t MeshFileVersion = 1;
+static constexpr uint64_t MeshFileAlignment = 64;
+
+struct MeshFileStream {
+    uint64_t Offset;
+    uint64_t Size;
+};
+
+struct MeshFileHeader {
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t HeaderSize;
+    uint32_t VertexSize;
+    uint64_t FileSize;
+    // checksum of everything after the header, see ComputeMeshFileChecksum
+    uint64_t Checksum;
+
+    uint32_t VertexCount;
+    uint32_t IndexCount;
+    uint32_t LodCount;
+    uint32_t MeshletCount;
+
+    float BoundsMin[3];
+    float BoundsMax[3];
+
+    MeshFileStream Vertices;
+    MeshFileStream Indices;
+    MeshFileStream Lods;
+    MeshFileStream Meshlets;
+};
+
+struct MeshFileData {
+    std::vector<VertexBase> Vertices;
+    std::vector<uint32_t> Indices;
+    std::vector<MeshLod> Lods;
+    std::vector<Meshlet> Meshlets;
+};
+
+uint64_t ComputeMeshFileChecksum(const void *data, size_t size);
+
+// computes the bounds and the checksum, false when an index is out of range of the vertices
+bool WriteMeshFile(const std::string &filename, const MeshFileData &data);
+
+// Maps a .mesh file and validates it, the stream pointers point straight into the mapping.
+class MeshFile {
+public:
+    MeshFile() = default;
+
+    // checksum validation reads every byte once, skip it for trusted files.
+    // Indices and index ranges are checked against the vertex and index counts either way.
+    explicit MeshFile(const std::string &filename, bool validateChecksum = true);
+
+    ~MeshFile() {
+        Release();
+    }
+
+    MeshFile(const MeshFile &) = delete;
+
+    MeshFile &operator=(const MeshFile &) = delete;
+
+    MeshFile(MeshFile &&other) noexcept {
+        Swap(other);
+    }
+
+    MeshFile &operator=(MeshFile &&other) noexcept {
+        if (this != &other) {
+            Release();
+            Swap(other);
+        }
+        return *this;
+    }
+
+    void Release();
+
+    void Swap(MeshFile &other) noexcept;
+
+    [[nodiscard]] bool IsValid() const { return m_header != nullptr; }
+
+    [[nodiscard]] const MeshFileHeader &GetHeader() const { return *m_header; }
+
+    [[nodiscard]] uint32_t GetVertexCount() const { return m_header->VertexCount; }
+
+    [[nodiscard]] uint32_t GetIndexCount() const { return m_header->IndexCount; }
+
+    [[nodiscard]] uint32_t GetLodCount() const { return m_header->LodCount; }
+
+    [[nodiscard]] uint32_t GetMeshletCount() const { return m_header->MeshletCount; }
+
+    [[nodiscard]] glm::vec3 GetBoundsMin() const { return {m_header->BoundsMin[0], m_header->BoundsMin[1], m_header->BoundsMin[2]}; }
+
+    [[nodiscard]] glm::vec3 GetBoundsMax() const { return {m_header->BoundsMax[0], m_header->BoundsMax[1], m_header->BoundsMax[2]}; }
+
+    [[nodiscard]] const VertexBase *GetVertices() const { return GetStream<VertexBase>(m_header->Vertices); }
+
+    [[nodiscard]] const uint32_t *GetIndices() const { return GetStream<uint32_t>(m_header->Indices); }
+
+    [[nodiscard]] const MeshLod *GetLods() const { return GetStream<MeshLod>(m_header->Lods); }
+
+    [[nodiscard]] const Meshlet *GetMeshlets() const { return GetStream<Meshlet>(m_header->Meshlets); }
+
+private:
+    template<class T>
+    const T *GetStream(const MeshFileStream &stream) const {
+        return reinterpret_cast<const T *>(static_cast<const uint8_t *>(m_file.GetData()) + stream.Offset);
+    }
+
+    MappedFile m_file;
+    const MeshFileHeader *m_header = nullptr;
+};
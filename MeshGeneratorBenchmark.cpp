@@ -0,0 +1,102 @@
+//
+// Created by andyroiiid on 12/31/2022.
+//
+
+#include <chrono>
+#include <limits>
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Debug.h"
+#include "MeshUtilities.h"
+#include "ThreadPool.h"
+
+// Builds a stress scene of about 10M triangles single threaded and on a thread pool and prints the timings.
+int main() {
+    constexpr uint32_t numBoxes = 1 << 18;
+    constexpr uint32_t numSpheres = 1024;
+    constexpr uint32_t sphereSegments = 64;
+    constexpr uint32_t sphereRings = 32;
+    constexpr uint32_t gridCells = 1024;
+    constexpr int numRepeats = 5;
+
+    std::mt19937 random(42); // NOLINT(cert-msc51-cpp)
+    std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+    std::uniform_real_distribution<float> size(0.5f, 4.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+
+    std::vector<glm::vec3> boxMins(numBoxes);
+    std::vector<glm::vec3> boxMaxs(numBoxes);
+    for (uint32_t i = 0; i < numBoxes; i++) {
+        boxMins[i] = {position(random), position(random) * 0.1f, position(random)};
+        boxMaxs[i] = boxMins[i] + glm::vec3{size(random), size(random), size(random)};
+    }
+
+    std::vector<glm::mat4> sphereTransforms(numSpheres);
+    for (glm::mat4 &transform: sphereTransforms) {
+        transform = glm::translate(glm::mat4{1.0f}, glm::vec3{position(random), position(random) * 0.1f, position(random)});
+        transform = glm::rotate(transform, angle(random), glm::vec3{0.0f, 1.0f, 0.0f});
+        transform = glm::scale(transform, glm::vec3{size(random), size(random), size(random)});
+    }
+
+    std::vector<float> heights((gridCells + 1) * (gridCells + 1));
+    for (uint32_t z = 0; z <= gridCells; z++) {
+        for (uint32_t x = 0; x <= gridCells; x++) {
+            heights[z * (gridCells + 1) + x] = glm::sin(static_cast<float>(x) * 0.05f) * glm::cos(static_cast<float>(z) * 0.05f) * 8.0f;
+        }
+    }
+
+    // one sphere is generated up front and copied by transform, like instanced props baked into one buffer
+    const MeshSize sphereSize = GetSphereSize(sphereSegments, sphereRings);
+    std::vector<VertexBase> sphereVertices(sphereSize.VertexCount);
+    std::vector<uint32_t> sphereIndices(sphereSize.IndexCount);
+    GenerateSphere(sphereVertices.data(), sphereIndices.data(), 0, glm::vec3{0.0f}, 1.0f, sphereSegments, sphereRings);
+
+    const MeshSize boxesSize = GetBoxSize() * numBoxes;
+    const MeshSize spheresSize = sphereSize * numSpheres;
+    const MeshSize gridSize = GetGridSize(gridCells, gridCells);
+    MeshSize sceneSize;
+    sceneSize += boxesSize;
+    sceneSize += spheresSize;
+    sceneSize += gridSize;
+    DebugInfo("{} vertices, {} triangles", sceneSize.VertexCount, sceneSize.IndexCount / 3);
+
+    std::vector<VertexBase> vertices(sceneSize.VertexCount);
+    std::vector<uint32_t> indices(sceneSize.IndexCount);
+
+    ThreadPool threadPool;
+    for (ThreadPool *pool: {static_cast<ThreadPool *>(nullptr), &threadPool}) {
+        // keep the fastest run to filter out scheduling noise
+        double bestSeconds = std::numeric_limits<double>::max();
+        for (int i = 0; i < numRepeats; i++) {
+            const auto start = std::chrono::high_resolution_clock::now();
+
+            VertexBase *vertexCursor = vertices.data();
+            uint32_t *indexCursor = indices.data();
+            uint32_t baseVertex = 0;
+            GenerateBoxes(vertexCursor, indexCursor, baseVertex, boxMins.data(), boxMaxs.data(), numBoxes, pool);
+            vertexCursor += boxesSize.VertexCount;
+            indexCursor += boxesSize.IndexCount;
+            baseVertex += boxesSize.VertexCount;
+
+            GenerateTransformedCopies(
+                    vertexCursor, indexCursor, baseVertex,
+                    sphereVertices.data(), sphereSize.VertexCount, sphereIndices.data(), sphereSize.IndexCount,
+                    sphereTransforms.data(), numSpheres, pool
+            );
+            vertexCursor += spheresSize.VertexCount;
+            indexCursor += spheresSize.IndexCount;
+            baseVertex += spheresSize.VertexCount;
+
+            GenerateGrid(vertexCursor, indexCursor, baseVertex, glm::vec3{-1000.0f, 0.0f, -1000.0f}, glm::vec2{2000.0f}, gridCells, gridCells, heights.data(), pool);
+
+            const auto end = std::chrono::high_resolution_clock::now();
+            bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(end - start).count());
+        }
+
+        const uint32_t numThreads = pool ? pool->GetNumThreads() + 1 : 1;
+        DebugInfo("{:>2} threads: {:.3f} ms, {:.1f} M triangles/s", numThreads, bestSeconds * 1000.0, sceneSize.IndexCount / 3 / (bestSeconds * 1e6));
+    }
+
+    return 0;
+}
@@ -0,0 +1,276 @@
+//
+// Created by andyroiiid on 12/29/2022.
+//
+
+#include "MeshLod.h"
+
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+
+// symmetric 4x4 error quadric in double precision, Q(p) = p'Ap + 2b'p + c
+struct Quadric {
+    double A00 = 0.0, A01 = 0.0, A02 = 0.0, A11 = 0.0, A12 = 0.0, A22 = 0.0;
+    double B0 = 0.0, B1 = 0.0, B2 = 0.0;
+    double C = 0.0;
+    double Weight = 0.0;
+
+    void AddPlane(const glm::vec3 &normal, float distance, double weight) {
+        const double x = normal.x, y = normal.y, z = normal.z, d = distance;
+        A00 += weight * x * x;
+        A01 += weight * x * y;
+        A02 += weight * x * z;
+        A11 += weight * y * y;
+        A12 += weight * y * z;
+        A22 += weight * z * z;
+        B0 += weight * x * d;
+        B1 += weight * y * d;
+        B2 += weight * z * d;
+        C += weight * d * d;
+        Weight += weight;
+    }
+
+    Quadric &operator+=(const Quadric &other) {
+        A00 += other.A00;
+        A01 += other.A01;
+        A02 += other.A02;
+        A11 += other.A11;
+        A12 += other.A12;
+        A22 += other.A22;
+        B0 += other.B0;
+        B1 += other.B1;
+        B2 += other.B2;
+        C += other.C;
+        Weight += other.Weight;
+        return *this;
+    }
+
+    // area weighted sum of squared distances to the planes
+    [[nodiscard]] double Evaluate(const glm::vec3 &point) const {
+        const double x = point.x, y = point.y, z = point.z;
+        const double result = A00 * x * x + 2.0 * A01 * x * y + 2.0 * A02 * x * z
+                              + A11 * y * y + 2.0 * A12 * y * z + A22 * z * z
+                              + 2.0 * (B0 * x + B1 * y + B2 * z) + C;
+        return std::max(result, 0.0);
+    }
+};
+
+struct Collapse {
+    uint32_t From;
+    uint32_t To;
+    double Cost;
+};
+
+static uint64_t GetEdgeKey(uint32_t a, uint32_t b) {
+    return a < b ? (static_cast<uint64_t>(a) << 32 | b) : (static_cast<uint64_t>(b) << 32 | a);
+}
+
+float SimplifyMesh(
+        const VertexBase *vertices,
+        size_t vertexCount,
+        const uint32_t *indices,
+        size_t indexCount,
+        size_t targetIndexCount,
+        std::vector<uint32_t> &result
+) {
+    result.assign(indices, indices + indexCount);
+
+    // an edge used by only one triangle is on a border
+    std::vector<bool> locked(vertexCount, false);
+    {
+        std::vector<uint64_t> edges;
+        edges.reserve(indexCount);
+        for (size_t i = 0; i < indexCount; i += 3) {
+            for (size_t k = 0; k < 3; k++) {
+                edges.push_back(GetEdgeKey(indices[i + k], indices[i + (k + 1) % 3]));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        for (size_t i = 0; i < edges.size();) {
+            size_t j = i + 1;
+            while (j < edges.size() && edges[j] == edges[i]) {
+                j++;
+            }
+            if (j - i == 1) {
+                locked[edges[i] >> 32] = true;
+                locked[edges[i] & 0xFFFFFFFF] = true;
+            }
+            i = j;
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < indexCount; i += 3) {
+        const glm::vec3 &p0 = vertices[indices[i]].Position;
+        const glm::vec3 &p1 = vertices[indices[i + 1]].Position;
+        const glm::vec3 &p2 = vertices[indices[i + 2]].Position;
+        const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        const float length = glm::length(normal);
+        if (length == 0.0f) {
+            continue;
+        }
+        const glm::vec3 unitNormal = normal / length;
+        const float distance = -glm::dot(unitNormal, p0);
+        for (size_t k = 0; k < 3; k++) {
+            quadrics[indices[i + k]].AddPlane(unitNormal, distance, length * 0.5);
+        }
+    }
+
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<bool> touched(vertexCount);
+    std::vector<uint32_t> remap(vertexCount);
+    std::iota(remap.begin(), remap.end(), 0);
+
+    double maxError = 0.0;
+    while (result.size() > targetIndexCount) {
+        // every interior edge shows up once per direction, so each half edge only proposes moving its start
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (size_t k = 0; k < 3; k++) {
+                const uint32_t from = result[i + k];
+                const uint32_t to = result[i + (k + 1) % 3];
+                if (locked[from]) {
+                    continue;
+                }
+                const glm::vec3 &position = vertices[to].Position;
+                collapses.push_back({from, to, quadrics[from].Evaluate(position) + quadrics[to].Evaluate(position)});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.Cost < b.Cost; });
+
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (uint32_t index: result) {
+            adjacencyOffsets[index + 1]++;
+        }
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+        adjacency.resize(result.size());
+        {
+            std::vector<uint32_t> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < result.size(); i++) {
+                adjacency[fillOffsets[result[i]]++] = i / 3;
+            }
+        }
+
+        // collapses in one pass must not share triangles, so the adjacency above stays valid
+        std::fill(touched.begin(), touched.end(), false);
+        const size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+        size_t trianglesRemoved = 0;
+        for (const Collapse &collapse: collapses) {
+            if (trianglesRemoved >= trianglesToRemove) {
+                break;
+            }
+            if (touched[collapse.From] || touched[collapse.To]) {
+                continue;
+            }
+
+            // reject collapses that flip a remaining triangle
+            const glm::vec3 &target = vertices[collapse.To].Position;
+            size_t collapsedTriangles = 0;
+            bool flips = false;
+            for (uint32_t j = adjacencyOffsets[collapse.From]; j < adjacencyOffsets[collapse.From + 1] && !flips; j++) {
+                const uint32_t *triangle = &result[adjacency[j] * 3];
+                if (triangle[0] == collapse.To || triangle[1] == collapse.To || triangle[2] == collapse.To) {
+                    collapsedTriangles++;
+                    continue;
+                }
+                glm::vec3 positions[3];
+                glm::vec3 movedPositions[3];
+                for (int k = 0; k < 3; k++) {
+                    positions[k] = vertices[triangle[k]].Position;
+                    movedPositions[k] = triangle[k] == collapse.From ? target : positions[k];
+                }
+                const glm::vec3 normal = glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+                const glm::vec3 movedNormal = glm::cross(movedPositions[1] - movedPositions[0], movedPositions[2] - movedPositions[0]);
+                flips = glm::dot(normal, movedNormal) <= 0.0f;
+            }
+            if (flips) {
+                continue;
+            }
+
+            for (uint32_t j = adjacencyOffsets[collapse.From]; j < adjacencyOffsets[collapse.From + 1]; j++) {
+                const uint32_t *triangle = &result[adjacency[j] * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+            }
+            remap[collapse.From] = collapse.To;
+            const double weight = quadrics[collapse.From].Weight + quadrics[collapse.To].Weight;
+            if (weight > 0.0) {
+                maxError = std::max(maxError, collapse.Cost / weight);
+            }
+            quadrics[collapse.To] += quadrics[collapse.From];
+            trianglesRemoved += collapsedTriangles;
+        }
+
+        if (trianglesRemoved == 0) {
+            break;
+        }
+
+        size_t writeIndex = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            const uint32_t a = remap[result[i]];
+            const uint32_t b = remap[result[i + 1]];
+            const uint32_t c = remap[result[i + 2]];
+            if (a == b || b == c || c == a) {
+                continue;
+            }
+            result[writeIndex++] = a;
+            result[writeIndex++] = b;
+            result[writeIndex++] = c;
+        }
+        result.resize(writeIndex);
+    }
+
+    // the cost is an area weighted squared distance
+    return static_cast<float>(std::sqrt(maxError));
+}
+
+void BuildLodChain(
+        const VertexBase *vertices,
+        size_t vertexCount,
+        const uint32_t *indices,
+        size_t indexCount,
+        std::vector<MeshLod> &lods,
+        std::vector<uint32_t> &lodIndices,
+        uint32_t maxLods,
+        float reduction
+) {
+    lods.push_back({static_cast<uint32_t>(lodIndices.size()), static_cast<uint32_t>(indexCount), 0.0f});
+    lodIndices.insert(lodIndices.end(), indices, indices + indexCount);
+
+    // every level is simplified from the previous one, so the errors add up
+    std::vector<uint32_t> previous(indices, indices + indexCount);
+    std::vector<uint32_t> simplified;
+    float error = 0.0f;
+    for (uint32_t lod = 1; lod < maxLods; lod++) {
+        const size_t targetIndexCount = static_cast<size_t>(static_cast<float>(previous.size() / 3) * reduction) * 3;
+        error += SimplifyMesh(vertices, vertexCount, previous.data(), previous.size(), targetIndexCount, simplified);
+        if (simplified.size() * 10 > previous.size() * 9) {
+            break;
+        }
+
+        lods.push_back({static_cast<uint32_t>(lodIndices.size()), static_cast<uint32_t>(simplified.size()), error});
+        lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.end());
+        std::swap(previous, simplified);
+    }
+}
+
+float GetLodProjectionScale(float fovY, float viewportHeight) {
+    return viewportHeight / (2.0f * glm::tan(fovY * 0.5f));
+}
+
+uint32_t SelectLod(const float *lodErrors, uint32_t lodCount, float distance, const LodSelection &selection, uint32_t previousLod) {
+    const float pixelsPerUnit = selection.ProjectionScale / std::max(distance, 1e-4f);
+    const float coarserThreshold = selection.ErrorThreshold * (1.0f - selection.Hysteresis);
+    uint32_t lod = 0;
+    while (lod + 1 < lodCount) {
+        const float threshold = lod + 1 > previousLod ? coarserThreshold : selection.ErrorThreshold;
+        if (lodErrors[lod + 1] * pixelsPerUnit > threshold) {
+            break;
+        }
+        lod++;
+    }
+    return lod;
+}
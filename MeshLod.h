@@ -0,0 +1,59 @@
+//
+// Created by andyroiiid on 12/29/2022.
+//
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "VertexBase.h"
+
+// Collapses edges onto existing vertices by quadric error until indexCount is at most targetIndexCount
+// or nothing can be collapsed any more, so the result still indexes the original vertex buffer.
+// Vertices on open borders (including UV seams, which are borders in index space) never move.
+// Writes the simplified triangle list to result and returns the geometric error in mesh units.
+float SimplifyMesh(
+        const VertexBase *vertices,
+        size_t vertexCount,
+        const uint32_t *indices,
+        size_t indexCount,
+        size_t targetIndexCount,
+        std::vector<uint32_t> &result
+);
+
+struct MeshLod {
+    // range in the LOD index buffer, all LODs share the vertices
+    uint32_t FirstIndex;
+    uint32_t IndexCount;
+    // accumulated geometric error in mesh units, 0 for LOD 0
+    float Error;
+};
+
+// Appends LOD 0 (a copy of indices) and up to maxLods - 1 simplified levels to lodIndices,
+// every level aims for reduction times the triangles of the previous one.
+// Stops early once a level would not remove at least 10% of the triangles.
+void BuildLodChain(
+        const VertexBase *vertices,
+        size_t vertexCount,
+        const uint32_t *indices,
+        size_t indexCount,
+        std::vector<MeshLod> &lods,
+        std::vector<uint32_t> &lodIndices,
+        uint32_t maxLods = 4,
+        float reduction = 0.5f
+);
+
+struct LodSelection {
+    // pixels covered by one unit at distance 1, see GetLodProjectionScale
+    float ProjectionScale = 1.0f;
+    // the coarsest LOD whose projected error stays under this many pixels is used
+    float ErrorThreshold = 1.0f;
+    // switching to a coarser LOD than last frame needs the error to be this fraction below the threshold
+    float Hysteresis = 0.25f;
+};
+
+float GetLodProjectionScale(float fovY, float viewportHeight);
+
+// lodErrors is sorted from fine to coarse, distance is from the camera to the closest point of the bounding sphere
+uint32_t SelectLod(const float *lodErrors, uint32_t lodCount, float distance, const LodSelection &selection, uint32_t previousLod);
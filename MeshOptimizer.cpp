@@ -0,0 +1,187 @@
+//
+// Created by andyroiiid on 12/31/2022.
+//
+
+#include "MeshOptimizer.h"
+
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+    struct VertexHash {
+        size_t operator()(const VertexBase &vertex) const {
+            // FNV-1a over the raw bytes, VertexBase has no padding
+            const auto *bytes = reinterpret_cast<const uint8_t *>(&vertex);
+            uint64_t hash = 0xCBF29CE484222325ull;
+            for (size_t i = 0; i < sizeof(VertexBase); i++) {
+                hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+            }
+            return hash;
+        }
+    };
+
+    struct VertexEqual {
+        bool operator()(const VertexBase &a, const VertexBase &b) const {
+            return memcmp(&a, &b, sizeof(VertexBase)) == 0;
+        }
+    };
+}
+
+void WeldVertices(std::vector<VertexBase> &vertices, std::vector<uint32_t> &indices) {
+    static_assert(sizeof(VertexBase) == sizeof(float) * 8, "VertexBase must not contain padding.");
+
+    std::unordered_map<VertexBase, uint32_t, VertexHash, VertexEqual> uniqueVertices;
+    uniqueVertices.reserve(vertices.size());
+    std::vector<uint32_t> remap(vertices.size());
+    uint32_t numUnique = 0;
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const auto [it, inserted] = uniqueVertices.emplace(vertices[i], numUnique);
+        if (inserted) {
+            vertices[numUnique++] = vertices[i];
+        }
+        remap[i] = it->second;
+    }
+    vertices.resize(numUnique);
+
+    for (uint32_t &index: indices) {
+        index = remap[index];
+    }
+}
+
+void OptimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // triangles around every vertex, in compressed sparse row form
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < indexCount; i++) {
+        adjacencyOffsets[indices[i] + 1]++;
+    }
+    for (size_t i = 0; i < vertexCount; i++) {
+        adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+    }
+    std::vector<uint32_t> adjacency(indexCount);
+    {
+        std::vector<uint32_t> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < indexCount; i++) {
+            adjacency[fillOffsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        liveTriangles[i] = adjacencyOffsets[i + 1] - adjacencyOffsets[i];
+    }
+
+    std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(indexCount);
+
+    constexpr int64_t NoVertex = -1;
+    int64_t fanningVertex = 0;
+    uint32_t timestamp = cacheSize + 1;
+    size_t scanCursor = 0;
+    while (fanningVertex != NoVertex) {
+        // emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (uint32_t j = adjacencyOffsets[fanningVertex]; j < adjacencyOffsets[fanningVertex + 1]; j++) {
+            const uint32_t triangle = adjacency[j];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = true;
+            for (uint32_t k = 0; k < 3; k++) {
+                const uint32_t vertex = indices[triangle * 3 + k];
+                result.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+                if (timestamp - cacheTimestamps[vertex] > cacheSize) {
+                    cacheTimestamps[vertex] = timestamp++;
+                }
+            }
+        }
+
+        // the candidate that will still be in the cache after its remaining triangles are emitted, and entered it earliest
+        fanningVertex = NoVertex;
+        int64_t bestPriority = -1;
+        for (uint32_t vertex: candidates) {
+            if (liveTriangles[vertex] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            if (timestamp - cacheTimestamps[vertex] + 2 * liveTriangles[vertex] <= cacheSize) {
+                priority = timestamp - cacheTimestamps[vertex];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fanningVertex = vertex;
+            }
+        }
+
+        if (fanningVertex != NoVertex) {
+            continue;
+        }
+        // dead end, prefer recently used vertices, then scan for anything left
+        while (!deadEnds.empty() && fanningVertex == NoVertex) {
+            const uint32_t vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[vertex] > 0) {
+                fanningVertex = vertex;
+            }
+        }
+        while (fanningVertex == NoVertex && scanCursor < vertexCount) {
+            if (liveTriangles[scanCursor] > 0) {
+                fanningVertex = static_cast<int64_t>(scanCursor);
+            }
+            scanCursor++;
+        }
+    }
+
+    memcpy(indices, result.data(), result.size() * sizeof(uint32_t));
+}
+
+void OptimizeVertexFetch(std::vector<VertexBase> &vertices, std::vector<uint32_t> &indices) {
+    constexpr uint32_t Unused = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> remap(vertices.size(), Unused);
+    std::vector<VertexBase> reordered;
+    reordered.reserve(vertices.size());
+    for (uint32_t &index: indices) {
+        if (remap[index] == Unused) {
+            remap[index] = reordered.size();
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices = std::move(reordered);
+}
+
+float ComputeAcmr(const uint32_t *indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+    if (indexCount < 3) {
+        return 0.0f;
+    }
+
+    // a vertex is cached while fewer than cacheSize misses happened since it was loaded
+    std::vector<uint32_t> loadTime(vertexCount, 0);
+    uint32_t misses = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        const uint32_t vertex = indices[i];
+        if (loadTime[vertex] == 0 || misses + 1 - loadTime[vertex] >= cacheSize) {
+            misses++;
+            loadTime[vertex] = misses;
+        }
+    }
+    return static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+}
+
+void OptimizeMesh(std::vector<VertexBase> &vertices, std::vector<uint32_t> &indices) {
+    WeldVertices(vertices, indices);
+    OptimizeVertexCache(indices.data(), indices.size(), vertices.size());
+    OptimizeVertexFetch(vertices, indices);
+}
@@ -0,0 +1,25 @@
+//
+// Created by andyroiiid on 12/31/2022.
+//
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "VertexBase.h"
+
+// Merges bitwise identical vertices and remaps the indices.
+void WeldVertices(std::vector<VertexBase> &vertices, std::vector<uint32_t> &indices);
+
+// Reorders triangles for the post transform vertex cache with Tipsify (Sander, Nehab and Barczak 2007).
+void OptimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+
+// Reorders vertices by first use so vertex fetch walks memory linearly, unused vertices are dropped.
+void OptimizeVertexFetch(std::vector<VertexBase> &vertices, std::vector<uint32_t> &indices);
+
+// Average cache miss ratio (transformed vertices per triangle) of a FIFO cache, lower is better.
+float ComputeAcmr(const uint32_t *indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+
+// WeldVertices, OptimizeVertexCache and OptimizeVertexFetch in order.
+void OptimizeMesh(std::vector<VertexBase> &vertices, std::vector<uint32_t> &indices);
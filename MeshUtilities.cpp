@@ -4,6 +4,21 @@
 
 #include "MeshUtilities.h"
 
+#include <algorithm>
+#include <glm/gtc/constants.hpp>
+#include <glm/trigonometric.hpp>
+#include <glm/geometric.hpp>
+#include <glm/mat3x3.hpp>
+
+#include "ThreadPool.h"
+
+// SSE2 is part of every x86-64 target
+#if defined(_M_X64) || defined(__x86_64__)
+#define MESH_UTILITIES_SSE
+
+#include <emmintrin.h>
+#endif
+
 void AppendBoxVertices(std::vector<VertexBase> &vertices, const glm::vec3 &min, const glm::vec3 &max) {
     const glm::vec3 P000{min.x, min.y, min.z};
     const glm::vec3 P001{min.x, min.y, max.z};
@@ -84,3 +99,345 @@ void AppendBoxVertices(std::vector<VertexBase> &vertices, const glm::vec3 &min,
     vertices.emplace_back(P100, NNZ, UVZ10);
     vertices.emplace_back(P110, NNZ, UVZ11);
 }
+
+void AppendBoxVertices(std::vector<VertexBase> &vertices, std::vector<uint32_t> &indices, const glm::vec3 &min, const glm::vec3 &max) {
+    const auto baseVertex = static_cast<uint32_t>(vertices.size());
+    const size_t baseIndex = indices.size();
+    const MeshSize size = GetBoxSize();
+    vertices.resize(vertices.size() + size.VertexCount);
+    indices.resize(indices.size() + size.IndexCount);
+    GenerateBox(vertices.data() + baseVertex, indices.data() + baseIndex, baseVertex, min, max);
+}
+
+void AppendSphereVertices(std::vector<VertexBase> &vertices, std::vector<uint32_t> &indices, const glm::vec3 &center, float radius, uint32_t segments, uint32_t rings) {
+    const auto baseVertex = static_cast<uint32_t>(vertices.size());
+    const size_t baseIndex = indices.size();
+    const MeshSize size = GetSphereSize(segments, rings);
+    vertices.resize(vertices.size() + size.VertexCount);
+    indices.resize(indices.size() + size.IndexCount);
+    GenerateSphere(vertices.data() + baseVertex, indices.data() + baseIndex, baseVertex, center, radius, segments, rings);
+}
+
+// Runs func(begin, end) over [0, count), split into batches of at least minBatchSize when there is a thread pool.
+template<class Func>
+static void ForEachBatch(ThreadPool *threadPool, uint32_t count, uint32_t minBatchSize, Func &&func) {
+    minBatchSize = std::max(minBatchSize, 1u);
+    if (threadPool == nullptr || count <= minBatchSize) {
+        func(0u, count);
+        return;
+    }
+
+    // a few batches per worker so uneven batches still balance
+    const uint32_t numBatches = std::min((count + minBatchSize - 1) / minBatchSize, (threadPool->GetNumThreads() + 1) * 4);
+    threadPool->ParallelFor(numBatches, [&](uint32_t batch) {
+        const auto begin = static_cast<uint32_t>(static_cast<uint64_t>(count) * batch / numBatches);
+        const auto end = static_cast<uint32_t>(static_cast<uint64_t>(count) * (batch + 1) / numBatches);
+        func(begin, end);
+    });
+}
+
+// roughly how many vertices one batch should write, smaller batches are dominated by scheduling
+static constexpr uint32_t VerticesPerBatch = 16384;
+
+static void WriteQuadIndices(uint32_t *indices, uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    indices[0] = a;
+    indices[1] = b;
+    indices[2] = c;
+    indices[3] = c;
+    indices[4] = b;
+    indices[5] = d;
+}
+
+MeshSize GetBoxSize() {
+    return {24, 36};
+}
+
+MeshSize GetSphereSize(uint32_t segments, uint32_t rings) {
+    return {(segments + 1) * (rings + 1), segments * rings * 6};
+}
+
+MeshSize GetGridSize(uint32_t cellsX, uint32_t cellsZ) {
+    return {(cellsX + 1) * (cellsZ + 1), cellsX * cellsZ * 6};
+}
+
+MeshSize GetCylinderSize(uint32_t segments) {
+    // side rows and two caps of a center plus a rim
+    return {(segments + 1) * 2 + (segments + 2) * 2, segments * 12};
+}
+
+// the faces of the non indexed AppendBoxVertices above, corners are (x << 2 | y << 1 | z)
+struct BoxFace {
+    uint8_t Corners[4];
+    glm::vec3 Normal;
+    uint8_t UAxis;
+    uint8_t VAxis;
+};
+
+static constexpr BoxFace BoxFaces[6]{
+        {{4, 5, 6, 7}, {1, 0, 0},  2, 1},
+        {{1, 0, 3, 2}, {-1, 0, 0}, 2, 1},
+        {{2, 6, 3, 7}, {0, 1, 0},  0, 2},
+        {{1, 5, 0, 4}, {0, -1, 0}, 0, 2},
+        {{5, 1, 7, 3}, {0, 0, 1},  0, 1},
+        {{0, 4, 2, 6}, {0, 0, -1}, 0, 1},
+};
+
+void GenerateBox(VertexBase *vertices, uint32_t *indices, uint32_t baseVertex, const glm::vec3 &min, const glm::vec3 &max) {
+    const glm::vec3 size = max - min;
+    for (const BoxFace &face: BoxFaces) {
+        for (uint32_t i = 0; i < 4; i++) {
+            const uint8_t corner = face.Corners[i];
+            VertexBase &vertex = *vertices++;
+            vertex.Position = {corner & 4 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 1 ? max.z : min.z};
+            vertex.Normal = face.Normal;
+            vertex.TexCoord = {i & 1 ? size[face.UAxis] : 0.0f, i & 2 ? size[face.VAxis] : 0.0f};
+        }
+        WriteQuadIndices(indices, baseVertex, baseVertex + 1, baseVertex + 2, baseVertex + 3);
+        indices += 6;
+        baseVertex += 4;
+    }
+}
+
+void GenerateBoxes(
+        VertexBase *vertices, uint32_t *indices, uint32_t baseVertex,
+        const glm::vec3 *mins, const glm::vec3 *maxs, uint32_t count,
+        ThreadPool *threadPool
+) {
+    const MeshSize size = GetBoxSize();
+    ForEachBatch(threadPool, count, VerticesPerBatch / size.VertexCount, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            GenerateBox(vertices + i * size.VertexCount, indices + i * size.IndexCount, baseVertex + i * size.VertexCount, mins[i], maxs[i]);
+        }
+    });
+}
+
+void GenerateSphere(
+        VertexBase *vertices, uint32_t *indices, uint32_t baseVertex,
+        const glm::vec3 &center, float radius, uint32_t segments, uint32_t rings,
+        ThreadPool *threadPool
+) {
+    // every vertex is a product of one ring and one segment term, so the trigonometry is done once per row and column
+    std::vector<glm::vec2> segmentDirections(segments + 1);
+    for (uint32_t segment = 0; segment <= segments; segment++) {
+        const float phi = static_cast<float>(segment) / static_cast<float>(segments) * glm::two_pi<float>();
+        segmentDirections[segment] = {glm::cos(phi), glm::sin(phi)};
+    }
+
+    const uint32_t stride = segments + 1;
+    const uint32_t rowsPerBatch = VerticesPerBatch / stride;
+    ForEachBatch(threadPool, rings + 1, rowsPerBatch, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t ring = begin; ring < end; ring++) {
+            const float v = static_cast<float>(ring) / static_cast<float>(rings);
+            const float theta = v * glm::pi<float>();
+            const float sinTheta = glm::sin(theta);
+            const float cosTheta = glm::cos(theta);
+            VertexBase *row = vertices + ring * stride;
+            for (uint32_t segment = 0; segment <= segments; segment++) {
+                const glm::vec3 normal{sinTheta * segmentDirections[segment].x, cosTheta, sinTheta * segmentDirections[segment].y};
+                row[segment] = {center + normal * radius, normal, {static_cast<float>(segment) / static_cast<float>(segments), v}};
+            }
+        }
+    });
+
+    // same winding as the boxes above
+    ForEachBatch(threadPool, rings, rowsPerBatch, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t ring = begin; ring < end; ring++) {
+            uint32_t *row = indices + ring * segments * 6;
+            for (uint32_t segment = 0; segment < segments; segment++) {
+                const uint32_t a = baseVertex + ring * stride + segment;
+                const uint32_t b = a + 1;
+                const uint32_t c = a + stride;
+                const uint32_t d = c + 1;
+                WriteQuadIndices(row + segment * 6, a, c, b, d);
+            }
+        }
+    });
+}
+
+void GenerateGrid(
+        VertexBase *vertices, uint32_t *indices, uint32_t baseVertex,
+        const glm::vec3 &origin, const glm::vec2 &size, uint32_t cellsX, uint32_t cellsZ, const float *heights,
+        ThreadPool *threadPool
+) {
+    const uint32_t stride = cellsX + 1;
+    const glm::vec2 cellSize = size / glm::vec2{static_cast<float>(cellsX), static_cast<float>(cellsZ)};
+    auto getHeight = [heights, stride](uint32_t x, uint32_t z) {
+        return heights ? heights[z * stride + x] : 0.0f;
+    };
+
+    const uint32_t rowsPerBatch = VerticesPerBatch / stride;
+    ForEachBatch(threadPool, cellsZ + 1, rowsPerBatch, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t z = begin; z < end; z++) {
+            VertexBase *row = vertices + z * stride;
+            const uint32_t z0 = z > 0 ? z - 1 : z;
+            const uint32_t z1 = z < cellsZ ? z + 1 : z;
+            for (uint32_t x = 0; x <= cellsX; x++) {
+                // central differences, one sided on the border
+                const uint32_t x0 = x > 0 ? x - 1 : x;
+                const uint32_t x1 = x < cellsX ? x + 1 : x;
+                const float slopeX = (getHeight(x1, z) - getHeight(x0, z)) / (static_cast<float>(x1 - x0) * cellSize.x);
+                const float slopeZ = (getHeight(x, z1) - getHeight(x, z0)) / (static_cast<float>(z1 - z0) * cellSize.y);
+
+                VertexBase &vertex = row[x];
+                vertex.Position = origin + glm::vec3{static_cast<float>(x) * cellSize.x, getHeight(x, z), static_cast<float>(z) * cellSize.y};
+                vertex.Normal = glm::normalize(glm::vec3{-slopeX, 1.0f, -slopeZ});
+                vertex.TexCoord = {static_cast<float>(x) / static_cast<float>(cellsX), static_cast<float>(z) / static_cast<float>(cellsZ)};
+            }
+        }
+    });
+
+    // same winding as the +y face of the boxes
+    ForEachBatch(threadPool, cellsZ, rowsPerBatch, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t z = begin; z < end; z++) {
+            uint32_t *row = indices + z * cellsX * 6;
+            for (uint32_t x = 0; x < cellsX; x++) {
+                const uint32_t a = baseVertex + z * stride + x;
+                WriteQuadIndices(row + x * 6, a, a + 1, a + stride, a + stride + 1);
+            }
+        }
+    });
+}
+
+void GenerateCylinder(
+        VertexBase *vertices, uint32_t *indices, uint32_t baseVertex,
+        const glm::vec3 &center, float radius, float height, uint32_t segments
+) {
+    const float halfHeight = height * 0.5f;
+    const uint32_t stride = segments + 1;
+    const uint32_t topCap = stride * 2;
+    const uint32_t bottomCap = topCap + segments + 2;
+
+    vertices[topCap] = {center + glm::vec3{0.0f, halfHeight, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.5f, 0.5f}};
+    vertices[bottomCap] = {center - glm::vec3{0.0f, halfHeight, 0.0f}, {0.0f, -1.0f, 0.0f}, {0.5f, 0.5f}};
+    for (uint32_t segment = 0; segment <= segments; segment++) {
+        const float u = static_cast<float>(segment) / static_cast<float>(segments);
+        const float phi = u * glm::two_pi<float>();
+        const glm::vec3 normal{glm::cos(phi), 0.0f, glm::sin(phi)};
+        const glm::vec3 top = center + normal * radius + glm::vec3{0.0f, halfHeight, 0.0f};
+        const glm::vec3 bottom = center + normal * radius - glm::vec3{0.0f, halfHeight, 0.0f};
+        const glm::vec2 capTexCoord = glm::vec2{0.5f} + glm::vec2{normal.x, normal.z} * 0.5f;
+
+        vertices[segment] = {top, normal, {u, 0.0f}};
+        vertices[stride + segment] = {bottom, normal, {u, 1.0f}};
+        vertices[topCap + 1 + segment] = {top, {0.0f, 1.0f, 0.0f}, capTexCoord};
+        vertices[bottomCap + 1 + segment] = {bottom, {0.0f, -1.0f, 0.0f}, capTexCoord};
+    }
+
+    // the side is wound like the sphere rows, caps fan around their center
+    for (uint32_t segment = 0; segment < segments; segment++) {
+        const uint32_t a = baseVertex + segment;
+        WriteQuadIndices(indices, a, a + stride, a + 1, a + stride + 1);
+        indices += 6;
+    }
+    for (uint32_t segment = 0; segment < segments; segment++) {
+        const uint32_t rim = baseVertex + topCap + 1 + segment;
+        indices[0] = baseVertex + topCap;
+        indices[1] = rim;
+        indices[2] = rim + 1;
+        indices += 3;
+    }
+    for (uint32_t segment = 0; segment < segments; segment++) {
+        const uint32_t rim = baseVertex + bottomCap + 1 + segment;
+        indices[0] = baseVertex + bottomCap;
+        indices[1] = rim + 1;
+        indices[2] = rim;
+        indices += 3;
+    }
+}
+
+// negative determinant of the upper 3x3
+static bool IsMirroring(const glm::mat4 &transform) {
+    return glm::dot(glm::vec3{transform[0]}, glm::cross(glm::vec3{transform[1]}, glm::vec3{transform[2]})) < 0.0f;
+}
+
+// normals go through the inverse transpose, the cofactor matrix is that up to a positive scale once det's sign is applied
+static glm::mat3 GetNormalMatrix(const glm::mat4 &transform) {
+    const glm::vec3 x{transform[0]};
+    const glm::vec3 y{transform[1]};
+    const glm::vec3 z{transform[2]};
+    const float sign = IsMirroring(transform) ? -1.0f : 1.0f;
+    return glm::mat3{glm::cross(y, z) * sign, glm::cross(z, x) * sign, glm::cross(x, y) * sign};
+}
+
+#ifdef MESH_UTILITIES_SSE
+// one vertex per iteration, VertexBase is exactly two 4 float registers: (px, py, pz, nx) and (ny, nz, u, v)
+static void TransformVertices(VertexBase *vertices, const VertexBase *sourceVertices, uint32_t count, const glm::mat4 &transform) {
+    static_assert(sizeof(VertexBase) == 8 * sizeof(float));
+
+    const glm::mat3 normalMatrix = GetNormalMatrix(transform);
+    const __m128 m0 = _mm_loadu_ps(&transform[0][0]);
+    const __m128 m1 = _mm_loadu_ps(&transform[1][0]);
+    const __m128 m2 = _mm_loadu_ps(&transform[2][0]);
+    const __m128 m3 = _mm_loadu_ps(&transform[3][0]);
+    const __m128 n0 = _mm_setr_ps(normalMatrix[0][0], normalMatrix[0][1], normalMatrix[0][2], 0.0f);
+    const __m128 n1 = _mm_setr_ps(normalMatrix[1][0], normalMatrix[1][1], normalMatrix[1][2], 0.0f);
+    const __m128 n2 = _mm_setr_ps(normalMatrix[2][0], normalMatrix[2][1], normalMatrix[2][2], 0.0f);
+    const __m128 minLengthSquared = _mm_set1_ps(1e-30f);
+
+    const auto *source = reinterpret_cast<const float *>(sourceVertices);
+    auto *destination = reinterpret_cast<float *>(vertices);
+    for (uint32_t i = 0; i < count; i++, source += 8, destination += 8) {
+        const __m128 low = _mm_loadu_ps(source);
+        const __m128 high = _mm_loadu_ps(source + 4);
+
+        __m128 position = _mm_mul_ps(m0, _mm_shuffle_ps(low, low, _MM_SHUFFLE(0, 0, 0, 0)));
+        position = _mm_add_ps(position, _mm_mul_ps(m1, _mm_shuffle_ps(low, low, _MM_SHUFFLE(1, 1, 1, 1))));
+        position = _mm_add_ps(position, _mm_mul_ps(m2, _mm_shuffle_ps(low, low, _MM_SHUFFLE(2, 2, 2, 2))));
+        position = _mm_add_ps(position, m3);
+
+        __m128 normal = _mm_mul_ps(n0, _mm_shuffle_ps(low, low, _MM_SHUFFLE(3, 3, 3, 3)));
+        normal = _mm_add_ps(normal, _mm_mul_ps(n1, _mm_shuffle_ps(high, high, _MM_SHUFFLE(0, 0, 0, 0))));
+        normal = _mm_add_ps(normal, _mm_mul_ps(n2, _mm_shuffle_ps(high, high, _MM_SHUFFLE(1, 1, 1, 1))));
+        const __m128 squared = _mm_mul_ps(normal, normal);
+        __m128 lengthSquared = _mm_add_ps(
+                _mm_add_ps(_mm_shuffle_ps(squared, squared, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(1, 1, 1, 1))),
+                _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(2, 2, 2, 2))
+        );
+        lengthSquared = _mm_max_ps(lengthSquared, minLengthSquared);
+        normal = _mm_div_ps(normal, _mm_sqrt_ps(lengthSquared));
+
+        // (pz, pz, nx, nx) then (px, py, pz, nx), the texture coordinates are passed through
+        const __m128 zx = _mm_shuffle_ps(position, normal, _MM_SHUFFLE(0, 0, 2, 2));
+        _mm_storeu_ps(destination, _mm_shuffle_ps(position, zx, _MM_SHUFFLE(2, 0, 1, 0)));
+        _mm_storeu_ps(destination + 4, _mm_shuffle_ps(normal, high, _MM_SHUFFLE(3, 2, 2, 1)));
+    }
+}
+#else
+static void TransformVertices(VertexBase *vertices, const VertexBase *sourceVertices, uint32_t count, const glm::mat4 &transform) {
+    const glm::mat3 normalMatrix = GetNormalMatrix(transform);
+    for (uint32_t i = 0; i < count; i++) {
+        const VertexBase &source = sourceVertices[i];
+        vertices[i] = {
+                glm::vec3{transform * glm::vec4{source.Position, 1.0f}},
+                glm::normalize(normalMatrix * source.Normal),
+                source.TexCoord
+        };
+    }
+}
+#endif
+
+void GenerateTransformedCopies(
+        VertexBase *vertices, uint32_t *indices, uint32_t baseVertex,
+        const VertexBase *sourceVertices, uint32_t sourceVertexCount, const uint32_t *sourceIndices, uint32_t sourceIndexCount,
+        const glm::mat4 *transforms, uint32_t count,
+        ThreadPool *threadPool
+) {
+    ForEachBatch(threadPool, count, VerticesPerBatch / std::max(sourceVertexCount, 1u), [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            TransformVertices(vertices + i * sourceVertexCount, sourceVertices, sourceVertexCount, transforms[i]);
+
+            uint32_t *copyIndices = indices + i * sourceIndexCount;
+            const uint32_t copyBaseVertex = baseVertex + i * sourceVertexCount;
+            for (uint32_t j = 0; j < sourceIndexCount; j++) {
+                copyIndices[j] = sourceIndices[j] + copyBaseVertex;
+            }
+
+            // mirroring transforms turn the triangles inside out
+            if (IsMirroring(transforms[i])) {
+                for (uint32_t j = 0; j + 2 < sourceIndexCount; j += 3) {
+                    std::swap(copyIndices[j + 1], copyIndices[j + 2]);
+                }
+            }
+        }
+    });
+}
@@ -5,7 +5,79 @@
 #pragma once
 
 #include <vector>
+#include <cstdint>
 
 #include "VertexBase.h"
 
+class ThreadPool;
+
 void AppendBoxVertices(std::vector<VertexBase> &vertices, const glm::vec3 &min, const glm::vec3 &max);
+
+// indexed variant, 24 vertices and 36 indices
+void AppendBoxVertices(std::vector<VertexBase> &vertices, std::vector<uint32_t> &indices, const glm::vec3 &min, const glm::vec3 &max);
+
+// UV sphere with (segments + 1) * (rings + 1) vertices and segments * rings * 6 indices
+void AppendSphereVertices(std::vector<VertexBase> &vertices, std::vector<uint32_t> &indices, const glm::vec3 &center, float radius, uint32_t segments, uint32_t rings);
+
+// Generators below write into caller allocated arrays instead of growing vectors.
+// Each writes exactly the number of vertices and indices reported by the matching Get*Size function,
+// indices are offset by baseVertex so several meshes can be packed into one buffer.
+// With a thread pool large meshes and batches are split across its workers.
+struct MeshSize {
+    uint32_t VertexCount = 0;
+    uint32_t IndexCount = 0;
+
+    MeshSize &operator+=(const MeshSize &other) {
+        VertexCount += other.VertexCount;
+        IndexCount += other.IndexCount;
+        return *this;
+    }
+
+    [[nodiscard]] MeshSize operator*(uint32_t count) const {
+        return {VertexCount * count, IndexCount * count};
+    }
+};
+
+[[nodiscard]] MeshSize GetBoxSize();
+
+[[nodiscard]] MeshSize GetSphereSize(uint32_t segments, uint32_t rings);
+
+[[nodiscard]] MeshSize GetGridSize(uint32_t cellsX, uint32_t cellsZ);
+
+[[nodiscard]] MeshSize GetCylinderSize(uint32_t segments);
+
+void GenerateBox(VertexBase *vertices, uint32_t *indices, uint32_t baseVertex, const glm::vec3 &min, const glm::vec3 &max);
+
+// count boxes from mins[i] to maxs[i], GetBoxSize() * count elements
+void GenerateBoxes(
+        VertexBase *vertices, uint32_t *indices, uint32_t baseVertex,
+        const glm::vec3 *mins, const glm::vec3 *maxs, uint32_t count,
+        ThreadPool *threadPool = nullptr
+);
+
+void GenerateSphere(
+        VertexBase *vertices, uint32_t *indices, uint32_t baseVertex,
+        const glm::vec3 &center, float radius, uint32_t segments, uint32_t rings,
+        ThreadPool *threadPool = nullptr
+);
+
+// xz plane grid starting at origin, heights is optional and holds (cellsX + 1) * (cellsZ + 1) y offsets in rows along x
+void GenerateGrid(
+        VertexBase *vertices, uint32_t *indices, uint32_t baseVertex,
+        const glm::vec3 &origin, const glm::vec2 &size, uint32_t cellsX, uint32_t cellsZ, const float *heights = nullptr,
+        ThreadPool *threadPool = nullptr
+);
+
+// y axis cylinder with caps, center is the middle of the axis
+void GenerateCylinder(
+        VertexBase *vertices, uint32_t *indices, uint32_t baseVertex,
+        const glm::vec3 &center, float radius, float height, uint32_t segments
+);
+
+// Writes count copies of a source mesh, positions transformed by transforms[i] and normals by its inverse transpose.
+void GenerateTransformedCopies(
+        VertexBase *vertices, uint32_t *indices, uint32_t baseVertex,
+        const VertexBase *sourceVertices, uint32_t sourceVertexCount, const uint32_t *sourceIndices, uint32_t sourceIndexCount,
+        const glm::mat4 *transforms, uint32_t count,
+        ThreadPool *threadPool = nullptr
+);
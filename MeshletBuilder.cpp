@@ -0,0 +1,220 @@
+//
+// Created by andyroiiid on 12/28/2022.
+//
+
+#include "MeshletBuilder.h"
+
+#include <limits>
+#include <glm/geometric.hpp>
+
+#include "Debug.h"
+
+static constexpr uint32_t NoTriangle = std::numeric_limits<uint32_t>::max();
+
+// face normal oriented by the vertex normals, so the winding convention does not matter
+static glm::vec3 GetTriangleNormal(const VertexBase &v0, const VertexBase &v1, const VertexBase &v2) {
+    const glm::vec3 normal = glm::cross(v1.Position - v0.Position, v2.Position - v0.Position);
+    return glm::dot(normal, v0.Normal + v1.Normal + v2.Normal) < 0.0f ? -normal : normal;
+}
+
+static void ComputeMeshletBounds(const VertexBase *vertices, const uint32_t *indices, Meshlet &meshlet) {
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{-std::numeric_limits<float>::max()};
+    for (uint32_t i = 0; i < meshlet.IndexCount; i++) {
+        const glm::vec3 &position = vertices[indices[i]].Position;
+        min = glm::min(min, position);
+        max = glm::max(max, position);
+    }
+    meshlet.Center = (min + max) * 0.5f;
+    meshlet.Radius = 0.0f;
+    for (uint32_t i = 0; i < meshlet.IndexCount; i++) {
+        meshlet.Radius = glm::max(meshlet.Radius, glm::distance(meshlet.Center, vertices[indices[i]].Position));
+    }
+
+    // area weighted average normal, the cross product length is twice the area
+    glm::vec3 normalSum{0.0f};
+    for (uint32_t i = 0; i < meshlet.IndexCount; i += 3) {
+        normalSum += GetTriangleNormal(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]]);
+    }
+
+    meshlet.ConeAxis = glm::vec3{0.0f, 0.0f, 1.0f};
+    meshlet.ConeCutoff = 1.0f;
+    const float normalSumLength = glm::length(normalSum);
+    if (normalSumLength < std::numeric_limits<float>::epsilon()) {
+        return;
+    }
+    const glm::vec3 axis = normalSum / normalSumLength;
+
+    float minDot = 1.0f;
+    for (uint32_t i = 0; i < meshlet.IndexCount; i += 3) {
+        const glm::vec3 normal = GetTriangleNormal(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]]);
+        const float normalLength = glm::length(normal);
+        if (normalLength > 0.0f) {
+            minDot = glm::min(minDot, glm::dot(normal, axis) / normalLength);
+        }
+    }
+
+    // the normals span more than a hemisphere, no view direction sees only back faces
+    if (minDot <= 0.0f) {
+        return;
+    }
+    meshlet.ConeAxis = axis;
+    // sin of the cone half angle, the cull test compares against the cosine of (half angle + 90 degrees)
+    meshlet.ConeCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+void BuildMeshlets(
+        const VertexBase *vertices,
+        size_t vertexCount,
+        const uint32_t *indices,
+        size_t indexCount,
+        std::vector<Meshlet> &meshlets,
+        std::vector<uint32_t> &meshletIndices,
+        const MeshletBuildSettings &settings
+) {
+    DebugCheckCritical(indexCount % 3 == 0, "Meshlets can only be built from triangle lists.");
+    DebugCheckCritical(settings.MaxVertices >= 3 && settings.MaxTriangles >= 1, "Meshlet limits are too small.");
+
+    const auto triangleCount = static_cast<uint32_t>(indexCount / 3);
+
+    // triangles around every vertex, in compressed sparse row form
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < indexCount; i++) {
+        adjacencyOffsets[indices[i] + 1]++;
+    }
+    for (size_t i = 0; i < vertexCount; i++) {
+        adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+    }
+    std::vector<uint32_t> adjacency(indexCount);
+    {
+        std::vector<uint32_t> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < indexCount; i++) {
+            adjacency[fillOffsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    // which meshlet last used a vertex, so membership tests never need clearing
+    std::vector<uint32_t> vertexMeshlet(vertexCount, NoTriangle);
+    std::vector<uint32_t> currentVertices;
+    currentVertices.reserve(settings.MaxVertices);
+
+    Meshlet current{};
+    auto currentId = static_cast<uint32_t>(meshlets.size());
+    uint32_t currentTriangles = 0;
+    glm::vec3 currentPositionSum{0.0f};
+    glm::vec3 currentMin{std::numeric_limits<float>::max()};
+    glm::vec3 currentMax{-std::numeric_limits<float>::max()};
+
+    auto getTriangleCenter = [&](uint32_t triangle) {
+        const uint32_t *triangleIndices = indices + triangle * 3;
+        return (vertices[triangleIndices[0]].Position + vertices[triangleIndices[1]].Position + vertices[triangleIndices[2]].Position) / 3.0f;
+    };
+
+    auto countNewVertices = [&](uint32_t triangle) {
+        uint32_t count = 0;
+        for (uint32_t k = 0; k < 3; k++) {
+            count += vertexMeshlet[indices[triangle * 3 + k]] != currentId;
+        }
+        return count;
+    };
+
+    // fewest new vertices first, then closest to the meshlet centroid so meshlets grow round instead of in strips
+    auto findNeighbor = [&](const uint32_t *vertexList, size_t numVertices) {
+        const glm::vec3 centroid = currentPositionSum / static_cast<float>(currentVertices.size());
+        uint32_t best = NoTriangle;
+        uint32_t bestNewVertices = 4;
+        float bestDistance = std::numeric_limits<float>::max();
+        for (size_t i = 0; i < numVertices; i++) {
+            const uint32_t vertex = vertexList[i];
+            for (uint32_t j = adjacencyOffsets[vertex]; j < adjacencyOffsets[vertex + 1]; j++) {
+                const uint32_t triangle = adjacency[j];
+                if (emitted[triangle]) {
+                    continue;
+                }
+                const uint32_t newVertices = countNewVertices(triangle);
+                if (newVertices > bestNewVertices) {
+                    continue;
+                }
+                const glm::vec3 delta = getTriangleCenter(triangle) - centroid;
+                const float distance = glm::dot(delta, delta);
+                if (newVertices < bestNewVertices || distance < bestDistance) {
+                    best = triangle;
+                    bestNewVertices = newVertices;
+                    bestDistance = distance;
+                }
+            }
+        }
+        return best;
+    };
+
+    auto finishMeshlet = [&]() {
+        current.IndexCount = currentTriangles * 3;
+        current.VertexCount = currentVertices.size();
+        ComputeMeshletBounds(vertices, meshletIndices.data() + current.FirstIndex, current);
+        meshlets.push_back(current);
+
+        current = {};
+        currentId++;
+        currentTriangles = 0;
+        currentPositionSum = glm::vec3{0.0f};
+        currentMin = glm::vec3{std::numeric_limits<float>::max()};
+        currentMax = glm::vec3{-std::numeric_limits<float>::max()};
+        currentVertices.clear();
+    };
+
+    uint32_t seedCursor = 0;
+    uint32_t next = NoTriangle;
+    for (;;) {
+        if (next == NoTriangle) {
+            while (seedCursor < triangleCount && emitted[seedCursor]) {
+                seedCursor++;
+            }
+            if (seedCursor == triangleCount) {
+                break;
+            }
+            next = seedCursor;
+
+            // a disconnected seed may only join the current meshlet when it is about as close as the meshlet is wide
+            if (currentTriangles > 0) {
+                const float distance = glm::distance(getTriangleCenter(next), (currentMin + currentMax) * 0.5f);
+                if (distance > glm::distance(currentMin, currentMax)) {
+                    finishMeshlet();
+                }
+            }
+        }
+
+        // a triangle that does not fit starts the next meshlet, which keeps that one local too
+        if (currentTriangles > 0 && (currentTriangles == settings.MaxTriangles || currentVertices.size() + countNewVertices(next) > settings.MaxVertices)) {
+            finishMeshlet();
+        }
+
+        if (currentTriangles == 0) {
+            current.FirstIndex = meshletIndices.size();
+        }
+        const uint32_t *triangleIndices = indices + next * 3;
+        for (uint32_t k = 0; k < 3; k++) {
+            const uint32_t vertex = triangleIndices[k];
+            if (vertexMeshlet[vertex] != currentId) {
+                vertexMeshlet[vertex] = currentId;
+                currentVertices.push_back(vertex);
+                currentPositionSum += vertices[vertex].Position;
+                currentMin = glm::min(currentMin, vertices[vertex].Position);
+                currentMax = glm::max(currentMax, vertices[vertex].Position);
+            }
+            meshletIndices.push_back(vertex);
+        }
+        emitted[next] = true;
+        currentTriangles++;
+
+        // prefer the neighborhood of the last triangle, then anything touching the meshlet
+        next = findNeighbor(triangleIndices, 3);
+        if (next == NoTriangle) {
+            next = findNeighbor(currentVertices.data(), currentVertices.size());
+        }
+    }
+
+    if (currentTriangles > 0) {
+        finishMeshlet();
+    }
+}
@@ -0,0 +1,46 @@
+//
+// Created by andyroiiid on 12/28/2022.
+//
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "VertexBase.h"
+
+// A small cluster of triangles drawn as one range of a shared index buffer.
+// Meshlets are only a preprocessing and culling granularity here, no mesh shaders are involved.
+struct Meshlet {
+    // local space bounding sphere
+    glm::vec3 Center;
+    float Radius;
+
+    // Normal cone: every triangle is backfacing when
+    // dot(Center - cameraPosition, ConeAxis) >= ConeCutoff * length(Center - cameraPosition) + Radius.
+    // ConeCutoff is 1 when the normals are spread too far apart to ever cull.
+    glm::vec3 ConeAxis;
+    float ConeCutoff;
+
+    // range in the meshlet index buffer, indices still refer to the original vertices
+    uint32_t FirstIndex;
+    uint32_t IndexCount;
+    uint32_t VertexCount;
+};
+
+struct MeshletBuildSettings {
+    uint32_t MaxVertices = 64;
+    uint32_t MaxTriangles = 124;
+};
+
+// Greedily grows meshlets across shared vertices so they stay spatially compact.
+// Appends to meshlets and meshletIndices, Meshlet::FirstIndex is an offset into meshletIndices.
+void BuildMeshlets(
+        const VertexBase *vertices,
+        size_t vertexCount,
+        const uint32_t *indices,
+        size_t indexCount,
+        std::vector<Meshlet> &meshlets,
+        std::vector<uint32_t> &meshletIndices,
+        const MeshletBuildSettings &settings = {}
+);
@@ -0,0 +1,851 @@
+//
+// Created by andyroiiid on 12/31/2022.
+//
+
+#include "ModelImporter.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <glm/geometric.hpp>
+#include <glm/common.hpp>
+
+#include "Debug.h"
+#include "Files.h"
+#include "Json.h"
+#include "MeshOptimizer.h"
+
+using ImportClock = std::chrono::high_resolution_clock;
+
+static double GetMillisecondsSince(ImportClock::time_point start) {
+    return std::chrono::duration<double, std::milli>(ImportClock::now() - start).count();
+}
+
+static std::string GetExtension(const std::string &filename) {
+    const size_t dot = filename.find_last_of('.');
+    if (dot == std::string::npos) {
+        return {};
+    }
+    std::string extension = filename.substr(dot + 1);
+    for (char &c: extension) {
+        c = static_cast<char>(tolower(c));
+    }
+    return extension;
+}
+
+static std::string GetDirectory(const std::string &filename) {
+    const size_t slash = filename.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : filename.substr(0, slash + 1);
+}
+
+// sources are right handed, mirroring z makes them left handed and keeps the winding front facing
+static glm::vec3 ConvertHandedness(const glm::vec3 &v) {
+    return {v.x, v.y, -v.z};
+}
+
+// area weighted, with the engine winding the triangle cross product points inwards
+static void ComputeNormals(std::vector<VertexBase> &vertices, const std::vector<uint32_t> &indices) {
+    for (VertexBase &vertex: vertices) {
+        vertex.Normal = glm::vec3{0.0f};
+    }
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        VertexBase &v0 = vertices[indices[i]];
+        VertexBase &v1 = vertices[indices[i + 1]];
+        VertexBase &v2 = vertices[indices[i + 2]];
+        const glm::vec3 normal = -glm::cross(v1.Position - v0.Position, v2.Position - v0.Position);
+        v0.Normal += normal;
+        v1.Normal += normal;
+        v2.Normal += normal;
+    }
+    for (VertexBase &vertex: vertices) {
+        const float length = glm::length(vertex.Normal);
+        vertex.Normal = length > 0.0f ? vertex.Normal / length : glm::vec3{0.0f, 1.0f, 0.0f};
+    }
+}
+
+static void ComputeBounds(ImportedMesh &mesh) {
+    if (mesh.Vertices.empty()) {
+        mesh.BoundsMin = mesh.BoundsMax = glm::vec3{0.0f};
+        return;
+    }
+    mesh.BoundsMin = glm::vec3{std::numeric_limits<float>::max()};
+    mesh.BoundsMax = glm::vec3{-std::numeric_limits<float>::max()};
+    for (const VertexBase &vertex: mesh.Vertices) {
+        mesh.BoundsMin = glm::min(mesh.BoundsMin, vertex.Position);
+        mesh.BoundsMax = glm::max(mesh.BoundsMax, vertex.Position);
+    }
+}
+
+// ---------------------------------------------------------------- OBJ
+
+// index fields are 1 based, relative ones count from the start of their chunk
+struct ObjCorner {
+    int32_t Position;
+    int32_t TexCoord;
+    int32_t Normal;
+};
+
+static constexpr int32_t ObjMissing = std::numeric_limits<int32_t>::min();
+static constexpr uint8_t ObjRelativePosition = 1;
+static constexpr uint8_t ObjRelativeTexCoord = 2;
+static constexpr uint8_t ObjRelativeNormal = 4;
+
+struct ObjGroup {
+    std::string Name;
+    // true for the implicit group at the start of a chunk, which continues the previous chunk's object
+    bool Continues;
+    uint32_t FirstCorner;
+};
+
+struct ObjChunk {
+    std::vector<glm::vec3> Positions;
+    std::vector<glm::vec2> TexCoords;
+    std::vector<glm::vec3> Normals;
+    // triangulated, 3 corners per triangle
+    std::vector<ObjCorner> Corners;
+    std::vector<uint8_t> RelativeFlags;
+    std::vector<ObjGroup> Groups;
+    bool Valid = true;
+};
+
+static const char *SkipSpaces(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    return p;
+}
+
+static const char *SkipLine(const char *p, const char *end) {
+    while (p < end && *p != '\n') {
+        p++;
+    }
+    return p < end ? p + 1 : end;
+}
+
+static const char *ParseObjInt(const char *p, const char *end, int32_t &value) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p++ == '-';
+    }
+    int64_t result = 0;
+    const char *start = p;
+    while (p < end && *p >= '0' && *p <= '9' && result < std::numeric_limits<int32_t>::max()) {
+        result = result * 10 + (*p++ - '0');
+    }
+    value = static_cast<int32_t>(negative ? -result : result);
+    return p == start ? nullptr : p;
+}
+
+// strtod needs a terminated string, the mapped file is not, and this is the hot loop of OBJ parsing
+static const char *ParseObjFloat(const char *p, const char *end, float &value) {
+    static const double Powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p++ == '-';
+    }
+
+    const char *start = p;
+    double result = 0.0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        result = result * 10.0 + (*p++ - '0');
+    }
+    if (p < end && *p == '.') {
+        p++;
+        int fractionDigits = 0;
+        double fraction = 0.0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (fractionDigits < 18) {
+                fraction = fraction * 10.0 + (*p - '0');
+                fractionDigits++;
+            }
+            p++;
+        }
+        result += fraction / Powers[fractionDigits];
+    }
+    if (p == start) {
+        return nullptr;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        int32_t exponent = 0;
+        p = ParseObjInt(p + 1, end, exponent);
+        if (!p) {
+            return nullptr;
+        }
+        result *= std::pow(10.0, exponent);
+    }
+
+    value = static_cast<float>(negative ? -result : result);
+    return p;
+}
+
+static const char *ParseObjCorner(const char *p, const char *end, const ObjChunk &chunk, ObjCorner &corner, uint8_t &relativeFlags) {
+    relativeFlags = 0;
+    corner = {ObjMissing, ObjMissing, ObjMissing};
+
+    // negative indices count back from the last element, which is only known relative to this chunk
+    auto resolve = [&relativeFlags](int32_t index, size_t localCount, uint8_t flag, int32_t &result) {
+        if (index < 0) {
+            result = static_cast<int32_t>(localCount) + index + 1;
+            relativeFlags |= flag;
+        } else if (index > 0) {
+            result = index;
+        }
+    };
+
+    int32_t index;
+    p = ParseObjInt(p, end, index);
+    if (!p) {
+        return nullptr;
+    }
+    resolve(index, chunk.Positions.size(), ObjRelativePosition, corner.Position);
+    if (p < end && *p == '/') {
+        p++;
+        if (p < end && *p != '/') {
+            p = ParseObjInt(p, end, index);
+            if (!p) {
+                return nullptr;
+            }
+            resolve(index, chunk.TexCoords.size(), ObjRelativeTexCoord, corner.TexCoord);
+        }
+        if (p < end && *p == '/') {
+            p = ParseObjInt(p + 1, end, index);
+            if (!p) {
+                return nullptr;
+            }
+            resolve(index, chunk.Normals.size(), ObjRelativeNormal, corner.Normal);
+        }
+    }
+    return p;
+}
+
+static void ParseObjChunk(const char *p, const char *end, ObjChunk &chunk) {
+    chunk.Groups.push_back({{}, true, 0});
+
+    ObjCorner polygon[3];
+    uint8_t polygonFlags[3];
+    while (p < end) {
+        p = SkipSpaces(p, end);
+        if (p + 1 >= end) {
+            break;
+        }
+
+        const char c0 = p[0];
+        const char c1 = p[1];
+        if (c0 == 'v' && (c1 == ' ' || c1 == '\t')) {
+            glm::vec3 &position = chunk.Positions.emplace_back();
+            for (int i = 0; i < 3 && p; i++) {
+                p = ParseObjFloat(SkipSpaces(p + (i == 0 ? 1 : 0), end), end, position[i]);
+            }
+        } else if (c0 == 'v' && c1 == 't') {
+            glm::vec2 &texCoord = chunk.TexCoords.emplace_back();
+            p += 2;
+            for (int i = 0; i < 2 && p; i++) {
+                p = ParseObjFloat(SkipSpaces(p, end), end, texCoord[i]);
+            }
+        } else if (c0 == 'v' && c1 == 'n') {
+            glm::vec3 &normal = chunk.Normals.emplace_back();
+            p += 2;
+            for (int i = 0; i < 3 && p; i++) {
+                p = ParseObjFloat(SkipSpaces(p, end), end, normal[i]);
+            }
+        } else if (c0 == 'f' && (c1 == ' ' || c1 == '\t')) {
+            // fan triangulation, corner 0 stays, 1 and 2 slide along the polygon
+            p++;
+            int numCorners = 0;
+            for (;;) {
+                p = SkipSpaces(p, end);
+                if (p == end || *p == '\n' || *p == '\r' || *p == '#') {
+                    break;
+                }
+                const int slot = numCorners < 2 ? numCorners : 2;
+                if (numCorners >= 3) {
+                    polygon[1] = polygon[2];
+                    polygonFlags[1] = polygonFlags[2];
+                }
+                p = ParseObjCorner(p, end, chunk, polygon[slot], polygonFlags[slot]);
+                if (!p) {
+                    break;
+                }
+                numCorners++;
+                if (numCorners >= 3) {
+                    chunk.Corners.insert(chunk.Corners.end(), polygon, polygon + 3);
+                    chunk.RelativeFlags.insert(chunk.RelativeFlags.end(), polygonFlags, polygonFlags + 3);
+                }
+            }
+        } else if ((c0 == 'o' || c0 == 'g') && (c1 == ' ' || c1 == '\t')) {
+            const char *nameBegin = SkipSpaces(p + 1, end);
+            const char *nameEnd = nameBegin;
+            while (nameEnd < end && *nameEnd != '\n' && *nameEnd != '\r') {
+                nameEnd++;
+            }
+            chunk.Groups.push_back({std::string(nameBegin, nameEnd), false, static_cast<uint32_t>(chunk.Corners.size())});
+            p = nameEnd;
+        }
+
+        if (!p) {
+            chunk.Valid = false;
+            return;
+        }
+        p = SkipLine(p, end);
+    }
+}
+
+struct ObjPiece {
+    uint32_t Chunk;
+    uint32_t FirstCorner;
+    uint32_t EndCorner;
+};
+
+struct ObjObject {
+    std::string Name;
+    std::vector<ObjPiece> Pieces;
+};
+
+struct ObjCornerHash {
+    size_t operator()(const ObjCorner &corner) const {
+        return (static_cast<size_t>(corner.Position) * 73856093u) ^ (static_cast<size_t>(corner.TexCoord) * 19349663u) ^ (static_cast<size_t>(corner.Normal) * 83492791u);
+    }
+};
+
+struct ObjCornerEqual {
+    bool operator()(const ObjCorner &a, const ObjCorner &b) const {
+        return a.Position == b.Position && a.TexCoord == b.TexCoord && a.Normal == b.Normal;
+    }
+};
+
+// ParallelFor counts in uint32_t, a larger count would silently wrap
+static bool CheckParallelCount(size_t count, const char *what) {
+    return DebugCheck(count <= std::numeric_limits<uint32_t>::max(), "Too many {} ({}) to convert in parallel.", what, count);
+}
+
+static bool ImportObj(const MappedFile &file, ThreadPool &threadPool, std::vector<ImportedMesh> &meshes, ImportTimings &timings) {
+    const auto *text = static_cast<const char *>(file.GetData());
+    const char *textEnd = text + file.GetSize();
+
+    // line aligned chunks, a few per thread so uneven chunks still balance
+    auto startTime = ImportClock::now();
+    constexpr size_t MinChunkSize = 1 << 20;
+    const size_t numChunks = std::max<size_t>(1, std::min<size_t>(threadPool.GetNumThreads() * 4, file.GetSize() / MinChunkSize));
+    std::vector<const char *> chunkBegins{text};
+    for (size_t i = 1; i < numChunks; i++) {
+        const char *begin = std::max(chunkBegins.back(), text + file.GetSize() * i / numChunks);
+        chunkBegins.push_back(begin == text ? text : SkipLine(begin - 1, textEnd));
+    }
+    chunkBegins.push_back(textEnd);
+
+    std::vector<ObjChunk> chunks(numChunks);
+    threadPool.ParallelFor(static_cast<uint32_t>(numChunks), [&](uint32_t i) {
+        ParseObjChunk(chunkBegins[i], chunkBegins[i + 1], chunks[i]);
+    });
+    for (const ObjChunk &chunk: chunks) {
+        if (!DebugCheck(chunk.Valid, "Malformed OBJ file.")) {
+            return false;
+        }
+    }
+
+    // concatenate the vertex attributes, chunk bases turn relative indices absolute
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;
+    std::vector<glm::vec3> normals;
+    std::vector<int32_t> positionBases, texCoordBases, normalBases;
+    for (const ObjChunk &chunk: chunks) {
+        positionBases.push_back(static_cast<int32_t>(positions.size()));
+        texCoordBases.push_back(static_cast<int32_t>(texCoords.size()));
+        normalBases.push_back(static_cast<int32_t>(normals.size()));
+        positions.insert(positions.end(), chunk.Positions.begin(), chunk.Positions.end());
+        texCoords.insert(texCoords.end(), chunk.TexCoords.begin(), chunk.TexCoords.end());
+        normals.insert(normals.end(), chunk.Normals.begin(), chunk.Normals.end());
+    }
+
+    std::vector<ObjObject> objects;
+    for (uint32_t chunkIndex = 0; chunkIndex < numChunks; chunkIndex++) {
+        const ObjChunk &chunk = chunks[chunkIndex];
+        for (size_t i = 0; i < chunk.Groups.size(); i++) {
+            const ObjGroup &group = chunk.Groups[i];
+            const uint32_t endCorner = i + 1 < chunk.Groups.size() ? chunk.Groups[i + 1].FirstCorner : chunk.Corners.size();
+            if (!group.Continues || objects.empty()) {
+                objects.push_back({group.Continues ? "default" : group.Name, {}});
+            }
+            if (endCorner > group.FirstCorner) {
+                objects.back().Pieces.push_back({chunkIndex, group.FirstCorner, endCorner});
+            }
+        }
+    }
+    objects.erase(std::remove_if(objects.begin(), objects.end(), [](const ObjObject &object) { return object.Pieces.empty(); }), objects.end());
+    timings.Parse = GetMillisecondsSince(startTime);
+
+    startTime = ImportClock::now();
+    if (!CheckParallelCount(objects.size(), "OBJ objects")) {
+        return false;
+    }
+    meshes.resize(objects.size());
+    std::atomic<bool> valid = true;
+    threadPool.ParallelFor(static_cast<uint32_t>(objects.size()), [&](uint32_t objectIndex) {
+        const ObjObject &object = objects[objectIndex];
+        ImportedMesh &mesh = meshes[objectIndex];
+        mesh.Name = object.Name;
+
+        auto resolve = [](int32_t index, bool relative, int32_t base, size_t count) {
+            if (index == ObjMissing) {
+                return -1;
+            }
+            const int32_t resolved = index - 1 + (relative ? base : 0);
+            return resolved >= 0 && static_cast<size_t>(resolved) < count ? resolved : std::numeric_limits<int32_t>::min();
+        };
+
+        std::unordered_map<ObjCorner, uint32_t, ObjCornerHash, ObjCornerEqual> uniqueCorners;
+        bool hasAllNormals = true;
+        for (const ObjPiece &piece: object.Pieces) {
+            const ObjChunk &chunk = chunks[piece.Chunk];
+            for (uint32_t i = piece.FirstCorner; i < piece.EndCorner; i++) {
+                const ObjCorner &corner = chunk.Corners[i];
+                const uint8_t flags = chunk.RelativeFlags[i];
+                const ObjCorner resolved{
+                        resolve(corner.Position, flags & ObjRelativePosition, positionBases[piece.Chunk], positions.size()),
+                        resolve(corner.TexCoord, flags & ObjRelativeTexCoord, texCoordBases[piece.Chunk], texCoords.size()),
+                        resolve(corner.Normal, flags & ObjRelativeNormal, normalBases[piece.Chunk], normals.size())
+                };
+                if (resolved.Position < 0 || resolved.TexCoord == std::numeric_limits<int32_t>::min() || resolved.Normal == std::numeric_limits<int32_t>::min()) {
+                    valid = false;
+                    return;
+                }
+
+                const auto [it, inserted] = uniqueCorners.emplace(resolved, static_cast<uint32_t>(mesh.Vertices.size()));
+                if (inserted) {
+                    hasAllNormals = hasAllNormals && resolved.Normal >= 0;
+                    mesh.Vertices.emplace_back(
+                            ConvertHandedness(positions[resolved.Position]),
+                            resolved.Normal >= 0 ? ConvertHandedness(normals[resolved.Normal]) : glm::vec3{0.0f},
+                            resolved.TexCoord >= 0 ? texCoords[resolved.TexCoord] : glm::vec2{0.0f}
+                    );
+                }
+                mesh.Indices.push_back(it->second);
+            }
+        }
+        if (!hasAllNormals) {
+            ComputeNormals(mesh.Vertices, mesh.Indices);
+        }
+    });
+    timings.Convert = GetMillisecondsSince(startTime);
+
+    return DebugCheck(valid, "OBJ file has out of range indices.");
+}
+
+// ---------------------------------------------------------------- glTF
+
+static constexpr uint32_t GlbMagic = 0x46546C67; // "glTF"
+static constexpr uint32_t GlbChunkJson = 0x4E4F534A;
+static constexpr uint32_t GlbChunkBin = 0x004E4942;
+
+static constexpr int GltfByte = 5120;
+static constexpr int GltfUnsignedByte = 5121;
+static constexpr int GltfShort = 5122;
+static constexpr int GltfUnsignedShort = 5123;
+static constexpr int GltfUnsignedInt = 5125;
+static constexpr int GltfFloat = 5126;
+static constexpr int GltfTriangles = 4;
+
+struct GltfBuffer {
+    const uint8_t *Data = nullptr;
+    size_t Size = 0;
+    // owners of Data, at most one is used
+    MappedFile File;
+    std::vector<uint8_t> Decoded;
+};
+
+struct GltfAccessor {
+    const uint8_t *Data = nullptr;
+    size_t Count = 0;
+    size_t Stride = 0;
+    int ComponentType = 0;
+    int NumComponents = 0;
+    bool Normalized = false;
+};
+
+static bool DecodeBase64(const char *text, size_t length, std::vector<uint8_t> &bytes) {
+    static const auto decodeTable = [] {
+        std::array<int8_t, 256> table{};
+        table.fill(-1);
+        const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (int i = 0; i < 64; i++) {
+            table[static_cast<uint8_t>(alphabet[i])] = static_cast<int8_t>(i);
+        }
+        return table;
+    }();
+
+    bytes.clear();
+    bytes.reserve(length / 4 * 3);
+    uint32_t accumulator = 0;
+    int bits = 0;
+    for (size_t i = 0; i < length && text[i] != '='; i++) {
+        const int8_t value = decodeTable[static_cast<uint8_t>(text[i])];
+        if (value < 0) {
+            return false;
+        }
+        accumulator = accumulator << 6 | value;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            bytes.push_back(static_cast<uint8_t>(accumulator >> bits));
+        }
+    }
+    return true;
+}
+
+// Sizes, offsets and indices of glTF files are JSON numbers, casting a negative, fractional or huge one is undefined.
+// Missing ones are defaultValue, whole numbers up to 2^53 are read and any other number rejects the file.
+static bool GetGltfSize(const JsonValue &value, size_t defaultValue, size_t &result) {
+    if (!value.IsNumber()) {
+        result = defaultValue;
+        return true;
+    }
+    const double number = value.GetNumber();
+    if (!(number >= 0.0 && number <= 9007199254740992.0 && std::floor(number) == number)) {
+        return false;
+    }
+    result = static_cast<size_t>(number);
+    return true;
+}
+
+static bool LoadGltfBuffer(const JsonValue &buffer, const std::string &directory, const uint8_t *glbBin, size_t glbBinSize, GltfBuffer &result) {
+    size_t byteLength = 0;
+    if (!GetGltfSize(buffer["byteLength"], 0, byteLength)) {
+        return false;
+    }
+    if (!buffer.Has("uri")) {
+        result.Data = glbBin;
+        result.Size = glbBinSize;
+    } else {
+        const std::string &uri = buffer["uri"].GetString();
+        if (uri.compare(0, 5, "data:") == 0) {
+            const size_t comma = uri.find(";base64,");
+            if (comma == std::string::npos || !DecodeBase64(uri.data() + comma + 8, uri.size() - comma - 8, result.Decoded)) {
+                return false;
+            }
+            result.Data = result.Decoded.data();
+            result.Size = result.Decoded.size();
+        } else {
+            result.File = MappedFile(directory + uri);
+            result.Data = static_cast<const uint8_t *>(result.File.GetData());
+            result.Size = result.File.GetSize();
+        }
+    }
+    return result.Data != nullptr && result.Size >= byteLength;
+}
+
+static bool GetGltfAccessor(const JsonValue &document, const std::vector<GltfBuffer> &buffers, const JsonValue &accessorIndex, GltfAccessor &result) {
+    // missing indices are out of range of every array
+    size_t index = 0, bufferViewIndex = 0;
+    if (!accessorIndex.IsNumber() || !GetGltfSize(accessorIndex, std::numeric_limits<size_t>::max(), index)) {
+        return false;
+    }
+    const JsonValue &accessor = document["accessors"][index];
+    if (!GetGltfSize(accessor["bufferView"], std::numeric_limits<size_t>::max(), bufferViewIndex)) {
+        return false;
+    }
+    const JsonValue &bufferView = document["bufferViews"][bufferViewIndex];
+    if (!accessor.IsObject() || !bufferView.IsObject() || accessor.Has("sparse")) {
+        return false;
+    }
+
+    size_t componentType = 0, bufferIndex = 0, viewOffset = 0, viewLength = 0, accessorOffset = 0;
+    if (!GetGltfSize(accessor["componentType"], 0, componentType) || !GetGltfSize(accessor["count"], 0, result.Count) ||
+        !GetGltfSize(bufferView["buffer"], std::numeric_limits<size_t>::max(), bufferIndex) || !GetGltfSize(bufferView["byteOffset"], 0, viewOffset) ||
+        !GetGltfSize(bufferView["byteLength"], 0, viewLength) || !GetGltfSize(accessor["byteOffset"], 0, accessorOffset)) {
+        return false;
+    }
+
+    const std::string &type = accessor["type"].GetString();
+    result.NumComponents = type == "SCALAR" ? 1 : type == "VEC2" ? 2 : type == "VEC3" ? 3 : type == "VEC4" ? 4 : 0;
+    // unknown component types have no size and are rejected below
+    result.ComponentType = componentType <= std::numeric_limits<int>::max() ? static_cast<int>(componentType) : 0;
+    result.Normalized = accessor["normalized"].GetBool();
+    const size_t componentSize = result.ComponentType == GltfFloat || result.ComponentType == GltfUnsignedInt ? 4
+                                 : result.ComponentType == GltfShort || result.ComponentType == GltfUnsignedShort ? 2
+                                 : result.ComponentType == GltfByte || result.ComponentType == GltfUnsignedByte ? 1 : 0;
+    const size_t elementSize = componentSize * result.NumComponents;
+    if (!GetGltfSize(bufferView["byteStride"], elementSize, result.Stride)) {
+        return false;
+    }
+
+    // the sizes are below 2^53, so sums of two of them can't overflow but products can
+    if (elementSize == 0 || bufferIndex >= buffers.size() || viewOffset + viewLength > buffers[bufferIndex].Size) {
+        return false;
+    }
+    if (result.Count > 0 && (accessorOffset + elementSize > viewLength || (result.Stride > 0 && (viewLength - accessorOffset - elementSize) / result.Stride < result.Count - 1))) {
+        return false;
+    }
+
+    result.Data = buffers[bufferIndex].Data + viewOffset + accessorOffset;
+    return true;
+}
+
+static float ReadGltfComponent(const uint8_t *data, int componentType, bool normalized) {
+    switch (componentType) {
+        case GltfFloat: {
+            float value;
+            memcpy(&value, data, sizeof(value));
+            return value;
+        }
+        case GltfUnsignedByte:
+            return normalized ? static_cast<float>(*data) / 255.0f : static_cast<float>(*data);
+        case GltfByte:
+            return normalized ? std::max(static_cast<float>(static_cast<int8_t>(*data)) / 127.0f, -1.0f) : static_cast<float>(static_cast<int8_t>(*data));
+        case GltfUnsignedShort: {
+            uint16_t value;
+            memcpy(&value, data, sizeof(value));
+            return normalized ? static_cast<float>(value) / 65535.0f : static_cast<float>(value);
+        }
+        case GltfShort: {
+            int16_t value;
+            memcpy(&value, data, sizeof(value));
+            return normalized ? std::max(static_cast<float>(value) / 32767.0f, -1.0f) : static_cast<float>(value);
+        }
+        default:
+            return 0.0f;
+    }
+}
+
+static glm::vec3 ReadGltfVec3(const GltfAccessor &accessor, size_t index) {
+    const uint8_t *element = accessor.Data + accessor.Stride * index;
+    const size_t componentSize = accessor.ComponentType == GltfFloat ? 4 : accessor.ComponentType == GltfShort || accessor.ComponentType == GltfUnsignedShort ? 2 : 1;
+    return {
+            ReadGltfComponent(element, accessor.ComponentType, accessor.Normalized),
+            ReadGltfComponent(element + componentSize, accessor.ComponentType, accessor.Normalized),
+            ReadGltfComponent(element + componentSize * 2, accessor.ComponentType, accessor.Normalized)
+    };
+}
+
+static glm::vec2 ReadGltfVec2(const GltfAccessor &accessor, size_t index) {
+    const uint8_t *element = accessor.Data + accessor.Stride * index;
+    const size_t componentSize = accessor.ComponentType == GltfFloat ? 4 : accessor.ComponentType == GltfShort || accessor.ComponentType == GltfUnsignedShort ? 2 : 1;
+    return {
+            ReadGltfComponent(element, accessor.ComponentType, accessor.Normalized),
+            ReadGltfComponent(element + componentSize, accessor.ComponentType, accessor.Normalized)
+    };
+}
+
+static uint32_t ReadGltfIndex(const GltfAccessor &accessor, size_t index) {
+    const uint8_t *element = accessor.Data + accessor.Stride * index;
+    switch (accessor.ComponentType) {
+        case GltfUnsignedByte:
+            return *element;
+        case GltfUnsignedShort: {
+            uint16_t value;
+            memcpy(&value, element, sizeof(value));
+            return value;
+        }
+        default: {
+            uint32_t value;
+            memcpy(&value, element, sizeof(value));
+            return value;
+        }
+    }
+}
+
+static bool ConvertGltfPrimitive(const JsonValue &document, const std::vector<GltfBuffer> &buffers, const JsonValue &primitive, ImportedMesh &result) {
+    if (primitive["mode"].GetNumber(GltfTriangles) != GltfTriangles) {
+        DebugWarning("Skipped a glTF primitive that is not a triangle list.");
+        return true;
+    }
+
+    const JsonValue &attributes = primitive["attributes"];
+    GltfAccessor positions, normals, texCoords, indices;
+    if (!GetGltfAccessor(document, buffers, attributes["POSITION"], positions) || positions.NumComponents != 3) {
+        return false;
+    }
+    const bool hasNormals = GetGltfAccessor(document, buffers, attributes["NORMAL"], normals) && normals.NumComponents == 3 && normals.Count == positions.Count;
+    const bool hasTexCoords = GetGltfAccessor(document, buffers, attributes["TEXCOORD_0"], texCoords) && texCoords.NumComponents == 2 && texCoords.Count == positions.Count;
+
+    result.Vertices.resize(positions.Count);
+    for (size_t i = 0; i < positions.Count; i++) {
+        VertexBase &vertex = result.Vertices[i];
+        vertex.Position = ConvertHandedness(ReadGltfVec3(positions, i));
+        vertex.Normal = hasNormals ? ConvertHandedness(ReadGltfVec3(normals, i)) : glm::vec3{0.0f};
+        // glTF puts the texture origin at the top left and mesh coordinates point up from the bottom left,
+        // the vertex shader flips v back since images are stored from the top, so the two flips cancel out
+        const glm::vec2 texCoord = hasTexCoords ? ReadGltfVec2(texCoords, i) : glm::vec2{0.0f};
+        vertex.TexCoord = {texCoord.x, 1.0f - texCoord.y};
+    }
+
+    if (primitive.Has("indices")) {
+        if (!GetGltfAccessor(document, buffers, primitive["indices"], indices) || indices.NumComponents != 1) {
+            return false;
+        }
+        result.Indices.resize(indices.Count);
+        for (size_t i = 0; i < indices.Count; i++) {
+            result.Indices[i] = ReadGltfIndex(indices, i);
+            if (result.Indices[i] >= positions.Count) {
+                return false;
+            }
+        }
+    } else {
+        result.Indices.resize(positions.Count);
+        for (size_t i = 0; i < positions.Count; i++) {
+            result.Indices[i] = i;
+        }
+    }
+    result.Indices.resize(result.Indices.size() / 3 * 3);
+
+    if (!hasNormals) {
+        ComputeNormals(result.Vertices, result.Indices);
+    }
+    return true;
+}
+
+static bool ImportGltf(const MappedFile &file, const std::string &filename, bool binary, ThreadPool &threadPool, std::vector<ImportedMesh> &meshes, ImportTimings &timings) {
+    auto startTime = ImportClock::now();
+
+    const auto *bytes = static_cast<const uint8_t *>(file.GetData());
+    const char *jsonText = static_cast<const char *>(file.GetData());
+    size_t jsonLength = file.GetSize();
+    const uint8_t *glbBin = nullptr;
+    size_t glbBinSize = 0;
+    if (binary) {
+        // 12 byte header, then chunks of {length, type, data} padded to 4 bytes
+        uint32_t header[3];
+        if (file.GetSize() < sizeof(header)) {
+            return false;
+        }
+        memcpy(header, bytes, sizeof(header));
+        if (!DebugCheck(header[0] == GlbMagic && header[1] == 2 && header[2] <= file.GetSize(), "{} is not a glTF 2.0 binary.", filename)) {
+            return false;
+        }
+        jsonText = nullptr;
+        for (size_t offset = sizeof(header); offset + 8 <= header[2];) {
+            uint32_t chunkHeader[2];
+            memcpy(chunkHeader, bytes + offset, sizeof(chunkHeader));
+            const size_t chunkOffset = offset + 8;
+            if (chunkOffset + chunkHeader[0] > header[2]) {
+                return false;
+            }
+            if (chunkHeader[1] == GlbChunkJson && !jsonText) {
+                jsonText = reinterpret_cast<const char *>(bytes + chunkOffset);
+                jsonLength = chunkHeader[0];
+            } else if (chunkHeader[1] == GlbChunkBin && !glbBin) {
+                glbBin = bytes + chunkOffset;
+                glbBinSize = chunkHeader[0];
+            }
+            offset = chunkOffset + (chunkHeader[0] + 3) / 4 * 4;
+        }
+        if (!DebugCheck(jsonText != nullptr, "{} has no JSON chunk.", filename)) {
+            return false;
+        }
+    }
+
+    JsonValue document;
+    if (!DebugCheck(ParseJson(jsonText, jsonLength, document), "Failed to parse glTF JSON in {}.", filename)) {
+        return false;
+    }
+    timings.Parse = GetMillisecondsSince(startTime);
+
+    // external buffers are mapped in parallel, they are usually the bulk of the data
+    startTime = ImportClock::now();
+    const JsonValue &bufferList = document["buffers"];
+    std::vector<GltfBuffer> buffers(bufferList.GetSize());
+    std::atomic<bool> buffersValid = true;
+    const std::string directory = GetDirectory(filename);
+    if (!CheckParallelCount(buffers.size(), "glTF buffers")) {
+        return false;
+    }
+    threadPool.ParallelFor(static_cast<uint32_t>(buffers.size()), [&](uint32_t i) {
+        if (!LoadGltfBuffer(bufferList[i], directory, glbBin, glbBinSize, buffers[i])) {
+            buffersValid = false;
+        }
+    });
+    timings.Read += GetMillisecondsSince(startTime);
+    if (!DebugCheck(buffersValid, "Failed to load the buffers of {}.", filename)) {
+        return false;
+    }
+
+    startTime = ImportClock::now();
+    struct PrimitiveRef {
+        size_t Mesh;
+        size_t Primitive;
+    };
+    std::vector<PrimitiveRef> primitiveRefs;
+    const JsonValue &meshList = document["meshes"];
+    for (size_t i = 0; i < meshList.GetSize(); i++) {
+        for (size_t j = 0; j < meshList[i]["primitives"].GetSize(); j++) {
+            primitiveRefs.push_back({i, j});
+        }
+    }
+
+    if (!CheckParallelCount(primitiveRefs.size(), "glTF primitives")) {
+        return false;
+    }
+    std::vector<ImportedMesh> primitives(primitiveRefs.size());
+    std::atomic<bool> primitivesValid = true;
+    threadPool.ParallelFor(static_cast<uint32_t>(primitiveRefs.size()), [&](uint32_t i) {
+        const JsonValue &primitive = meshList[primitiveRefs[i].Mesh]["primitives"][primitiveRefs[i].Primitive];
+        if (!ConvertGltfPrimitive(document, buffers, primitive, primitives[i])) {
+            primitivesValid = false;
+        }
+    });
+    if (!DebugCheck(primitivesValid, "{} has invalid primitives.", filename)) {
+        return false;
+    }
+
+    // primitives of one mesh are merged, they only differ by material
+    meshes.resize(meshList.GetSize());
+    for (size_t i = 0; i < meshes.size(); i++) {
+        const std::string &name = meshList[i]["name"].GetString();
+        meshes[i].Name = name.empty() ? "mesh" + std::to_string(i) : name;
+    }
+    for (size_t i = 0; i < primitiveRefs.size(); i++) {
+        ImportedMesh &mesh = meshes[primitiveRefs[i].Mesh];
+        const auto baseVertex = static_cast<uint32_t>(mesh.Vertices.size());
+        mesh.Vertices.insert(mesh.Vertices.end(), primitives[i].Vertices.begin(), primitives[i].Vertices.end());
+        for (uint32_t index: primitives[i].Indices) {
+            mesh.Indices.push_back(baseVertex + index);
+        }
+    }
+    timings.Convert = GetMillisecondsSince(startTime);
+    return true;
+}
+
+bool ImportModel(const std::string &filename, ThreadPool &threadPool, std::vector<ImportedMesh> &meshes, ImportTimings *timings, bool optimize) {
+    ImportTimings localTimings;
+    ImportTimings &stageTimings = timings ? *timings : localTimings;
+    stageTimings = {};
+    meshes.clear();
+
+    auto startTime = ImportClock::now();
+    MappedFile file(filename);
+    stageTimings.Read = GetMillisecondsSince(startTime);
+    if (!DebugCheck(file.IsValid(), "Failed to open model {}.", filename)) {
+        return false;
+    }
+
+    const std::string extension = GetExtension(filename);
+    bool succeeded;
+    if (extension == "obj") {
+        succeeded = ImportObj(file, threadPool, meshes, stageTimings);
+    } else if (extension == "gltf" || extension == "glb") {
+        succeeded = ImportGltf(file, filename, extension == "glb", threadPool, meshes, stageTimings);
+    } else {
+        DebugWarning("Unsupported model format {}.", filename);
+        succeeded = false;
+    }
+    if (!succeeded) {
+        meshes.clear();
+        return false;
+    }
+
+    startTime = ImportClock::now();
+    meshes.erase(std::remove_if(meshes.begin(), meshes.end(), [](const ImportedMesh &mesh) { return mesh.Indices.empty(); }), meshes.end());
+    // at most one mesh per OBJ object or glTF primitive, which were checked above
+    threadPool.ParallelFor(static_cast<uint32_t>(meshes.size()), [&](uint32_t i) {
+        if (optimize) {
+            OptimizeMesh(meshes[i].Vertices, meshes[i].Indices);
+        }
+        ComputeBounds(meshes[i]);
+    });
+    stageTimings.Optimize = GetMillisecondsSince(startTime);
+    return true;
+}
@@ -0,0 +1,33 @@
+//
+// Created by andyroiiid on 12/31/2022.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "VertexBase.h"
+#include "ThreadPool.h"
+
+struct ImportedMesh {
+    std::string Name;
+    std::vector<VertexBase> Vertices;
+    std::vector<uint32_t> Indices;
+    glm::vec3 BoundsMin{0.0f};
+    glm::vec3 BoundsMax{0.0f};
+};
+
+// wall clock milliseconds spent in every stage of ImportModel
+struct ImportTimings {
+    double Read = 0.0;
+    double Parse = 0.0;
+    double Convert = 0.0;
+    double Optimize = 0.0;
+};
+
+// Loads every mesh of an .obj, .gltf or .glb file into indexed VertexBase streams.
+// OBJ objects/groups and glTF meshes become one ImportedMesh each, their parsing and conversion is spread over threadPool.
+// Positions and normals are converted from the right handed source space by mirroring z, glTF node transforms are not applied.
+// With optimize every mesh is welded and reordered for the vertex cache, see MeshOptimizer.
+bool ImportModel(const std::string &filename, ThreadPool &threadPool, std::vector<ImportedMesh> &meshes, ImportTimings *timings = nullptr, bool optimize = true);
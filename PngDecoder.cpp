@@ -0,0 +1,686 @@
+//
+// Created by andyroiiid on 1/3/2023.
+//
+
+#include "PngDecoder.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// SSE2 is part of every x64 CPU, so no per function targets are needed
+#if defined(_M_X64) || defined(__x86_64__)
+#define PNG_X86
+
+#include <emmintrin.h>
+
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define PNG_NEON
+
+#include <arm_neon.h>
+
+#endif
+
+namespace {
+    uint32_t ReadBigEndian(const uint8_t *data) {
+        return static_cast<uint32_t>(data[0]) << 24 | static_cast<uint32_t>(data[1]) << 16 | static_cast<uint32_t>(data[2]) << 8 | data[3];
+    }
+
+    // Inflate
+
+    constexpr uint32_t FastBits = 10;
+    constexpr uint32_t FastMask = (1u << FastBits) - 1;
+    constexpr uint32_t MaxCodeLength = 15;
+
+    struct HuffmanTable {
+        // symbol << 4 | length of every code of up to FastBits bits, indexed by the next FastBits input bits, 0 for longer codes
+        uint16_t Fast[1 << FastBits];
+        uint16_t Counts[MaxCodeLength + 1];
+        // symbols ordered by their canonical code
+        uint16_t Symbols[288];
+
+        bool Build(const uint8_t *lengths, uint32_t numSymbols) {
+            memset(Fast, 0, sizeof(Fast));
+            memset(Counts, 0, sizeof(Counts));
+            for (uint32_t symbol = 0; symbol < numSymbols; symbol++) {
+                Counts[lengths[symbol]]++;
+            }
+            Counts[0] = 0;
+
+            // incomplete codes are fine, over subscribed ones are broken
+            int32_t left = 1;
+            for (uint32_t length = 1; length <= MaxCodeLength; length++) {
+                left = (left << 1) - Counts[length];
+                if (left < 0) {
+                    return false;
+                }
+            }
+
+            uint16_t offsets[MaxCodeLength + 1];
+            uint32_t nextCodes[MaxCodeLength + 1];
+            offsets[0] = 0;
+            nextCodes[0] = 0;
+            for (uint32_t length = 1; length <= MaxCodeLength; length++) {
+                offsets[length] = offsets[length - 1] + Counts[length - 1];
+                nextCodes[length] = (nextCodes[length - 1] + Counts[length - 1]) << 1;
+            }
+
+            for (uint32_t symbol = 0; symbol < numSymbols; symbol++) {
+                const uint32_t length = lengths[symbol];
+                if (length == 0) {
+                    continue;
+                }
+                Symbols[offsets[length]++] = static_cast<uint16_t>(symbol);
+                const uint32_t code = nextCodes[length]++;
+                if (length > FastBits) {
+                    continue;
+                }
+                // deflate stores codes starting from their most significant bit
+                uint32_t reversed = 0;
+                for (uint32_t bit = 0; bit < length; bit++) {
+                    reversed |= (code >> bit & 1) << (length - 1 - bit);
+                }
+                for (uint32_t index = reversed; index <= FastMask; index += 1u << length) {
+                    Fast[index] = static_cast<uint16_t>(symbol << 4 | length);
+                }
+            }
+            return true;
+        }
+    };
+
+    class BitReader {
+    public:
+        BitReader(const uint8_t *data, size_t size)
+                : m_begin(data),
+                  m_next(data),
+                  m_end(data + size) {
+        }
+
+        // tops the buffer up to at least 56 bits, reading zeros past the end
+        void Refill() {
+            if (m_end - m_next >= 8) {
+                uint64_t bytes;
+                memcpy(&bytes, m_next, 8);
+                m_bits |= bytes << m_count;
+                m_next += (63 - m_count) >> 3;
+                m_count |= 56;
+                return;
+            }
+            while (m_count < 56) {
+                if (m_next < m_end) {
+                    m_bits |= static_cast<uint64_t>(*m_next++) << m_count;
+                } else {
+                    m_overrun++;
+                }
+                m_count += 8;
+            }
+        }
+
+        void Consume(uint32_t count) {
+            m_bits >>= count;
+            m_count -= count;
+        }
+
+        uint32_t GetBits(uint32_t count) {
+            if (m_count < count) {
+                Refill();
+            }
+            const auto value = static_cast<uint32_t>(m_bits & ((uint64_t(1) << count) - 1));
+            Consume(count);
+            return value;
+        }
+
+        int32_t Decode(const HuffmanTable &table) {
+            if (m_count < 16) {
+                Refill();
+            }
+            const uint32_t entry = table.Fast[m_bits & FastMask];
+            if (entry) {
+                Consume(entry & 15);
+                return static_cast<int32_t>(entry >> 4);
+            }
+
+            // canonical decoding one bit at a time for the long codes
+            uint32_t code = 0, first = 0, index = 0;
+            for (uint32_t length = 1; length <= MaxCodeLength; length++) {
+                code |= GetBits(1);
+                const uint32_t count = table.Counts[length];
+                if (code - first < count) {
+                    return table.Symbols[index + code - first];
+                }
+                index += count;
+                first = (first + count) << 1;
+                code <<= 1;
+            }
+            return -1;
+        }
+
+        // drops the bits up to the next byte boundary
+        void AlignToByte() {
+            Consume(m_count & 7);
+        }
+
+        // copies count bytes after a AlignToByte, false when the input is too short
+        bool CopyBytes(uint8_t *destination, size_t count) {
+            // the bytes already in the buffer come first
+            while (count > 0 && m_count >= 8) {
+                *destination++ = static_cast<uint8_t>(m_bits);
+                Consume(8);
+                count--;
+            }
+            if (count == 0) {
+                return true;
+            }
+            if (static_cast<size_t>(m_end - m_next) < count) {
+                return false;
+            }
+            memcpy(destination, m_next, count);
+            m_next += count;
+            m_bits = 0;
+            return true;
+        }
+
+        // false when more bits were consumed than the input had
+        [[nodiscard]] bool IsValid() const {
+            const size_t bytesRead = static_cast<size_t>(m_next - m_begin) + m_overrun;
+            return bytesRead * 8 - m_count <= static_cast<size_t>(m_end - m_begin) * 8;
+        }
+
+    private:
+        const uint8_t *m_begin = nullptr;
+        const uint8_t *m_next = nullptr;
+        const uint8_t *m_end = nullptr;
+        uint64_t m_bits = 0;
+        uint32_t m_count = 0;
+        size_t m_overrun = 0;
+    };
+
+    const uint16_t LengthBases[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    const uint8_t LengthExtraBits[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    const uint16_t DistanceBases[30] = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+    };
+    const uint8_t DistanceExtraBits[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    bool InflateBlock(BitReader &reader, const HuffmanTable &literals, const HuffmanTable &distances, uint8_t *begin, uint8_t *&position, uint8_t *end) {
+        uint8_t *output = position;
+        while (true) {
+            const int32_t symbol = reader.Decode(literals);
+            if (symbol < 256) {
+                if (symbol < 0 || output == end) {
+                    return false;
+                }
+                *output++ = static_cast<uint8_t>(symbol);
+                continue;
+            }
+            if (symbol == 256) {
+                position = output;
+                return true;
+            }
+
+            const uint32_t lengthCode = symbol - 257;
+            if (lengthCode >= 29) {
+                return false;
+            }
+            const size_t length = LengthBases[lengthCode] + reader.GetBits(LengthExtraBits[lengthCode]);
+            const int32_t distanceCode = reader.Decode(distances);
+            if (distanceCode < 0 || distanceCode >= 30) {
+                return false;
+            }
+            const size_t distance = DistanceBases[distanceCode] + reader.GetBits(DistanceExtraBits[distanceCode]);
+            if (distance > static_cast<size_t>(output - begin) || length > static_cast<size_t>(end - output)) {
+                return false;
+            }
+
+            const uint8_t *source = output - distance;
+            if (distance >= 8 && static_cast<size_t>(end - output) >= ((length + 7) & ~size_t(7))) {
+                // every chunk was written before it is read, the last one may write a few bytes past the match
+                for (size_t i = 0; i < length; i += 8) {
+                    memcpy(output + i, source + i, 8);
+                }
+            } else if (distance == 1) {
+                memset(output, *source, length);
+            } else {
+                for (size_t i = 0; i < length; i++) {
+                    output[i] = source[i];
+                }
+            }
+            output += length;
+        }
+    }
+
+    // Inflates a raw deflate stream into exactly size bytes, without checksums.
+    bool Inflate(const uint8_t *data, size_t dataSize, uint8_t *output, size_t size) {
+        static const uint8_t CodeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+        BitReader reader(data, dataSize);
+        uint8_t *position = output;
+        uint8_t *end = output + size;
+        HuffmanTable literals; // NOLINT(cppcoreguidelines-pro-type-member-init)
+        HuffmanTable distances; // NOLINT(cppcoreguidelines-pro-type-member-init)
+        bool finalBlock = false;
+        while (!finalBlock) {
+            finalBlock = reader.GetBits(1) != 0;
+            const uint32_t type = reader.GetBits(2);
+            if (type == 0) {
+                reader.AlignToByte();
+                const uint32_t length = reader.GetBits(16);
+                const uint32_t lengthComplement = reader.GetBits(16);
+                if ((length ^ 0xFFFF) != lengthComplement || length > static_cast<size_t>(end - position) || !reader.CopyBytes(position, length)) {
+                    return false;
+                }
+                position += length;
+                continue;
+            }
+
+            uint8_t lengths[288 + 32] = {};
+            if (type == 1) {
+                memset(lengths, 8, 144);
+                memset(lengths + 144, 9, 112);
+                memset(lengths + 256, 7, 24);
+                memset(lengths + 280, 8, 8);
+                memset(lengths + 288, 5, 32);
+                literals.Build(lengths, 288);
+                distances.Build(lengths + 288, 32);
+            } else if (type == 2) {
+                const uint32_t numLiterals = reader.GetBits(5) + 257;
+                const uint32_t numDistances = reader.GetBits(5) + 1;
+                const uint32_t numCodeLengths = reader.GetBits(4) + 4;
+
+                uint8_t codeLengthLengths[19] = {};
+                for (uint32_t i = 0; i < numCodeLengths; i++) {
+                    codeLengthLengths[CodeLengthOrder[i]] = static_cast<uint8_t>(reader.GetBits(3));
+                }
+                HuffmanTable codeLengths; // NOLINT(cppcoreguidelines-pro-type-member-init)
+                if (!codeLengths.Build(codeLengthLengths, 19)) {
+                    return false;
+                }
+
+                const uint32_t numLengths = numLiterals + numDistances;
+                uint32_t count = 0;
+                while (count < numLengths) {
+                    const int32_t symbol = reader.Decode(codeLengths);
+                    if (symbol < 0) {
+                        return false;
+                    }
+                    if (symbol < 16) {
+                        lengths[count++] = static_cast<uint8_t>(symbol);
+                        continue;
+                    }
+                    uint8_t value = 0;
+                    uint32_t repeat;
+                    if (symbol == 16) {
+                        if (count == 0) {
+                            return false;
+                        }
+                        value = lengths[count - 1];
+                        repeat = 3 + reader.GetBits(2);
+                    } else if (symbol == 17) {
+                        repeat = 3 + reader.GetBits(3);
+                    } else {
+                        repeat = 11 + reader.GetBits(7);
+                    }
+                    if (count + repeat > numLengths) {
+                        return false;
+                    }
+                    memset(lengths + count, value, repeat);
+                    count += repeat;
+                }
+                if (lengths[256] == 0 || !literals.Build(lengths, numLiterals) || !distances.Build(lengths + numLiterals, numDistances)) {
+                    return false;
+                }
+            } else {
+                return false;
+            }
+
+            if (!InflateBlock(reader, literals, distances, output, position, end)) {
+                return false;
+            }
+        }
+        return position == end && reader.IsValid();
+    }
+
+    // Unfiltering, every filter but Up depends on the pixel to the left, so Sub, Average and Paeth work one pixel at a time.
+    // Pixel holds one pixel in its low bytes, pixels are always loaded and stored as 4 bytes,
+    // so the byte after an RGB row has to be readable and writable.
+
+#if defined(PNG_X86)
+    using Pixel = __m128i;
+
+    Pixel LoadPixel(const uint8_t *data) {
+        uint32_t value;
+        memcpy(&value, data, 4);
+        return _mm_cvtsi32_si128(static_cast<int>(value));
+    }
+
+    void StorePixel(uint8_t *data, Pixel pixel) {
+        const auto value = static_cast<uint32_t>(_mm_cvtsi128_si32(pixel));
+        memcpy(data, &value, 4);
+    }
+
+    Pixel ZeroPixel() { return _mm_setzero_si128(); }
+
+    Pixel AddPixels(Pixel a, Pixel b) { return _mm_add_epi8(a, b); }
+
+    // avg_epu8 rounds up, the filter rounds down
+    Pixel AveragePixels(Pixel a, Pixel b) {
+        return _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+    }
+
+    __m128i Abs16(__m128i value) {
+        const __m128i sign = _mm_srai_epi16(value, 15);
+        return _mm_sub_epi16(_mm_xor_si128(value, sign), sign);
+    }
+
+    __m128i Select(__m128i mask, __m128i a, __m128i b) {
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    }
+
+    Pixel PaethPredict(Pixel left, Pixel up, Pixel upLeft) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i a = _mm_unpacklo_epi8(left, zero);
+        const __m128i b = _mm_unpacklo_epi8(up, zero);
+        const __m128i c = _mm_unpacklo_epi8(upLeft, zero);
+        // distances of a + b - c to a, b and c
+        __m128i pa = _mm_sub_epi16(b, c);
+        __m128i pb = _mm_sub_epi16(a, c);
+        __m128i pc = _mm_add_epi16(pa, pb);
+        pa = Abs16(pa);
+        pb = Abs16(pb);
+        pc = Abs16(pc);
+        const __m128i smallest = _mm_min_epi16(pa, _mm_min_epi16(pb, pc));
+        const __m128i nearest = Select(_mm_cmpeq_epi16(pa, smallest), a, Select(_mm_cmpeq_epi16(pb, smallest), b, c));
+        return _mm_packus_epi16(nearest, nearest);
+    }
+
+    void UnfilterUp(const uint8_t *source, const uint8_t *previous, uint8_t *destination, size_t rowBytes) {
+        size_t i = 0;
+        for (; i + 16 <= rowBytes; i += 16) {
+            const __m128i sum = _mm_add_epi8(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i)),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(previous + i))
+            );
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i), sum);
+        }
+        for (; i < rowBytes; i++) {
+            destination[i] = static_cast<uint8_t>(source[i] + previous[i]);
+        }
+    }
+
+    // four RGBA pixels at a time with a prefix sum, returns the last pixel
+    Pixel UnfilterSub4(const uint8_t *source, uint8_t *destination, size_t rowBytes, size_t &i) {
+        __m128i left = _mm_setzero_si128();
+        for (; i + 16 <= rowBytes; i += 16) {
+            __m128i sum = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+            sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 4));
+            sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 8));
+            sum = _mm_add_epi8(sum, left);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i), sum);
+            left = _mm_shuffle_epi32(sum, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+        return left;
+    }
+#elif defined(PNG_NEON)
+    using Pixel = uint8x8_t;
+
+    Pixel LoadPixel(const uint8_t *data) {
+        uint32_t value;
+        memcpy(&value, data, 4);
+        return vreinterpret_u8_u32(vdup_n_u32(value));
+    }
+
+    void StorePixel(uint8_t *data, Pixel pixel) {
+        const uint32_t value = vget_lane_u32(vreinterpret_u32_u8(pixel), 0);
+        memcpy(data, &value, 4);
+    }
+
+    Pixel ZeroPixel() { return vdup_n_u8(0); }
+
+    Pixel AddPixels(Pixel a, Pixel b) { return vadd_u8(a, b); }
+
+    Pixel AveragePixels(Pixel a, Pixel b) { return vhadd_u8(a, b); }
+
+    Pixel PaethPredict(Pixel left, Pixel up, Pixel upLeft) {
+        const int16x8_t a = vreinterpretq_s16_u16(vmovl_u8(left));
+        const int16x8_t b = vreinterpretq_s16_u16(vmovl_u8(up));
+        const int16x8_t c = vreinterpretq_s16_u16(vmovl_u8(upLeft));
+        // distances of a + b - c to a, b and c
+        const int16x8_t pb = vsubq_s16(a, c);
+        int16x8_t pa = vsubq_s16(b, c);
+        const int16x8_t pc = vabsq_s16(vaddq_s16(pa, pb));
+        pa = vabsq_s16(pa);
+        const int16x8_t absPb = vabsq_s16(pb);
+        const int16x8_t smallest = vminq_s16(pa, vminq_s16(absPb, pc));
+        const int16x8_t nearest = vbslq_s16(vceqq_s16(pa, smallest), a, vbslq_s16(vceqq_s16(absPb, smallest), b, c));
+        return vmovn_u16(vreinterpretq_u16_s16(nearest));
+    }
+
+    void UnfilterUp(const uint8_t *source, const uint8_t *previous, uint8_t *destination, size_t rowBytes) {
+        size_t i = 0;
+        for (; i + 16 <= rowBytes; i += 16) {
+            vst1q_u8(destination + i, vaddq_u8(vld1q_u8(source + i), vld1q_u8(previous + i)));
+        }
+        for (; i < rowBytes; i++) {
+            destination[i] = static_cast<uint8_t>(source[i] + previous[i]);
+        }
+    }
+
+    // four RGBA pixels at a time with a prefix sum, returns the last pixel
+    Pixel UnfilterSub4(const uint8_t *source, uint8_t *destination, size_t rowBytes, size_t &i) {
+        const uint8x16_t zero = vdupq_n_u8(0);
+        uint8x16_t left = zero;
+        for (; i + 16 <= rowBytes; i += 16) {
+            uint8x16_t sum = vld1q_u8(source + i);
+            sum = vaddq_u8(sum, vextq_u8(zero, sum, 12));
+            sum = vaddq_u8(sum, vextq_u8(zero, sum, 8));
+            sum = vaddq_u8(sum, left);
+            vst1q_u8(destination + i, sum);
+            left = vreinterpretq_u8_u32(vdupq_laneq_u32(vreinterpretq_u32_u8(sum), 3));
+        }
+        return vget_low_u8(left);
+    }
+#else
+    struct Pixel {
+        uint8_t Channels[4];
+    };
+
+    Pixel LoadPixel(const uint8_t *data) {
+        Pixel pixel;
+        memcpy(pixel.Channels, data, 4);
+        return pixel;
+    }
+
+    void StorePixel(uint8_t *data, Pixel pixel) {
+        memcpy(data, pixel.Channels, 4);
+    }
+
+    Pixel ZeroPixel() { return {}; }
+
+    Pixel AddPixels(Pixel a, Pixel b) {
+        for (int i = 0; i < 4; i++) {
+            a.Channels[i] = static_cast<uint8_t>(a.Channels[i] + b.Channels[i]);
+        }
+        return a;
+    }
+
+    Pixel AveragePixels(Pixel a, Pixel b) {
+        for (int i = 0; i < 4; i++) {
+            a.Channels[i] = static_cast<uint8_t>((a.Channels[i] + b.Channels[i]) >> 1);
+        }
+        return a;
+    }
+
+    Pixel PaethPredict(Pixel left, Pixel up, Pixel upLeft) {
+        Pixel nearest{};
+        for (int i = 0; i < 4; i++) {
+            const int a = left.Channels[i], b = up.Channels[i], c = upLeft.Channels[i];
+            const int pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - c - c);
+            nearest.Channels[i] = static_cast<uint8_t>(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+        }
+        return nearest;
+    }
+
+    void UnfilterUp(const uint8_t *source, const uint8_t *previous, uint8_t *destination, size_t rowBytes) {
+        for (size_t i = 0; i < rowBytes; i++) {
+            destination[i] = static_cast<uint8_t>(source[i] + previous[i]);
+        }
+    }
+
+    Pixel UnfilterSub4(const uint8_t *, uint8_t *, size_t, size_t &) {
+        return {};
+    }
+#endif
+
+    template<int Bpp>
+    bool UnfilterRow(uint8_t filter, const uint8_t *source, const uint8_t *previous, uint8_t *destination, size_t rowBytes) {
+        switch (filter) {
+            case 0:
+                memcpy(destination, source, rowBytes);
+                return true;
+            case 1: {
+                size_t i = 0;
+                Pixel left = Bpp == 4 ? UnfilterSub4(source, destination, rowBytes, i) : ZeroPixel();
+                for (; i < rowBytes; i += Bpp) {
+                    left = AddPixels(LoadPixel(source + i), left);
+                    StorePixel(destination + i, left);
+                }
+                return true;
+            }
+            case 2:
+                UnfilterUp(source, previous, destination, rowBytes);
+                return true;
+            case 3: {
+                Pixel left = ZeroPixel();
+                for (size_t i = 0; i < rowBytes; i += Bpp) {
+                    left = AddPixels(LoadPixel(source + i), AveragePixels(left, LoadPixel(previous + i)));
+                    StorePixel(destination + i, left);
+                }
+                return true;
+            }
+            case 4: {
+                Pixel left = ZeroPixel();
+                Pixel upLeft = ZeroPixel();
+                for (size_t i = 0; i < rowBytes; i += Bpp) {
+                    const Pixel up = LoadPixel(previous + i);
+                    left = AddPixels(LoadPixel(source + i), PaethPredict(left, up, upLeft));
+                    StorePixel(destination + i, left);
+                    upLeft = up;
+                }
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+}
+
+bool DecodePng(const void *data, size_t size, void *pixels, uint32_t width, uint32_t height) {
+    static const uint8_t Signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    const uint8_t *end = bytes + size;
+    if (size < 8 + 25 || memcmp(bytes, Signature, 8) != 0) {
+        return false;
+    }
+
+    // IHDR comes first, the decoder handles 8 bit RGB and RGBA without interlacing
+    const uint8_t *header = bytes + 8;
+    if (ReadBigEndian(header) != 13 || memcmp(header + 4, "IHDR", 4) != 0) {
+        return false;
+    }
+    const uint8_t bitDepth = header[16];
+    const uint8_t colorType = header[17];
+    if (ReadBigEndian(header + 8) != width || ReadBigEndian(header + 12) != height || width == 0 || height == 0 ||
+        bitDepth != 8 || (colorType != 2 && colorType != 6) || header[18] != 0 || header[19] != 0 || header[20] != 0) {
+        return false;
+    }
+
+    // the image data may be split into many IDAT chunks, only those are joined into one stream
+    const uint8_t *stream = nullptr;
+    size_t streamSize = 0;
+    std::vector<uint8_t> joinedStream;
+    for (const uint8_t *chunk = header + 25; chunk != end;) {
+        if (end - chunk < 12) {
+            return false;
+        }
+        const uint32_t length = ReadBigEndian(chunk);
+        if (static_cast<size_t>(end - chunk - 12) < length) {
+            return false;
+        }
+        const uint8_t *chunkData = chunk + 8;
+        if (memcmp(chunk + 4, "IDAT", 4) == 0) {
+            if (stream == nullptr) {
+                stream = chunkData;
+                streamSize = length;
+            } else {
+                if (joinedStream.empty()) {
+                    joinedStream.assign(stream, stream + streamSize);
+                }
+                joinedStream.insert(joinedStream.end(), chunkData, chunkData + length);
+            }
+        } else if (memcmp(chunk + 4, "tRNS", 4) == 0) {
+            // a transparent color key
+            return false;
+        } else if (memcmp(chunk + 4, "IEND", 4) == 0) {
+            break;
+        }
+        chunk = chunkData + length + 4;
+    }
+    if (!joinedStream.empty()) {
+        stream = joinedStream.data();
+        streamSize = joinedStream.size();
+    }
+
+    // zlib header of a deflate stream without a preset dictionary
+    if (stream == nullptr || streamSize < 2 || (stream[0] & 0x0F) != 8 || (stream[0] << 8 | stream[1]) % 31 != 0 || (stream[1] & 0x20) != 0) {
+        return false;
+    }
+
+    const uint32_t channels = colorType == 6 ? 4 : 3;
+    const size_t rowBytes = static_cast<size_t>(width) * channels;
+    const size_t filteredRowBytes = rowBytes + 1;
+    // one byte of padding after every row
+    std::vector<uint8_t> filtered(filteredRowBytes * height + 1);
+    if (!Inflate(stream + 2, streamSize - 2, filtered.data(), filteredRowBytes * height)) {
+        return false;
+    }
+
+    const std::vector<uint8_t> zeroRow(rowBytes + 1);
+    auto *destination = static_cast<uint8_t *>(pixels);
+    if (channels == 4) {
+        // straight into the destination, the row above is read back from there
+        const uint8_t *previous = zeroRow.data();
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t *source = filtered.data() + filteredRowBytes * y;
+            uint8_t *row = destination + rowBytes * y;
+            if (!UnfilterRow<4>(source[0], source + 1, previous, row, rowBytes)) {
+                return false;
+            }
+            previous = row;
+        }
+        return true;
+    }
+
+    // RGB rows are unfiltered into two alternating rows and expanded to opaque RGBA
+    std::vector<uint8_t> rows(filteredRowBytes * 2);
+    const uint8_t *previous = zeroRow.data();
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t *source = filtered.data() + filteredRowBytes * y;
+        uint8_t *row = rows.data() + filteredRowBytes * (y & 1);
+        if (!UnfilterRow<3>(source[0], source + 1, previous, row, rowBytes)) {
+            return false;
+        }
+        previous = row;
+
+        uint8_t *texel = destination + static_cast<size_t>(width) * 4 * y;
+        for (uint32_t x = 0; x < width; x++, texel += 4) {
+            // little endian, the padding byte becomes the alpha
+            uint32_t value;
+            memcpy(&value, row + x * 3, 4);
+            value |= 0xFF000000u;
+            memcpy(texel, &value, 4);
+        }
+    }
+    return true;
+}
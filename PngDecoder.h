@@ -0,0 +1,13 @@
+//
+// Created by andyroiiid on 1/3/2023.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Decodes non interlaced 8 bit RGB and RGBA PNGs into RGBA8 pixels, rows from top to bottom,
+// with a table driven inflate and SIMD unfiltering. pixels holds width x height texels of the size in the header.
+// False for every other variant and for broken files, so the caller can fall back to a complete decoder.
+bool DecodePng(const void *data, size_t size, void *pixels, uint32_t width, uint32_t height);
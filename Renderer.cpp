@@ -4,22 +4,22 @@
 
 #include "Renderer.h"
 
+#include <numeric>
+#include <algorithm>
+#include <limits>
 #include <glm/gtc/matrix_transform.hpp>
 #include <imgui.h>
 
-#include "VertexBase.h"
 #include "MeshUtilities.h"
-#include "ImageFile.h"
+#include "MeshletBuilder.h"
+#include "MeshLod.h"
+#include "MeshFile.h"
 
 struct EngineUniformData {
     glm::mat4 Projection;
     glm::mat4 View;
 };
 
-struct ModelConstantsData {
-    glm::mat4 Model;
-};
-
 Renderer::Renderer(GLFWwindow *window) {
     m_window = window;
     m_device = std::make_unique<VulkanBase>(window, false);
@@ -27,8 +27,13 @@ Renderer::Renderer(GLFWwindow *window) {
     CreateBufferingObjects();
     CreatePipeline();
     CreateMesh();
+    m_gpuInstanceCulling = GpuInstanceCulling(m_device.get());
+    CreateInstances();
+    m_gpuMeshletCulling = GpuMeshletCulling(m_device.get());
+    CreateMeshletScene();
+    CreateWaveMesh();
+    CreateVoxelWorld();
     CreateTexture();
-    CreateMaterial();
     m_device->ImGuiInit();
 }
 
@@ -43,7 +48,7 @@ void Renderer::CreateDescriptorSetLayouts() {
     m_materialDescriptorSetLayout = VulkanDescriptorSetLayout(
             m_device.get(),
             {
-                    {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT}
+                    {0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_SHADER_STAGE_FRAGMENT_BIT}
             }
     );
 }
@@ -77,6 +82,13 @@ void Renderer::CreateBufferingObjects() {
 
         bufferingObjects.EngineUniformBuffer = std::move(engineUniformBuffer);
         bufferingObjects.EngineDescriptorSet = descriptorSet;
+
+        bufferingObjects.InstanceBuffer = m_device->CreateBuffer(
+                MaxGridSize * MaxGridSize * sizeof(InstanceBase),
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+                VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
+        );
     }
 }
 
@@ -85,9 +97,9 @@ void Renderer::CreatePipeline() {
     pipelineCreateInfo.Device = m_device.get();
     pipelineCreateInfo.DescriptorSetLayouts = {
             m_engineDescriptorSetLayout.Get(),
-            m_materialDescriptorSetLayout.Get()
+            m_materialDescriptorSetLayout.Get(),
+            m_device->GetSamplerDescriptorSetLayout()
     };
-    pipelineCreateInfo.PushConstantSize = sizeof(ModelConstantsData);
     pipelineCreateInfo.ShaderStages = {
             {VK_SHADER_STAGE_VERTEX_BIT,   R"GLSL(
 #version 450 core
@@ -95,25 +107,25 @@ void Renderer::CreatePipeline() {
 layout (location = 0) in vec3 aPosition;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in mat4 aModel;
+layout (location = 7) in vec4 aColor;
 
 layout (location = 0) out vec3 vWorldNormal;
 layout (location = 1) out vec2 vTexCoord;
+layout (location = 2) out vec4 vColor;
 
 layout (set = 0, binding = 0) uniform EngineUniformData {
     mat4 uProjection;
     mat4 uView;
 };
 
-layout (push_constant) uniform ModelConstantsData
-{
-    mat4 uModel;
-};
-
 void main()
 {
-    gl_Position = uProjection * uView * uModel * vec4(aPosition, 1);
-    vWorldNormal = (uModel * vec4(aNormal, 1)).xyz;
-    vTexCoord = aTexCoord;
+    gl_Position = uProjection * uView * aModel * vec4(aPosition, 1);
+    vWorldNormal = mat3(aModel) * aNormal;
+    // texture coordinates point up, texture rows are stored from the top
+    vTexCoord = vec2(aTexCoord.x, 1 - aTexCoord.y);
+    vColor = aColor;
 }
 )GLSL"},
             {VK_SHADER_STAGE_FRAGMENT_BIT, R"GLSL(
@@ -121,10 +133,13 @@ void main()
 
 layout (location = 0) in vec3 vWorldNormal;
 layout (location = 1) in vec2 vTexCoord;
+layout (location = 2) in vec4 vColor;
 
 layout (location = 0) out vec4 fColor;
 
-layout (set = 1, binding = 0) uniform sampler2D uTexture;
+layout (set = 1, binding = 0) uniform texture2D uTexture;
+// shared by every texture with the same sampler state
+layout (set = 2, binding = 0) uniform sampler uSampler;
 
 float LightDiffuse(vec3 worldNormal, vec3 lightDirection) {
     return max(0, dot(worldNormal, normalize(lightDirection)));
@@ -133,13 +148,13 @@ float LightDiffuse(vec3 worldNormal, vec3 lightDirection) {
 void main()
 {
     vec3 worldNormal = normalize(vWorldNormal);
-    vec4 color = texture(uTexture, vTexCoord);
+    vec4 color = texture(sampler2D(uTexture, uSampler), vTexCoord) * vColor;
     color.rgb *= LightDiffuse(worldNormal, vec3(1, 2, -3));
     fColor = color;
 }
 )GLSL"}
     };
-    pipelineCreateInfo.VertexInput = &VertexBase::GetPipelineVertexInputStateCreateInfo();
+    pipelineCreateInfo.VertexInput = &InstanceBase::GetPipelineVertexInputStateCreateInfo();
     pipelineCreateInfo.RenderPass = m_device->GetPrimaryRenderPass();
 
     m_fillPipeline = VulkanPipeline(pipelineCreateInfo);
@@ -150,19 +165,203 @@ void main()
 }
 
 void Renderer::CreateMesh() {
+    const std::pair<glm::vec3, glm::vec3> boxes[] = {
+            {{-1.0f, -1.0f, -1.0f}, {1.0f, 1.0f, 1.0f}}, // cube
+            {{-0.5f, -1.0f, -0.5f}, {0.5f, 3.0f, 0.5f}}, // pillar
+            {{-1.5f, -1.0f, -1.5f}, {1.5f, -0.5f, 1.5f}} // slab
+    };
+
     std::vector<VertexBase> vertices;
-    AppendBoxVertices(vertices, {-1.0f, -1.0f, -1.0f}, {1.0f, 1.0f, 1.0f});
-    m_mesh = VulkanMesh(m_device.get(), vertices.size(), sizeof(VertexBase), vertices.data());
+    std::vector<uint32_t> indices;
+    m_shapes.clear();
+
+    // indices are relative to VertexOffset
+    auto addShape = [&](const std::vector<VertexBase> &shapeVertices, const std::vector<uint32_t> &shapeIndices, const glm::vec4 &bounds) {
+        std::vector<MeshLod> lods;
+        std::vector<uint32_t> lodIndices;
+        BuildLodChain(shapeVertices.data(), shapeVertices.size(), shapeIndices.data(), shapeIndices.size(), lods, lodIndices, GpuInstanceCulling::MaxLods);
+
+        Shape &shape = m_shapes.emplace_back();
+        shape.Bounds = bounds;
+        for (const MeshLod &lod: lods) {
+            VulkanSubMesh &subMesh = shape.Lods.emplace_back();
+            subMesh.FirstIndex = indices.size() + lod.FirstIndex;
+            subMesh.IndexCount = lod.IndexCount;
+            subMesh.VertexOffset = static_cast<int32_t>(vertices.size());
+            shape.LodErrors.push_back(lod.Error);
+        }
+        vertices.insert(vertices.end(), shapeVertices.begin(), shapeVertices.end());
+        indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+    };
+
+    for (const auto &[min, max]: boxes) {
+        // boxes are all borders, so they keep a single LOD
+        std::vector<VertexBase> shapeVertices;
+        std::vector<uint32_t> shapeIndices;
+        AppendBoxVertices(shapeVertices, shapeIndices, min, max);
+        addShape(shapeVertices, shapeIndices, glm::vec4((min + max) * 0.5f, glm::length(max - min) * 0.5f));
+    }
+    {
+        std::vector<VertexBase> shapeVertices;
+        std::vector<uint32_t> shapeIndices;
+        AppendSphereVertices(shapeVertices, shapeIndices, glm::vec3{0.0f}, 1.2f, 64, 32);
+        addShape(shapeVertices, shapeIndices, glm::vec4(0.0f, 0.0f, 0.0f, 1.2f));
+    }
+    m_mesh = VulkanMesh(m_device.get(), vertices.size(), sizeof(VertexBase), vertices.data(), indices.size(), indices.data());
+
+    m_drawList = VulkanDrawList(m_device.get(), 64);
 }
 
-void Renderer::CreateTexture() {
-    ImageFile imageFile("test.png");
-    m_texture = VulkanTexture(m_device.get(), imageFile.GetWidth(), imageFile.GetHeight(), imageFile.GetData());
+void Renderer::CreateInstances() {
+    constexpr float spacing = 4.0f;
+    const float halfExtent = static_cast<float>(m_gridSize - 1) * spacing * 0.5f;
+
+    std::vector<std::vector<InstanceBase>> instancesPerShape(m_shapes.size());
+    for (int z = 0; z < m_gridSize; z++) {
+        for (int x = 0; x < m_gridSize; x++) {
+            const glm::vec3 position{static_cast<float>(x) * spacing - halfExtent, 0.0f, static_cast<float>(z) * spacing - halfExtent};
+            const glm::vec4 color{
+                    0.5f + 0.5f * static_cast<float>(x) / static_cast<float>(m_gridSize),
+                    1.0f,
+                    0.5f + 0.5f * static_cast<float>(z) / static_cast<float>(m_gridSize),
+                    1.0f
+            };
+            const size_t shapeIndex = (x * 7 + z * 13) % m_shapes.size();
+            instancesPerShape[shapeIndex].emplace_back(glm::translate(glm::mat4(1.0f), position), color);
+        }
+    }
+
+    m_instances.clear();
+    m_instances.reserve(m_gridSize * m_gridSize);
+    m_batches.clear();
+    for (const std::vector<InstanceBase> &instances: instancesPerShape) {
+        InstanceBatch &batch = m_batches.emplace_back();
+        batch.FirstInstance = m_instances.size();
+        batch.InstanceCount = instances.size();
+        m_instances.insert(m_instances.end(), instances.begin(), instances.end());
+    }
+
+    std::vector<GpuCullingMesh> cullingMeshes;
+    for (const Shape &shape: m_shapes) {
+        cullingMeshes.push_back({shape.Lods, shape.LodErrors});
+    }
+    std::vector<GpuCullingObject> cullingObjects;
+    cullingObjects.reserve(m_instances.size());
+    m_cullingBounds.Clear();
+    m_cullingBounds.Reserve(m_instances.size());
+    m_sceneBvh.Clear();
+    for (size_t i = 0; i < m_batches.size(); i++) {
+        const InstanceBatch &batch = m_batches[i];
+        const glm::vec4 &localBounds = m_shapes[i].Bounds;
+        for (uint32_t j = 0; j < batch.InstanceCount; j++) {
+            // instances are only translated
+            const glm::mat4 &model = m_instances[batch.FirstInstance + j].Model;
+            const glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(localBounds), 1.0f));
+            cullingObjects.push_back({glm::vec4(center, localBounds.w), static_cast<uint32_t>(i)});
+            m_cullingBounds.AddSphere(center, localBounds.w);
+            m_sceneBvh.Insert(center - localBounds.w, center + localBounds.w, batch.FirstInstance + j);
+        }
+    }
+    m_sceneBvh.Build();
+    m_gpuInstanceCulling.SetScene(cullingMeshes, cullingObjects, m_instances);
+    m_visibleIndices.resize(m_instances.size());
+    m_instanceLods.assign(m_instances.size(), 0);
 }
 
-void Renderer::CreateMaterial() {
-    m_materialDescriptorSet = m_materialDescriptorSetLayout.AllocateDescriptorSet();
-    m_texture.BindToDescriptorSet(m_materialDescriptorSet, 0);
+void Renderer::CreateMeshletScene() {
+    // cooked with "MeshCook sphere.mesh sphere --segments 256 --rings 128", the streams are uploaded straight from the mapping
+    std::vector<Meshlet> meshlets;
+    MeshFile meshFile("sphere.mesh");
+    if (meshFile.IsValid() && meshFile.GetMeshletCount() > 0) {
+        meshlets.assign(meshFile.GetMeshlets(), meshFile.GetMeshlets() + meshFile.GetMeshletCount());
+        m_meshletMesh = VulkanMesh(
+                m_device.get(),
+                meshFile.GetVertexCount(), sizeof(VertexBase), meshFile.GetVertices(),
+                meshFile.GetIndexCount(), meshFile.GetIndices()
+        );
+    } else {
+        std::vector<VertexBase> vertices;
+        std::vector<uint32_t> indices;
+        AppendSphereVertices(vertices, indices, glm::vec3{0.0f}, 1.0f, 256, 128);
+
+        std::vector<uint32_t> meshletIndices;
+        BuildMeshlets(vertices.data(), vertices.size(), indices.data(), indices.size(), meshlets, meshletIndices);
+        m_meshletMesh = VulkanMesh(m_device.get(), vertices.size(), sizeof(VertexBase), vertices.data(), meshletIndices.size(), meshletIndices.data());
+    }
+
+    // a floating layer of big spheres above the box grid
+    constexpr int sphereGridSize = 8;
+    constexpr float spacing = 24.0f;
+    constexpr float halfExtent = static_cast<float>(sphereGridSize - 1) * spacing * 0.5f;
+    std::vector<InstanceBase> instances;
+    std::vector<GpuMeshletObject> objects;
+    for (int z = 0; z < sphereGridSize; z++) {
+        for (int x = 0; x < sphereGridSize; x++) {
+            const glm::vec3 position{static_cast<float>(x) * spacing - halfExtent, 30.0f, static_cast<float>(z) * spacing - halfExtent};
+            const glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(8.0f));
+            instances.emplace_back(model, glm::vec4(1.0f, 0.8f, 0.6f, 1.0f));
+            objects.push_back({0, static_cast<uint32_t>(meshlets.size())});
+        }
+    }
+    m_gpuMeshletCulling.SetScene(meshlets, 0, objects, instances);
+}
+
+void Renderer::CreateWaveMesh() {
+    const MeshSize size = GetGridSize(WaveCells, WaveCells);
+    m_waveMesh = VulkanDynamicMesh(m_device.get(), sizeof(VertexBase), size.VertexCount, size.IndexCount);
+    m_waveMesh.Resize(size.VertexCount, size.IndexCount);
+    m_waveHeights.resize(size.VertexCount);
+    UpdateWaveMesh();
+    m_waveMesh.MarkIndicesDirty(0, size.IndexCount);
+
+    const InstanceBase instance(glm::mat4(1.0f), glm::vec4(0.3f, 0.5f, 0.9f, 1.0f));
+    m_waveInstanceBuffer = m_device->CreateBufferWithData(sizeof(InstanceBase), &instance, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+}
+
+void Renderer::UpdateWaveMesh() {
+    constexpr float waveExtent = 256.0f;
+    for (uint32_t z = 0; z <= WaveCells; z++) {
+        for (uint32_t x = 0; x <= WaveCells; x++) {
+            const float phaseX = static_cast<float>(x) * 0.15f + m_waveTime * 1.5f;
+            const float phaseZ = static_cast<float>(z) * 0.1f + m_waveTime;
+            m_waveHeights[z * (WaveCells + 1) + x] = glm::sin(phaseX) * glm::cos(phaseZ) * 2.0f;
+        }
+    }
+
+    // the grid indices come out the same every time, so only the vertices need to reach the GPU again
+    GenerateGrid(
+            static_cast<VertexBase *>(m_waveMesh.GetVertexData()), m_waveMesh.GetIndexData(), 0,
+            glm::vec3{-waveExtent, -8.0f, -waveExtent}, glm::vec2{waveExtent * 2.0f}, WaveCells, WaveCells, m_waveHeights.data()
+    );
+    m_waveMesh.MarkVerticesDirty(0, m_waveMesh.GetVertexCount());
+}
+
+void Renderer::CreateVoxelWorld() {
+    constexpr float halfSize = static_cast<float>(VoxelTerrainSize) * 0.5f;
+    m_voxelWorld = VoxelWorld(m_device.get(), &m_threadPool, glm::vec3{-halfSize, -48.0f, -halfSize});
+    FillVoxelTerrain();
+
+    const InstanceBase instance(glm::mat4(1.0f), glm::vec4(0.6f, 0.5f, 0.35f, 1.0f));
+    m_voxelInstanceBuffer = m_device->CreateBufferWithData(sizeof(InstanceBase), &instance, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+}
+
+void Renderer::FillVoxelTerrain() {
+    for (int z = 0; z < VoxelTerrainSize; z++) {
+        for (int x = 0; x < VoxelTerrainSize; x++) {
+            const float height = glm::sin(static_cast<float>(x) * 0.05f) * glm::cos(static_cast<float>(z) * 0.07f) * 10.0f + 16.0f;
+            const int top = static_cast<int>(height);
+            m_voxelWorld.FillBox({x, 0, z}, {x, top, z}, 1);
+            m_voxelWorld.FillBox({x, top + 1, z}, {x, VoxelTerrainHeight - 1, z}, 0);
+        }
+    }
+}
+
+void Renderer::CreateTexture() {
+    m_textureCache = TextureCache(m_device.get(), &m_threadPool);
+    m_textureStreamer = TextureStreamer(m_device.get(), &m_threadPool, &m_textureCache, m_materialDescriptorSetLayout.Get(), 0);
+
+    // a precompressed copy with its mips is uploaded as is, Frame falls back to the PNG when it can't be loaded
+    m_texture = m_textureStreamer.Request("test.ktx2", {}, true);
 }
 
 Renderer::~Renderer() {
@@ -170,9 +369,22 @@ Renderer::~Renderer() {
 
     m_device->ImGuiShutdown();
 
-    m_device->FreeDescriptorSet(m_materialDescriptorSet);
-
     m_texture = {};
+    m_textureStreamer = {};
+    m_textureCache = {};
+
+    m_gpuInstanceCulling = {};
+
+    m_gpuMeshletCulling = {};
+    m_meshletMesh = {};
+
+    m_waveMesh = {};
+    m_waveInstanceBuffer = {};
+
+    m_voxelWorld = {};
+    m_voxelInstanceBuffer = {};
+
+    m_drawList = {};
 
     m_mesh = {};
 
@@ -181,6 +393,7 @@ Renderer::~Renderer() {
 
     for (BufferingObjects &bufferingObjects: m_bufferingObjects) {
         bufferingObjects.EngineUniformBuffer = {};
+        bufferingObjects.InstanceBuffer = {};
         m_device->FreeDescriptorSet(bufferingObjects.EngineDescriptorSet);
     }
 
@@ -194,24 +407,78 @@ void Renderer::Frame(float deltaTime) {
     m_fps = 1.0f / deltaTime;
     m_rotation += glm::radians(deltaTime * m_rotationSpeed);
 
+    if (m_instancesDirty) {
+        m_device->WaitIdle();
+        CreateInstances();
+        m_instancesDirty = false;
+    }
+
     auto [screenFramebuffer, bufferingIndex, cmd] = m_device->BeginFrame();
+    m_textureCache.Update();
+    m_textureStreamer.Update(cmd, bufferingIndex);
+    // the precompressed copy is missing or in a format the device can't sample, the PNG has its mips generated instead
+    if (m_texture->HasFailed() && m_texture->GetFilename() != "test.png") {
+        m_texture = m_textureStreamer.Request("test.png", {}, true);
+    }
 
     BufferingObjects &bufferingObjects = m_bufferingObjects[bufferingIndex];
     const VkExtent2D &swapchainExtent = m_device->GetSwapchainExtent();
+    const float fovY = glm::radians(60.0f);
     const glm::mat4 projection = glm::perspective(
-            glm::radians(60.0f),
+            fovY,
             static_cast<float>(swapchainExtent.width) / static_cast<float>(swapchainExtent.height),
             0.1f,
-            100.0f
+            4000.0f
     );
+    // orbit around the grid, far enough to see all of it
+    const float orbitRadius = 5.0f + static_cast<float>(m_gridSize) * 2.0f;
+    const glm::vec3 eye{
+            orbitRadius * glm::sin(m_rotation),
+            orbitRadius * 0.6f,
+            -orbitRadius * glm::cos(m_rotation)
+    };
     const glm::mat4 view = glm::lookAt(
-            glm::vec3(3.0f, 4.0f, -5.0f),
+            eye,
             glm::vec3(0.0f, 0.0f, 0.0f),
             glm::vec3(0.0f, 1.0f, 0.0f)
     );
     EngineUniformData engineUniformData{projection, view};
     bufferingObjects.EngineUniformBuffer.Upload(sizeof(EngineUniformData), &engineUniformData);
 
+    const Frustum frustum(projection * view);
+    m_lodSelection.ProjectionScale = GetLodProjectionScale(fovY, static_cast<float>(swapchainExtent.height));
+    // every instance samples the same texture, the closest one needs the finest mip
+    float nearestDistance = std::numeric_limits<float>::max();
+    for (size_t i = 0; i < m_instances.size(); i++) {
+        const glm::vec3 center{m_cullingBounds.GetCenterX()[i], m_cullingBounds.GetCenterY()[i], m_cullingBounds.GetCenterZ()[i]};
+        nearestDistance = glm::min(nearestDistance, glm::max(glm::distance(center, eye) - m_cullingBounds.GetRadius()[i], 0.0f));
+    }
+    TextureStreamer::ReportUsage(*m_texture, nearestDistance, 1.0f, m_lodSelection.ProjectionScale);
+    if (m_gpuCulling) {
+        m_gpuInstanceCulling.Cull(cmd, bufferingIndex, frustum, eye, m_lodSelection);
+    }
+    if (m_drawMeshlets) {
+        m_gpuMeshletCulling.Cull(cmd, bufferingIndex, frustum, eye);
+    }
+    if (m_drawWaves) {
+        m_waveTime += deltaTime;
+        UpdateWaveMesh();
+        m_waveMesh.Upload(bufferingIndex);
+    }
+    if (m_drawVoxels) {
+        if (m_carveVoxels) {
+            m_voxelTime += deltaTime;
+            const float radius = static_cast<float>(VoxelTerrainSize) * 0.35f;
+            const glm::vec3 center{
+                    static_cast<float>(VoxelTerrainSize) * 0.5f + glm::cos(m_voxelTime * 0.5f) * radius,
+                    static_cast<float>(VoxelTerrainHeight) * 0.5f,
+                    static_cast<float>(VoxelTerrainSize) * 0.5f + glm::sin(m_voxelTime * 0.35f) * radius
+            };
+            m_voxelWorld.FillSphere(center, 6.0f, 0);
+        }
+        m_voxelWorld.Update(bufferingIndex);
+    }
+
     VkClearValue clearValues[2];
     clearValues[0].color = m_clearColor;
     VkClearDepthStencilValue &clearDepthStencil = clearValues[1].depthStencil;
@@ -229,11 +496,74 @@ void Renderer::Frame(float deltaTime) {
     VulkanPipeline &pipeline = m_fill ? m_fillPipeline : m_wirePipeline;
     pipeline.Bind(cmd);
     pipeline.BindDescriptorSet(cmd, bufferingObjects.EngineDescriptorSet, 0);
-    pipeline.BindDescriptorSet(cmd, m_materialDescriptorSet, 1);
-    const glm::mat4 model = glm::rotate(glm::mat4(1.0f), m_rotation, glm::vec3(0.0f, 1.0f, 0.0f));
-    const ModelConstantsData constantsData{model};
-    pipeline.PushConstants(cmd, constantsData);
-    m_mesh.BindAndDraw(cmd);
+    pipeline.BindDescriptorSet(cmd, m_texture->GetDescriptorSet(bufferingIndex), 1);
+    pipeline.BindDescriptorSet(cmd, m_texture->GetSamplerDescriptorSet(bufferingIndex), 2);
+    if (m_gpuCulling) {
+        m_gpuInstanceCulling.Draw(cmd, bufferingIndex, m_mesh);
+    } else {
+        m_mesh.BindInstanced(cmd, bufferingObjects.InstanceBuffer.Get());
+        m_drawList.Begin(bufferingIndex);
+        if (m_cpuCulling && m_bvhCulling) {
+            m_numVisible = m_sceneBvh.QueryFrustum(frustum, m_visibleIndices.data());
+            // the BVH reports in tree order
+            std::sort(m_visibleIndices.begin(), m_visibleIndices.begin() + m_numVisible);
+        } else if (m_cpuCulling) {
+            m_numVisible = CullBounds(m_cullingBounds, frustum, m_visibleIndices.data());
+        } else {
+            m_numVisible = m_instances.size();
+            std::iota(m_visibleIndices.begin(), m_visibleIndices.end(), 0);
+        }
+
+        // visible indices are sorted, so every batch is a contiguous range of them,
+        // inside a batch the instances are bucketed by LOD so that every LOD is one draw
+        auto *visibleInstances = static_cast<InstanceBase *>(bufferingObjects.InstanceBuffer.GetMappedData());
+        uint32_t visibleIndex = 0;
+        for (size_t i = 0; i < m_shapes.size(); i++) {
+            const Shape &shape = m_shapes[i];
+            const auto lodCount = static_cast<uint32_t>(shape.Lods.size());
+            const uint32_t batchBegin = visibleIndex;
+            const uint32_t batchEnd = m_batches[i].FirstInstance + m_batches[i].InstanceCount;
+
+            uint32_t lodCounts[GpuInstanceCulling::MaxLods]{};
+            for (; visibleIndex < m_numVisible && m_visibleIndices[visibleIndex] < batchEnd; visibleIndex++) {
+                const uint32_t instanceIndex = m_visibleIndices[visibleIndex];
+                const glm::vec3 center{
+                        m_cullingBounds.GetCenterX()[instanceIndex],
+                        m_cullingBounds.GetCenterY()[instanceIndex],
+                        m_cullingBounds.GetCenterZ()[instanceIndex]
+                };
+                const float distance = glm::max(glm::distance(center, eye) - m_cullingBounds.GetRadius()[instanceIndex], 0.0f);
+                const uint32_t lod = SelectLod(shape.LodErrors.data(), lodCount, distance, m_lodSelection, m_instanceLods[instanceIndex]);
+                m_instanceLods[instanceIndex] = lod;
+                lodCounts[lod]++;
+            }
+
+            uint32_t lodOffsets[GpuInstanceCulling::MaxLods];
+            uint32_t firstInstance = batchBegin;
+            for (uint32_t lod = 0; lod < lodCount; lod++) {
+                lodOffsets[lod] = firstInstance;
+                if (lodCounts[lod] > 0) {
+                    m_drawList.AddDraw(shape.Lods[lod], lodCounts[lod], firstInstance);
+                }
+                firstInstance += lodCounts[lod];
+            }
+            for (uint32_t j = batchBegin; j < visibleIndex; j++) {
+                const uint32_t instanceIndex = m_visibleIndices[j];
+                visibleInstances[lodOffsets[m_instanceLods[instanceIndex]]++] = m_instances[instanceIndex];
+            }
+        }
+        bufferingObjects.InstanceBuffer.Flush(0, m_numVisible * sizeof(InstanceBase));
+        m_drawList.Submit(cmd);
+    }
+    if (m_drawMeshlets) {
+        m_gpuMeshletCulling.Draw(cmd, bufferingIndex, m_meshletMesh);
+    }
+    if (m_drawWaves) {
+        m_waveMesh.BindAndDrawInstanced(cmd, m_waveInstanceBuffer.Get(), 1);
+    }
+    if (m_drawVoxels) {
+        m_voxelWorld.Draw(cmd, m_voxelInstanceBuffer.Get(), frustum);
+    }
 
     if (m_showImGui) {
         m_device->ImGuiNewFrame();
@@ -244,6 +574,50 @@ void Renderer::Frame(float deltaTime) {
 
         ImGui::ColorEdit4("Clear Color", m_clearColor.float32);
         ImGui::Checkbox("Cube Filled", &m_fill);
+        if (ImGui::SliderInt("Grid Size", &m_gridSize, 1, MaxGridSize)) {
+            m_instancesDirty = true;
+        }
+        ImGui::Checkbox("GPU Culling", &m_gpuCulling);
+        if (!m_gpuCulling) {
+            ImGui::Checkbox("CPU Culling", &m_cpuCulling);
+            if (m_cpuCulling) {
+                ImGui::Checkbox("BVH Culling", &m_bvhCulling);
+            }
+            ImGui::Text("visible = %u (%s)", m_numVisible, GetCullingIsaName(GetBestCullingIsa()));
+        }
+        ImGui::Text("instances = %zu", m_instances.size());
+        ImGui::SliderFloat("LOD Error (px)", &m_lodSelection.ErrorThreshold, 0.1f, 16.0f);
+        ImGui::SliderFloat("LOD Hysteresis", &m_lodSelection.Hysteresis, 0.0f, 0.9f);
+        ImGui::Checkbox("Meshlet Spheres", &m_drawMeshlets);
+        ImGui::Text("meshlet clusters = %u", m_gpuMeshletCulling.GetClusterCount());
+        ImGui::Checkbox("CPU Waves", &m_drawWaves);
+        if (const TextureHandle &texture = m_texture->GetTexture()) {
+            if (m_texture->GetMipCount() > 0) {
+                ImGui::Text("texture mips = %u-%u resident (format %d)", texture->GetFirstMip(), m_texture->GetMipCount() - 1, static_cast<int>(texture->GetFormat()));
+            } else {
+                ImGui::Text("texture mips = %u (format %d)", texture->GetMipLevels(), static_cast<int>(texture->GetFormat()));
+            }
+        } else {
+            ImGui::Text("texture = %s (%s)", m_texture->GetFilename().c_str(), m_texture->HasFailed() ? "failed" : "streaming");
+        }
+        ImGui::Text("streaming textures = %u pending", m_textureStreamer.GetPendingCount());
+        ImGui::Text("samplers = %zu", m_device->GetSamplerCount());
+        ImGui::Text(
+                "texture cache = %zu textures, %.1f MB, %llu hits, %llu misses",
+                m_textureCache.GetTextureCount(),
+                static_cast<double>(m_textureCache.GetMemorySize()) / (1024.0 * 1024.0),
+                static_cast<unsigned long long>(m_textureCache.GetHitCount()),
+                static_cast<unsigned long long>(m_textureCache.GetMissCount())
+        );
+        ImGui::Checkbox("Voxels", &m_drawVoxels);
+        if (m_drawVoxels) {
+            ImGui::Checkbox("Carve Voxels", &m_carveVoxels);
+            if (ImGui::Button("Reset Voxels")) {
+                FillVoxelTerrain();
+            }
+            ImGui::Text("voxel chunks = %zu (%zu pending)", m_voxelWorld.GetChunkCount(), m_voxelWorld.GetPendingChunkCount());
+            ImGui::Text("voxel triangles = %u (%llu as boxes)", m_voxelWorld.GetTriangleCount(), static_cast<unsigned long long>(m_voxelWorld.GetBoxTriangleCount()));
+        }
         m_device->ImGuiRender(cmd);
     }
 
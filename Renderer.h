@@ -12,7 +12,16 @@
 #include "VulkanDescriptorSetLayout.h"
 #include "VulkanPipeline.h"
 #include "VulkanMesh.h"
-#include "VulkanTexture.h"
+#include "VulkanDynamicMesh.h"
+#include "VoxelWorld.h"
+#include "ThreadPool.h"
+#include "VulkanDrawList.h"
+#include "GpuInstanceCulling.h"
+#include "FrustumCulling.h"
+#include "SceneBvh.h"
+#include "GpuMeshletCulling.h"
+#include "TextureStreamer.h"
+#include "VertexBase.h"
 
 class Renderer {
 public:
@@ -43,9 +52,19 @@ private:
 
     void CreateMesh();
 
-    void CreateTexture();
+    void CreateInstances();
+
+    void CreateMeshletScene();
+
+    void CreateWaveMesh();
 
-    void CreateMaterial();
+    void UpdateWaveMesh();
+
+    void CreateVoxelWorld();
+
+    void FillVoxelTerrain();
+
+    void CreateTexture();
 
     GLFWwindow *m_window = nullptr;
     std::unique_ptr<VulkanBase> m_device;
@@ -56,6 +75,7 @@ private:
     struct BufferingObjects {
         VulkanBuffer EngineUniformBuffer;
         VkDescriptorSet EngineDescriptorSet;
+        VulkanBuffer InstanceBuffer;
     };
     std::vector<BufferingObjects> m_bufferingObjects;
 
@@ -63,11 +83,74 @@ private:
     VulkanPipeline m_fillPipeline;
     VulkanPipeline m_wirePipeline;
 
+    // all shapes share one vertex/index buffer so they can be drawn from one indirect batch
     VulkanMesh m_mesh;
-
-    VulkanTexture m_texture;
-
-    VkDescriptorSet m_materialDescriptorSet = VK_NULL_HANDLE;
+    struct Shape {
+        // Lods[0] is the full detail, every LOD is a range of the shared index buffer
+        std::vector<VulkanSubMesh> Lods;
+        std::vector<float> LodErrors;
+        // local space bounding sphere
+        glm::vec4 Bounds;
+    };
+    std::vector<Shape> m_shapes;
+
+    static constexpr int MaxGridSize = 512;
+    int m_gridSize = 100;
+    // instances are rebuilt before the next frame starts recording, the current one may still use them
+    bool m_instancesDirty = false;
+    // sorted by shape, m_batches[i] covers the instances of m_shapes[i]
+    std::vector<InstanceBase> m_instances;
+    struct InstanceBatch {
+        uint32_t FirstInstance = 0;
+        uint32_t InstanceCount = 0;
+    };
+    std::vector<InstanceBatch> m_batches;
+
+    VulkanDrawList m_drawList;
+
+    LodSelection m_lodSelection;
+
+    bool m_gpuCulling = true;
+    GpuInstanceCulling m_gpuInstanceCulling;
+
+    // used when GPU culling is off, m_cullingBounds[i] bounds m_instances[i]
+    bool m_cpuCulling = true;
+    CullingBounds m_cullingBounds;
+    std::vector<uint32_t> m_visibleIndices;
+    uint32_t m_numVisible = 0;
+    // the same boxes in a BVH, its user data is the instance index
+    bool m_bvhCulling = false;
+    SceneBvh m_sceneBvh;
+    // the LOD every instance used last frame on the CPU path
+    std::vector<uint32_t> m_instanceLods;
+
+    // dense spheres split into meshlets, culled per cluster on the GPU
+    bool m_drawMeshlets = true;
+    VulkanMesh m_meshletMesh;
+    GpuMeshletCulling m_gpuMeshletCulling;
+
+    // a heightmap animated on the CPU and streamed through a dynamic mesh every frame
+    static constexpr uint32_t WaveCells = 128;
+    bool m_drawWaves = true;
+    float m_waveTime = 0.0f;
+    VulkanDynamicMesh m_waveMesh;
+    std::vector<float> m_waveHeights;
+    VulkanBuffer m_waveInstanceBuffer;
+
+    // chunked voxel terrain carved by a moving sphere, dirty chunks are greedy meshed on the thread pool
+    static constexpr int VoxelTerrainSize = 256;
+    static constexpr int VoxelTerrainHeight = 32;
+    ThreadPool m_threadPool;
+    bool m_drawVoxels = true;
+    bool m_carveVoxels = true;
+    float m_voxelTime = 0.0f;
+    VoxelWorld m_voxelWorld;
+    VulkanBuffer m_voxelInstanceBuffer;
+
+    TextureCache m_textureCache;
+    // the texture is drawn with a placeholder until it has streamed in
+    TextureStreamer m_textureStreamer;
+    StreamedTextureHandle m_texture;
 
     bool m_showImGui = true;
 
@@ -0,0 +1,796 @@
+//
+// Created by andyroiiid on 1/1/2023.
+//
+
+#include "SceneBvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <glm/common.hpp>
+
+#include "Debug.h"
+
+// SSE2 is part of every x86-64 target
+#if defined(_M_X64) || defined(__x86_64__)
+#define SCENE_BVH_SSE
+
+#include <emmintrin.h>
+#endif
+
+static float GetSurfaceArea(const glm::vec3 &min, const glm::vec3 &max) {
+    const glm::vec3 size = max - min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+void SceneBvh::Clear() {
+    m_proxies.clear();
+    m_freeProxies.clear();
+    m_nodes.clear();
+    m_freeNodes.clear();
+    m_root = InvalidNode;
+    m_flatNodes.clear();
+    m_treeBoundsStale = false;
+    m_flatTopologyStale = false;
+    m_flatBoundsStale = false;
+}
+
+uint32_t SceneBvh::AllocateNode() {
+    if (!m_freeNodes.empty()) {
+        const uint32_t node = m_freeNodes.back();
+        m_freeNodes.pop_back();
+        return node;
+    }
+    m_nodes.emplace_back();
+    return m_nodes.size() - 1;
+}
+
+void SceneBvh::FreeNode(uint32_t node) {
+    m_freeNodes.push_back(node);
+}
+
+uint32_t SceneBvh::Insert(const glm::vec3 &min, const glm::vec3 &max, uint32_t userData) {
+    uint32_t proxy;
+    if (!m_freeProxies.empty()) {
+        proxy = m_freeProxies.back();
+        m_freeProxies.pop_back();
+    } else {
+        proxy = m_proxies.size();
+        m_proxies.emplace_back();
+    }
+
+    const uint32_t leaf = AllocateNode();
+    m_nodes[leaf] = {min, max, InvalidNode, {InvalidNode, InvalidNode}, proxy};
+    m_proxies[proxy] = {min, max, userData, leaf};
+    InsertLeaf(leaf);
+    return proxy;
+}
+
+void SceneBvh::Remove(uint32_t proxy) {
+    if (!DebugCheck(proxy < m_proxies.size() && m_proxies[proxy].Leaf != InvalidNode, "Invalid BVH proxy {}.", proxy)) {
+        return;
+    }
+    const uint32_t leaf = m_proxies[proxy].Leaf;
+    RemoveLeaf(leaf);
+    FreeNode(leaf);
+    m_proxies[proxy].Leaf = InvalidNode;
+    m_freeProxies.push_back(proxy);
+}
+
+void SceneBvh::Update(uint32_t proxy, const glm::vec3 &min, const glm::vec3 &max) {
+    if (!DebugCheck(proxy < m_proxies.size() && m_proxies[proxy].Leaf != InvalidNode, "Invalid BVH proxy {}.", proxy)) {
+        return;
+    }
+    m_proxies[proxy].Min = min;
+    m_proxies[proxy].Max = max;
+    m_treeBoundsStale = true;
+    m_flatBoundsStale = true;
+}
+
+void SceneBvh::InsertLeaf(uint32_t leaf) {
+    if (m_treeBoundsStale) {
+        RefitTree();
+    }
+    m_flatTopologyStale = true;
+
+    if (m_root == InvalidNode) {
+        m_root = leaf;
+        m_nodes[leaf].Parent = InvalidNode;
+        return;
+    }
+
+    // Walk down to the cheapest sibling by surface area: creating a parent here costs the combined area,
+    // going down a level additionally grows this node (inherited cost) and puts the leaf next to a child.
+    const glm::vec3 leafMin = m_nodes[leaf].Min;
+    const glm::vec3 leafMax = m_nodes[leaf].Max;
+    uint32_t sibling = m_root;
+    while (!m_nodes[sibling].IsLeaf()) {
+        const Node &node = m_nodes[sibling];
+        const float area = GetSurfaceArea(node.Min, node.Max);
+        const float combinedArea = GetSurfaceArea(glm::min(node.Min, leafMin), glm::max(node.Max, leafMax));
+        const float cost = 2.0f * combinedArea;
+        const float inheritedCost = 2.0f * (combinedArea - area);
+
+        float childCosts[2];
+        for (int i = 0; i < 2; i++) {
+            const Node &child = m_nodes[node.Children[i]];
+            const float unionArea = GetSurfaceArea(glm::min(child.Min, leafMin), glm::max(child.Max, leafMax));
+            childCosts[i] = (child.IsLeaf() ? unionArea : unionArea - GetSurfaceArea(child.Min, child.Max)) + inheritedCost;
+        }
+        if (cost < childCosts[0] && cost < childCosts[1]) {
+            break;
+        }
+        sibling = childCosts[0] < childCosts[1] ? node.Children[0] : node.Children[1];
+    }
+
+    const uint32_t oldParent = m_nodes[sibling].Parent;
+    const uint32_t newParent = AllocateNode();
+    Node &parent = m_nodes[newParent];
+    parent.Min = glm::min(m_nodes[sibling].Min, leafMin);
+    parent.Max = glm::max(m_nodes[sibling].Max, leafMax);
+    parent.Parent = oldParent;
+    parent.Children[0] = sibling;
+    parent.Children[1] = leaf;
+    parent.Proxy = InvalidProxy;
+    m_nodes[sibling].Parent = newParent;
+    m_nodes[leaf].Parent = newParent;
+
+    if (oldParent == InvalidNode) {
+        m_root = newParent;
+    } else {
+        Node &grandParent = m_nodes[oldParent];
+        grandParent.Children[grandParent.Children[0] == sibling ? 0 : 1] = newParent;
+        RefitAncestors(oldParent);
+    }
+}
+
+void SceneBvh::RemoveLeaf(uint32_t leaf) {
+    if (m_treeBoundsStale) {
+        RefitTree();
+    }
+    m_flatTopologyStale = true;
+
+    if (leaf == m_root) {
+        m_root = InvalidNode;
+        return;
+    }
+
+    // the sibling takes the place of the parent
+    const uint32_t parent = m_nodes[leaf].Parent;
+    const uint32_t grandParent = m_nodes[parent].Parent;
+    const uint32_t sibling = m_nodes[parent].Children[m_nodes[parent].Children[0] == leaf ? 1 : 0];
+    m_nodes[sibling].Parent = grandParent;
+    if (grandParent == InvalidNode) {
+        m_root = sibling;
+    } else {
+        Node &node = m_nodes[grandParent];
+        node.Children[node.Children[0] == parent ? 0 : 1] = sibling;
+        RefitAncestors(grandParent);
+    }
+    FreeNode(parent);
+}
+
+void SceneBvh::RefitAncestors(uint32_t node) {
+    while (node != InvalidNode) {
+        Node &current = m_nodes[node];
+        const Node &child0 = m_nodes[current.Children[0]];
+        const Node &child1 = m_nodes[current.Children[1]];
+        current.Min = glm::min(child0.Min, child1.Min);
+        current.Max = glm::max(child0.Max, child1.Max);
+        node = current.Parent;
+    }
+}
+
+void SceneBvh::Build() {
+    m_nodes.clear();
+    m_freeNodes.clear();
+    m_root = InvalidNode;
+    m_treeBoundsStale = false;
+    m_flatTopologyStale = true;
+
+    struct BuildItem {
+        glm::vec3 Min;
+        glm::vec3 Max;
+        glm::vec3 Centroid;
+        uint32_t Proxy;
+    };
+    struct BuildBounds {
+        glm::vec3 Min{std::numeric_limits<float>::max()};
+        glm::vec3 Max{-std::numeric_limits<float>::max()};
+        glm::vec3 CentroidMin{std::numeric_limits<float>::max()};
+        glm::vec3 CentroidMax{-std::numeric_limits<float>::max()};
+        uint32_t Count = 0;
+
+        void Add(const BuildItem &item) {
+            Min = glm::min(Min, item.Min);
+            Max = glm::max(Max, item.Max);
+            CentroidMin = glm::min(CentroidMin, item.Centroid);
+            CentroidMax = glm::max(CentroidMax, item.Centroid);
+            Count++;
+        }
+
+        void Add(const BuildBounds &other) {
+            Min = glm::min(Min, other.Min);
+            Max = glm::max(Max, other.Max);
+            CentroidMin = glm::min(CentroidMin, other.CentroidMin);
+            CentroidMax = glm::max(CentroidMax, other.CentroidMax);
+            Count += other.Count;
+        }
+
+        [[nodiscard]] float GetCost() const {
+            return Count > 0 ? static_cast<float>(Count) * GetSurfaceArea(Min, Max) : 0.0f;
+        }
+    };
+
+    std::vector<BuildItem> items;
+    items.reserve(GetObjectCount());
+    BuildBounds rootBounds;
+    for (uint32_t i = 0; i < m_proxies.size(); i++) {
+        const Proxy &proxy = m_proxies[i];
+        if (proxy.Leaf != InvalidNode) {
+            rootBounds.Add(items.emplace_back(BuildItem{proxy.Min, proxy.Max, (proxy.Min + proxy.Max) * 0.5f, i}));
+        }
+    }
+    if (items.empty()) {
+        return;
+    }
+
+    // nodes never move during the build
+    m_nodes.reserve(items.size() * 2 - 1);
+    m_root = AllocateNode();
+    m_nodes[m_root].Parent = InvalidNode;
+
+    // bounds of the children come out of the binning, so every level touches the items twice: binning and partitioning
+    struct BuildTask {
+        uint32_t Node;
+        uint32_t Begin;
+        BuildBounds Bounds;
+    };
+    std::vector<BuildTask> tasks{{m_root, 0, rootBounds}};
+    std::vector<uint8_t> itemBins(items.size());
+    while (!tasks.empty()) {
+        const BuildTask task = tasks.back();
+        tasks.pop_back();
+        const uint32_t end = task.Begin + task.Bounds.Count;
+
+        Node &node = m_nodes[task.Node];
+        node.Min = task.Bounds.Min;
+        node.Max = task.Bounds.Max;
+        if (task.Bounds.Count == 1) {
+            node.Children[0] = node.Children[1] = InvalidNode;
+            node.Proxy = items[task.Begin].Proxy;
+            m_proxies[node.Proxy].Leaf = task.Node;
+            continue;
+        }
+
+        const glm::vec3 centroidExtent = task.Bounds.CentroidMax - task.Bounds.CentroidMin;
+        const int axis = centroidExtent.x > centroidExtent.y && centroidExtent.x > centroidExtent.z ? 0 : centroidExtent.y > centroidExtent.z ? 1 : 2;
+
+        // binning costs more than it gains on a handful of objects, they are split at the median
+        constexpr uint32_t MinBinnedCount = 16;
+        uint32_t middle = task.Begin;
+        BuildBounds leftBounds;
+        BuildBounds rightBounds;
+        if (task.Bounds.Count >= MinBinnedCount && centroidExtent[axis] > 0.0f) {
+            // binned surface area heuristic, the split cost is count * area summed over both sides
+            constexpr int NumBins = 16;
+            BuildBounds bins[NumBins];
+            const float binScale = static_cast<float>(NumBins) / centroidExtent[axis];
+            for (uint32_t i = task.Begin; i < end; i++) {
+                const int bin = std::min(static_cast<int>((items[i].Centroid[axis] - task.Bounds.CentroidMin[axis]) * binScale), NumBins - 1);
+                itemBins[i] = static_cast<uint8_t>(bin);
+                bins[bin].Add(items[i]);
+            }
+
+            BuildBounds rightSweep[NumBins];
+            for (int i = NumBins - 1; i > 0; i--) {
+                rightSweep[i] = i + 1 < NumBins ? rightSweep[i + 1] : BuildBounds{};
+                rightSweep[i].Add(bins[i]);
+            }
+
+            int bestSplit = 0;
+            float bestCost = std::numeric_limits<float>::max();
+            BuildBounds leftSweep;
+            for (int i = 1; i < NumBins; i++) {
+                leftSweep.Add(bins[i - 1]);
+                const float cost = leftSweep.GetCost() + rightSweep[i].GetCost();
+                if (leftSweep.Count > 0 && rightSweep[i].Count > 0 && cost < bestCost) {
+                    bestCost = cost;
+                    bestSplit = i;
+                    leftBounds = leftSweep;
+                    rightBounds = rightSweep[i];
+                }
+            }
+
+            if (bestSplit > 0) {
+                // partition items and their bins together
+                uint32_t left = task.Begin;
+                uint32_t right = end;
+                while (left < right) {
+                    if (itemBins[left] < bestSplit) {
+                        left++;
+                    } else {
+                        right--;
+                        std::swap(items[left], items[right]);
+                        std::swap(itemBins[left], itemBins[right]);
+                    }
+                }
+                middle = left;
+            }
+        }
+
+        // few objects or all centroids in one bin
+        if (middle == task.Begin) {
+            middle = task.Begin + task.Bounds.Count / 2;
+            std::nth_element(items.begin() + task.Begin, items.begin() + middle, items.begin() + end, [axis](const BuildItem &a, const BuildItem &b) {
+                return a.Centroid[axis] < b.Centroid[axis];
+            });
+            leftBounds = rightBounds = {};
+            for (uint32_t i = task.Begin; i < middle; i++) {
+                leftBounds.Add(items[i]);
+            }
+            for (uint32_t i = middle; i < end; i++) {
+                rightBounds.Add(items[i]);
+            }
+        }
+
+        const uint32_t child0 = AllocateNode();
+        const uint32_t child1 = AllocateNode();
+        Node &parent = m_nodes[task.Node];
+        parent.Children[0] = child0;
+        parent.Children[1] = child1;
+        parent.Proxy = InvalidProxy;
+        m_nodes[child0].Parent = task.Node;
+        m_nodes[child1].Parent = task.Node;
+        tasks.push_back({child0, task.Begin, leftBounds});
+        tasks.push_back({child1, middle, rightBounds});
+    }
+}
+
+void SceneBvh::RefitTree() {
+    m_treeBoundsStale = false;
+    if (m_root == InvalidNode) {
+        return;
+    }
+
+    // pre-order, walked backwards every child is refit before its parent
+    std::vector<uint32_t> order;
+    order.reserve(m_nodes.size() - m_freeNodes.size());
+    m_stack.clear();
+    m_stack.push_back(m_root);
+    while (!m_stack.empty()) {
+        const uint32_t node = m_stack.back();
+        m_stack.pop_back();
+        order.push_back(node);
+        if (!m_nodes[node].IsLeaf()) {
+            m_stack.push_back(m_nodes[node].Children[0]);
+            m_stack.push_back(m_nodes[node].Children[1]);
+        }
+    }
+
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        Node &node = m_nodes[*it];
+        if (node.IsLeaf()) {
+            node.Min = m_proxies[node.Proxy].Min;
+            node.Max = m_proxies[node.Proxy].Max;
+        } else {
+            const Node &child0 = m_nodes[node.Children[0]];
+            const Node &child1 = m_nodes[node.Children[1]];
+            node.Min = glm::min(child0.Min, child1.Min);
+            node.Max = glm::max(child0.Max, child1.Max);
+        }
+    }
+}
+
+static void SetFlatLane(float *minX, float *minY, float *minZ, float *maxX, float *maxY, float *maxZ, int lane, const glm::vec3 &min, const glm::vec3 &max) {
+    minX[lane] = min.x;
+    minY[lane] = min.y;
+    minZ[lane] = min.z;
+    maxX[lane] = max.x;
+    maxY[lane] = max.y;
+    maxZ[lane] = max.z;
+}
+
+void SceneBvh::Flatten() {
+    m_flatNodes.clear();
+    if (m_root == InvalidNode) {
+        return;
+    }
+    m_flatNodes.reserve((m_nodes.size() - m_freeNodes.size()) / 2 + 1);
+
+    constexpr float nan = std::numeric_limits<float>::quiet_NaN();
+    const glm::vec3 nanBounds{nan};
+
+    // pairs of binary node and the flat node it becomes
+    std::vector<std::pair<uint32_t, uint32_t>> stack{{m_root, 0}};
+    m_flatNodes.emplace_back();
+    while (!stack.empty()) {
+        const auto [node, flatIndex] = stack.back();
+        stack.pop_back();
+
+        // pull grandchildren up by always opening the largest internal lane until there are 4
+        uint32_t lanes[4];
+        int numLanes = 0;
+        if (m_nodes[node].IsLeaf()) {
+            lanes[numLanes++] = node;
+        } else {
+            lanes[numLanes++] = m_nodes[node].Children[0];
+            lanes[numLanes++] = m_nodes[node].Children[1];
+        }
+        while (numLanes < 4) {
+            int largest = -1;
+            float largestArea = -1.0f;
+            for (int i = 0; i < numLanes; i++) {
+                const Node &lane = m_nodes[lanes[i]];
+                const float area = GetSurfaceArea(lane.Min, lane.Max);
+                if (!lane.IsLeaf() && area > largestArea) {
+                    largest = i;
+                    largestArea = area;
+                }
+            }
+            if (largest < 0) {
+                break;
+            }
+            const Node &opened = m_nodes[lanes[largest]];
+            lanes[largest] = opened.Children[0];
+            lanes[numLanes++] = opened.Children[1];
+        }
+
+        for (int i = 0; i < 4; i++) {
+            uint32_t child = EmptyChild;
+            glm::vec3 min = nanBounds;
+            glm::vec3 max = nanBounds;
+            if (i < numLanes) {
+                const Node &lane = m_nodes[lanes[i]];
+                min = lane.Min;
+                max = lane.Max;
+                if (lane.IsLeaf()) {
+                    child = LeafFlag | lane.Proxy;
+                } else {
+                    child = m_flatNodes.size();
+                    m_flatNodes.emplace_back();
+                    stack.emplace_back(lanes[i], child);
+                }
+            }
+            FlatNode &flat = m_flatNodes[flatIndex];
+            SetFlatLane(flat.MinX, flat.MinY, flat.MinZ, flat.MaxX, flat.MaxY, flat.MaxZ, i, min, max);
+            flat.Children[i] = child;
+        }
+    }
+}
+
+void SceneBvh::RefitFlatNodes() {
+    for (size_t i = m_flatNodes.size(); i-- > 0;) {
+        FlatNode &flat = m_flatNodes[i];
+        for (int lane = 0; lane < 4; lane++) {
+            const uint32_t child = flat.Children[lane];
+            if (child == EmptyChild) {
+                continue;
+            }
+            if (child & LeafFlag) {
+                const Proxy &proxy = m_proxies[child & ~LeafFlag];
+                SetFlatLane(flat.MinX, flat.MinY, flat.MinZ, flat.MaxX, flat.MaxY, flat.MaxZ, lane, proxy.Min, proxy.Max);
+                continue;
+            }
+
+            // children come after their parents, so they are already refit
+            const FlatNode &childNode = m_flatNodes[child];
+            glm::vec3 min{std::numeric_limits<float>::max()};
+            glm::vec3 max{-std::numeric_limits<float>::max()};
+            for (int j = 0; j < 4; j++) {
+                if (childNode.Children[j] != EmptyChild) {
+                    min = glm::min(min, glm::vec3{childNode.MinX[j], childNode.MinY[j], childNode.MinZ[j]});
+                    max = glm::max(max, glm::vec3{childNode.MaxX[j], childNode.MaxY[j], childNode.MaxZ[j]});
+                }
+            }
+            SetFlatLane(flat.MinX, flat.MinY, flat.MinZ, flat.MaxX, flat.MaxY, flat.MaxZ, lane, min, max);
+        }
+    }
+}
+
+void SceneBvh::Refit() {
+    // the binary tree is only refit when it is edited next
+    if (m_flatTopologyStale) {
+        if (m_treeBoundsStale) {
+            RefitTree();
+        }
+        Flatten();
+        m_flatTopologyStale = false;
+        m_flatBoundsStale = false;
+    } else if (m_flatBoundsStale) {
+        RefitFlatNodes();
+        m_flatBoundsStale = false;
+    }
+}
+
+// Node tests return a 4 bit mask of the lanes that pass. Unused lanes have NaN bounds and fail every comparison.
+
+SceneBvh::RayQuery SceneBvh::MakeRayQuery(const glm::vec3 &origin, const glm::vec3 &direction) {
+    // a huge finite slope instead of infinity keeps 0 * inf from turning into NaN
+    auto inverse = [](float d) {
+        return std::abs(d) > 1e-30f ? 1.0f / d : std::copysign(1e30f, d);
+    };
+    return {origin, {inverse(direction.x), inverse(direction.y), inverse(direction.z)}};
+}
+
+#ifdef SCENE_BVH_SSE
+
+// insideMask are the lanes that are also completely inside, their subtrees need no more tests
+uint32_t SceneBvh::TestFrustum(const FlatNode &node, const Frustum &frustum, uint32_t &insideMask) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 minX = _mm_load_ps(node.MinX);
+    const __m128 minY = _mm_load_ps(node.MinY);
+    const __m128 minZ = _mm_load_ps(node.MinZ);
+    const __m128 maxX = _mm_load_ps(node.MaxX);
+    const __m128 maxY = _mm_load_ps(node.MaxY);
+    const __m128 maxZ = _mm_load_ps(node.MaxZ);
+
+    __m128 visible = _mm_cmpeq_ps(zero, zero);
+    __m128 inside = visible;
+    for (const glm::vec4 &plane: frustum.Planes) {
+        const __m128 nx = _mm_set1_ps(plane.x);
+        const __m128 ny = _mm_set1_ps(plane.y);
+        const __m128 nz = _mm_set1_ps(plane.z);
+        const __m128 w = _mm_set1_ps(plane.w);
+        // the corners furthest along and against the plane normal
+        const __m128 positive = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(nx, plane.x >= 0.0f ? maxX : minX),
+                _mm_mul_ps(ny, plane.y >= 0.0f ? maxY : minY)
+        ), _mm_add_ps(_mm_mul_ps(nz, plane.z >= 0.0f ? maxZ : minZ), w));
+        const __m128 negative = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(nx, plane.x >= 0.0f ? minX : maxX),
+                _mm_mul_ps(ny, plane.y >= 0.0f ? minY : maxY)
+        ), _mm_add_ps(_mm_mul_ps(nz, plane.z >= 0.0f ? minZ : maxZ), w));
+        visible = _mm_and_ps(visible, _mm_cmpge_ps(positive, zero));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(negative, zero));
+    }
+
+    const auto mask = static_cast<uint32_t>(_mm_movemask_ps(visible));
+    insideMask = mask & static_cast<uint32_t>(_mm_movemask_ps(inside));
+    return mask;
+}
+
+uint32_t SceneBvh::TestAabb(const FlatNode &node, const glm::vec3 &min, const glm::vec3 &max) {
+    __m128 overlap = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.MinX), _mm_set1_ps(max.x)), _mm_cmpge_ps(_mm_load_ps(node.MaxX), _mm_set1_ps(min.x)));
+    overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.MinY), _mm_set1_ps(max.y)), _mm_cmpge_ps(_mm_load_ps(node.MaxY), _mm_set1_ps(min.y))));
+    overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.MinZ), _mm_set1_ps(max.z)), _mm_cmpge_ps(_mm_load_ps(node.MaxZ), _mm_set1_ps(min.z))));
+    return _mm_movemask_ps(overlap);
+}
+
+// slab test, entryDistances receives where the ray enters every lane
+uint32_t SceneBvh::TestRay(const FlatNode &node, const RayQuery &ray, float maxDistance, float *entryDistances) {
+    __m128 entry = _mm_setzero_ps();
+    __m128 exit = _mm_set1_ps(maxDistance);
+    __m128 valid = _mm_cmpeq_ps(entry, entry);
+    const float *mins[3] = {node.MinX, node.MinY, node.MinZ};
+    const float *maxs[3] = {node.MaxX, node.MaxY, node.MaxZ};
+    for (int axis = 0; axis < 3; axis++) {
+        const __m128 min = _mm_load_ps(mins[axis]);
+        const __m128 max = _mm_load_ps(maxs[axis]);
+        const __m128 origin = _mm_set1_ps(ray.Origin[axis]);
+        const __m128 inverseDirection = _mm_set1_ps(ray.InverseDirection[axis]);
+        const __m128 t0 = _mm_mul_ps(_mm_sub_ps(min, origin), inverseDirection);
+        const __m128 t1 = _mm_mul_ps(_mm_sub_ps(max, origin), inverseDirection);
+        entry = _mm_max_ps(entry, _mm_min_ps(t0, t1));
+        exit = _mm_min_ps(exit, _mm_max_ps(t0, t1));
+        valid = _mm_and_ps(valid, _mm_cmple_ps(min, max));
+    }
+    _mm_storeu_ps(entryDistances, entry);
+    return _mm_movemask_ps(_mm_and_ps(valid, _mm_cmple_ps(entry, exit)));
+}
+
+#else
+
+uint32_t SceneBvh::TestFrustum(const FlatNode &node, const Frustum &frustum, uint32_t &insideMask) {
+    uint32_t mask = 0;
+    insideMask = 0;
+    for (int lane = 0; lane < 4; lane++) {
+        bool visible = true;
+        bool inside = true;
+        for (const glm::vec4 &plane: frustum.Planes) {
+            const float positive = plane.x * (plane.x >= 0.0f ? node.MaxX[lane] : node.MinX[lane]) +
+                                   plane.y * (plane.y >= 0.0f ? node.MaxY[lane] : node.MinY[lane]) +
+                                   plane.z * (plane.z >= 0.0f ? node.MaxZ[lane] : node.MinZ[lane]) + plane.w;
+            const float negative = plane.x * (plane.x >= 0.0f ? node.MinX[lane] : node.MaxX[lane]) +
+                                   plane.y * (plane.y >= 0.0f ? node.MinY[lane] : node.MaxY[lane]) +
+                                   plane.z * (plane.z >= 0.0f ? node.MinZ[lane] : node.MaxZ[lane]) + plane.w;
+            visible = visible && positive >= 0.0f;
+            inside = inside && negative >= 0.0f;
+        }
+        mask |= visible ? 1u << lane : 0u;
+        insideMask |= visible && inside ? 1u << lane : 0u;
+    }
+    return mask;
+}
+
+uint32_t SceneBvh::TestAabb(const FlatNode &node, const glm::vec3 &min, const glm::vec3 &max) {
+    uint32_t mask = 0;
+    for (int lane = 0; lane < 4; lane++) {
+        const bool overlap = node.MinX[lane] <= max.x && node.MaxX[lane] >= min.x &&
+                             node.MinY[lane] <= max.y && node.MaxY[lane] >= min.y &&
+                             node.MinZ[lane] <= max.z && node.MaxZ[lane] >= min.z;
+        mask |= overlap ? 1u << lane : 0u;
+    }
+    return mask;
+}
+
+uint32_t SceneBvh::TestRay(const FlatNode &node, const RayQuery &ray, float maxDistance, float *entryDistances) {
+    const float *mins[3] = {node.MinX, node.MinY, node.MinZ};
+    const float *maxs[3] = {node.MaxX, node.MaxY, node.MaxZ};
+    uint32_t mask = 0;
+    for (int lane = 0; lane < 4; lane++) {
+        float entry = 0.0f;
+        float exit = maxDistance;
+        bool valid = true;
+        for (int axis = 0; axis < 3; axis++) {
+            const float t0 = (mins[axis][lane] - ray.Origin[axis]) * ray.InverseDirection[axis];
+            const float t1 = (maxs[axis][lane] - ray.Origin[axis]) * ray.InverseDirection[axis];
+            entry = std::max(entry, std::min(t0, t1));
+            exit = std::min(exit, std::max(t0, t1));
+            valid = valid && mins[axis][lane] <= maxs[axis][lane];
+        }
+        entryDistances[lane] = entry;
+        mask |= valid && entry <= exit ? 1u << lane : 0u;
+    }
+    return mask;
+}
+
+#endif
+
+// stack entries with this bit set are inside the frustum as a whole
+static constexpr uint32_t InsideFlag = 0x80000000u;
+
+uint32_t SceneBvh::QueryFrustum(const Frustum &frustum, uint32_t *results) {
+    Refit();
+    if (m_flatNodes.empty()) {
+        return 0;
+    }
+
+    uint32_t numResults = 0;
+    m_stack.clear();
+    m_stack.push_back(0);
+    while (!m_stack.empty()) {
+        const uint32_t entry = m_stack.back();
+        m_stack.pop_back();
+        const FlatNode &node = m_flatNodes[entry & ~InsideFlag];
+
+        uint32_t mask;
+        uint32_t insideMask;
+        if (entry & InsideFlag) {
+            mask = 0;
+            for (int lane = 0; lane < 4; lane++) {
+                mask |= node.Children[lane] != EmptyChild ? 1u << lane : 0u;
+            }
+            insideMask = mask;
+        } else {
+            mask = TestFrustum(node, frustum, insideMask);
+        }
+
+        for (int lane = 0; lane < 4; lane++) {
+            if (!(mask & (1u << lane))) {
+                continue;
+            }
+            const uint32_t child = node.Children[lane];
+            if (child & LeafFlag) {
+                results[numResults++] = m_proxies[child & ~LeafFlag].UserData;
+            } else {
+                m_stack.push_back(insideMask & (1u << lane) ? child | InsideFlag : child);
+            }
+        }
+    }
+    return numResults;
+}
+
+uint32_t SceneBvh::QueryAabb(const glm::vec3 &min, const glm::vec3 &max, uint32_t *results) {
+    Refit();
+    if (m_flatNodes.empty()) {
+        return 0;
+    }
+
+    uint32_t numResults = 0;
+    m_stack.clear();
+    m_stack.push_back(0);
+    while (!m_stack.empty()) {
+        const FlatNode &node = m_flatNodes[m_stack.back()];
+        m_stack.pop_back();
+
+        const uint32_t mask = TestAabb(node, min, max);
+        for (int lane = 0; lane < 4; lane++) {
+            if (!(mask & (1u << lane))) {
+                continue;
+            }
+            const uint32_t child = node.Children[lane];
+            if (child & LeafFlag) {
+                results[numResults++] = m_proxies[child & ~LeafFlag].UserData;
+            } else {
+                m_stack.push_back(child);
+            }
+        }
+    }
+    return numResults;
+}
+
+uint32_t SceneBvh::QueryRay(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, uint32_t *results) {
+    Refit();
+    if (m_flatNodes.empty()) {
+        return 0;
+    }
+
+    const RayQuery ray = MakeRayQuery(origin, direction);
+    uint32_t numResults = 0;
+    m_stack.clear();
+    m_stack.push_back(0);
+    while (!m_stack.empty()) {
+        const FlatNode &node = m_flatNodes[m_stack.back()];
+        m_stack.pop_back();
+
+        float entryDistances[4];
+        const uint32_t mask = TestRay(node, ray, maxDistance, entryDistances);
+        for (int lane = 0; lane < 4; lane++) {
+            if (!(mask & (1u << lane))) {
+                continue;
+            }
+            const uint32_t child = node.Children[lane];
+            if (child & LeafFlag) {
+                results[numResults++] = m_proxies[child & ~LeafFlag].UserData;
+            } else {
+                m_stack.push_back(child);
+            }
+        }
+    }
+    return numResults;
+}
+
+bool SceneBvh::RayCast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, uint32_t &userData, float &distance) {
+    Refit();
+    if (m_flatNodes.empty()) {
+        return false;
+    }
+
+    const RayQuery ray = MakeRayQuery(origin, direction);
+    bool hit = false;
+    float closest = maxDistance;
+    m_stack.clear();
+    m_stack.push_back(0);
+    while (!m_stack.empty()) {
+        const FlatNode &node = m_flatNodes[m_stack.back()];
+        m_stack.pop_back();
+
+        // nodes pushed earlier are tested again against the closest hit when they are popped
+        float entryDistances[4];
+        const uint32_t mask = TestRay(node, ray, closest, entryDistances);
+
+        std::pair<float, uint32_t> internalLanes[4];
+        int numInternalLanes = 0;
+        for (int lane = 0; lane < 4; lane++) {
+            if (!(mask & (1u << lane))) {
+                continue;
+            }
+            const uint32_t child = node.Children[lane];
+            if (child & LeafFlag) {
+                if (entryDistances[lane] <= closest) {
+                    hit = true;
+                    closest = entryDistances[lane];
+                    userData = m_proxies[child & ~LeafFlag].UserData;
+                }
+            } else {
+                internalLanes[numInternalLanes++] = {entryDistances[lane], child};
+            }
+        }
+
+        // farthest first, so the nearest child is pushed last and visited first
+        for (int i = 1; i < numInternalLanes; i++) {
+            for (int j = i; j > 0 && internalLanes[j - 1].first < internalLanes[j].first; j--) {
+                std::swap(internalLanes[j - 1], internalLanes[j]);
+            }
+        }
+        for (int i = 0; i < numInternalLanes; i++) {
+            m_stack.push_back(internalLanes[i].second);
+        }
+    }
+
+    if (hit) {
+        distance = closest;
+    }
+    return hit;
+}
@@ -0,0 +1,136 @@
+//
+// Created by andyroiiid on 1/1/2023.
+//
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "Frustum.h"
+
+// Bounding volume hierarchy over the axis aligned boxes of scene objects.
+// Edits go to a binary tree: Build does a binned surface area heuristic build, Insert and Remove change it incrementally
+// and Update only moves a box, node bounds are refit lazily before the next edit or query.
+// Queries run on a flattened 4 wide tree with its boxes stored as structure of arrays, one SIMD test covers all 4 children.
+// Queries may refit or flatten lazily, so they are not const and must not run concurrently with each other.
+class SceneBvh {
+public:
+    static constexpr uint32_t InvalidProxy = UINT32_MAX;
+
+    void Clear();
+
+    // userData is what the queries report for this object, the returned proxy is for Remove and Update
+    uint32_t Insert(const glm::vec3 &min, const glm::vec3 &max, uint32_t userData);
+
+    void Remove(uint32_t proxy);
+
+    void Update(uint32_t proxy, const glm::vec3 &min, const glm::vec3 &max);
+
+    // Rebuilds the whole tree, best after adding many objects at once or when the objects moved far since the last build.
+    void Build();
+
+    // Brings the query tree up to date with all edits, refitting after Update and flattening after Build, Insert or Remove.
+    // Queries do this when needed, calling it ahead of time keeps the cost out of the first query.
+    void Refit();
+
+    [[nodiscard]] uint32_t GetObjectCount() const { return m_proxies.size() - m_freeProxies.size(); }
+
+    // Queries write the userData of every hit object to results, which must have room for GetObjectCount() entries.
+    // They return the number of hits, in no particular order.
+
+    uint32_t QueryFrustum(const Frustum &frustum, uint32_t *results);
+
+    uint32_t QueryAabb(const glm::vec3 &min, const glm::vec3 &max, uint32_t *results);
+
+    // objects whose box the ray enters within maxDistance, direction does not need to be normalized
+    uint32_t QueryRay(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, uint32_t *results);
+
+    // Finds the object whose box the ray enters first, distance is in units of direction's length.
+    bool RayCast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, uint32_t &userData, float &distance);
+
+private:
+    static constexpr uint32_t InvalidNode = UINT32_MAX;
+
+    struct Proxy {
+        glm::vec3 Min;
+        glm::vec3 Max;
+        uint32_t UserData;
+        // InvalidNode for free proxies
+        uint32_t Leaf;
+    };
+
+    struct Node {
+        glm::vec3 Min;
+        glm::vec3 Max;
+        uint32_t Parent;
+        // both InvalidNode for leaves
+        uint32_t Children[2];
+        uint32_t Proxy;
+
+        [[nodiscard]] bool IsLeaf() const { return Children[0] == InvalidNode; }
+    };
+
+    // children are FlatNode indices, or a proxy with LeafFlag set, unused lanes are EmptyChild with NaN bounds
+    static constexpr uint32_t LeafFlag = 0x80000000u;
+    static constexpr uint32_t EmptyChild = UINT32_MAX;
+
+    struct alignas(16) FlatNode {
+        float MinX[4];
+        float MinY[4];
+        float MinZ[4];
+        float MaxX[4];
+        float MaxY[4];
+        float MaxZ[4];
+        uint32_t Children[4];
+    };
+
+    struct RayQuery {
+        glm::vec3 Origin;
+        glm::vec3 InverseDirection;
+    };
+
+    static RayQuery MakeRayQuery(const glm::vec3 &origin, const glm::vec3 &direction);
+
+    // 4 wide node tests, they return a mask of the lanes that pass
+    static uint32_t TestFrustum(const FlatNode &node, const Frustum &frustum, uint32_t &insideMask);
+
+    static uint32_t TestAabb(const FlatNode &node, const glm::vec3 &min, const glm::vec3 &max);
+
+    static uint32_t TestRay(const FlatNode &node, const RayQuery &ray, float maxDistance, float *entryDistances);
+
+    uint32_t AllocateNode();
+
+    void FreeNode(uint32_t node);
+
+    void InsertLeaf(uint32_t leaf);
+
+    void RemoveLeaf(uint32_t leaf);
+
+    void RefitAncestors(uint32_t node);
+
+    void RefitTree();
+
+    void RefitFlatNodes();
+
+    void Flatten();
+
+    std::vector<Proxy> m_proxies;
+    std::vector<uint32_t> m_freeProxies;
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_freeNodes;
+    uint32_t m_root = InvalidNode;
+
+    // parents always come before their children
+    std::vector<FlatNode> m_flatNodes;
+
+    // the binary node bounds do not match the proxies
+    bool m_treeBoundsStale = false;
+    // the flattened tree does not match the binary tree
+    bool m_flatTopologyStale = false;
+    // the flattened boxes do not match the proxies
+    bool m_flatBoundsStale = false;
+
+    std::vector<uint32_t> m_stack;
+};
@@ -0,0 +1,180 @@
+//
+// Created by andyroiiid on 1/3/2023.
+//
+
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <cstring>
+
+#define STB_RECT_PACK_IMPLEMENTATION
+
+#include "imgui/imstb_rectpack.h"
+
+#include "Debug.h"
+#include "ImageFile.h"
+#include "TextureMips.h"
+
+TextureAtlas::TextureAtlas(VulkanBase *device, uint32_t pageSize, uint32_t padding, const VulkanTextureOptions &options, ThreadPool *threadPool)
+        : m_device(device),
+          m_threadPool(threadPool),
+          m_pageSize(pageSize),
+          m_padding(padding),
+          m_options(options) {
+    DebugCheckCritical((padding & (padding - 1)) == 0, "Texture atlas padding {} is not a power of two.", padding);
+    m_alignment = std::max(padding, 1u);
+    DebugCheckCritical(pageSize % m_alignment == 0, "Texture atlas page size {} is not a multiple of the padding {}.", pageSize, padding);
+
+    // mip n still has padding >> n texels between images
+    while ((m_alignment >> m_mipLevels) > 0) {
+        m_mipLevels++;
+    }
+    m_mipLevels = std::min(m_mipLevels, VulkanImage::GetFullMipLevels({pageSize, pageSize}));
+    GetMipChainLayout(pageSize, pageSize, m_mips);
+    m_mips.resize(m_mipLevels);
+    // the mips are built on the CPU, the GPU would filter across the padding
+    m_options.GenerateMips = false;
+}
+
+void TextureAtlas::Release() {
+    m_device = nullptr;
+    m_threadPool = nullptr;
+    m_pageSize = 0;
+    m_padding = 0;
+    m_alignment = 1;
+    m_mipLevels = 1;
+    m_mips.clear();
+    m_options = {};
+    m_regions.clear();
+    m_pendingImages.clear();
+    m_pages.clear();
+}
+
+void TextureAtlas::Swap(TextureAtlas &other) noexcept {
+    std::swap(m_device, other.m_device);
+    std::swap(m_threadPool, other.m_threadPool);
+    std::swap(m_pageSize, other.m_pageSize);
+    std::swap(m_padding, other.m_padding);
+    std::swap(m_alignment, other.m_alignment);
+    std::swap(m_mipLevels, other.m_mipLevels);
+    std::swap(m_mips, other.m_mips);
+    std::swap(m_options, other.m_options);
+    std::swap(m_regions, other.m_regions);
+    std::swap(m_pendingImages, other.m_pendingImages);
+    // swapping keeps the pages where they are
+    std::swap(m_pages, other.m_pages);
+}
+
+uint32_t TextureAtlas::Add(const uint8_t *pixels, uint32_t width, uint32_t height) {
+    if (!DebugCheck(
+            width > 0 && height > 0 && width + m_padding * 2 <= m_pageSize && height + m_padding * 2 <= m_pageSize,
+            "Image of {}x{} does not fit into a texture atlas page of {}x{} with {} texels of padding.",
+            width, height, m_pageSize, m_pageSize, m_padding
+    )) {
+        return InvalidRegion;
+    }
+
+    const auto region = static_cast<uint32_t>(m_regions.size());
+    TextureAtlasRegion &atlasRegion = m_regions.emplace_back();
+    atlasRegion.Width = width;
+    atlasRegion.Height = height;
+
+    PendingImage &image = m_pendingImages.emplace_back();
+    image.Region = region;
+    image.Pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    return region;
+}
+
+uint32_t TextureAtlas::Add(const ImageFile &image) {
+    if (!DebugCheck(image.GetData() != nullptr, "Can't add an image that failed to load to a texture atlas.")) {
+        return InvalidRegion;
+    }
+    return Add(image.GetData(), image.GetWidth(), image.GetHeight());
+}
+
+void TextureAtlas::AddPage() {
+    const uint32_t numCells = m_pageSize / m_alignment;
+    Page &page = m_pages.emplace_back();
+    // one node per column never runs out of memory
+    page.Nodes.resize(numCells);
+    stbrp_init_target(&page.Packer, static_cast<int>(numCells), static_cast<int>(numCells), page.Nodes.data(), static_cast<int>(numCells));
+    page.Pixels.resize(m_mips.back().Offset + m_mips.back().Size);
+}
+
+void TextureAtlas::CopyToPage(uint32_t page, const PendingImage &image, uint32_t x, uint32_t y) {
+    TextureAtlasRegion &region = m_regions[image.Region];
+    const uint32_t width = region.Width;
+    const uint32_t height = region.Height;
+    Page &atlasPage = m_pages[page];
+
+    // the padded rectangle is rounded up to the grid, every texel of it repeats the closest one of the image
+    const uint32_t left = x * m_alignment;
+    const uint32_t top = y * m_alignment;
+    const uint32_t paddedWidth = (width + m_padding * 2 + m_alignment - 1) / m_alignment * m_alignment;
+    const uint32_t paddedHeight = (height + m_padding * 2 + m_alignment - 1) / m_alignment * m_alignment;
+    for (uint32_t row = 0; row < paddedHeight; row++) {
+        const uint32_t sourceRow = std::min(static_cast<uint32_t>(std::max(static_cast<int64_t>(row) - m_padding, int64_t(0))), height - 1);
+        const uint8_t *source = image.Pixels.data() + static_cast<size_t>(sourceRow) * width * 4;
+        uint8_t *destination = atlasPage.Pixels.data() + (static_cast<size_t>(top + row) * m_pageSize + left) * 4;
+        for (uint32_t column = 0; column < m_padding; column++) {
+            memcpy(destination + column * 4, source, 4);
+        }
+        memcpy(destination + m_padding * 4, source, static_cast<size_t>(width) * 4);
+        for (uint32_t column = m_padding + width; column < paddedWidth; column++) {
+            memcpy(destination + column * 4, source + (width - 1) * 4, 4);
+        }
+    }
+
+    const auto pageSize = static_cast<float>(m_pageSize);
+    region.Page = page;
+    region.UvScale = {static_cast<float>(width) / pageSize, static_cast<float>(height) / pageSize};
+    region.UvOffset = {static_cast<float>(left + m_padding) / pageSize, static_cast<float>(top + m_padding) / pageSize};
+    atlasPage.Dirty = true;
+}
+
+void TextureAtlas::UploadPage(Page &page) {
+    // only the levels that are uploaded are built, level 0 is at the start of the pixels and never overwritten
+    GenerateMips(page.Pixels.data(), m_mips.data(), m_mipLevels, MipFilter::Box, false, m_threadPool);
+    page.Texture = std::make_shared<VulkanTexture>(m_device, VK_FORMAT_R8G8B8A8_UNORM, m_mips.data(), m_mipLevels, page.Pixels.data(), m_options);
+    page.Dirty = false;
+}
+
+void TextureAtlas::Build() {
+    if (m_pendingImages.empty()) {
+        return;
+    }
+
+    std::vector<stbrp_rect> rects(m_pendingImages.size());
+    for (size_t i = 0; i < rects.size(); i++) {
+        const TextureAtlasRegion &region = m_regions[m_pendingImages[i].Region];
+        rects[i].id = static_cast<int>(i);
+        rects[i].w = static_cast<stbrp_coord>((region.Width + m_padding * 2 + m_alignment - 1) / m_alignment);
+        rects[i].h = static_cast<stbrp_coord>((region.Height + m_padding * 2 + m_alignment - 1) / m_alignment);
+    }
+
+    // the space left on existing pages is used before new pages are added, Add made sure every image fits into an empty one
+    for (uint32_t page = 0; !rects.empty(); page++) {
+        if (page == m_pages.size()) {
+            AddPage();
+        }
+        stbrp_pack_rects(&m_pages[page].Packer, rects.data(), static_cast<int>(rects.size()));
+
+        std::vector<stbrp_rect> unpackedRects;
+        for (const stbrp_rect &rect: rects) {
+            if (rect.was_packed) {
+                CopyToPage(page, m_pendingImages[rect.id], rect.x, rect.y);
+            } else {
+                unpackedRects.push_back(rect);
+            }
+        }
+        rects = std::move(unpackedRects);
+    }
+    m_pendingImages.clear();
+
+    for (Page &page: m_pages) {
+        if (page.Dirty) {
+            UploadPage(page);
+        }
+    }
+    DebugInfo("Texture atlas has {} regions on {} pages.", m_regions.size(), m_pages.size());
+}
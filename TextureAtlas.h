@@ -0,0 +1,124 @@
+//
+// Created by andyroiiid on 1/3/2023.
+//
+
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <glm/vec2.hpp>
+
+#include "imgui/imstb_rectpack.h"
+
+#include "VulkanBase.h"
+#include "TextureCache.h"
+
+class ImageFile;
+class ThreadPool;
+
+struct TextureAtlasRegion {
+    // UINT32_MAX until the atlas is built
+    uint32_t Page = UINT32_MAX;
+    // atlas uv = uv * UvScale + UvOffset, in sampling space where v = 0 is the top row of the page.
+    // Mesh texture coordinates point up, so they need the vertex shader's 1 - v before the transform.
+    glm::vec2 UvScale{0.0f};
+    glm::vec2 UvOffset{0.0f};
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+};
+
+// Packs many small RGBA8 images into a few square pages, so they can be sampled through one binding per page.
+// Every image is surrounded by padding texels repeating its edge and starts at a multiple of padding,
+// pages only get the mips in which every image still has a gutter of at least one texel, so filtering never bleeds.
+// Images added after a Build go into the space left on existing pages first and then into new pages,
+// regions that were already packed never move.
+class TextureAtlas {
+public:
+    static constexpr uint32_t InvalidRegion = UINT32_MAX;
+
+    TextureAtlas() = default;
+
+    // padding must be 0 or a power of two, pages get log2(padding) + 1 mips
+    TextureAtlas(VulkanBase *device, uint32_t pageSize = 2048, uint32_t padding = 4, const VulkanTextureOptions &options = {}, ThreadPool *threadPool = nullptr);
+
+    ~TextureAtlas() {
+        Release();
+    }
+
+    TextureAtlas(const TextureAtlas &) = delete;
+
+    TextureAtlas &operator=(const TextureAtlas &) = delete;
+
+    TextureAtlas(TextureAtlas &&other) noexcept {
+        Swap(other);
+    }
+
+    TextureAtlas &operator=(TextureAtlas &&other) noexcept {
+        if (this != &other) {
+            Release();
+            Swap(other);
+        }
+        return *this;
+    }
+
+    void Release();
+
+    void Swap(TextureAtlas &other) noexcept;
+
+    // The pixels are copied, the region is placed by the next Build.
+    // InvalidRegion when the image and its padding do not fit into a page.
+    uint32_t Add(const uint8_t *pixels, uint32_t width, uint32_t height);
+
+    uint32_t Add(const ImageFile &image);
+
+    // Packs the images added since the last Build and uploads every page that changed, waiting for the uploads.
+    // Changed pages get a new texture, the old one stays alive as long as a handle to it does.
+    void Build();
+
+    [[nodiscard]] const TextureAtlasRegion &GetRegion(uint32_t region) const { return m_regions[region]; }
+
+    [[nodiscard]] size_t GetRegionCount() const { return m_regions.size(); }
+
+    // nullptr until the page is built
+    [[nodiscard]] const TextureHandle &GetPage(uint32_t page) const { return m_pages[page].Texture; }
+
+    [[nodiscard]] size_t GetPageCount() const { return m_pages.size(); }
+
+private:
+    struct PendingImage {
+        uint32_t Region = 0;
+        std::vector<uint8_t> Pixels;
+    };
+
+    // the packer keeps pointers into itself and Nodes, so pages never move
+    struct Page {
+        stbrp_context Packer{};
+        std::vector<stbrp_node> Nodes;
+        // laid out like m_mips, the full size level comes first and is kept to build the mips again when images are added
+        std::vector<uint8_t> Pixels;
+        TextureHandle Texture;
+        bool Dirty = false;
+    };
+
+    void AddPage();
+
+    // x and y are in units of m_alignment
+    void CopyToPage(uint32_t page, const PendingImage &image, uint32_t x, uint32_t y);
+
+    void UploadPage(Page &page);
+
+    VulkanBase *m_device = nullptr;
+    ThreadPool *m_threadPool = nullptr;
+    uint32_t m_pageSize = 0;
+    uint32_t m_padding = 0;
+    // images are packed on a grid of this many texels, so box filtered mips never mix two of them
+    uint32_t m_alignment = 1;
+    uint32_t m_mipLevels = 1;
+    // the first m_mipLevels levels of a page's mip chain
+    std::vector<TextureMip> m_mips;
+    VulkanTextureOptions m_options;
+
+    std::vector<TextureAtlasRegion> m_regions;
+    std::vector<PendingImage> m_pendingImages;
+    std::deque<Page> m_pages;
+};
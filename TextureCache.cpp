@@ -0,0 +1,264 @@
+//
+// Created by andyroiiid on 1/3/2023.
+//
+
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+#include "Debug.h"
+#include "Files.h"
+#include "ImageFile.h"
+#include "TextureFile.h"
+#include "TextureMips.h"
+#include "ThreadPool.h"
+
+static bool HasTextureFileExtension(const std::string &filename) {
+    std::string extension = std::filesystem::path(filename).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    });
+    return extension == ".ktx2" || extension == ".dds";
+}
+
+bool LoadTextureStaging(VulkanBase *device, const std::string &filename, VulkanTextureStaging &staging, bool generateMips) {
+    if (HasTextureFileExtension(filename)) {
+        const TextureFile file(filename);
+        if (!file.IsValid()) {
+            return false;
+        }
+        if (!DebugCheck(VulkanTexture::IsFormatSupported(device, file.GetFormat()), "Texture format {} of {} is not supported by the device.", static_cast<int>(file.GetFormat()), filename)) {
+            return false;
+        }
+        staging = VulkanTexture::CreateStaging(device, file.GetFormat(), file.GetMips(), file.GetMipLevels(), file.GetData());
+        return true;
+    }
+
+    // decoded straight from the mapped file into the staging buffer, the CPU mips are built in place behind it
+    const MappedFile file(filename);
+    uint32_t width = 0, height = 0;
+    if (!DebugCheck(file.IsValid() && GetImageSize(file.GetData(), file.GetSize(), width, height), "Failed to load texture {}.", filename)) {
+        return false;
+    }
+    std::vector<TextureMip> mips;
+    if (generateMips) {
+        GetMipChainLayout(width, height, mips);
+    } else {
+        mips.push_back({0, static_cast<uint64_t>(width) * height * 4, width, height});
+    }
+    staging = VulkanTexture::AllocateStaging(device, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_VIEW_TYPE_2D, 1, 1, mips.data(), mips.size(), true);
+    auto *data = static_cast<uint8_t *>(staging.Buffer.GetMappedData());
+    if (!DebugCheck(DecodeImage(file.GetData(), file.GetSize(), data + staging.Mips[0].Offset, width, height), "Failed to decode texture {}.", filename)) {
+        staging = {};
+        return false;
+    }
+    if (generateMips) {
+        GenerateMips(data, staging.Mips.data(), staging.Mips.size(), MipFilter::Box, false);
+    }
+    staging.Buffer.Flush();
+    return true;
+}
+
+TextureCache::TextureCache(VulkanBase *device, ThreadPool *threadPool, VkDeviceSize budget)
+        : m_device(device),
+          m_threadPool(threadPool),
+          m_budget(budget) {
+}
+
+void TextureCache::Release() {
+    m_device = nullptr;
+    m_threadPool = nullptr;
+    m_budget = 0;
+
+    m_entries.clear();
+    m_entryMap.clear();
+    m_memorySize = 0;
+
+    m_frame = 0;
+    m_numHits = 0;
+    m_numMisses = 0;
+}
+
+void TextureCache::Swap(TextureCache &other) noexcept {
+    std::swap(m_device, other.m_device);
+    std::swap(m_threadPool, other.m_threadPool);
+    std::swap(m_budget, other.m_budget);
+    // list iterators stay valid and follow their elements into the other list
+    std::swap(m_entries, other.m_entries);
+    std::swap(m_entryMap, other.m_entryMap);
+    std::swap(m_memorySize, other.m_memorySize);
+    std::swap(m_frame, other.m_frame);
+    std::swap(m_numHits, other.m_numHits);
+    std::swap(m_numMisses, other.m_numMisses);
+}
+
+std::string TextureCache::GetKey(const std::string &filename, const VulkanTextureOptions &options) {
+    return NormalizeFilename(filename) +
+           '|' + std::to_string(static_cast<int>(options.Filter)) +
+           '|' + std::to_string(options.GenerateMips) +
+           '|' + std::to_string(options.MaxAnisotropy) +
+           '|' + std::to_string(static_cast<int>(options.AddressMode)) +
+           '|' + std::to_string(reinterpret_cast<uintptr_t>(options.Compressor)) +
+           '|' + std::to_string(static_cast<int>(options.CompressedFormat));
+}
+
+std::string TextureCache::NormalizeFilename(const std::string &filename) {
+    return std::filesystem::path(filename).lexically_normal().generic_string();
+}
+
+TextureHandle TextureCache::Hit(std::list<Entry>::iterator entry) {
+    m_numHits++;
+    entry->LastUsedFrame = m_frame;
+    m_entries.splice(m_entries.begin(), m_entries, entry);
+    return entry->Texture;
+}
+
+void TextureCache::Insert(const std::string &key, const TextureHandle &texture) {
+    Entry &entry = m_entries.emplace_front();
+    entry.Key = key;
+    entry.Texture = texture;
+    entry.MemorySize = texture->GetMemorySize();
+    entry.LastUsedFrame = m_frame;
+    m_entryMap.emplace(key, m_entries.begin());
+    m_memorySize += entry.MemorySize;
+}
+
+void TextureCache::Evict(std::list<Entry>::iterator entry) {
+    DebugVerbose("Evicting texture {}, {} bytes.", entry->Key, entry->MemorySize);
+    m_memorySize -= entry->MemorySize;
+    m_entryMap.erase(entry->Key);
+    m_entries.erase(entry);
+}
+
+TextureHandle TextureCache::Load(const std::string &filename, const VulkanTextureOptions &options) {
+    if (TextureHandle texture = Find(filename, options)) {
+        return texture;
+    }
+
+    m_numMisses++;
+    VulkanTextureStaging staging;
+    if (!LoadTextureStaging(m_device, NormalizeFilename(filename), staging)) {
+        return nullptr;
+    }
+    auto texture = std::make_shared<VulkanTexture>(m_device, VK_NULL_HANDLE, staging, options);
+    Insert(GetKey(filename, options), texture);
+    return texture;
+}
+
+std::vector<TextureHandle> TextureCache::LoadAll(const std::vector<std::string> &filenames, const VulkanTextureOptions &options) {
+    std::vector<TextureHandle> textures(filenames.size());
+
+    // files listed more than once share one decode, they are filled in after the uploads
+    std::vector<DecodedTexture> decodes;
+    std::unordered_map<std::string, size_t> decodeIndices;
+    std::vector<std::pair<size_t, size_t>> pendingTextures;
+    for (size_t i = 0; i < filenames.size(); i++) {
+        std::string key = GetKey(filenames[i], options);
+        if (auto pair = m_entryMap.find(key); pair != m_entryMap.end()) {
+            textures[i] = Hit(pair->second);
+            continue;
+        }
+
+        auto [pair, inserted] = decodeIndices.emplace(key, decodes.size());
+        if (inserted) {
+            m_numMisses++;
+            DecodedTexture &decoded = decodes.emplace_back();
+            decoded.Filename = NormalizeFilename(filenames[i]);
+            decoded.Key = std::move(key);
+        } else {
+            m_numHits++;
+        }
+        pendingTextures.emplace_back(i, pair->second);
+    }
+
+    auto decode = [this, &decodes](uint32_t i) {
+        decodes[i].Loaded = LoadTextureStaging(m_device, decodes[i].Filename, decodes[i].Staging);
+    };
+    if (m_threadPool) {
+        m_threadPool->ParallelFor(decodes.size(), decode);
+    } else {
+        for (uint32_t i = 0; i < decodes.size(); i++) {
+            decode(i);
+        }
+    }
+
+    std::vector<TextureHandle> uploadedTextures(decodes.size());
+    for (size_t i = 0; i < decodes.size(); i++) {
+        if (decodes[i].Loaded) {
+            uploadedTextures[i] = std::make_shared<VulkanTexture>(m_device, VK_NULL_HANDLE, decodes[i].Staging, options);
+            Insert(decodes[i].Key, uploadedTextures[i]);
+        }
+        // staging memory is freed as soon as it is uploaded
+        decodes[i].Staging = {};
+    }
+    for (const auto &[textureIndex, decodeIndex]: pendingTextures) {
+        textures[textureIndex] = uploadedTextures[decodeIndex];
+    }
+    return textures;
+}
+
+TextureHandle TextureCache::Find(const std::string &filename, const VulkanTextureOptions &options) {
+    if (auto pair = m_entryMap.find(GetKey(filename, options)); pair != m_entryMap.end()) {
+        return Hit(pair->second);
+    }
+    return nullptr;
+}
+
+void TextureCache::Add(const std::string &filename, const VulkanTextureOptions &options, const TextureHandle &texture) {
+    std::string key = GetKey(filename, options);
+    if (!DebugCheck(m_entryMap.find(key) == m_entryMap.end(), "Texture {} is already cached.", key)) {
+        return;
+    }
+    m_numMisses++;
+    Insert(key, texture);
+}
+
+bool TextureCache::IsOverBudget(VkDeviceSize usage, VkDeviceSize budget, VkDeviceSize evictedBytes) const {
+    if (m_budget && m_memorySize > m_budget) {
+        return true;
+    }
+    return usage > budget + evictedBytes;
+}
+
+void TextureCache::Update() {
+    m_frame++;
+
+    // textures held outside of the cache are in use, keep the list ordered by their last use
+    for (auto entry = m_entries.begin(); entry != m_entries.end();) {
+        const auto next = std::next(entry);
+        if (entry->Texture.use_count() > 1) {
+            entry->LastUsedFrame = m_frame;
+            m_entries.splice(m_entries.begin(), m_entries, entry);
+        }
+        entry = next;
+    }
+
+    // the last frame that may have sampled a texture has to finish before it is destroyed
+    const uint64_t numBuffering = m_device->GetNumBuffering();
+    // VMA's usage only drops once a whole block is freed, so it is sampled once and the evicted sizes are taken off it
+    VkDeviceSize usage, budget;
+    m_device->GetDeviceLocalMemoryBudget(usage, budget);
+    VkDeviceSize evictedBytes = 0;
+    auto entry = m_entries.end();
+    while (entry != m_entries.begin() && IsOverBudget(usage, budget, evictedBytes)) {
+        --entry;
+        if (entry->Texture.use_count() == 1 && m_frame - entry->LastUsedFrame > numBuffering) {
+            const auto next = std::next(entry);
+            evictedBytes += entry->MemorySize;
+            Evict(entry);
+            entry = next;
+        }
+    }
+}
+
+void TextureCache::Clear() {
+    for (auto entry = m_entries.begin(); entry != m_entries.end();) {
+        const auto next = std::next(entry);
+        if (entry->Texture.use_count() == 1) {
+            Evict(entry);
+        }
+        entry = next;
+    }
+}
@@ -0,0 +1,133 @@
+//
+// Created by andyroiiid on 1/3/2023.
+//
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "VulkanBase.h"
+#include "VulkanTexture.h"
+
+class ThreadPool;
+
+// textures stay alive as long as a handle to them does, even after the cache evicted them
+using TextureHandle = std::shared_ptr<VulkanTexture>;
+
+// Maps KTX2 and DDS files and copies their mips into staging memory, other images are decoded from the mapped file
+// straight into staging memory. With generateMips decoded images get a box filtered mip chain built on the CPU right behind
+// the decoded level in the same staging memory, instead of leaving it to the GPU.
+// Safe to call on any thread, false when the file can't be loaded or its format is not supported.
+bool LoadTextureStaging(VulkanBase *device, const std::string &filename, VulkanTextureStaging &staging, bool generateMips = false);
+
+// Shares one VulkanTexture between every load of the same file with the same options.
+// Paths are normalized before they are compared, files are loaded with LoadTextureStaging.
+// Textures nothing else holds on to are evicted least recently used first while the cache is over its budget,
+// but only after a full buffering cycle so frames in flight never lose a texture they sample.
+class TextureCache {
+public:
+    TextureCache() = default;
+
+    // a budget of 0 only evicts when the device local heaps are over the budget VMA reports
+    TextureCache(VulkanBase *device, ThreadPool *threadPool, VkDeviceSize budget = 0);
+
+    ~TextureCache() {
+        Release();
+    }
+
+    TextureCache(const TextureCache &) = delete;
+
+    TextureCache &operator=(const TextureCache &) = delete;
+
+    TextureCache(TextureCache &&other) noexcept {
+        Swap(other);
+    }
+
+    TextureCache &operator=(TextureCache &&other) noexcept {
+        if (this != &other) {
+            Release();
+            Swap(other);
+        }
+        return *this;
+    }
+
+    void Release();
+
+    void Swap(TextureCache &other) noexcept;
+
+    // nullptr when the file can't be loaded or its format is not supported, failures are not cached
+    TextureHandle Load(const std::string &filename, const VulkanTextureOptions &options = {});
+
+    // Same as calling Load for every file, but every file missing from the cache is decoded once on the thread pool,
+    // however many times it is listed. Uploads happen on the calling thread.
+    std::vector<TextureHandle> LoadAll(const std::vector<std::string> &filenames, const VulkanTextureOptions &options = {});
+
+    // the cached texture or nullptr, a found texture counts as a hit
+    TextureHandle Find(const std::string &filename, const VulkanTextureOptions &options = {});
+
+    // caches a texture loaded elsewhere, such as by TextureStreamer, and counts it as a miss
+    void Add(const std::string &filename, const VulkanTextureOptions &options, const TextureHandle &texture);
+
+    // the normalized path followed by every option that changes the texture
+    static std::string GetKey(const std::string &filename, const VulkanTextureOptions &options);
+
+    static std::string NormalizeFilename(const std::string &filename);
+
+    // call once per frame, evicts while over budget
+    void Update();
+
+    // evicts every texture nothing else holds on to, the device must be idle
+    void Clear();
+
+    [[nodiscard]] size_t GetTextureCount() const { return m_entries.size(); }
+
+    [[nodiscard]] VkDeviceSize GetMemorySize() const { return m_memorySize; }
+
+    [[nodiscard]] uint64_t GetHitCount() const { return m_numHits; }
+
+    [[nodiscard]] uint64_t GetMissCount() const { return m_numMisses; }
+
+private:
+    struct Entry {
+        std::string Key;
+        TextureHandle Texture;
+        VkDeviceSize MemorySize = 0;
+        // the last Update that saw a handle outside of the cache, or the frame of the last Load
+        uint64_t LastUsedFrame = 0;
+    };
+
+    // a decoded file waiting for its upload
+    struct DecodedTexture {
+        std::string Filename;
+        std::string Key;
+        bool Loaded = false;
+        VulkanTextureStaging Staging;
+    };
+
+    // moves the entry to the front and returns its texture
+    TextureHandle Hit(std::list<Entry>::iterator entry);
+
+    void Insert(const std::string &key, const TextureHandle &texture);
+
+    void Evict(std::list<Entry>::iterator entry);
+
+    // usage and budget are the device local memory sampled before evicting evictedBytes
+    [[nodiscard]] bool IsOverBudget(VkDeviceSize usage, VkDeviceSize budget, VkDeviceSize evictedBytes) const;
+
+    VulkanBase *m_device = nullptr;
+    ThreadPool *m_threadPool = nullptr;
+    VkDeviceSize m_budget = 0;
+
+    // most recently used first
+    std::list<Entry> m_entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_entryMap;
+    VkDeviceSize m_memorySize = 0;
+
+    uint64_t m_frame = 0;
+    uint64_t m_numHits = 0;
+    uint64_t m_numMisses = 0;
+};
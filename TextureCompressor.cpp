@@ -0,0 +1,599 @@
+//
+// Created by andyroiiid on 1/3/2023.
+//
+
+#include "TextureCompressor.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+#include "Debug.h"
+#include "ThreadPool.h"
+
+// SSE2 is part of every x86-64 target
+#if defined(_M_X64) || defined(__x86_64__)
+#define TEXTURE_COMPRESSOR_SSE
+
+#include <emmintrin.h>
+#endif
+
+// the texels of a block split by channel, so that 4 texels of one channel fit in an SSE register
+struct BlockTexels {
+    float Channels[4][16];
+};
+
+static void LoadBlockTexels(const uint8_t *texels, BlockTexels &block) {
+    for (int i = 0; i < 16; i++) {
+        for (int channel = 0; channel < 4; channel++) {
+            block.Channels[channel][i] = texels[i * 4 + channel];
+        }
+    }
+}
+
+#ifdef TEXTURE_COMPRESSOR_SSE
+// Picks the closest palette entry for every texel over the first numChannels channels, returns the summed squared distance.
+// Four texels are tested against one palette entry at a time.
+static float FindClosestIndices(const BlockTexels &texels, uint32_t numChannels, const float (*palette)[4], uint32_t numColors, uint8_t *indices) {
+    __m128 totalError = _mm_setzero_ps();
+    for (int i = 0; i < 16; i += 4) {
+        __m128 channels[4];
+        for (uint32_t channel = 0; channel < numChannels; channel++) {
+            channels[channel] = _mm_loadu_ps(texels.Channels[channel] + i);
+        }
+
+        __m128 bestError = _mm_set1_ps(FLT_MAX);
+        __m128i bestIndex = _mm_setzero_si128();
+        for (uint32_t color = 0; color < numColors; color++) {
+            __m128 error = _mm_setzero_ps();
+            for (uint32_t channel = 0; channel < numChannels; channel++) {
+                const __m128 difference = _mm_sub_ps(channels[channel], _mm_set1_ps(palette[color][channel]));
+                error = _mm_add_ps(error, _mm_mul_ps(difference, difference));
+            }
+            // ties keep the lower index
+            const __m128i better = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+            bestIndex = _mm_or_si128(_mm_and_si128(better, _mm_set1_epi32(static_cast<int>(color))), _mm_andnot_si128(better, bestIndex));
+            bestError = _mm_min_ps(error, bestError);
+        }
+
+        totalError = _mm_add_ps(totalError, bestError);
+        alignas(16) int32_t bestIndices[4];
+        _mm_store_si128(reinterpret_cast<__m128i *>(bestIndices), bestIndex);
+        for (int j = 0; j < 4; j++) {
+            indices[i + j] = static_cast<uint8_t>(bestIndices[j]);
+        }
+    }
+
+    alignas(16) float errors[4];
+    _mm_store_ps(errors, totalError);
+    return errors[0] + errors[1] + errors[2] + errors[3];
+}
+#else
+static float FindClosestIndices(const BlockTexels &texels, uint32_t numChannels, const float (*palette)[4], uint32_t numColors, uint8_t *indices) {
+    float totalError = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float bestError = FLT_MAX;
+        for (uint32_t color = 0; color < numColors; color++) {
+            float error = 0.0f;
+            for (uint32_t channel = 0; channel < numChannels; channel++) {
+                const float difference = texels.Channels[channel][i] - palette[color][channel];
+                error += difference * difference;
+            }
+            if (error < bestError) {
+                bestError = error;
+                indices[i] = color;
+            }
+        }
+        totalError += bestError;
+    }
+    return totalError;
+}
+#endif
+
+// Per channel minimum and maximum, inset by 1/16 of the range because the extremes are rarely hit exactly.
+// Channels that fall as the channel with the largest range rises get their endpoints swapped.
+static void GetBoundingBoxEndpoints(const BlockTexels &texels, uint32_t numChannels, float *endpoint0, float *endpoint1) {
+    float mean[4]{};
+    uint32_t widestChannel = 0;
+    float widestRange = -1.0f;
+    for (uint32_t channel = 0; channel < numChannels; channel++) {
+        const float *values = texels.Channels[channel];
+        const float minValue = *std::min_element(values, values + 16);
+        const float maxValue = *std::max_element(values, values + 16);
+        const float inset = (maxValue - minValue) / 16.0f;
+        endpoint0[channel] = minValue + inset;
+        endpoint1[channel] = maxValue - inset;
+        mean[channel] = std::accumulate(values, values + 16, 0.0f) / 16.0f;
+        if (maxValue - minValue > widestRange) {
+            widestRange = maxValue - minValue;
+            widestChannel = channel;
+        }
+    }
+
+    for (uint32_t channel = 0; channel < numChannels; channel++) {
+        float covariance = 0.0f;
+        for (int i = 0; i < 16; i++) {
+            covariance += (texels.Channels[channel][i] - mean[channel]) * (texels.Channels[widestChannel][i] - mean[widestChannel]);
+        }
+        if (covariance < 0.0f) {
+            std::swap(endpoint0[channel], endpoint1[channel]);
+        }
+    }
+}
+
+// The line through the mean along the principal axis found by power iteration, clipped to the span of the texels.
+static void GetPrincipalEndpoints(const BlockTexels &texels, uint32_t numChannels, float *endpoint0, float *endpoint1) {
+    float mean[4]{};
+    for (uint32_t channel = 0; channel < numChannels; channel++) {
+        mean[channel] = std::accumulate(texels.Channels[channel], texels.Channels[channel] + 16, 0.0f) / 16.0f;
+    }
+
+    float covariance[4][4]{};
+    for (int i = 0; i < 16; i++) {
+        for (uint32_t a = 0; a < numChannels; a++) {
+            for (uint32_t b = 0; b < numChannels; b++) {
+                covariance[a][b] += (texels.Channels[a][i] - mean[a]) * (texels.Channels[b][i] - mean[b]);
+            }
+        }
+    }
+
+    float axis[4]{1.0f, 1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4]{};
+        float length = 0.0f;
+        for (uint32_t a = 0; a < numChannels; a++) {
+            for (uint32_t b = 0; b < numChannels; b++) {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length = std::max(length, std::abs(next[a]));
+        }
+        if (length < 1e-6f) {
+            // flat block, both endpoints are the mean
+            std::copy(mean, mean + numChannels, endpoint0);
+            std::copy(mean, mean + numChannels, endpoint1);
+            return;
+        }
+        for (uint32_t a = 0; a < numChannels; a++) {
+            axis[a] = next[a] / length;
+        }
+    }
+
+    float minProjection = FLT_MAX;
+    float maxProjection = -FLT_MAX;
+    float axisLengthSquared = 0.0f;
+    for (uint32_t channel = 0; channel < numChannels; channel++) {
+        axisLengthSquared += axis[channel] * axis[channel];
+    }
+    for (int i = 0; i < 16; i++) {
+        float projection = 0.0f;
+        for (uint32_t channel = 0; channel < numChannels; channel++) {
+            projection += (texels.Channels[channel][i] - mean[channel]) * axis[channel];
+        }
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+    for (uint32_t channel = 0; channel < numChannels; channel++) {
+        endpoint0[channel] = mean[channel] + axis[channel] * minProjection / axisLengthSquared;
+        endpoint1[channel] = mean[channel] + axis[channel] * maxProjection / axisLengthSquared;
+    }
+}
+
+// Least squares endpoints for fixed indices, weights[index] is the fraction of endpoint 1 in that palette entry.
+// Returns false when every texel uses the same weight, which leaves the system singular.
+static bool FitEndpoints(const BlockTexels &texels, uint32_t numChannels, const uint8_t *indices, const float *weights, float *endpoint0, float *endpoint1) {
+    float a = 0.0f, b = 0.0f, c = 0.0f;
+    float rhs0[4]{};
+    float rhs1[4]{};
+    for (int i = 0; i < 16; i++) {
+        const float t = weights[indices[i]];
+        a += (1.0f - t) * (1.0f - t);
+        b += (1.0f - t) * t;
+        c += t * t;
+        for (uint32_t channel = 0; channel < numChannels; channel++) {
+            rhs0[channel] += (1.0f - t) * texels.Channels[channel][i];
+            rhs1[channel] += t * texels.Channels[channel][i];
+        }
+    }
+
+    const float determinant = a * c - b * b;
+    if (std::abs(determinant) < 1e-6f) {
+        return false;
+    }
+    for (uint32_t channel = 0; channel < numChannels; channel++) {
+        endpoint0[channel] = std::clamp((c * rhs0[channel] - b * rhs1[channel]) / determinant, 0.0f, 255.0f);
+        endpoint1[channel] = std::clamp((a * rhs1[channel] - b * rhs0[channel]) / determinant, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+static void GetInitialEndpoints(const BlockTexels &texels, uint32_t numChannels, TextureQuality quality, float *endpoint0, float *endpoint1) {
+    if (quality == TextureQuality::Fast) {
+        GetBoundingBoxEndpoints(texels, numChannels, endpoint0, endpoint1);
+    } else {
+        GetPrincipalEndpoints(texels, numChannels, endpoint0, endpoint1);
+    }
+}
+
+static int GetRefinements(TextureQuality quality) {
+    switch (quality) {
+        case TextureQuality::Fast:
+            return 0;
+        case TextureQuality::Normal:
+            return 1;
+        case TextureQuality::High:
+            return 4;
+    }
+    return 0;
+}
+
+static uint32_t QuantizeChannel(float value, uint32_t maxValue) {
+    return static_cast<uint32_t>(std::clamp(value, 0.0f, 255.0f) * static_cast<float>(maxValue) / 255.0f + 0.5f);
+}
+
+static uint16_t QuantizeRgb565(const float *color) {
+    return QuantizeChannel(color[0], 31) << 11 | QuantizeChannel(color[1], 63) << 5 | QuantizeChannel(color[2], 31);
+}
+
+static void ExpandRgb565(uint16_t color, float *expanded) {
+    const uint32_t r = color >> 11 & 31;
+    const uint32_t g = color >> 5 & 63;
+    const uint32_t b = color & 31;
+    expanded[0] = static_cast<float>(r << 3 | r >> 2);
+    expanded[1] = static_cast<float>(g << 2 | g >> 4);
+    expanded[2] = static_cast<float>(b << 3 | b >> 2);
+    expanded[3] = 0.0f;
+}
+
+float EncodeBc1Block(const uint8_t *texels, uint8_t *block, TextureQuality quality) {
+    BlockTexels blockTexels;
+    LoadBlockTexels(texels, blockTexels);
+
+    // color0 > color1 selects the 4 color mode, the palette is color0, color1, 2/3 color0 + 1/3 color1, 1/3 color0 + 2/3 color1
+    static constexpr float weights[4]{0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+    float endpoint0[4], endpoint1[4];
+    GetInitialEndpoints(blockTexels, 3, quality, endpoint0, endpoint1);
+
+    float bestError = FLT_MAX;
+    uint16_t bestColors[2]{};
+    uint8_t bestIndices[16]{};
+    const int refinements = GetRefinements(quality);
+    for (int refinement = 0; refinement <= refinements; refinement++) {
+        uint16_t colors[2]{QuantizeRgb565(endpoint0), QuantizeRgb565(endpoint1)};
+        if (colors[0] < colors[1]) {
+            std::swap(colors[0], colors[1]);
+        }
+
+        float palette[4][4];
+        ExpandRgb565(colors[0], palette[0]);
+        ExpandRgb565(colors[1], palette[1]);
+        for (int i = 2; i < 4; i++) {
+            for (int channel = 0; channel < 3; channel++) {
+                palette[i][channel] = palette[0][channel] + (palette[1][channel] - palette[0][channel]) * weights[i];
+            }
+        }
+
+        // equal colors fall back to the 3 color mode, where index 0 is still color0
+        uint8_t indices[16];
+        const float error = colors[0] == colors[1] ? FindClosestIndices(blockTexels, 3, palette, 1, indices) : FindClosestIndices(blockTexels, 3, palette, 4, indices);
+        if (error < bestError) {
+            bestError = error;
+            std::copy(colors, colors + 2, bestColors);
+            std::copy(indices, indices + 16, bestIndices);
+        }
+
+        if (refinement < refinements && !FitEndpoints(blockTexels, 3, indices, weights, endpoint0, endpoint1)) {
+            break;
+        }
+    }
+
+    uint32_t packedIndices = 0;
+    for (int i = 0; i < 16; i++) {
+        packedIndices |= static_cast<uint32_t>(bestIndices[i]) << (i * 2);
+    }
+    memcpy(block, bestColors, sizeof(bestColors));
+    memcpy(block + 4, &packedIndices, sizeof(packedIndices));
+    return bestError;
+}
+
+// palette of the 8 value mode, which red0 > red1 selects
+static void GetBc4Palette8(uint32_t red0, uint32_t red1, float (*palette)[4]) {
+    palette[0][0] = static_cast<float>(red0);
+    palette[1][0] = static_cast<float>(red1);
+    for (uint32_t i = 2; i < 8; i++) {
+        palette[i][0] = static_cast<float>(((8 - i) * red0 + (i - 1) * red1) / 7);
+    }
+}
+
+// palette of the 6 value mode with explicit 0 and 255, which red0 <= red1 selects
+static void GetBc4Palette6(uint32_t red0, uint32_t red1, float (*palette)[4]) {
+    palette[0][0] = static_cast<float>(red0);
+    palette[1][0] = static_cast<float>(red1);
+    for (uint32_t i = 2; i < 6; i++) {
+        palette[i][0] = static_cast<float>(((6 - i) * red0 + (i - 1) * red1) / 5);
+    }
+    palette[6][0] = 0.0f;
+    palette[7][0] = 255.0f;
+}
+
+static void PackBc4Block(uint32_t red0, uint32_t red1, const uint8_t *indices, uint8_t *block) {
+    uint64_t packedIndices = 0;
+    for (int i = 0; i < 16; i++) {
+        packedIndices |= static_cast<uint64_t>(indices[i]) << (i * 3);
+    }
+    block[0] = red0;
+    block[1] = red1;
+    for (int i = 0; i < 6; i++) {
+        block[2 + i] = packedIndices >> (i * 8) & 0xFF;
+    }
+}
+
+float EncodeBc4Block(const uint8_t *texels, uint32_t channel, uint8_t *block, TextureQuality quality) {
+    BlockTexels blockTexels;
+    for (int i = 0; i < 16; i++) {
+        blockTexels.Channels[0][i] = texels[i * 4 + channel];
+    }
+
+    static constexpr float weights[8]{0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f};
+
+    float endpoint0[4], endpoint1[4];
+    endpoint0[0] = *std::max_element(blockTexels.Channels[0], blockTexels.Channels[0] + 16);
+    endpoint1[0] = *std::min_element(blockTexels.Channels[0], blockTexels.Channels[0] + 16);
+
+    float bestError = FLT_MAX;
+    uint32_t bestReds[2]{};
+    uint8_t bestIndices[16]{};
+    const int refinements = GetRefinements(quality);
+    for (int refinement = 0; refinement <= refinements; refinement++) {
+        uint32_t reds[2]{QuantizeChannel(endpoint0[0], 255), QuantizeChannel(endpoint1[0], 255)};
+        if (reds[0] < reds[1]) {
+            std::swap(reds[0], reds[1]);
+        }
+
+        // equal values fall back to the 6 value mode, where index 0 is still red0
+        float palette[8][4];
+        GetBc4Palette8(reds[0], reds[1], palette);
+        uint8_t indices[16];
+        const float error = FindClosestIndices(blockTexels, 1, palette, reds[0] == reds[1] ? 1 : 8, indices);
+        if (error < bestError) {
+            bestError = error;
+            std::copy(reds, reds + 2, bestReds);
+            std::copy(indices, indices + 16, bestIndices);
+        }
+
+        if (refinement < refinements && !FitEndpoints(blockTexels, 1, indices, weights, endpoint0, endpoint1)) {
+            break;
+        }
+    }
+
+    // the 6 value mode spends its interpolated values on the texels between the extremes
+    if (quality == TextureQuality::High) {
+        uint32_t reds[2]{255, 0};
+        for (float value: blockTexels.Channels[0]) {
+            if (value > 0.0f && value < 255.0f) {
+                reds[0] = std::min(reds[0], static_cast<uint32_t>(value));
+                reds[1] = std::max(reds[1], static_cast<uint32_t>(value));
+            }
+        }
+        if (reds[0] > reds[1]) {
+            reds[0] = reds[1] = 0;
+        }
+
+        float palette[8][4];
+        GetBc4Palette6(reds[0], reds[1], palette);
+        uint8_t indices[16];
+        const float error = FindClosestIndices(blockTexels, 1, palette, 8, indices);
+        if (error < bestError) {
+            bestError = error;
+            std::copy(reds, reds + 2, bestReds);
+            std::copy(indices, indices + 16, bestIndices);
+        }
+    }
+
+    PackBc4Block(bestReds[0], bestReds[1], bestIndices, block);
+    return bestError;
+}
+
+float EncodeBc5Block(const uint8_t *texels, uint8_t *block, TextureQuality quality) {
+    return EncodeBc4Block(texels, 0, block, quality) + EncodeBc4Block(texels, 1, block + 8, quality);
+}
+
+// writes fields from the least significant bit of the block up
+class BlockBitWriter {
+public:
+    explicit BlockBitWriter(uint8_t *bytes) : m_bytes(bytes) {}
+
+    void Write(uint32_t value, uint32_t numBits) {
+        for (uint32_t i = 0; i < numBits; i++, m_position++) {
+            m_bytes[m_position / 8] |= (value >> i & 1) << (m_position % 8);
+        }
+    }
+
+private:
+    uint8_t *m_bytes;
+    uint32_t m_position = 0;
+};
+
+static constexpr uint32_t Bc7Weights4[16]{0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// 7 bit endpoint channels sharing one p-bit as their lowest bit
+struct Bc7Endpoint {
+    uint32_t Channels[4];
+    uint32_t PBit;
+
+    [[nodiscard]] uint32_t GetValue(uint32_t channel) const { return Channels[channel] << 1 | PBit; }
+};
+
+static Bc7Endpoint QuantizeBc7Endpoint(const float *endpoint, uint32_t pBit) {
+    Bc7Endpoint quantized{{}, pBit};
+    for (int channel = 0; channel < 4; channel++) {
+        const float value = (std::clamp(endpoint[channel], 0.0f, 255.0f) - static_cast<float>(pBit)) * 0.5f;
+        quantized.Channels[channel] = std::min(static_cast<uint32_t>(std::max(value + 0.5f, 0.0f)), 127u);
+    }
+    return quantized;
+}
+
+static float GetBc7QuantizationError(const float *endpoint, const Bc7Endpoint &quantized) {
+    float error = 0.0f;
+    for (uint32_t channel = 0; channel < 4; channel++) {
+        const float difference = endpoint[channel] - static_cast<float>(quantized.GetValue(channel));
+        error += difference * difference;
+    }
+    return error;
+}
+
+// the p-bit whose rounding lands closer to the unquantized endpoint
+static Bc7Endpoint QuantizeBc7EndpointBestPBit(const float *endpoint) {
+    const Bc7Endpoint even = QuantizeBc7Endpoint(endpoint, 0);
+    const Bc7Endpoint odd = QuantizeBc7Endpoint(endpoint, 1);
+    return GetBc7QuantizationError(endpoint, even) <= GetBc7QuantizationError(endpoint, odd) ? even : odd;
+}
+
+float EncodeBc7Block(const uint8_t *texels, uint8_t *block, TextureQuality quality) {
+    BlockTexels blockTexels;
+    LoadBlockTexels(texels, blockTexels);
+
+    float weights[16];
+    for (int i = 0; i < 16; i++) {
+        weights[i] = static_cast<float>(Bc7Weights4[i]) / 64.0f;
+    }
+
+    float endpoint0[4], endpoint1[4];
+    GetInitialEndpoints(blockTexels, 4, quality, endpoint0, endpoint1);
+
+    float bestError = FLT_MAX;
+    Bc7Endpoint bestEndpoints[2]{};
+    uint8_t bestIndices[16]{};
+    const int refinements = std::min(GetRefinements(quality), 2);
+    for (int refinement = 0; refinement <= refinements; refinement++) {
+        uint8_t refinementIndices[16];
+        float refinementError = FLT_MAX;
+        const uint32_t numCandidates = quality == TextureQuality::High ? 4 : 1;
+        for (uint32_t candidate = 0; candidate < numCandidates; candidate++) {
+            Bc7Endpoint endpoints[2];
+            if (quality == TextureQuality::High) {
+                endpoints[0] = QuantizeBc7Endpoint(endpoint0, candidate & 1);
+                endpoints[1] = QuantizeBc7Endpoint(endpoint1, candidate >> 1);
+            } else {
+                endpoints[0] = QuantizeBc7EndpointBestPBit(endpoint0);
+                endpoints[1] = QuantizeBc7EndpointBestPBit(endpoint1);
+            }
+
+            float palette[16][4];
+            for (int i = 0; i < 16; i++) {
+                for (uint32_t channel = 0; channel < 4; channel++) {
+                    const uint32_t value = ((64 - Bc7Weights4[i]) * endpoints[0].GetValue(channel) + Bc7Weights4[i] * endpoints[1].GetValue(channel) + 32) >> 6;
+                    palette[i][channel] = static_cast<float>(value);
+                }
+            }
+
+            uint8_t indices[16];
+            const float error = FindClosestIndices(blockTexels, 4, palette, 16, indices);
+            if (error < refinementError) {
+                refinementError = error;
+                std::copy(indices, indices + 16, refinementIndices);
+            }
+            if (error < bestError) {
+                bestError = error;
+                std::copy(endpoints, endpoints + 2, bestEndpoints);
+                std::copy(indices, indices + 16, bestIndices);
+            }
+        }
+
+        if (refinement < refinements && !FitEndpoints(blockTexels, 4, refinementIndices, weights, endpoint0, endpoint1)) {
+            break;
+        }
+    }
+
+    // the first index is stored without its top bit, so it must be below 8
+    if (bestIndices[0] >= 8) {
+        std::swap(bestEndpoints[0], bestEndpoints[1]);
+        for (uint8_t &index: bestIndices) {
+            index = 15 - index;
+        }
+    }
+
+    memset(block, 0, 16);
+    BlockBitWriter writer(block);
+    writer.Write(1 << 6, 7);
+    for (uint32_t channel = 0; channel < 4; channel++) {
+        writer.Write(bestEndpoints[0].Channels[channel], 7);
+        writer.Write(bestEndpoints[1].Channels[channel], 7);
+    }
+    writer.Write(bestEndpoints[0].PBit, 1);
+    writer.Write(bestEndpoints[1].PBit, 1);
+    writer.Write(bestIndices[0], 3);
+    for (int i = 1; i < 16; i++) {
+        writer.Write(bestIndices[i], 4);
+    }
+    return bestError;
+}
+
+static float EncodeBc4RedBlock(const uint8_t *texels, uint8_t *block, TextureQuality quality) {
+    return EncodeBc4Block(texels, 0, block, quality);
+}
+
+struct CompressorFormat {
+    VkFormat Format;
+    uint32_t BlockSize;
+    float (*Encode)(const uint8_t *texels, uint8_t *block, TextureQuality quality);
+};
+
+static constexpr CompressorFormat CompressorFormats[]{
+        {VK_FORMAT_BC1_RGB_UNORM_BLOCK, 8,  EncodeBc1Block},
+        {VK_FORMAT_BC1_RGB_SRGB_BLOCK,  8,  EncodeBc1Block},
+        {VK_FORMAT_BC4_UNORM_BLOCK,     8,  EncodeBc4RedBlock},
+        {VK_FORMAT_BC5_UNORM_BLOCK,     16, EncodeBc5Block},
+        {VK_FORMAT_BC7_UNORM_BLOCK,     16, EncodeBc7Block},
+        {VK_FORMAT_BC7_SRGB_BLOCK,      16, EncodeBc7Block},
+};
+
+static const CompressorFormat *FindCompressorFormat(VkFormat format) {
+    for (const CompressorFormat &compressorFormat: CompressorFormats) {
+        if (compressorFormat.Format == format) {
+            return &compressorFormat;
+        }
+    }
+    return nullptr;
+}
+
+bool IsCompressorFormat(VkFormat format) {
+    return FindCompressorFormat(format) != nullptr;
+}
+
+double CompressTexture(VkFormat format, const uint8_t *pixels, uint32_t width, uint32_t height, uint8_t *blocks, TextureQuality quality, ThreadPool *threadPool) {
+    const CompressorFormat *compressorFormat = FindCompressorFormat(format);
+    DebugCheckCritical(compressorFormat != nullptr, "Texture format {} can't be compressed.", static_cast<int>(format));
+
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+    std::vector<double> rowErrors(blocksY);
+    auto compressRow = [&](uint32_t blockY) {
+        uint8_t texels[64];
+        double error = 0.0;
+        for (uint32_t blockX = 0; blockX < blocksX; blockX++) {
+            for (uint32_t y = 0; y < 4; y++) {
+                const uint32_t pixelY = std::min(blockY * 4 + y, height - 1);
+                for (uint32_t x = 0; x < 4; x++) {
+                    const uint32_t pixelX = std::min(blockX * 4 + x, width - 1);
+                    memcpy(texels + (y * 4 + x) * 4, pixels + (static_cast<size_t>(pixelY) * width + pixelX) * 4, 4);
+                }
+            }
+            uint8_t *block = blocks + (static_cast<size_t>(blockY) * blocksX + blockX) * compressorFormat->BlockSize;
+            error += compressorFormat->Encode(texels, block, quality);
+        }
+        rowErrors[blockY] = error;
+    };
+
+    if (threadPool) {
+        threadPool->ParallelFor(blocksY, compressRow);
+    } else {
+        for (uint32_t blockY = 0; blockY < blocksY; blockY++) {
+            compressRow(blockY);
+        }
+    }
+    return std::accumulate(rowErrors.begin(), rowErrors.end(), 0.0);
+}
@@ -0,0 +1,41 @@
+//
+// Created by andyroiiid on 1/3/2023.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+class ThreadPool;
+
+enum class TextureQuality {
+    // bounding box endpoints without refinement
+    Fast,
+    // principal axis endpoints refined once by least squares
+    Normal,
+    // more refinement rounds, also tries the 6 value BC4 mode and every BC7 p-bit combination
+    High
+};
+
+// Block encoders take 16 RGBA8 texels of a 4x4 block in row major order
+// and return the squared error of the encoded block over the channels it stores.
+
+// BC1 without alpha, 8 bytes
+float EncodeBc1Block(const uint8_t *texels, uint8_t *block, TextureQuality quality);
+
+// one channel of the texels, 8 bytes
+float EncodeBc4Block(const uint8_t *texels, uint32_t channel, uint8_t *block, TextureQuality quality);
+
+// red and green as two BC4 blocks, 16 bytes
+float EncodeBc5Block(const uint8_t *texels, uint8_t *block, TextureQuality quality);
+
+// mode 6 only, one RGBA endpoint pair with 4 bit indices, 16 bytes
+float EncodeBc7Block(const uint8_t *texels, uint8_t *block, TextureQuality quality);
+
+// BC1 RGB, BC4 and BC5 UNORM, BC7 UNORM and SRGB
+bool IsCompressorFormat(VkFormat format);
+
+// Encodes an RGBA8 image into row major blocks, blocks on the right and bottom edge repeat the last column and row.
+// Rows of blocks are spread over the thread pool when given, returns the summed squared error of every block.
+double CompressTexture(VkFormat format, const uint8_t *pixels, uint32_t width, uint32_t height, uint8_t *blocks, TextureQuality quality, ThreadPool *threadPool = nullptr);
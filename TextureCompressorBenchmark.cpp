@@ -0,0 +1,105 @@
+//
+// Created by andyroiiid on 1/3/2023.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "Debug.h"
+#include "ImageFile.h"
+#include "TextureCompressor.h"
+#include "TextureFile.h"
+#include "ThreadPool.h"
+
+// Compresses an image into every format at every quality single threaded and on a thread pool and prints blocks per second.
+// Without an image argument a 1024x1024 mix of gradients, hard edges and noise is used.
+int main(int argc, char *argv[]) {
+    constexpr int numRepeats = 3;
+
+    uint32_t width = 1024;
+    uint32_t height = 1024;
+    std::vector<uint8_t> pixels;
+    if (argc > 1) {
+        const ImageFile image(argv[1]);
+        if (!DebugCheck(image.GetData() != nullptr, "Failed to load {}.", argv[1])) {
+            return 1;
+        }
+        width = image.GetWidth();
+        height = image.GetHeight();
+        pixels.assign(image.GetData(), image.GetData() + static_cast<size_t>(width) * height * 4);
+    } else {
+        std::mt19937 random(42); // NOLINT(cert-msc51-cpp)
+        std::uniform_int_distribution<int> noise(-12, 12);
+        pixels.resize(static_cast<size_t>(width) * height * 4);
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                uint8_t *pixel = &pixels[(static_cast<size_t>(y) * width + x) * 4];
+                const bool checker = (x / 64 + y / 64) % 2;
+                const float wave = std::sin(static_cast<float>(x) * 0.02f) * std::cos(static_cast<float>(y) * 0.03f);
+                const int base[4]{
+                        static_cast<int>(x * 255 / width),
+                        static_cast<int>(128.0f + wave * 100.0f),
+                        checker ? 200 : 40,
+                        static_cast<int>(y * 255 / height)
+                };
+                for (int channel = 0; channel < 4; channel++) {
+                    pixel[channel] = std::clamp(base[channel] + noise(random), 0, 255);
+                }
+            }
+        }
+    }
+
+    struct BenchmarkFormat {
+        const char *Name;
+        VkFormat Format;
+        uint32_t NumChannels;
+    };
+    constexpr BenchmarkFormat formats[]{
+            {"BC1", VK_FORMAT_BC1_RGB_UNORM_BLOCK, 3},
+            {"BC4", VK_FORMAT_BC4_UNORM_BLOCK,     1},
+            {"BC5", VK_FORMAT_BC5_UNORM_BLOCK,     2},
+            {"BC7", VK_FORMAT_BC7_UNORM_BLOCK,     4},
+    };
+    constexpr std::pair<const char *, TextureQuality> qualities[]{
+            {"fast",   TextureQuality::Fast},
+            {"normal", TextureQuality::Normal},
+            {"high",   TextureQuality::High},
+    };
+
+    const uint64_t numBlocks = static_cast<uint64_t>((width + 3) / 4) * ((height + 3) / 4);
+    DebugInfo("{}x{}, {} blocks", width, height, numBlocks);
+
+    ThreadPool threadPool;
+    for (const BenchmarkFormat &format: formats) {
+        TextureFormatInfo info;
+        GetTextureFormatInfo(format.Format, info);
+        std::vector<uint8_t> blocks(GetTextureMipSize(info, width, height));
+
+        for (const auto &[qualityName, quality]: qualities) {
+            for (ThreadPool *pool: {static_cast<ThreadPool *>(nullptr), &threadPool}) {
+                // keep the fastest run to filter out scheduling noise
+                double bestSeconds = std::numeric_limits<double>::max();
+                double error = 0.0;
+                for (int i = 0; i < numRepeats; i++) {
+                    const auto start = std::chrono::high_resolution_clock::now();
+                    error = CompressTexture(format.Format, pixels.data(), width, height, blocks.data(), quality, pool);
+                    const auto end = std::chrono::high_resolution_clock::now();
+                    bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(end - start).count());
+                }
+
+                const double psnr = 10.0 * std::log10(255.0 * 255.0 / (error / static_cast<double>(numBlocks * 16 * format.NumChannels)));
+                const uint32_t numThreads = pool ? pool->GetNumThreads() + 1 : 1;
+                DebugInfo(
+                        "{} {:>6} {:>2} threads: {:8.2f} ms, {:7.2f} M blocks/s, PSNR {:.2f} dB",
+                        format.Name, qualityName, numThreads, bestSeconds * 1000.0, static_cast<double>(numBlocks) / bestSeconds / 1e6, psnr
+                );
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,189 @@
+//
+// Created by andyroiiid on 1/3/2023.
+//
+
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Debug.h"
+#include "ImageFile.h"
+#include "TextureCompressor.h"
+#include "TextureFile.h"
+#include "TextureMips.h"
+#include "ThreadPool.h"
+
+// the whole argument has to be a number, std::stoul would throw
+static bool ParseUint32(const char *text, uint32_t &value) {
+    const char *end = text + strlen(text);
+    const auto [pointer, error] = std::from_chars(text, end, value);
+    return error == std::errc() && pointer == end;
+}
+
+static void PrintUsage() {
+    DebugInfo("usage: TextureCook <output.ktx2> <image> [--format rgba8|bc1|bc4|bc5|bc7] [--quality fast|normal|high] [--filter box|kaiser] [--srgb] [--no-mips] [--threads n]");
+}
+
+struct CookFormat {
+    const char *Name;
+    VkFormat Format;
+    // VK_FORMAT_UNDEFINED when there is no sRGB variant
+    VkFormat SrgbFormat;
+    // channels the error is measured over
+    uint32_t NumChannels;
+};
+
+static constexpr CookFormat CookFormats[]{
+        {"rgba8", VK_FORMAT_R8G8B8A8_UNORM,      VK_FORMAT_R8G8B8A8_SRGB,      4},
+        {"bc1",   VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_BC1_RGB_SRGB_BLOCK, 3},
+        {"bc4",   VK_FORMAT_BC4_UNORM_BLOCK,     VK_FORMAT_UNDEFINED,          1},
+        {"bc5",   VK_FORMAT_BC5_UNORM_BLOCK,     VK_FORMAT_UNDEFINED,          2},
+        {"bc7",   VK_FORMAT_BC7_UNORM_BLOCK,     VK_FORMAT_BC7_SRGB_BLOCK,     4},
+};
+
+static const CookFormat *FindCookFormat(const char *name) {
+    for (const CookFormat &format: CookFormats) {
+        if (strcmp(format.Name, name) == 0) {
+            return &format;
+        }
+    }
+    return nullptr;
+}
+
+// Converts an image into a KTX2 file with a CPU filtered mip chain, optionally block compressed on every core.
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        PrintUsage();
+        return 1;
+    }
+
+    const std::string outputFilename = argv[1];
+    const std::string source = argv[2];
+    const CookFormat *cookFormat = FindCookFormat("bc7");
+    TextureQuality quality = TextureQuality::Normal;
+    MipFilter filter = MipFilter::Kaiser;
+    bool srgb = false;
+    bool generateMips = true;
+    uint32_t numThreads = 0;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            cookFormat = FindCookFormat(argv[++i]);
+            if (!cookFormat) {
+                PrintUsage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--quality") == 0 && i + 1 < argc) {
+            const std::string name = argv[++i];
+            if (name == "fast") {
+                quality = TextureQuality::Fast;
+            } else if (name == "normal") {
+                quality = TextureQuality::Normal;
+            } else if (name == "high") {
+                quality = TextureQuality::High;
+            } else {
+                PrintUsage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            const std::string name = argv[++i];
+            if (name == "box") {
+                filter = MipFilter::Box;
+            } else if (name == "kaiser") {
+                filter = MipFilter::Kaiser;
+            } else {
+                PrintUsage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--srgb") == 0) {
+            srgb = true;
+        } else if (strcmp(argv[i], "--no-mips") == 0) {
+            generateMips = false;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            const char *text = argv[++i];
+            if (!DebugCheck(ParseUint32(text, numThreads), "--threads expects a number, got {}.", text)) {
+                return 1;
+            }
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (!DebugCheck(!srgb || cookFormat->SrgbFormat != VK_FORMAT_UNDEFINED, "{} has no sRGB variant.", cookFormat->Name)) {
+        return 1;
+    }
+    const VkFormat format = srgb ? cookFormat->SrgbFormat : cookFormat->Format;
+
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    auto logStage = [startTime](const char *stage) {
+        const auto now = std::chrono::high_resolution_clock::now();
+        DebugInfo("{:>10}: {:.2f} ms", stage, std::chrono::duration<double, std::milli>(now - startTime).count());
+    };
+
+    ThreadPool threadPool(numThreads);
+
+    const ImageFile image(source);
+    if (!DebugCheck(image.GetData() != nullptr, "Failed to load {}.", source)) {
+        return 1;
+    }
+    logStage("load");
+
+    std::vector<uint8_t> pixels;
+    std::vector<TextureMip> mips;
+    if (generateMips) {
+        GenerateMipChain(image.GetData(), image.GetWidth(), image.GetHeight(), filter, srgb, pixels, mips, &threadPool);
+        logStage("mips");
+    } else {
+        const uint64_t size = static_cast<uint64_t>(image.GetWidth()) * image.GetHeight() * 4;
+        pixels.assign(image.GetData(), image.GetData() + size);
+        mips.push_back({0, size, image.GetWidth(), image.GetHeight()});
+    }
+
+    if (IsCompressorFormat(format)) {
+        TextureFormatInfo info;
+        GetTextureFormatInfo(format, info);
+
+        std::vector<TextureMip> blockMips;
+        uint64_t size = 0;
+        for (const TextureMip &mip: mips) {
+            blockMips.push_back({size, GetTextureMipSize(info, mip.Width, mip.Height), mip.Width, mip.Height});
+            size += blockMips.back().Size;
+        }
+
+        const auto compressStart = std::chrono::high_resolution_clock::now();
+        std::vector<uint8_t> blocks(size);
+        double topError = 0.0;
+        for (size_t level = 0; level < mips.size(); level++) {
+            const TextureMip &mip = mips[level];
+            const double error = CompressTexture(format, pixels.data() + mip.Offset, mip.Width, mip.Height, blocks.data() + blockMips[level].Offset, quality, &threadPool);
+            if (level == 0) {
+                topError = error;
+            }
+        }
+        const double compressSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - compressStart).count();
+        logStage("compress");
+
+        const uint64_t numBlocks = size / info.BlockSize;
+        const double topSamples = static_cast<double>(GetTextureMipSize(info, mips[0].Width, mips[0].Height) / info.BlockSize * 16 * cookFormat->NumChannels);
+        const double psnr = topError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / (topError / topSamples)) : INFINITY;
+        DebugInfo(
+                "{} blocks on {} threads, {:.2f} M blocks/s, top mip PSNR {:.2f} dB",
+                numBlocks, threadPool.GetNumThreads() + 1, static_cast<double>(numBlocks) / compressSeconds / 1e6, psnr
+        );
+
+        pixels = std::move(blocks);
+        mips = std::move(blockMips);
+    }
+
+    if (!WriteKtx2File(outputFilename, format, mips.data(), mips.size(), pixels.data())) {
+        DebugError("Failed to write {}.", outputFilename);
+        return 1;
+    }
+    logStage("write");
+
+    DebugInfo("{}: {}x{}, {} mips, {}, {} bytes", outputFilename, mips[0].Width, mips[0].Height, mips.size(), cookFormat->Name, pixels.size());
+    return 0;
+}
@@ -0,0 +1,475 @@
+//
+// Created by andyroiiid on 1/2/2023.
+//
+
+#include "TextureFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+#include "Debug.h"
+
+bool GetTextureFormatInfo(VkFormat format, TextureFormatInfo &info) {
+    switch (format) {
+        case VK_FORMAT_R8_UNORM:
+            info = {1, 1, 1};
+            return true;
+        case VK_FORMAT_R8G8_UNORM:
+            info = {1, 1, 2};
+            return true;
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+            info = {1, 1, 4};
+            return true;
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+        case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+        case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+            info = {4, 4, 8};
+            return true;
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+        case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+        case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+        case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+        case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+            info = {4, 4, 16};
+            return true;
+        default:
+            break;
+    }
+
+    // every ASTC LDR format is 16 bytes per block, the UNORM and SRGB variants of one block size are adjacent
+    if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK) {
+        constexpr uint32_t astcBlockSizes[][2]{
+                {4, 4}, {5, 4}, {5, 5}, {6, 5}, {6, 6}, {8, 5}, {8, 6}, {8, 8},
+                {10, 5}, {10, 6}, {10, 8}, {10, 10}, {12, 10}, {12, 12}
+        };
+        const uint32_t *blockSize = astcBlockSizes[(format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) / 2];
+        info = {blockSize[0], blockSize[1], 16};
+        return true;
+    }
+    return false;
+}
+
+uint64_t GetTextureMipSize(const TextureFormatInfo &info, uint32_t width, uint32_t height) {
+    const uint64_t blocksX = (width + info.BlockWidth - 1) / info.BlockWidth;
+    const uint64_t blocksY = (height + info.BlockHeight - 1) / info.BlockHeight;
+    return blocksX * blocksY * info.BlockSize;
+}
+
+static constexpr uint8_t Ktx2Identifier[12]{0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+TextureFile::TextureFile(const std::string &filename) {
+    m_file = MappedFile(filename);
+    if (!DebugCheck(m_file.IsValid(), "Failed to map texture file {}.", filename)) {
+        return;
+    }
+
+    const bool loaded = m_file.GetSize() >= sizeof(Ktx2Identifier) && memcmp(m_file.GetData(), Ktx2Identifier, sizeof(Ktx2Identifier)) == 0
+                        ? LoadKtx2(filename)
+                        : LoadDds(filename);
+    if (!loaded || !ValidateMips(filename)) {
+        Release();
+    }
+}
+
+void TextureFile::Release() {
+    m_file = {};
+    m_format = VK_FORMAT_UNDEFINED;
+    m_mips.clear();
+}
+
+void TextureFile::Swap(TextureFile &other) noexcept {
+    std::swap(m_file, other.m_file);
+    std::swap(m_format, other.m_format);
+    std::swap(m_mips, other.m_mips);
+}
+
+struct Ktx2Header {
+    uint8_t Identifier[12];
+    uint32_t Format;
+    uint32_t TypeSize;
+    uint32_t PixelWidth;
+    uint32_t PixelHeight;
+    uint32_t PixelDepth;
+    uint32_t LayerCount;
+    uint32_t FaceCount;
+    uint32_t LevelCount;
+    uint32_t SupercompressionScheme;
+    uint32_t DfdByteOffset;
+    uint32_t DfdByteLength;
+    uint32_t KvdByteOffset;
+    uint32_t KvdByteLength;
+    uint64_t SgdByteOffset;
+    uint64_t SgdByteLength;
+};
+
+// follows the header, one per level starting from the largest
+struct Ktx2Level {
+    uint64_t ByteOffset;
+    uint64_t ByteLength;
+    uint64_t UncompressedByteLength;
+};
+
+// floor(log2(max(width, height))) + 1, more levels would shift the size by 32 or more bits
+static uint32_t GetMaxMipLevels(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+        levels++;
+    }
+    return levels;
+}
+
+bool TextureFile::LoadKtx2(const std::string &filename) {
+    if (!DebugCheck(m_file.GetSize() >= sizeof(Ktx2Header), "KTX2 file {} is truncated.", filename)) {
+        return false;
+    }
+    const auto *header = static_cast<const Ktx2Header *>(m_file.GetData());
+
+    // 0 levels asks the loader to generate mips, which VulkanTexture does when the format allows it
+    const uint32_t levelCount = std::max(header->LevelCount, 1u);
+    const bool is2D = header->PixelHeight > 0 && header->PixelDepth == 0 && header->LayerCount == 0 && header->FaceCount == 1;
+    if (!DebugCheck(is2D, "KTX2 file {} is not a 2D texture.", filename) ||
+        !DebugCheck(header->SupercompressionScheme == 0, "KTX2 file {} is supercompressed.", filename) ||
+        !DebugCheck(levelCount <= GetMaxMipLevels(header->PixelWidth, header->PixelHeight), "KTX2 file {} has {} levels, more than its size allows.", filename, levelCount) ||
+        !DebugCheck(m_file.GetSize() >= sizeof(Ktx2Header) + levelCount * sizeof(Ktx2Level), "KTX2 file {} is truncated.", filename)) {
+        return false;
+    }
+
+    m_format = static_cast<VkFormat>(header->Format);
+    const auto *levels = reinterpret_cast<const Ktx2Level *>(header + 1);
+    for (uint32_t level = 0; level < levelCount; level++) {
+        m_mips.push_back({
+                levels[level].ByteOffset,
+                levels[level].ByteLength,
+                std::max(header->PixelWidth >> level, 1u),
+                std::max(header->PixelHeight >> level, 1u)
+        });
+    }
+    return true;
+}
+
+// one sample of a basic data format descriptor block
+struct Ktx2DfdSample {
+    uint8_t Channel;
+    uint16_t BitOffset;
+    uint8_t BitLength;
+};
+
+struct Ktx2DfdFormat {
+    VkFormat Format;
+    uint8_t ColorModel;
+    bool Srgb;
+    uint32_t NumSamples;
+    Ktx2DfdSample Samples[4];
+};
+
+// KHR_DF_MODEL_*, the block compressed models call their color data channel 0 and the second BC5 channel 1
+static constexpr uint8_t DfdModelRgbsda = 1;
+static constexpr uint8_t DfdModelBc1a = 128;
+static constexpr uint8_t DfdModelBc4 = 131;
+static constexpr uint8_t DfdModelBc5 = 132;
+static constexpr uint8_t DfdModelBc7 = 134;
+static constexpr uint8_t DfdChannelAlpha = 15;
+static constexpr uint8_t DfdSampleLinear = 0x10;
+
+static constexpr Ktx2DfdFormat Ktx2DfdFormats[]{
+        {VK_FORMAT_R8_UNORM,            DfdModelRgbsda, false, 1, {{0, 0, 8}}},
+        {VK_FORMAT_R8G8_UNORM,          DfdModelRgbsda, false, 2, {{0, 0, 8}, {1, 8, 8}}},
+        {VK_FORMAT_R8G8B8A8_UNORM,      DfdModelRgbsda, false, 4, {{0, 0, 8}, {1, 8, 8}, {2, 16, 8}, {DfdChannelAlpha, 24, 8}}},
+        {VK_FORMAT_R8G8B8A8_SRGB,       DfdModelRgbsda, true,  4, {{0, 0, 8}, {1, 8, 8}, {2, 16, 8}, {DfdChannelAlpha, 24, 8}}},
+        {VK_FORMAT_BC1_RGB_UNORM_BLOCK, DfdModelBc1a,   false, 1, {{0, 0, 64}}},
+        {VK_FORMAT_BC1_RGB_SRGB_BLOCK,  DfdModelBc1a,   true,  1, {{0, 0, 64}}},
+        {VK_FORMAT_BC4_UNORM_BLOCK,     DfdModelBc4,    false, 1, {{0, 0, 64}}},
+        {VK_FORMAT_BC5_UNORM_BLOCK,     DfdModelBc5,    false, 2, {{0, 0, 64}, {1, 64, 64}}},
+        {VK_FORMAT_BC7_UNORM_BLOCK,     DfdModelBc7,    false, 1, {{0, 0, 128}}},
+        {VK_FORMAT_BC7_SRGB_BLOCK,      DfdModelBc7,    true,  1, {{0, 0, 128}}},
+};
+
+// the total size followed by a single basic descriptor block, readers like libktx require it
+static std::vector<uint32_t> BuildKtx2Dfd(const Ktx2DfdFormat &dfdFormat, const TextureFormatInfo &info) {
+    const uint32_t blockSize = 24 + 16 * dfdFormat.NumSamples;
+    std::vector<uint32_t> words{
+            4 + blockSize,
+            // Khronos vendor, basic descriptor type
+            0,
+            // version 2 for KDF 1.3
+            2 | blockSize << 16,
+            // BT.709 primaries, straight alpha
+            dfdFormat.ColorModel | 1u << 8 | (dfdFormat.Srgb ? 2u : 1u) << 16,
+            (info.BlockWidth - 1) | (info.BlockHeight - 1) << 8,
+            // bytes in plane 0
+            info.BlockSize,
+            0
+    };
+    for (uint32_t i = 0; i < dfdFormat.NumSamples; i++) {
+        const Ktx2DfdSample &sample = dfdFormat.Samples[i];
+        // alpha is never sRGB encoded
+        const uint32_t channelType = sample.Channel | (dfdFormat.Srgb && sample.Channel == DfdChannelAlpha ? DfdSampleLinear : 0);
+        words.push_back(sample.BitOffset | (sample.BitLength - 1) << 16 | channelType << 24);
+        // sample position and lower bound
+        words.push_back(0);
+        words.push_back(0);
+        words.push_back(IsBlockCompressed(info) ? 0xFFFFFFFF : (1u << sample.BitLength) - 1);
+    }
+    return words;
+}
+
+bool WriteKtx2File(const std::string &filename, VkFormat format, const TextureMip *mips, uint32_t mipLevels, const void *data) {
+    const Ktx2DfdFormat *dfdFormat = nullptr;
+    for (const Ktx2DfdFormat &candidate: Ktx2DfdFormats) {
+        if (candidate.Format == format) {
+            dfdFormat = &candidate;
+        }
+    }
+    TextureFormatInfo info;
+    if (!DebugCheck(dfdFormat && GetTextureFormatInfo(format, info), "Texture format {} can't be written to KTX2.", static_cast<int>(format))) {
+        return false;
+    }
+    if (!DebugCheck(mipLevels <= GetMaxMipLevels(mips[0].Width, mips[0].Height), "{} has {} mips, more than its size allows.", filename, mipLevels)) {
+        return false;
+    }
+    const std::vector<uint32_t> dfd = BuildKtx2Dfd(*dfdFormat, info);
+
+    Ktx2Header header{};
+    memcpy(header.Identifier, Ktx2Identifier, sizeof(Ktx2Identifier));
+    header.Format = format;
+    header.TypeSize = 1;
+    header.PixelWidth = mips[0].Width;
+    header.PixelHeight = mips[0].Height;
+    header.FaceCount = 1;
+    header.LevelCount = mipLevels;
+    header.DfdByteOffset = sizeof(Ktx2Header) + mipLevels * sizeof(Ktx2Level);
+    header.DfdByteLength = dfd.size() * sizeof(uint32_t);
+
+    // levels are stored from the smallest up, each one aligned to both the block size and 4 bytes
+    const uint64_t alignment = std::lcm<uint64_t>(info.BlockSize, 4);
+    std::vector<Ktx2Level> levels(mipLevels);
+    uint64_t offset = header.DfdByteOffset + header.DfdByteLength;
+    for (uint32_t level = mipLevels; level-- > 0;) {
+        const TextureMip &mip = mips[level];
+        const bool valid = mip.Width == std::max(header.PixelWidth >> level, 1u) &&
+                           mip.Height == std::max(header.PixelHeight >> level, 1u) &&
+                           mip.Size == GetTextureMipSize(info, mip.Width, mip.Height);
+        if (!DebugCheck(valid, "Mip {} of {} does not match its format and size.", level, filename)) {
+            return false;
+        }
+        offset = (offset + alignment - 1) / alignment * alignment;
+        levels[level] = {offset, mip.Size, mip.Size};
+        offset += mip.Size;
+    }
+
+    // padding stays zero
+    std::vector<uint8_t> bytes(offset, 0);
+    memcpy(bytes.data(), &header, sizeof(Ktx2Header));
+    memcpy(bytes.data() + sizeof(Ktx2Header), levels.data(), levels.size() * sizeof(Ktx2Level));
+    memcpy(bytes.data() + header.DfdByteOffset, dfd.data(), header.DfdByteLength);
+    for (uint32_t level = 0; level < mipLevels; level++) {
+        memcpy(bytes.data() + levels[level].ByteOffset, static_cast<const uint8_t *>(data) + mips[level].Offset, mips[level].Size);
+    }
+    return WriteFile(filename, bytes.data(), bytes.size());
+}
+
+static constexpr uint32_t DdsMagic = 0x20534444; // "DDS "
+
+static constexpr uint32_t MakeFourCC(char a, char b, char c, char d) {
+    return static_cast<uint32_t>(a) | static_cast<uint32_t>(b) << 8 | static_cast<uint32_t>(c) << 16 | static_cast<uint32_t>(d) << 24;
+}
+
+struct DdsPixelFormat {
+    uint32_t Size;
+    uint32_t Flags;
+    uint32_t FourCC;
+    uint32_t RgbBitCount;
+    uint32_t RBitMask;
+    uint32_t GBitMask;
+    uint32_t BBitMask;
+    uint32_t ABitMask;
+};
+
+// follows the magic
+struct DdsHeader {
+    uint32_t Size;
+    uint32_t Flags;
+    uint32_t Height;
+    uint32_t Width;
+    uint32_t PitchOrLinearSize;
+    uint32_t Depth;
+    uint32_t MipMapCount;
+    uint32_t Reserved1[11];
+    DdsPixelFormat PixelFormat;
+    uint32_t Caps;
+    uint32_t Caps2;
+    uint32_t Caps3;
+    uint32_t Caps4;
+    uint32_t Reserved2;
+};
+
+// follows DdsHeader when the four CC is "DX10"
+struct DdsHeaderDx10 {
+    uint32_t DxgiFormat;
+    uint32_t ResourceDimension;
+    uint32_t MiscFlag;
+    uint32_t ArraySize;
+    uint32_t MiscFlags2;
+};
+
+static constexpr uint32_t DdsPixelFormatFourCC = 0x4;
+static constexpr uint32_t DdsPixelFormatRgb = 0x40;
+static constexpr uint32_t DdsCaps2CubeMap = 0x200;
+static constexpr uint32_t DdsCaps2Volume = 0x200000;
+static constexpr uint32_t DdsDimensionTexture2D = 3;
+static constexpr uint32_t DdsMiscTextureCube = 0x4;
+
+struct DdsFormatMapping {
+    uint32_t Code;
+    VkFormat Format;
+};
+
+static constexpr DdsFormatMapping DxgiFormats[]{
+        {28, VK_FORMAT_R8G8B8A8_UNORM},
+        {29, VK_FORMAT_R8G8B8A8_SRGB},
+        {49, VK_FORMAT_R8G8_UNORM},
+        {61, VK_FORMAT_R8_UNORM},
+        {71, VK_FORMAT_BC1_RGBA_UNORM_BLOCK},
+        {72, VK_FORMAT_BC1_RGBA_SRGB_BLOCK},
+        {74, VK_FORMAT_BC2_UNORM_BLOCK},
+        {75, VK_FORMAT_BC2_SRGB_BLOCK},
+        {77, VK_FORMAT_BC3_UNORM_BLOCK},
+        {78, VK_FORMAT_BC3_SRGB_BLOCK},
+        {80, VK_FORMAT_BC4_UNORM_BLOCK},
+        {81, VK_FORMAT_BC4_SNORM_BLOCK},
+        {83, VK_FORMAT_BC5_UNORM_BLOCK},
+        {84, VK_FORMAT_BC5_SNORM_BLOCK},
+        {87, VK_FORMAT_B8G8R8A8_UNORM},
+        {91, VK_FORMAT_B8G8R8A8_SRGB},
+        {95, VK_FORMAT_BC6H_UFLOAT_BLOCK},
+        {96, VK_FORMAT_BC6H_SFLOAT_BLOCK},
+        {98, VK_FORMAT_BC7_UNORM_BLOCK},
+        {99, VK_FORMAT_BC7_SRGB_BLOCK},
+};
+
+static constexpr DdsFormatMapping FourCCFormats[]{
+        {MakeFourCC('D', 'X', 'T', '1'), VK_FORMAT_BC1_RGBA_UNORM_BLOCK},
+        {MakeFourCC('D', 'X', 'T', '3'), VK_FORMAT_BC2_UNORM_BLOCK},
+        {MakeFourCC('D', 'X', 'T', '5'), VK_FORMAT_BC3_UNORM_BLOCK},
+        {MakeFourCC('A', 'T', 'I', '1'), VK_FORMAT_BC4_UNORM_BLOCK},
+        {MakeFourCC('B', 'C', '4', 'U'), VK_FORMAT_BC4_UNORM_BLOCK},
+        {MakeFourCC('B', 'C', '4', 'S'), VK_FORMAT_BC4_SNORM_BLOCK},
+        {MakeFourCC('A', 'T', 'I', '2'), VK_FORMAT_BC5_UNORM_BLOCK},
+        {MakeFourCC('B', 'C', '5', 'U'), VK_FORMAT_BC5_UNORM_BLOCK},
+        {MakeFourCC('B', 'C', '5', 'S'), VK_FORMAT_BC5_SNORM_BLOCK},
+};
+
+template<size_t N>
+static VkFormat FindDdsFormat(const DdsFormatMapping (&mappings)[N], uint32_t code) {
+    for (const DdsFormatMapping &mapping: mappings) {
+        if (mapping.Code == code) {
+            return mapping.Format;
+        }
+    }
+    return VK_FORMAT_UNDEFINED;
+}
+
+// legacy headers describe the format with a four CC or with channel masks
+static VkFormat GetDdsPixelFormat(const DdsPixelFormat &pixelFormat) {
+    if (pixelFormat.Flags & DdsPixelFormatFourCC) {
+        return FindDdsFormat(FourCCFormats, pixelFormat.FourCC);
+    }
+    if ((pixelFormat.Flags & DdsPixelFormatRgb) && pixelFormat.RgbBitCount == 32) {
+        if (pixelFormat.RBitMask == 0x000000FF && pixelFormat.GBitMask == 0x0000FF00 && pixelFormat.BBitMask == 0x00FF0000) {
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        }
+        if (pixelFormat.RBitMask == 0x00FF0000 && pixelFormat.GBitMask == 0x0000FF00 && pixelFormat.BBitMask == 0x000000FF) {
+            return VK_FORMAT_B8G8R8A8_UNORM;
+        }
+    }
+    return VK_FORMAT_UNDEFINED;
+}
+
+bool TextureFile::LoadDds(const std::string &filename) {
+    const auto *bytes = static_cast<const uint8_t *>(m_file.GetData());
+    const size_t fileSize = m_file.GetSize();
+    if (!DebugCheck(fileSize >= sizeof(uint32_t) + sizeof(DdsHeader) && *reinterpret_cast<const uint32_t *>(bytes) == DdsMagic, "{} is neither a KTX2 nor a DDS file.", filename)) {
+        return false;
+    }
+    const auto *header = reinterpret_cast<const DdsHeader *>(bytes + sizeof(uint32_t));
+    uint64_t dataOffset = sizeof(uint32_t) + sizeof(DdsHeader);
+
+    if (!DebugCheck((header->Caps2 & (DdsCaps2CubeMap | DdsCaps2Volume)) == 0, "DDS file {} is not a 2D texture.", filename)) {
+        return false;
+    }
+
+    if ((header->PixelFormat.Flags & DdsPixelFormatFourCC) && header->PixelFormat.FourCC == MakeFourCC('D', 'X', '1', '0')) {
+        if (!DebugCheck(fileSize >= dataOffset + sizeof(DdsHeaderDx10), "DDS file {} is truncated.", filename)) {
+            return false;
+        }
+        const auto *headerDx10 = reinterpret_cast<const DdsHeaderDx10 *>(bytes + dataOffset);
+        dataOffset += sizeof(DdsHeaderDx10);
+        const bool is2D = headerDx10->ResourceDimension == DdsDimensionTexture2D && headerDx10->ArraySize <= 1 && (headerDx10->MiscFlag & DdsMiscTextureCube) == 0;
+        if (!DebugCheck(is2D, "DDS file {} is not a 2D texture.", filename)) {
+            return false;
+        }
+        m_format = FindDdsFormat(DxgiFormats, headerDx10->DxgiFormat);
+    } else {
+        m_format = GetDdsPixelFormat(header->PixelFormat);
+    }
+
+    TextureFormatInfo info;
+    if (!DebugCheck(GetTextureFormatInfo(m_format, info), "DDS file {} has an unsupported pixel format.", filename)) {
+        return false;
+    }
+
+    // mips are tightly packed one after another
+    const uint32_t mipLevels = std::max(header->MipMapCount, 1u);
+    if (!DebugCheck(mipLevels <= GetMaxMipLevels(header->Width, header->Height), "DDS file {} has {} mips, more than its size allows.", filename, mipLevels)) {
+        return false;
+    }
+    for (uint32_t level = 0; level < mipLevels; level++) {
+        const uint32_t width = std::max(header->Width >> level, 1u);
+        const uint32_t height = std::max(header->Height >> level, 1u);
+        const uint64_t size = GetTextureMipSize(info, width, height);
+        m_mips.push_back({dataOffset, size, width, height});
+        dataOffset += size;
+    }
+    return true;
+}
+
+bool TextureFile::ValidateMips(const std::string &filename) const {
+    TextureFormatInfo info;
+    if (!DebugCheck(GetTextureFormatInfo(m_format, info), "Texture file {} has unsupported format {}.", filename, static_cast<int>(m_format))) {
+        return false;
+    }
+    if (!DebugCheck(m_mips[0].Width > 0 && m_mips[0].Height > 0, "Texture file {} is empty.", filename)) {
+        return false;
+    }
+    for (const TextureMip &mip: m_mips) {
+        const bool valid = mip.Size == GetTextureMipSize(info, mip.Width, mip.Height) &&
+                           mip.Offset <= m_file.GetSize() &&
+                           mip.Size <= m_file.GetSize() - mip.Offset;
+        if (!DebugCheck(valid, "Texture file {} has an invalid {}x{} mip.", filename, mip.Width, mip.Height)) {
+            return false;
+        }
+    }
+    return true;
+}
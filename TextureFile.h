@@ -0,0 +1,103 @@
+//
+// Created by andyroiiid on 1/2/2023.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+#include "Files.h"
+
+// Texels of block compressed formats are stored in blocks, uncompressed formats are 1x1 blocks.
+struct TextureFormatInfo {
+    uint32_t BlockWidth = 1;
+    uint32_t BlockHeight = 1;
+    // bytes per block
+    uint32_t BlockSize = 0;
+};
+
+// false for formats TextureFile and VulkanTexture do not handle
+bool GetTextureFormatInfo(VkFormat format, TextureFormatInfo &info);
+
+[[nodiscard]] inline bool IsBlockCompressed(const TextureFormatInfo &info) {
+    return info.BlockWidth > 1 || info.BlockHeight > 1;
+}
+
+// bytes of one tightly packed mip, partial blocks at the edges count as whole blocks
+uint64_t GetTextureMipSize(const TextureFormatInfo &info, uint32_t width, uint32_t height);
+
+struct TextureMip {
+    // byte range of the mip in the texture data
+    uint64_t Offset;
+    uint64_t Size;
+    uint32_t Width;
+    uint32_t Height;
+};
+
+// Writes a 2D KTX2 file without supercompression, mips[0] is the full size level and the offsets are relative to data.
+// Only formats with a known data format descriptor can be written: R8, RG8 and RGBA8 UNORM, RGBA8 SRGB, BC1 RGB, BC4, BC5 and BC7.
+bool WriteKtx2File(const std::string &filename, VkFormat format, const TextureMip *mips, uint32_t mipLevels, const void *data);
+
+// Maps a KTX2 or DDS file holding one 2D texture and its mips, told apart by their magic.
+// The mips point straight into the mapping, block compressed data is uploaded without decoding it on the CPU.
+// KTX2 files must not be supercompressed, arrays, cube maps and volumes are rejected.
+class TextureFile {
+public:
+    TextureFile() = default;
+
+    explicit TextureFile(const std::string &filename);
+
+    ~TextureFile() {
+        Release();
+    }
+
+    TextureFile(const TextureFile &) = delete;
+
+    TextureFile &operator=(const TextureFile &) = delete;
+
+    TextureFile(TextureFile &&other) noexcept {
+        Swap(other);
+    }
+
+    TextureFile &operator=(TextureFile &&other) noexcept {
+        if (this != &other) {
+            Release();
+            Swap(other);
+        }
+        return *this;
+    }
+
+    void Release();
+
+    void Swap(TextureFile &other) noexcept;
+
+    [[nodiscard]] bool IsValid() const { return m_format != VK_FORMAT_UNDEFINED; }
+
+    [[nodiscard]] VkFormat GetFormat() const { return m_format; }
+
+    [[nodiscard]] uint32_t GetWidth() const { return m_mips[0].Width; }
+
+    [[nodiscard]] uint32_t GetHeight() const { return m_mips[0].Height; }
+
+    [[nodiscard]] uint32_t GetMipLevels() const { return m_mips.size(); }
+
+    // mip offsets are relative to GetData
+    [[nodiscard]] const TextureMip *GetMips() const { return m_mips.data(); }
+
+    [[nodiscard]] const void *GetData() const { return m_file.GetData(); }
+
+private:
+    bool LoadKtx2(const std::string &filename);
+
+    bool LoadDds(const std::string &filename);
+
+    // checks the sizes and bounds of m_mips
+    bool ValidateMips(const std::string &filename) const;
+
+    MappedFile m_file;
+    VkFormat m_format = VK_FORMAT_UNDEFINED;
+    std::vector<TextureMip> m_mips;
+};
@@ -0,0 +1,251 @@
+//
+// Created by andyroiiid on 1/3/2023.
+//
+
+#include "TextureMips.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "ThreadPool.h"
+
+// SSE2 is part of every x86-64 target
+#if defined(_M_X64) || defined(__x86_64__)
+#define TEXTURE_MIPS_SSE
+
+#include <emmintrin.h>
+#endif
+
+// the filters work on one RGBA float texel at a time, which is exactly one SSE register
+#ifdef TEXTURE_MIPS_SSE
+using Texel = __m128;
+
+static Texel ZeroTexel() {
+    return _mm_setzero_ps();
+}
+
+static Texel LoadTexel(const float *texel) {
+    return _mm_loadu_ps(texel);
+}
+
+static void StoreTexel(float *texel, Texel value) {
+    _mm_storeu_ps(texel, value);
+}
+
+static Texel MultiplyAdd(Texel sum, Texel value, float weight) {
+    return _mm_add_ps(sum, _mm_mul_ps(value, _mm_set1_ps(weight)));
+}
+#else
+struct Texel {
+    float Channels[4];
+};
+
+static Texel ZeroTexel() {
+    return {};
+}
+
+static Texel LoadTexel(const float *texel) {
+    return {texel[0], texel[1], texel[2], texel[3]};
+}
+
+static void StoreTexel(float *texel, Texel value) {
+    memcpy(texel, value.Channels, sizeof(value.Channels));
+}
+
+static Texel MultiplyAdd(Texel sum, Texel value, float weight) {
+    for (int i = 0; i < 4; i++) {
+        sum.Channels[i] += value.Channels[i] * weight;
+    }
+    return sum;
+}
+#endif
+
+template<class Func>
+static void ForEachRow(ThreadPool *threadPool, uint32_t numRows, Func &&func) {
+    if (threadPool) {
+        threadPool->ParallelFor(numRows, func);
+    } else {
+        for (uint32_t y = 0; y < numRows; y++) {
+            func(y);
+        }
+    }
+}
+
+static void DownsampleBox(const float *source, uint32_t sourceWidth, uint32_t sourceHeight, float *destination, uint32_t width, uint32_t height, ThreadPool *threadPool) {
+    ForEachRow(threadPool, height, [=](uint32_t y) {
+        const float *row0 = source + std::min(y * 2, sourceHeight - 1) * sourceWidth * 4;
+        const float *row1 = source + std::min(y * 2 + 1, sourceHeight - 1) * sourceWidth * 4;
+        float *output = destination + y * width * 4;
+        for (uint32_t x = 0; x < width; x++) {
+            const uint32_t x0 = std::min(x * 2, sourceWidth - 1) * 4;
+            const uint32_t x1 = std::min(x * 2 + 1, sourceWidth - 1) * 4;
+            Texel sum = ZeroTexel();
+            sum = MultiplyAdd(sum, LoadTexel(row0 + x0), 0.25f);
+            sum = MultiplyAdd(sum, LoadTexel(row0 + x1), 0.25f);
+            sum = MultiplyAdd(sum, LoadTexel(row1 + x0), 0.25f);
+            sum = MultiplyAdd(sum, LoadTexel(row1 + x1), 0.25f);
+            StoreTexel(output + x * 4, sum);
+        }
+    });
+}
+
+// destination texel x covers source texels 2x and 2x + 1, the taps are source texels 2x - 3 to 2x + 4
+static constexpr int KaiserTaps = 8;
+
+static float BesselI0(float x) {
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (int k = 1; k < 16; k++) {
+        term *= (x * 0.5f / static_cast<float>(k)) * (x * 0.5f / static_cast<float>(k));
+        sum += term;
+    }
+    return sum;
+}
+
+static void GetKaiserWeights(float weights[KaiserTaps]) {
+    constexpr float pi = 3.14159265f;
+    constexpr float alpha = 4.0f;
+    constexpr float halfWidth = KaiserTaps / 2;
+
+    float sum = 0.0f;
+    for (int i = 0; i < KaiserTaps; i++) {
+        // distance from the destination texel center in source texels, the sinc cuts off at the destination Nyquist frequency
+        const float distance = static_cast<float>(i) - (halfWidth - 0.5f);
+        const float x = pi * distance * 0.5f;
+        const float sinc = std::sin(x) / x;
+        const float ratio = distance / halfWidth;
+        const float window = BesselI0(alpha * std::sqrt(1.0f - ratio * ratio)) / BesselI0(alpha);
+        weights[i] = sinc * window;
+        sum += weights[i];
+    }
+    for (int i = 0; i < KaiserTaps; i++) {
+        weights[i] /= sum;
+    }
+}
+
+// separable, rows are filtered into a half width temporary and then its columns into the destination
+static void DownsampleKaiser(const float *source, uint32_t sourceWidth, uint32_t sourceHeight, float *destination, uint32_t width, uint32_t height, ThreadPool *threadPool) {
+    float weights[KaiserTaps];
+    GetKaiserWeights(weights);
+
+    auto clampTap = [](uint32_t center, int tap, uint32_t size) {
+        const int64_t position = static_cast<int64_t>(center) * 2 - (KaiserTaps / 2 - 1) + tap;
+        return static_cast<uint32_t>(std::clamp<int64_t>(position, 0, size - 1));
+    };
+
+    std::vector<float> horizontal(static_cast<size_t>(width) * sourceHeight * 4);
+    float *temporary = horizontal.data();
+    ForEachRow(threadPool, sourceHeight, [&](uint32_t y) {
+        const float *input = source + static_cast<size_t>(y) * sourceWidth * 4;
+        float *output = temporary + static_cast<size_t>(y) * width * 4;
+        for (uint32_t x = 0; x < width; x++) {
+            Texel sum = ZeroTexel();
+            for (int tap = 0; tap < KaiserTaps; tap++) {
+                sum = MultiplyAdd(sum, LoadTexel(input + clampTap(x, tap, sourceWidth) * 4), weights[tap]);
+            }
+            StoreTexel(output + x * 4, sum);
+        }
+    });
+
+    ForEachRow(threadPool, height, [&](uint32_t y) {
+        const float *rows[KaiserTaps];
+        for (int tap = 0; tap < KaiserTaps; tap++) {
+            rows[tap] = temporary + static_cast<size_t>(clampTap(y, tap, sourceHeight)) * width * 4;
+        }
+        float *output = destination + static_cast<size_t>(y) * width * 4;
+        for (uint32_t x = 0; x < width; x++) {
+            Texel sum = ZeroTexel();
+            for (int tap = 0; tap < KaiserTaps; tap++) {
+                sum = MultiplyAdd(sum, LoadTexel(rows[tap] + x * 4), weights[tap]);
+            }
+            StoreTexel(output + x * 4, sum);
+        }
+    });
+}
+
+static float SrgbToLinear(float value) {
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSrgb(float value) {
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+void GenerateMipChain(
+        const uint8_t *pixels, uint32_t width, uint32_t height,
+        MipFilter filter, bool srgb,
+        std::vector<uint8_t> &data, std::vector<TextureMip> &mips,
+        ThreadPool *threadPool
+) {
+    GetMipChainLayout(width, height, mips);
+    data.resize(mips.back().Offset + mips.back().Size);
+    memcpy(data.data(), pixels, mips[0].Size);
+    GenerateMips(data.data(), mips.data(), mips.size(), filter, srgb, threadPool);
+}
+
+void GetMipChainLayout(uint32_t width, uint32_t height, std::vector<TextureMip> &mips) {
+    mips.clear();
+    uint64_t size = 0;
+    for (uint32_t mipWidth = width, mipHeight = height;; mipWidth = std::max(mipWidth / 2, 1u), mipHeight = std::max(mipHeight / 2, 1u)) {
+        const uint64_t mipSize = static_cast<uint64_t>(mipWidth) * mipHeight * 4;
+        mips.push_back({size, mipSize, mipWidth, mipHeight});
+        size += mipSize;
+        if (mipWidth == 1 && mipHeight == 1) {
+            break;
+        }
+    }
+}
+
+void GenerateMips(
+        uint8_t *data, const TextureMip *mips, uint32_t mipLevels,
+        MipFilter filter, bool srgb,
+        ThreadPool *threadPool
+) {
+    const uint8_t *pixels = data + mips[0].Offset;
+    const uint32_t width = mips[0].Width;
+    const uint32_t height = mips[0].Height;
+
+    float toFloat[2][256];
+    for (uint32_t i = 0; i < 256; i++) {
+        toFloat[0][i] = static_cast<float>(i) / 255.0f;
+        toFloat[1][i] = srgb ? SrgbToLinear(toFloat[0][i]) : toFloat[0][i];
+    }
+
+    std::vector<float> source(mips[0].Size);
+    ForEachRow(threadPool, height, [&](uint32_t y) {
+        const size_t begin = static_cast<size_t>(y) * width * 4;
+        for (size_t i = begin; i < begin + width * 4; i++) {
+            // every fourth channel is alpha
+            source[i] = toFloat[i % 4 != 3][pixels[i]];
+        }
+    });
+
+    std::vector<float> destination;
+    for (uint32_t level = 1; level < mipLevels; level++) {
+        const TextureMip &sourceMip = mips[level - 1];
+        const TextureMip &mip = mips[level];
+        destination.resize(mip.Size);
+        if (filter == MipFilter::Kaiser) {
+            DownsampleKaiser(source.data(), sourceMip.Width, sourceMip.Height, destination.data(), mip.Width, mip.Height, threadPool);
+        } else {
+            DownsampleBox(source.data(), sourceMip.Width, sourceMip.Height, destination.data(), mip.Width, mip.Height, threadPool);
+        }
+
+        uint8_t *output = data + mip.Offset;
+        ForEachRow(threadPool, mip.Height, [&](uint32_t y) {
+            const size_t begin = static_cast<size_t>(y) * mip.Width * 4;
+            for (size_t i = begin; i < begin + mip.Width * 4; i++) {
+                // Kaiser weights go negative, so texels may ring out of range
+                float value = std::clamp(destination[i], 0.0f, 1.0f);
+                if (srgb && i % 4 != 3) {
+                    value = LinearToSrgb(value);
+                }
+                output[i] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+            }
+        });
+
+        // the next level is filtered from this one before quantization
+        std::swap(source, destination);
+    }
+}
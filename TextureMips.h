@@ -0,0 +1,40 @@
+//
+// Created by andyroiiid on 1/3/2023.
+//
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "TextureFile.h"
+
+class ThreadPool;
+
+enum class MipFilter {
+    // average of 2x2 texels, fast but aliases on high frequency content
+    Box,
+    // 8 tap Kaiser windowed sinc, sharper mips with less aliasing
+    Kaiser
+};
+
+// Builds the full mip chain of an RGBA8 image on the CPU, mips[0] is a copy of the image.
+// Filtering happens in float, sRGB color channels are filtered in linear space and alpha always is.
+// Texels outside of the image clamp to its edge, rows of every level are spread over the thread pool when given.
+void GenerateMipChain(
+        const uint8_t *pixels, uint32_t width, uint32_t height,
+        MipFilter filter, bool srgb,
+        std::vector<uint8_t> &data, std::vector<TextureMip> &mips,
+        ThreadPool *threadPool = nullptr
+);
+
+// The sizes of every level of a full mip chain, packed one after the other like GenerateMipChain lays them out.
+void GetMipChainLayout(uint32_t width, uint32_t height, std::vector<TextureMip> &mips);
+
+// GenerateMipChain on a chain that is already laid out, for example in a staging buffer.
+// Level 0 is read from data + mips[0].Offset, every other level is written to its own offset.
+void GenerateMips(
+        uint8_t *data, const TextureMip *mips, uint32_t mipLevels,
+        MipFilter filter, bool srgb,
+        ThreadPool *threadPool = nullptr
+);
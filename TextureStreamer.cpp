@@ -0,0 +1,340 @@
+//
+// Created by andyroiiid on 1/3/2023.
+//
+
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Debug.h"
+#include "ThreadPool.h"
+
+TextureStreamer::TextureStreamer(VulkanBase *device, ThreadPool *threadPool, TextureCache *cache, VkDescriptorSetLayout layout, uint32_t binding)
+        : m_device(device),
+          m_threadPool(threadPool),
+          m_cache(cache),
+          m_layout(layout),
+          m_binding(binding) {
+    m_completed = std::make_shared<CompletedLoads>();
+    m_stagingInFlight.resize(m_device->GetNumBuffering());
+    CreateDescriptorPool();
+    CreatePlaceholder();
+}
+
+void TextureStreamer::CreateDescriptorPool() {
+    const uint32_t maxSets = MaxStreamedTextures * m_device->GetNumBuffering();
+    VkDescriptorPoolSize poolSize{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, maxSets};
+
+    VkDescriptorPoolCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    createInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    createInfo.maxSets = maxSets;
+    createInfo.poolSizeCount = 1;
+    createInfo.pPoolSizes = &poolSize;
+    m_descriptorPool = m_device->CreateDescriptorPool(createInfo);
+}
+
+void TextureStreamer::CreatePlaceholder() {
+    const uint8_t white[4]{255, 255, 255, 255};
+    VulkanTextureOptions placeholderOptions;
+    placeholderOptions.Filter = TextureFilter::Nearest;
+    placeholderOptions.GenerateMips = false;
+    m_placeholder = VulkanTexture(m_device, 1, 1, white, placeholderOptions);
+}
+
+void TextureStreamer::Release() {
+    // the jobs allocate staging buffers from the device
+    if (m_numJobsInFlight > 0) {
+        m_threadPool->WaitIdle();
+    }
+
+    // destroying the pool frees the sets of every texture
+    if (m_device) {
+        m_device->DestroyDescriptorPool(m_descriptorPool);
+    }
+
+    m_device = nullptr;
+    m_threadPool = nullptr;
+    m_cache = nullptr;
+    m_layout = VK_NULL_HANDLE;
+    m_binding = 0;
+    m_descriptorPool = VK_NULL_HANDLE;
+    m_placeholder = {};
+    m_textures.clear();
+    m_numPending = 0;
+    m_numJobsInFlight = 0;
+    m_completed.reset();
+    m_uploadQueue.clear();
+    m_stagingInFlight.clear();
+    m_retiredTextures.clear();
+    m_retiredBytes = 0;
+    m_frame = 0;
+}
+
+void TextureStreamer::Swap(TextureStreamer &other) noexcept {
+    std::swap(m_device, other.m_device);
+    std::swap(m_threadPool, other.m_threadPool);
+    std::swap(m_cache, other.m_cache);
+    std::swap(m_layout, other.m_layout);
+    std::swap(m_binding, other.m_binding);
+    std::swap(m_descriptorPool, other.m_descriptorPool);
+    std::swap(m_placeholder, other.m_placeholder);
+    std::swap(m_textures, other.m_textures);
+    std::swap(m_numPending, other.m_numPending);
+    std::swap(m_numJobsInFlight, other.m_numJobsInFlight);
+    std::swap(m_completed, other.m_completed);
+    std::swap(m_uploadQueue, other.m_uploadQueue);
+    std::swap(m_stagingInFlight, other.m_stagingInFlight);
+    std::swap(m_retiredTextures, other.m_retiredTextures);
+    std::swap(m_retiredBytes, other.m_retiredBytes);
+    std::swap(m_frame, other.m_frame);
+}
+
+StreamedTextureHandle TextureStreamer::Request(const std::string &filename, const VulkanTextureOptions &options, bool streamMips) {
+    VulkanTextureOptions streamedOptions = options;
+    streamedOptions.Compressor = nullptr;
+
+    std::string key = TextureCache::GetKey(filename, streamedOptions) + (streamMips ? "|streamed mips" : "");
+    if (auto pair = m_textures.find(key); pair != m_textures.end()) {
+        pair->second->m_lastUsedFrame = m_frame;
+        return pair->second;
+    }
+
+    if (!DebugCheck(
+            m_textures.size() < MaxStreamedTextures,
+            "Can't stream {}, the descriptor pool of the texture streamer is full with {} textures.", filename, MaxStreamedTextures
+    )) {
+        return nullptr;
+    }
+
+    auto texture = std::make_shared<StreamedTexture>();
+    texture->m_filename = TextureCache::NormalizeFilename(filename);
+    texture->m_options = streamedOptions;
+    texture->m_streamMips = streamMips;
+    texture->m_lastUsedFrame = m_frame;
+    // nothing has bound the new sets yet, so they can be written right away
+    texture->m_descriptorSets.resize(m_stagingInFlight.size());
+    texture->m_samplerDescriptorSets.resize(m_stagingInFlight.size(), m_placeholder.GetSamplerDescriptorSet());
+    texture->m_staleDescriptorSets.resize(m_stagingInFlight.size(), false);
+    for (VkDescriptorSet &descriptorSet: texture->m_descriptorSets) {
+        descriptorSet = m_device->AllocateDescriptorSet(m_layout, m_descriptorPool);
+        m_placeholder.BindToDescriptorSet(descriptorSet, m_binding);
+    }
+    m_textures.emplace(std::move(key), texture);
+
+    if (TextureHandle cachedTexture = m_cache && !streamMips ? m_cache->Find(filename, streamedOptions) : nullptr) {
+        texture->m_texture = std::move(cachedTexture);
+        for (VkDescriptorSet descriptorSet: texture->m_descriptorSets) {
+            texture->m_texture->BindToDescriptorSet(descriptorSet, m_binding);
+        }
+        std::fill(texture->m_samplerDescriptorSets.begin(), texture->m_samplerDescriptorSets.end(), texture->m_texture->GetSamplerDescriptorSet());
+        return texture;
+    }
+
+    m_numPending++;
+    m_numJobsInFlight++;
+    m_threadPool->Enqueue([device = m_device, completed = m_completed, texture]() {
+        LoadedTexture load;
+        load.Texture = texture;
+        load.Loaded = LoadTextureStaging(device, texture->m_filename, load.Staging, texture->m_streamMips && texture->m_options.GenerateMips);
+
+        std::lock_guard lock(completed->Mutex);
+        completed->Loads.push_back(std::move(load));
+    });
+    return texture;
+}
+
+void TextureStreamer::MakeResident(StreamedTexture &texture, TextureHandle residentTexture) {
+    texture.m_texture = std::move(residentTexture);
+    std::fill(texture.m_staleDescriptorSets.begin(), texture.m_staleDescriptorSets.end(), true);
+}
+
+void TextureStreamer::Upload(VkCommandBuffer commandBuffer, uint32_t bufferingIndex, LoadedTexture &load) {
+    StreamedTexture &texture = *load.Texture;
+    m_numPending--;
+    if (!load.Loaded) {
+        texture.m_failed = true;
+        return;
+    }
+
+    if (texture.m_streamMips) {
+        texture.m_staging = std::move(load.Staging);
+        uint32_t firstMip = 0;
+        while (firstMip + 1 < texture.GetMipCount() && std::max(texture.m_staging.Mips[firstMip].Width, texture.m_staging.Mips[firstMip].Height) > InitialMipSize) {
+            firstMip++;
+        }
+        ChangeResidency(commandBuffer, texture, firstMip);
+        return;
+    }
+
+    // another request may have loaded the same texture into the cache in the meantime
+    TextureHandle residentTexture = m_cache ? m_cache->Find(texture.m_filename, texture.m_options) : nullptr;
+    if (!residentTexture) {
+        residentTexture = std::make_shared<VulkanTexture>(m_device, commandBuffer, load.Staging, texture.m_options);
+        if (m_cache) {
+            m_cache->Add(texture.m_filename, texture.m_options, residentTexture);
+        }
+        m_stagingInFlight[bufferingIndex].push_back(std::move(load.Staging.Buffer));
+    }
+    MakeResident(texture, std::move(residentTexture));
+}
+
+void TextureStreamer::ReportUsage(StreamedTexture &texture, float distance, float uvDensity, float projectionScale) {
+    if (!texture.m_streamMips || texture.GetMipCount() == 0) {
+        return;
+    }
+
+    // texels of the full size mip covered by one pixel, every mip halves them
+    const TextureMip &fullMip = texture.m_staging.Mips[0];
+    const float texelsPerUnit = static_cast<float>(std::max(fullMip.Width, fullMip.Height)) * uvDensity;
+    const float texelsPerPixel = texelsPerUnit * std::max(distance, 0.0f) / projectionScale;
+    const auto mip = static_cast<uint32_t>(std::floor(std::log2(std::max(texelsPerPixel, 1.0f))));
+    texture.m_wantedMip = std::min({texture.m_wantedMip, mip, texture.GetMipCount() - 1});
+}
+
+void TextureStreamer::ChangeResidency(VkCommandBuffer commandBuffer, StreamedTexture &texture, uint32_t firstMip) {
+    TextureHandle residentTexture = std::make_shared<VulkanTexture>(m_device, commandBuffer, texture.m_staging, firstMip, texture.m_texture.get(), texture.m_options);
+    if (texture.m_texture) {
+        m_retiredBytes += texture.m_texture->GetMemorySize();
+        m_retiredTextures.emplace_back(m_frame, std::move(texture.m_texture));
+    }
+    MakeResident(texture, std::move(residentTexture));
+}
+
+void TextureStreamer::UpdateResidency(VkCommandBuffer commandBuffer) {
+    VkDeviceSize usage, budget;
+    m_device->GetDeviceLocalMemoryBudget(usage, budget);
+    const auto targetUsage = static_cast<VkDeviceSize>(static_cast<double>(budget) * MemoryBudgetFraction);
+
+    // textures nobody holds are about to be released with their staging memory, which the copies would read
+    std::vector<StreamedTexture *> textures;
+    for (const auto &[key, texture]: m_textures) {
+        if (texture->m_streamMips && texture->m_texture && texture.use_count() > 1) {
+            textures.push_back(texture.get());
+        }
+    }
+
+    auto getSize = [](const StreamedTexture *texture, uint32_t firstMip) {
+        VkDeviceSize size = 0;
+        for (uint32_t mip = firstMip; mip < texture->GetMipCount(); mip++) {
+            size += texture->m_staging.Mips[mip].Size;
+        }
+        return size;
+    };
+
+    uint32_t numChanges = 0;
+    if (usage > targetUsage) {
+        // drop what is not wanted first, then degrade the textures with the largest resident mips
+        std::sort(textures.begin(), textures.end(), [](const StreamedTexture *a, const StreamedTexture *b) {
+            const bool aUnwanted = a->m_texture->GetFirstMip() < a->m_wantedMip;
+            const bool bUnwanted = b->m_texture->GetFirstMip() < b->m_wantedMip;
+            if (aUnwanted != bUnwanted) {
+                return aUnwanted;
+            }
+            return a->m_texture->GetMemorySize() > b->m_texture->GetMemorySize();
+        });
+        // Images replaced by earlier changes are still in the usage until they retire,
+        // dropping more mips before that would overshoot the budget and stream the mips back in afterwards.
+        // The ones replaced here give their memory back the same way.
+        VkDeviceSize retiringUsage = 0;
+        for (StreamedTexture *texture: textures) {
+            const uint32_t firstMip = texture->m_texture->GetFirstMip();
+            if (m_retiredBytes > 0 || usage <= targetUsage + retiringUsage || numChanges == MaxResidencyChangesPerFrame) {
+                break;
+            }
+            if (firstMip + 1 >= texture->GetMipCount()) {
+                continue;
+            }
+            const uint32_t newFirstMip = std::max(firstMip + 1, std::min(texture->m_wantedMip, texture->GetMipCount() - 1));
+            // the new image is allocated while the old one is still alive
+            usage += getSize(texture, newFirstMip);
+            retiringUsage += texture->m_texture->GetMemorySize();
+            ChangeResidency(commandBuffer, *texture, newFirstMip);
+            numChanges++;
+        }
+    } else {
+        // stream in the textures that are the furthest from what they want first
+        std::sort(textures.begin(), textures.end(), [](const StreamedTexture *a, const StreamedTexture *b) {
+            return static_cast<int64_t>(a->m_texture->GetFirstMip()) - a->m_wantedMip > static_cast<int64_t>(b->m_texture->GetFirstMip()) - b->m_wantedMip;
+        });
+        for (StreamedTexture *texture: textures) {
+            const uint32_t firstMip = texture->m_texture->GetFirstMip();
+            if (numChanges == MaxResidencyChangesPerFrame) {
+                break;
+            }
+            if (texture->m_wantedMip < firstMip) {
+                // the old image stays alive next to the new one for a few frames
+                const VkDeviceSize newSize = getSize(texture, texture->m_wantedMip);
+                if (usage + newSize > targetUsage) {
+                    continue;
+                }
+                usage += newSize;
+                ChangeResidency(commandBuffer, *texture, texture->m_wantedMip);
+                numChanges++;
+            } else if (texture->m_wantedMip != UINT32_MAX && texture->m_wantedMip > firstMip + 1) {
+                // a mip of slack keeps textures at the edge of a mip from bouncing between two images
+                ChangeResidency(commandBuffer, *texture, texture->m_wantedMip - 1);
+                numChanges++;
+            }
+        }
+    }
+
+    for (StreamedTexture *texture: textures) {
+        texture->m_wantedMip = UINT32_MAX;
+    }
+}
+
+void TextureStreamer::Update(VkCommandBuffer commandBuffer, uint32_t bufferingIndex) {
+    m_frame++;
+
+    // BeginFrame waited for the last frame recorded in this slot
+    m_stagingInFlight[bufferingIndex].clear();
+    // every slot has swapped its set away from them and finished the frames that sampled them
+    const uint64_t numBuffering = m_stagingInFlight.size();
+    while (!m_retiredTextures.empty() && m_frame - m_retiredTextures.front().first > numBuffering) {
+        m_retiredBytes -= m_retiredTextures.front().second->GetMemorySize();
+        m_retiredTextures.pop_front();
+    }
+
+    std::vector<LoadedTexture> completedLoads;
+    {
+        std::lock_guard lock(m_completed->Mutex);
+        completedLoads.swap(m_completed->Loads);
+    }
+    m_numJobsInFlight -= completedLoads.size();
+    for (LoadedTexture &load: completedLoads) {
+        m_uploadQueue.push_back(std::move(load));
+    }
+
+    VkDeviceSize uploadedBytes = 0;
+    while (!m_uploadQueue.empty() && (uploadedBytes == 0 || uploadedBytes + m_uploadQueue.front().Staging.Buffer.GetSize() <= MaxUploadBytesPerFrame)) {
+        uploadedBytes += m_uploadQueue.front().Staging.Buffer.GetSize();
+        Upload(commandBuffer, bufferingIndex, m_uploadQueue.front());
+        m_uploadQueue.pop_front();
+    }
+
+    UpdateResidency(commandBuffer);
+
+    // the sets of this slot are not read by the GPU any more, swap the resident textures in
+    for (auto pair = m_textures.begin(); pair != m_textures.end();) {
+        StreamedTexture &texture = *pair->second;
+        if (texture.m_staleDescriptorSets[bufferingIndex]) {
+            texture.m_texture->BindToDescriptorSet(texture.m_descriptorSets[bufferingIndex], m_binding);
+            texture.m_samplerDescriptorSets[bufferingIndex] = texture.m_texture->GetSamplerDescriptorSet();
+            texture.m_staleDescriptorSets[bufferingIndex] = false;
+        }
+
+        // a texture nobody holds may still be bound by the frames in flight, and loading ones are held by their jobs
+        if (pair->second.use_count() > 1) {
+            texture.m_lastUsedFrame = m_frame;
+        } else if (m_frame - texture.m_lastUsedFrame > numBuffering) {
+            for (VkDescriptorSet descriptorSet: texture.m_descriptorSets) {
+                m_device->FreeDescriptorSet(descriptorSet, m_descriptorPool);
+            }
+            pair = m_textures.erase(pair);
+            continue;
+        }
+        ++pair;
+    }
+}
@@ -0,0 +1,191 @@
+//
+// Created by andyroiiid on 1/3/2023.
+//
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "VulkanBase.h"
+#include "TextureCache.h"
+
+class ThreadPool;
+
+// A texture that may still be loading, its descriptor sets point at the placeholder until it is resident.
+class StreamedTexture {
+public:
+    [[nodiscard]] const std::string &GetFilename() const { return m_filename; }
+
+    // one set per buffering slot, bind the one of the frame being recorded
+    [[nodiscard]] VkDescriptorSet GetDescriptorSet(uint32_t bufferingIndex) const { return m_descriptorSets[bufferingIndex]; }
+
+    // the shared sampler set of the image GetDescriptorSet(bufferingIndex) points at, bind it alongside
+    [[nodiscard]] VkDescriptorSet GetSamplerDescriptorSet(uint32_t bufferingIndex) const { return m_samplerDescriptorSets[bufferingIndex]; }
+
+    [[nodiscard]] bool IsResident() const { return m_texture != nullptr; }
+
+    // the placeholder stays bound forever
+    [[nodiscard]] bool HasFailed() const { return m_failed; }
+
+    // nullptr until resident
+    [[nodiscard]] const TextureHandle &GetTexture() const { return m_texture; }
+
+    // mips of the source with streamed mips and 0 otherwise, only the ones from GetTexture()->GetFirstMip() on are resident
+    [[nodiscard]] uint32_t GetMipCount() const { return m_staging.Mips.size(); }
+
+private:
+    friend class TextureStreamer;
+
+    std::string m_filename;
+    VulkanTextureOptions m_options;
+    // the staging memory of all mips is kept to stream finer ones in later
+    bool m_streamMips = false;
+    VulkanTextureStaging m_staging;
+    // finest mip any ReportUsage asked for since the last Update
+    uint32_t m_wantedMip = UINT32_MAX;
+    std::vector<VkDescriptorSet> m_descriptorSets;
+    // owned by the device, never freed here
+    std::vector<VkDescriptorSet> m_samplerDescriptorSets;
+    // sets still pointing at the placeholder after the texture became resident
+    std::vector<bool> m_staleDescriptorSets;
+    TextureHandle m_texture;
+    bool m_failed = false;
+    uint64_t m_lastUsedFrame = 0;
+};
+
+using StreamedTextureHandle = std::shared_ptr<StreamedTexture>;
+
+// Loads textures without ever waiting for them. Files are decoded into staging memory on the thread pool,
+// Update records their uploads into the frame's command buffer and rewrites the descriptor sets of every buffering slot
+// when that slot begins its next frame, so no set is changed while the GPU may still read it.
+// Resident textures are shared through the TextureCache.
+//
+// Textures requested with streamMips only keep the mips ReportUsage asked for resident, starting from the coarse ones.
+// Finer mips are streamed in while the device local heaps are below MemoryBudgetFraction of their budget
+// and the finest ones are dropped above it, by swapping in a new image that copies the levels it shares with the old one.
+class TextureStreamer {
+public:
+    // at least one upload is recorded per frame, however large it is
+    static constexpr VkDeviceSize MaxUploadBytesPerFrame = 32 * 1024 * 1024;
+
+    // streamed mips start with the largest mip no larger than this resident
+    static constexpr uint32_t InitialMipSize = 64;
+
+    // the rest of the budget is left for other allocations
+    static constexpr float MemoryBudgetFraction = 0.9f;
+
+    static constexpr uint32_t MaxResidencyChangesPerFrame = 4;
+
+    // the streamer's own descriptor pool holds the sets of this many textures, unused ones are freed after a few frames
+    static constexpr uint32_t MaxStreamedTextures = 1024;
+
+    TextureStreamer() = default;
+
+    // the descriptor sets of streamed textures come from layout and have the texture at binding as a sampled image,
+    // layout must not have other bindings since the sets are allocated from a pool sized for just that one
+    TextureStreamer(VulkanBase *device, ThreadPool *threadPool, TextureCache *cache, VkDescriptorSetLayout layout, uint32_t binding);
+
+    ~TextureStreamer() {
+        Release();
+    }
+
+    TextureStreamer(const TextureStreamer &) = delete;
+
+    TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+    TextureStreamer(TextureStreamer &&other) noexcept {
+        Swap(other);
+    }
+
+    TextureStreamer &operator=(TextureStreamer &&other) noexcept {
+        if (this != &other) {
+            Release();
+            Swap(other);
+        }
+        return *this;
+    }
+
+    // waits for the loads in flight, the device must be idle
+    void Release();
+
+    void Swap(TextureStreamer &other) noexcept;
+
+    // Returns immediately, textures already in the cache are resident right away.
+    // Requests for a texture that is loading or loaded share its StreamedTexture.
+    // options.Compressor is ignored since it waits for the GPU. Images with streamMips get their mips generated on the CPU,
+    // the textures are not shared through the cache since their images change.
+    // nullptr when MaxStreamedTextures textures are alive already.
+    StreamedTextureHandle Request(const std::string &filename, const VulkanTextureOptions &options = {}, bool streamMips = false);
+
+    // Asks for the mips a surface distance units away needs, uvDensity is texture coordinate units per world unit.
+    // projectionScale is the pixels one unit covers at distance 1, see GetLodProjectionScale.
+    // Call every frame for every visible surface using a texture with streamed mips,
+    // unreported textures are the first to lose their fine mips when over the budget.
+    static void ReportUsage(StreamedTexture &texture, float distance, float uvDensity, float projectionScale);
+
+    // Call once per frame after BeginFrame and before the render pass, commandBuffer must be the frame's.
+    // Uploads finished loads, changes mip residency, swaps the descriptor sets of this slot and releases textures nothing holds any more.
+    void Update(VkCommandBuffer commandBuffer, uint32_t bufferingIndex);
+
+    [[nodiscard]] size_t GetTextureCount() const { return m_textures.size(); }
+
+    // requested textures that are not resident or failed yet
+    [[nodiscard]] uint32_t GetPendingCount() const { return m_numPending; }
+
+private:
+    struct LoadedTexture {
+        StreamedTextureHandle Texture;
+        bool Loaded = false;
+        VulkanTextureStaging Staging;
+    };
+
+    // shared with the jobs, so a job may outlive the streamer
+    struct CompletedLoads {
+        std::mutex Mutex;
+        std::vector<LoadedTexture> Loads;
+    };
+
+    void CreateDescriptorPool();
+
+    void CreatePlaceholder();
+
+    void MakeResident(StreamedTexture &texture, TextureHandle residentTexture);
+
+    void Upload(VkCommandBuffer commandBuffer, uint32_t bufferingIndex, LoadedTexture &load);
+
+    // replaces the texture's image with one holding the mips from firstMip on
+    void ChangeResidency(VkCommandBuffer commandBuffer, StreamedTexture &texture, uint32_t firstMip);
+
+    void UpdateResidency(VkCommandBuffer commandBuffer);
+
+    VulkanBase *m_device = nullptr;
+    ThreadPool *m_threadPool = nullptr;
+    TextureCache *m_cache = nullptr;
+    VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+    uint32_t m_binding = 0;
+    // the sets of every buffering slot of MaxStreamedTextures textures, kept out of the device's shared pool
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+
+    // 1x1 white, sampled until a texture is resident
+    VulkanTexture m_placeholder;
+
+    // keyed by TextureCache::GetKey
+    std::unordered_map<std::string, StreamedTextureHandle> m_textures;
+    uint32_t m_numPending = 0;
+    uint32_t m_numJobsInFlight = 0;
+    std::shared_ptr<CompletedLoads> m_completed;
+    // finished loads that did not fit into the upload budget of their frame
+    std::deque<LoadedTexture> m_uploadQueue;
+    // staging buffers read by the frame recorded in each buffering slot
+    std::vector<std::vector<VulkanBuffer>> m_stagingInFlight;
+    // images replaced by a residency change, still bound by the frames in flight until their sets are swapped
+    std::deque<std::pair<uint64_t, TextureHandle>> m_retiredTextures;
+    // memory of m_retiredTextures, still counted in the heap usage until they retire
+    VkDeviceSize m_retiredBytes = 0;
+    uint64_t m_frame = 0;
+};
@@ -0,0 +1,63 @@
+//
+// Created by andyroiiid on 12/31/2022.
+//
+
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(uint32_t numThreads) {
+    if (numThreads == 0) {
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    m_threads.reserve(numThreads);
+    for (uint32_t i = 0; i < numThreads; i++) {
+        m_threads.emplace_back(&ThreadPool::WorkerMain, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobAvailable.notify_all();
+    for (std::thread &thread: m_threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::Enqueue(std::function<void()> job) {
+    {
+        std::lock_guard lock(m_mutex);
+        m_jobs.push(std::move(job));
+    }
+    m_jobAvailable.notify_one();
+}
+
+void ThreadPool::WaitIdle() {
+    std::unique_lock lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_jobs.empty() && m_activeJobs == 0; });
+}
+
+void ThreadPool::WorkerMain() {
+    std::unique_lock lock(m_mutex);
+    for (;;) {
+        m_jobAvailable.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+        if (m_jobs.empty()) {
+            // stopping, and every queued job has run
+            return;
+        }
+
+        std::function<void()> job = std::move(m_jobs.front());
+        m_jobs.pop();
+        m_activeJobs++;
+        lock.unlock();
+
+        job();
+
+        lock.lock();
+        m_activeJobs--;
+        if (m_jobs.empty() && m_activeJobs == 0) {
+            m_idle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,85 @@
+//
+// Created by andyroiiid on 12/31/2022.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads consuming a FIFO of jobs.
+class ThreadPool {
+public:
+    // 0 means one worker per hardware thread
+    explicit ThreadPool(uint32_t numThreads = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ThreadPool(ThreadPool &&) = delete;
+
+    ThreadPool &operator=(ThreadPool &&) = delete;
+
+    [[nodiscard]] uint32_t GetNumThreads() const { return m_threads.size(); }
+
+    void Enqueue(std::function<void()> job);
+
+    // blocks until the queue is empty and every worker is idle
+    void WaitIdle();
+
+    // Calls func(i) for every i in [0, count) and returns when all of them are done.
+    // The calling thread works too, so nesting ParallelFor inside a job can not deadlock.
+    template<class Func>
+    void ParallelFor(uint32_t count, Func &&func) {
+        if (count == 0) {
+            return;
+        }
+
+        // helpers that only start after everything is done still touch the counters, so they are shared
+        struct Counters {
+            std::atomic<uint32_t> Next{0};
+            std::atomic<uint32_t> Done{0};
+        };
+        auto counters = std::make_shared<Counters>();
+        auto work = [counters, &func, count]() {
+            uint32_t i;
+            while ((i = counters->Next.fetch_add(1)) < count) {
+                func(i);
+                counters->Done.fetch_add(1, std::memory_order_release);
+            }
+        };
+
+        const uint32_t numHelpers = std::min(count, GetNumThreads() + 1) - 1;
+        for (uint32_t i = 0; i < numHelpers; i++) {
+            Enqueue(work);
+        }
+        work();
+
+        // only items that other threads already picked up are waited for
+        while (counters->Done.load(std::memory_order_acquire) < count) {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    void WorkerMain();
+
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+    std::condition_variable m_jobAvailable;
+    std::condition_variable m_idle;
+    std::queue<std::function<void()>> m_jobs;
+    uint32_t m_activeJobs = 0;
+    bool m_stopping = false;
+};
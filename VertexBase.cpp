@@ -35,3 +35,26 @@ const VkPipelineVertexInputStateCreateInfo &VertexBase::GetPipelineVertexInputSt
 
     return vertexInput;
 }
+
+const VkPipelineVertexInputStateCreateInfo &InstanceBase::GetPipelineVertexInputStateCreateInfo() {
+    static const std::vector<VkVertexInputBindingDescription> bindings{
+            {0, sizeof(VertexBase),   VK_VERTEX_INPUT_RATE_VERTEX},
+            {1, sizeof(InstanceBase), VK_VERTEX_INPUT_RATE_INSTANCE}
+    };
+
+    static const std::vector<VkVertexInputAttributeDescription> attributes{
+            {0, 0, VK_FORMAT_R32G32B32_SFLOAT,    static_cast<uint32_t>(offsetof(VertexBase, Position))},
+            {1, 0, VK_FORMAT_R32G32B32_SFLOAT,    static_cast<uint32_t>(offsetof(VertexBase, Normal))},
+            {2, 0, VK_FORMAT_R32G32_SFLOAT,       static_cast<uint32_t>(offsetof(VertexBase, TexCoord))},
+            // a mat4 occupies 4 consecutive locations, one per column
+            {3, 1, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(offsetof(InstanceBase, Model) + sizeof(glm::vec4) * 0)},
+            {4, 1, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(offsetof(InstanceBase, Model) + sizeof(glm::vec4) * 1)},
+            {5, 1, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(offsetof(InstanceBase, Model) + sizeof(glm::vec4) * 2)},
+            {6, 1, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(offsetof(InstanceBase, Model) + sizeof(glm::vec4) * 3)},
+            {7, 1, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(offsetof(InstanceBase, Color))}
+    };
+
+    static const VkPipelineVertexInputStateCreateInfo vertexInput = CreatePipelineVertexInputStateCreateInfo(bindings, attributes);
+
+    return vertexInput;
+}
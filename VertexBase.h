@@ -4,8 +4,10 @@
 
 #pragma once
 
+#include <glm/vec4.hpp>
 #include <glm/vec3.hpp>
 #include <glm/vec2.hpp>
+#include <glm/mat4x4.hpp>
 
 struct VkPipelineVertexInputStateCreateInfo;
 
@@ -21,3 +23,17 @@ struct VertexBase {
 
     static const VkPipelineVertexInputStateCreateInfo &GetPipelineVertexInputStateCreateInfo();
 };
+
+// per-instance data streamed through vertex binding 1 with VK_VERTEX_INPUT_RATE_INSTANCE
+struct InstanceBase {
+    glm::mat4 Model;
+    glm::vec4 Color;
+
+    InstanceBase() = default;
+
+    InstanceBase(const glm::mat4 &model, const glm::vec4 &color)
+            : Model(model), Color(color) {}
+
+    // vertex binding 0 is VertexBase, vertex binding 1 is InstanceBase
+    static const VkPipelineVertexInputStateCreateInfo &GetPipelineVertexInputStateCreateInfo();
+};
@@ -0,0 +1,114 @@
+//
+// Created by andyroiiid on 1/2/2023.
+//
+
+#include "VoxelMesher.h"
+
+#include <algorithm>
+
+struct VoxelFace {
+    int Axis;
+    int Sign;
+    // chosen so that cross(U, V) points against the normal, the same winding as GenerateBox
+    int UAxis;
+    int VAxis;
+};
+
+static constexpr VoxelFace VoxelFaces[6]{
+        {0, 1,  2, 1},
+        {0, -1, 1, 2},
+        {1, 1,  0, 2},
+        {1, -1, 2, 0},
+        {2, 1,  1, 0},
+        {2, -1, 0, 1},
+};
+
+static void EmitQuad(
+        std::vector<VertexBase> &vertices, std::vector<uint32_t> &indices,
+        const VoxelFace &face, int slice, int u, int v, int width, int height,
+        const glm::vec3 &origin, float voxelSize
+) {
+    glm::vec3 corner{0.0f};
+    corner[face.Axis] = static_cast<float>(face.Sign > 0 ? slice + 1 : slice);
+    corner[face.UAxis] = static_cast<float>(u);
+    corner[face.VAxis] = static_cast<float>(v);
+    glm::vec3 uEdge{0.0f};
+    uEdge[face.UAxis] = static_cast<float>(width);
+    glm::vec3 vEdge{0.0f};
+    vEdge[face.VAxis] = static_cast<float>(height);
+    glm::vec3 normal{0.0f};
+    normal[face.Axis] = static_cast<float>(face.Sign);
+
+    const auto baseVertex = static_cast<uint32_t>(vertices.size());
+    for (uint32_t i = 0; i < 4; i++) {
+        const glm::vec3 position = corner + (i & 1 ? uEdge : glm::vec3{0.0f}) + (i & 2 ? vEdge : glm::vec3{0.0f});
+        const glm::vec2 texCoord{i & 1 ? static_cast<float>(width) : 0.0f, i & 2 ? static_cast<float>(height) : 0.0f};
+        vertices.emplace_back(origin + position * voxelSize, normal, texCoord);
+    }
+    indices.insert(indices.end(), {baseVertex, baseVertex + 1, baseVertex + 2, baseVertex + 2, baseVertex + 1, baseVertex + 3});
+}
+
+VoxelMeshStats MeshVoxelChunk(
+        const uint8_t *paddedVoxels, const glm::vec3 &origin, float voxelSize,
+        std::vector<VertexBase> &vertices, std::vector<uint32_t> &indices
+) {
+    constexpr int size = VoxelChunkSize;
+    constexpr int strides[3]{1, VoxelPaddedChunkSize, VoxelPaddedChunkSize * VoxelPaddedChunkSize};
+    const int firstVoxel = GetPaddedVoxelIndex(0, 0, 0);
+
+    VoxelMeshStats stats;
+    // value of the visible face at (u, v) of the current slice, 0 when there is none
+    uint8_t mask[size * size];
+    for (const VoxelFace &face: VoxelFaces) {
+        const int neighborOffset = face.Sign * strides[face.Axis];
+        for (int slice = 0; slice < size; slice++) {
+            uint32_t numFaces = 0;
+            for (int v = 0; v < size; v++) {
+                const int rowStart = firstVoxel + slice * strides[face.Axis] + v * strides[face.VAxis];
+                for (int u = 0; u < size; u++) {
+                    const int index = rowStart + u * strides[face.UAxis];
+                    const uint8_t value = paddedVoxels[index];
+                    const bool visible = value != 0 && paddedVoxels[index + neighborOffset] == 0;
+                    mask[v * size + u] = visible ? value : 0;
+                    numFaces += visible;
+                }
+            }
+            if (numFaces == 0) {
+                continue;
+            }
+            stats.VisibleFaces += numFaces;
+
+            // grow every unmerged face along u first, then along v while the whole row matches
+            for (int v = 0; v < size; v++) {
+                for (int u = 0; u < size;) {
+                    const uint8_t value = mask[v * size + u];
+                    if (value == 0) {
+                        u++;
+                        continue;
+                    }
+
+                    int width = 1;
+                    while (u + width < size && mask[v * size + u + width] == value) {
+                        width++;
+                    }
+
+                    int height = 1;
+                    for (; v + height < size; height++) {
+                        const uint8_t *row = mask + (v + height) * size + u;
+                        if (!std::all_of(row, row + width, [value](uint8_t other) { return other == value; })) {
+                            break;
+                        }
+                    }
+
+                    for (int i = 0; i < height; i++) {
+                        std::fill_n(mask + (v + i) * size + u, width, 0);
+                    }
+                    EmitQuad(vertices, indices, face, slice, u, v, width, height, origin, voxelSize);
+                    stats.Quads++;
+                    u += width;
+                }
+            }
+        }
+    }
+    return stats;
+}
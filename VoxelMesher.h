@@ -0,0 +1,38 @@
+//
+// Created by andyroiiid on 1/2/2023.
+//
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "VertexBase.h"
+
+// voxels along every edge of a chunk
+static constexpr int VoxelChunkSize = 32;
+// a chunk plus one voxel of each neighbor on every side, so faces on the chunk border can be culled
+static constexpr int VoxelPaddedChunkSize = VoxelChunkSize + 2;
+static constexpr int VoxelPaddedChunkVolume = VoxelPaddedChunkSize * VoxelPaddedChunkSize * VoxelPaddedChunkSize;
+
+// index of (x, y, z) in a padded chunk, every coordinate is in [-1, VoxelChunkSize]
+inline int GetPaddedVoxelIndex(int x, int y, int z) {
+    return ((z + 1) * VoxelPaddedChunkSize + (y + 1)) * VoxelPaddedChunkSize + (x + 1);
+}
+
+struct VoxelMeshStats {
+    // faces between a solid and an empty voxel
+    uint32_t VisibleFaces = 0;
+    // quads after merging
+    uint32_t Quads = 0;
+};
+
+// Meshes one chunk of voxels, 0 is empty and anything else is solid.
+// Faces against solid voxels are dropped and coplanar faces of the same voxel value are merged into rectangles greedily,
+// a solid chunk becomes 12 triangles instead of the 12 per voxel that a box per voxel would give.
+// paddedVoxels holds VoxelPaddedChunkVolume voxels, see GetPaddedVoxelIndex.
+// Vertices are placed at origin + voxelSize * (x, y, z) and texture coordinates count voxels, so textures repeat per voxel.
+VoxelMeshStats MeshVoxelChunk(
+        const uint8_t *paddedVoxels, const glm::vec3 &origin, float voxelSize,
+        std::vector<VertexBase> &vertices, std::vector<uint32_t> &indices
+);
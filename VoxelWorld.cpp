@@ -0,0 +1,306 @@
+//
+// Created by andyroiiid on 1/2/2023.
+//
+
+#include "VoxelWorld.h"
+
+#include <glm/common.hpp>
+
+#include "ThreadPool.h"
+
+// chunk coordinate of a voxel, rounding towards negative infinity
+static glm::ivec3 GetChunkCoord(const glm::ivec3 &position) {
+    return {
+            position.x >= 0 ? position.x / VoxelChunkSize : (position.x + 1) / VoxelChunkSize - 1,
+            position.y >= 0 ? position.y / VoxelChunkSize : (position.y + 1) / VoxelChunkSize - 1,
+            position.z >= 0 ? position.z / VoxelChunkSize : (position.z + 1) / VoxelChunkSize - 1
+    };
+}
+
+static int GetLocalVoxelIndex(int x, int y, int z) {
+    return (z * VoxelChunkSize + y) * VoxelChunkSize + x;
+}
+
+VoxelWorld::VoxelWorld(VulkanBase *device, ThreadPool *threadPool, const glm::vec3 &origin, float voxelSize)
+        : m_device(device),
+          m_threadPool(threadPool),
+          m_origin(origin),
+          m_voxelSize(voxelSize),
+          m_completed(std::make_shared<CompletedMeshes>()) {
+}
+
+void VoxelWorld::Release() {
+    // jobs still in flight only write to m_completed, which they share
+    m_device = nullptr;
+    m_threadPool = nullptr;
+    m_origin = glm::vec3{0.0f};
+    m_voxelSize = 1.0f;
+    m_chunks.clear();
+    m_dirtyChunks.clear();
+    m_numJobsInFlight = 0;
+    m_completed.reset();
+    m_numTriangles = 0;
+    m_numSolidVoxels = 0;
+}
+
+void VoxelWorld::Swap(VoxelWorld &other) noexcept {
+    std::swap(m_device, other.m_device);
+    std::swap(m_threadPool, other.m_threadPool);
+    std::swap(m_origin, other.m_origin);
+    std::swap(m_voxelSize, other.m_voxelSize);
+    std::swap(m_chunks, other.m_chunks);
+    std::swap(m_dirtyChunks, other.m_dirtyChunks);
+    std::swap(m_numJobsInFlight, other.m_numJobsInFlight);
+    std::swap(m_completed, other.m_completed);
+    std::swap(m_numTriangles, other.m_numTriangles);
+    std::swap(m_numSolidVoxels, other.m_numSolidVoxels);
+}
+
+uint64_t VoxelWorld::GetChunkKey(const glm::ivec3 &coord) {
+    // 21 bits per axis
+    constexpr uint64_t mask = (1 << 21) - 1;
+    return (static_cast<uint64_t>(coord.x) & mask) << 42 | (static_cast<uint64_t>(coord.y) & mask) << 21 | (static_cast<uint64_t>(coord.z) & mask);
+}
+
+const VoxelWorld::Chunk *VoxelWorld::FindChunk(const glm::ivec3 &coord) const {
+    const auto it = m_chunks.find(GetChunkKey(coord));
+    return it != m_chunks.end() ? &it->second : nullptr;
+}
+
+VoxelWorld::Chunk &VoxelWorld::GetOrCreateChunk(const glm::ivec3 &coord) {
+    const auto [it, inserted] = m_chunks.try_emplace(GetChunkKey(coord));
+    Chunk &chunk = it->second;
+    if (inserted) {
+        chunk.Coord = coord;
+        chunk.Voxels.resize(VoxelChunkSize * VoxelChunkSize * VoxelChunkSize);
+        // buffers are only created once there is a mesh
+        chunk.Mesh = VulkanDynamicMesh(m_device, sizeof(VertexBase), 0, 0);
+    }
+    return chunk;
+}
+
+uint8_t VoxelWorld::GetVoxel(const glm::ivec3 &position) const {
+    const glm::ivec3 coord = GetChunkCoord(position);
+    const Chunk *chunk = FindChunk(coord);
+    if (chunk == nullptr) {
+        return 0;
+    }
+    const glm::ivec3 local = position - coord * VoxelChunkSize;
+    return chunk->Voxels[GetLocalVoxelIndex(local.x, local.y, local.z)];
+}
+
+bool VoxelWorld::WriteVoxel(const glm::ivec3 &position, uint8_t value) {
+    const glm::ivec3 coord = GetChunkCoord(position);
+    Chunk *chunk;
+    if (value == 0) {
+        // clearing never needs a new chunk
+        const auto it = m_chunks.find(GetChunkKey(coord));
+        if (it == m_chunks.end()) {
+            return false;
+        }
+        chunk = &it->second;
+    } else {
+        chunk = &GetOrCreateChunk(coord);
+    }
+
+    const glm::ivec3 local = position - coord * VoxelChunkSize;
+    uint8_t &voxel = chunk->Voxels[GetLocalVoxelIndex(local.x, local.y, local.z)];
+    if (voxel == value) {
+        return false;
+    }
+    if (voxel == 0) {
+        chunk->NumSolid++;
+        m_numSolidVoxels++;
+    } else if (value == 0) {
+        chunk->NumSolid--;
+        m_numSolidVoxels--;
+    }
+    voxel = value;
+    return true;
+}
+
+void VoxelWorld::SetVoxel(const glm::ivec3 &position, uint8_t value) {
+    if (WriteVoxel(position, value)) {
+        MarkDirty(position, position);
+    }
+}
+
+void VoxelWorld::FillBox(const glm::ivec3 &min, const glm::ivec3 &max, uint8_t value) {
+    bool changed = false;
+    for (int z = min.z; z <= max.z; z++) {
+        for (int y = min.y; y <= max.y; y++) {
+            for (int x = min.x; x <= max.x; x++) {
+                changed |= WriteVoxel({x, y, z}, value);
+            }
+        }
+    }
+    if (changed) {
+        MarkDirty(min, max);
+    }
+}
+
+void VoxelWorld::FillSphere(const glm::vec3 &center, float radius, uint8_t value) {
+    const glm::ivec3 min{glm::floor(center - radius)};
+    const glm::ivec3 max{glm::ceil(center + radius)};
+    bool changed = false;
+    for (int z = min.z; z <= max.z; z++) {
+        for (int y = min.y; y <= max.y; y++) {
+            for (int x = min.x; x <= max.x; x++) {
+                const glm::vec3 offset = glm::vec3{x, y, z} + 0.5f - center;
+                if (glm::dot(offset, offset) <= radius * radius) {
+                    changed |= WriteVoxel({x, y, z}, value);
+                }
+            }
+        }
+    }
+    if (changed) {
+        MarkDirty(min, max);
+    }
+}
+
+void VoxelWorld::Clear() {
+    for (auto &[key, chunk]: m_chunks) {
+        if (chunk.NumSolid == 0) {
+            continue;
+        }
+        std::fill(chunk.Voxels.begin(), chunk.Voxels.end(), 0);
+        m_numSolidVoxels -= chunk.NumSolid;
+        chunk.NumSolid = 0;
+        chunk.Version++;
+        if (!chunk.Queued) {
+            chunk.Queued = true;
+            m_dirtyChunks.push_back(key);
+        }
+    }
+}
+
+void VoxelWorld::MarkDirty(const glm::ivec3 &min, const glm::ivec3 &max) {
+    const glm::ivec3 minCoord = GetChunkCoord(min - 1);
+    const glm::ivec3 maxCoord = GetChunkCoord(max + 1);
+    for (int z = minCoord.z; z <= maxCoord.z; z++) {
+        for (int y = minCoord.y; y <= maxCoord.y; y++) {
+            for (int x = minCoord.x; x <= maxCoord.x; x++) {
+                const uint64_t key = GetChunkKey({x, y, z});
+                const auto it = m_chunks.find(key);
+                if (it == m_chunks.end()) {
+                    continue;
+                }
+                Chunk &chunk = it->second;
+                chunk.Version++;
+                if (!chunk.Queued) {
+                    chunk.Queued = true;
+                    m_dirtyChunks.push_back(key);
+                }
+            }
+        }
+    }
+}
+
+void VoxelWorld::CopyPaddedVoxels(const glm::ivec3 &coord, uint8_t *paddedVoxels) const {
+    // the chunk and its 26 neighbors, index (z * 3 + y) * 3 + x with 1 being this chunk
+    const Chunk *neighbors[27];
+    for (int z = 0; z < 3; z++) {
+        for (int y = 0; y < 3; y++) {
+            for (int x = 0; x < 3; x++) {
+                neighbors[(z * 3 + y) * 3 + x] = FindChunk(coord + glm::ivec3{x - 1, y - 1, z - 1});
+            }
+        }
+    }
+
+    for (int z = -1; z <= VoxelChunkSize; z++) {
+        const int neighborZ = (z + VoxelChunkSize) / VoxelChunkSize;
+        const int localZ = z - (neighborZ - 1) * VoxelChunkSize;
+        for (int y = -1; y <= VoxelChunkSize; y++) {
+            const int neighborY = (y + VoxelChunkSize) / VoxelChunkSize;
+            const int localY = y - (neighborY - 1) * VoxelChunkSize;
+            for (int x = -1; x <= VoxelChunkSize; x++) {
+                const int neighborX = (x + VoxelChunkSize) / VoxelChunkSize;
+                const int localX = x - (neighborX - 1) * VoxelChunkSize;
+                const Chunk *chunk = neighbors[(neighborZ * 3 + neighborY) * 3 + neighborX];
+                paddedVoxels[GetPaddedVoxelIndex(x, y, z)] = chunk != nullptr ? chunk->Voxels[GetLocalVoxelIndex(localX, localY, localZ)] : 0;
+            }
+        }
+    }
+}
+
+void VoxelWorld::StartMeshing(uint64_t key, Chunk &chunk) {
+    // the job works on a snapshot so edits can continue while it runs
+    std::vector<uint8_t> paddedVoxels(VoxelPaddedChunkVolume);
+    CopyPaddedVoxels(chunk.Coord, paddedVoxels.data());
+
+    chunk.Meshing = true;
+    m_numJobsInFlight++;
+    const glm::vec3 origin = m_origin + glm::vec3(chunk.Coord * VoxelChunkSize) * m_voxelSize;
+    m_threadPool->Enqueue([completed = m_completed, key, version = chunk.Version, paddedVoxels = std::move(paddedVoxels), origin, voxelSize = m_voxelSize]() {
+        ChunkMesh mesh{key, version};
+        MeshVoxelChunk(paddedVoxels.data(), origin, voxelSize, mesh.Vertices, mesh.Indices);
+
+        std::lock_guard lock(completed->Mutex);
+        completed->Meshes.push_back(std::move(mesh));
+    });
+}
+
+void VoxelWorld::SetMesh(Chunk &chunk, uint32_t version, const std::vector<VertexBase> &vertices, const std::vector<uint32_t> &indices) {
+    chunk.Mesh.Resize(vertices.size(), indices.size());
+    if (!indices.empty()) {
+        chunk.Mesh.UpdateVertices(0, vertices.size(), vertices.data());
+        chunk.Mesh.UpdateIndices(0, indices.size(), indices.data());
+    }
+    m_numTriangles -= chunk.NumTriangles;
+    chunk.NumTriangles = indices.size() / 3;
+    m_numTriangles += chunk.NumTriangles;
+    chunk.MeshedVersion = version;
+}
+
+void VoxelWorld::Update(uint32_t bufferingIndex) {
+    std::vector<ChunkMesh> meshes;
+    {
+        std::lock_guard lock(m_completed->Mutex);
+        std::swap(meshes, m_completed->Meshes);
+    }
+    for (const ChunkMesh &mesh: meshes) {
+        m_numJobsInFlight--;
+        Chunk &chunk = m_chunks.find(mesh.Key)->second;
+        chunk.Meshing = false;
+        // an outdated mesh is still newer than the current one, the chunk stays queued for the latest version
+        SetMesh(chunk, mesh.Version, mesh.Vertices, mesh.Indices);
+    }
+
+    size_t numQueued = 0;
+    for (const uint64_t key: m_dirtyChunks) {
+        Chunk &chunk = m_chunks.find(key)->second;
+        if (chunk.Meshing) {
+            m_dirtyChunks[numQueued++] = key;
+        } else if (chunk.MeshedVersion == chunk.Version) {
+            chunk.Queued = false;
+        } else if (chunk.NumSolid == 0) {
+            // faces only come from solid voxels of the chunk itself
+            SetMesh(chunk, chunk.Version, {}, {});
+            chunk.Queued = false;
+        } else {
+            if (m_numJobsInFlight < MaxJobsInFlight) {
+                StartMeshing(key, chunk);
+            }
+            m_dirtyChunks[numQueued++] = key;
+        }
+    }
+    m_dirtyChunks.resize(numQueued);
+
+    for (auto &[key, chunk]: m_chunks) {
+        chunk.Mesh.Upload(bufferingIndex);
+    }
+}
+
+void VoxelWorld::Draw(VkCommandBuffer commandBuffer, VkBuffer instanceBuffer, const Frustum &frustum) {
+    const float chunkExtent = VoxelChunkSize * m_voxelSize;
+    for (auto &[key, chunk]: m_chunks) {
+        if (chunk.Mesh.GetIndexCount() == 0) {
+            continue;
+        }
+        const glm::vec3 min = m_origin + glm::vec3(chunk.Coord) * chunkExtent;
+        if (!frustum.IntersectsAabb(min, min + chunkExtent)) {
+            continue;
+        }
+        chunk.Mesh.BindAndDrawInstanced(commandBuffer, instanceBuffer, 1);
+    }
+}
@@ -0,0 +1,148 @@
+//
+// Created by andyroiiid on 1/2/2023.
+//
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <glm/vec3.hpp>
+
+#include "VulkanBase.h"
+#include "VulkanDynamicMesh.h"
+#include "VoxelMesher.h"
+#include "Frustum.h"
+
+class ThreadPool;
+
+// Sparse grid of voxel chunks, every chunk is drawn as one greedy mesh.
+// Edits only bump the version of the chunks they touch, including neighbors whose border faces may change.
+// Update snapshots dirty chunks on the calling thread and remeshes them on the thread pool,
+// finished meshes are picked up by a later Update and streamed into the chunk's VulkanDynamicMesh.
+class VoxelWorld {
+public:
+    // limits the snapshots in memory and the meshes uploaded in one frame
+    static constexpr uint32_t MaxJobsInFlight = 64;
+
+    VoxelWorld() = default;
+
+    // voxel (x, y, z) covers origin + voxelSize * [x, x + 1] and so on, meshes are in world space
+    VoxelWorld(VulkanBase *device, ThreadPool *threadPool, const glm::vec3 &origin, float voxelSize = 1.0f);
+
+    ~VoxelWorld() {
+        Release();
+    }
+
+    VoxelWorld(const VoxelWorld &) = delete;
+
+    VoxelWorld &operator=(const VoxelWorld &) = delete;
+
+    VoxelWorld(VoxelWorld &&other) noexcept {
+        Swap(other);
+    }
+
+    VoxelWorld &operator=(VoxelWorld &&other) noexcept {
+        if (this != &other) {
+            Release();
+            Swap(other);
+        }
+        return *this;
+    }
+
+    void Release();
+
+    void Swap(VoxelWorld &other) noexcept;
+
+    // 0 is empty, voxels outside of every chunk are empty
+    [[nodiscard]] uint8_t GetVoxel(const glm::ivec3 &position) const;
+
+    void SetVoxel(const glm::ivec3 &position, uint8_t value);
+
+    // sets every voxel in [min, max]
+    void FillBox(const glm::ivec3 &min, const glm::ivec3 &max, uint8_t value);
+
+    // sets every voxel whose center is inside the sphere, center and radius are in voxels
+    void FillSphere(const glm::vec3 &center, float radius, uint8_t value);
+
+    // Empties every voxel, chunks keep their GPU buffers because frames in flight may still draw them.
+    void Clear();
+
+    // Collects finished meshes, starts meshing dirty chunks and uploads this buffering slot,
+    // call once per frame after the edits and before Draw.
+    void Update(uint32_t bufferingIndex);
+
+    // instanceBuffer holds one InstanceBase, chunks outside of the frustum are skipped
+    void Draw(VkCommandBuffer commandBuffer, VkBuffer instanceBuffer, const Frustum &frustum);
+
+    [[nodiscard]] size_t GetChunkCount() const { return m_chunks.size(); }
+
+    // chunks whose mesh is older than their voxels
+    [[nodiscard]] size_t GetPendingChunkCount() const { return m_dirtyChunks.size(); }
+
+    [[nodiscard]] uint32_t GetTriangleCount() const { return m_numTriangles; }
+
+    // triangles if every solid voxel was drawn as a box
+    [[nodiscard]] uint64_t GetBoxTriangleCount() const { return m_numSolidVoxels * 12; }
+
+private:
+    struct Chunk {
+        glm::ivec3 Coord;
+        // VoxelChunkSize^3 voxels, x varies fastest
+        std::vector<uint8_t> Voxels;
+        uint32_t NumSolid = 0;
+        // bumped by every edit that can change the mesh, the mesh was built from MeshedVersion
+        uint32_t Version = 1;
+        uint32_t MeshedVersion = 0;
+        // in m_dirtyChunks
+        bool Queued = false;
+        // a job for this chunk is in flight, there is at most one so meshes arrive in version order
+        bool Meshing = false;
+        uint32_t NumTriangles = 0;
+        VulkanDynamicMesh Mesh;
+    };
+
+    struct ChunkMesh {
+        uint64_t Key;
+        uint32_t Version;
+        std::vector<VertexBase> Vertices;
+        std::vector<uint32_t> Indices;
+    };
+
+    // shared with the jobs, so a job may outlive the world
+    struct CompletedMeshes {
+        std::mutex Mutex;
+        std::vector<ChunkMesh> Meshes;
+    };
+
+    static uint64_t GetChunkKey(const glm::ivec3 &coord);
+
+    [[nodiscard]] const Chunk *FindChunk(const glm::ivec3 &coord) const;
+
+    Chunk &GetOrCreateChunk(const glm::ivec3 &coord);
+
+    // returns whether the voxel changed, neighbors are not marked dirty
+    bool WriteVoxel(const glm::ivec3 &position, uint8_t value);
+
+    // bumps the version of every chunk containing a voxel in [min - 1, max + 1]
+    void MarkDirty(const glm::ivec3 &min, const glm::ivec3 &max);
+
+    void CopyPaddedVoxels(const glm::ivec3 &coord, uint8_t *paddedVoxels) const;
+
+    void StartMeshing(uint64_t key, Chunk &chunk);
+
+    void SetMesh(Chunk &chunk, uint32_t version, const std::vector<VertexBase> &vertices, const std::vector<uint32_t> &indices);
+
+    VulkanBase *m_device = nullptr;
+    ThreadPool *m_threadPool = nullptr;
+    glm::vec3 m_origin{0.0f};
+    float m_voxelSize = 1.0f;
+
+    std::unordered_map<uint64_t, Chunk> m_chunks;
+    std::vector<uint64_t> m_dirtyChunks;
+    uint32_t m_numJobsInFlight = 0;
+    std::shared_ptr<CompletedMeshes> m_completed;
+
+    uint32_t m_numTriangles = 0;
+    uint64_t m_numSolidVoxels = 0;
+};
@@ -204,6 +204,33 @@ VulkanBase::~VulkanBase() {
     DestroyFence(m_immediateFence);
 }
 
+VulkanBuffer VulkanBase::CreateBufferWithData(VkDeviceSize size, const void *data, VkBufferUsageFlags bufferUsage) {
+    VulkanBuffer uploadBuffer = CreateBuffer(
+            size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+            VMA_MEMORY_USAGE_AUTO_PREFER_HOST
+    );
+    uploadBuffer.Upload(size, data);
+
+    VulkanBuffer buffer = CreateBuffer(
+            size,
+            bufferUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            0,
+            VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
+    );
+
+    ImmediateSubmit([size, &uploadBuffer, &buffer](VkCommandBuffer cmd) {
+        VkBufferCopy copy{};
+        copy.srcOffset = 0;
+        copy.dstOffset = 0;
+        copy.size = size;
+        vkCmdCopyBuffer(cmd, uploadBuffer.Get(), buffer.Get(), 1, &copy);
+    });
+
+    return buffer;
+}
+
 void VulkanBase::ImGuiInit() {
     ImGui::CreateContext();
     ImGui::GetIO().IniFilename = nullptr;
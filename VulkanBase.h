@@ -58,6 +58,9 @@ public:
         ResetFence(m_immediateFence);
     }
 
+    // creates a device local buffer and uploads data through a staging buffer
+    VulkanBuffer CreateBufferWithData(VkDeviceSize size, const void *data, VkBufferUsageFlags bufferUsage);
+
 private:
     void CreateImmediateContext();
 
@@ -22,10 +22,13 @@ VulkanBuffer::VulkanBuffer(
     allocationCreateInfo.flags = flags;
     allocationCreateInfo.usage = memoryUsage;
 
+    VmaAllocationInfo allocationInfo{};
     DebugCheckCriticalVk(
-            vmaCreateBuffer(m_allocator, &bufferCreateInfo, &allocationCreateInfo, &m_buffer, &m_allocation, nullptr),
+            vmaCreateBuffer(m_allocator, &bufferCreateInfo, &allocationCreateInfo, &m_buffer, &m_allocation, &allocationInfo),
             "Failed to create Vulkan buffer."
     );
+    m_size = size;
+    m_mappedData = allocationInfo.pMappedData;
 }
 
 void VulkanBuffer::Release() {
@@ -34,20 +37,38 @@ void VulkanBuffer::Release() {
     m_allocator = VK_NULL_HANDLE;
     m_buffer = VK_NULL_HANDLE;
     m_allocation = VK_NULL_HANDLE;
+    m_size = 0;
+    m_mappedData = nullptr;
 }
 
 void VulkanBuffer::Swap(VulkanBuffer &other) noexcept {
     std::swap(m_allocator, other.m_allocator);
     std::swap(m_buffer, other.m_buffer);
     std::swap(m_allocation, other.m_allocation);
+    std::swap(m_size, other.m_size);
+    std::swap(m_mappedData, other.m_mappedData);
 }
 
 void VulkanBuffer::Upload(size_t size, const void *data) {
+    if (m_mappedData) {
+        memcpy(m_mappedData, data, size);
+        Flush(0, size);
+        return;
+    }
+
     void *mappedMemory = nullptr;
     DebugCheckCriticalVk(
             vmaMapMemory(m_allocator, m_allocation, &mappedMemory),
             "Failed to map Vulkan memory."
     );
     memcpy(mappedMemory, data, size);
+    Flush(0, size);
     vmaUnmapMemory(m_allocator, m_allocation);
 }
+
+void VulkanBuffer::Flush(VkDeviceSize offset, VkDeviceSize size) {
+    DebugCheckVk(
+            vmaFlushAllocation(m_allocator, m_allocation, offset, size),
+            "Failed to flush Vulkan memory."
+    );
+}
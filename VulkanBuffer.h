@@ -46,11 +46,20 @@ public:
 
     void Upload(size_t size, const void *data);
 
+    void Flush(VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
     [[nodiscard]] const VkBuffer &Get() const { return m_buffer; }
 
+    [[nodiscard]] VkDeviceSize GetSize() const { return m_size; }
+
+    // only non-null for buffers created with VMA_ALLOCATION_CREATE_MAPPED_BIT
+    [[nodiscard]] void *GetMappedData() const { return m_mappedData; }
+
 private:
     VmaAllocator m_allocator = VK_NULL_HANDLE;
 
     VkBuffer m_buffer = VK_NULL_HANDLE;
     VmaAllocation m_allocation = VK_NULL_HANDLE;
+    VkDeviceSize m_size = 0;
+    void *m_mappedData = nullptr;
 };
@@ -0,0 +1,96 @@
+//
+// Created by andyroiiid on 12/25/2022.
+//
+
+#include "VulkanComputePipeline.h"
+
+#include "Debug.h"
+#include "ShaderCompiler.h"
+
+VulkanComputePipeline::VulkanComputePipeline(const VulkanComputePipelineCreateInfo &createInfo)
+        : m_device(createInfo.Device) {
+    CreatePipelineLayout(createInfo);
+    CreateShaderModule(createInfo);
+    CreatePipeline(createInfo);
+}
+
+void VulkanComputePipeline::CreatePipelineLayout(const VulkanComputePipelineCreateInfo &createInfo) {
+    VkPushConstantRange pushConstantRange;
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = createInfo.PushConstantSize;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.setLayoutCount = createInfo.DescriptorSetLayouts.size();
+    pipelineLayoutCreateInfo.pSetLayouts = createInfo.DescriptorSetLayouts.data();
+    if (createInfo.PushConstantSize > 0) {
+        pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+        pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+    }
+    m_pipelineLayout = m_device->CreatePipelineLayout(pipelineLayoutCreateInfo);
+}
+
+void VulkanComputePipeline::CreateShaderModule(const VulkanComputePipelineCreateInfo &createInfo) {
+    std::vector<uint32_t> spirv;
+    DebugCheckCritical(
+            ShaderCompiler::GetInstance().Compile(EShLangCompute, createInfo.Source, spirv),
+            "Failed to compile compute shader."
+    );
+
+    VkShaderModuleCreateInfo shaderModuleCreateInfo{};
+    shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shaderModuleCreateInfo.codeSize = spirv.size() * sizeof(uint32_t);
+    shaderModuleCreateInfo.pCode = spirv.data();
+    m_shaderModule = m_device->CreateShaderModule(shaderModuleCreateInfo);
+}
+
+void VulkanComputePipeline::CreatePipeline(const VulkanComputePipelineCreateInfo &createInfo) {
+    for (int i = 0; i < 3; i++) {
+        m_localSize[i] = createInfo.LocalSize[i];
+    }
+
+    const VkSpecializationMapEntry specializationMapEntries[] = {
+            {0, sizeof(uint32_t) * 0, sizeof(uint32_t)},
+            {1, sizeof(uint32_t) * 1, sizeof(uint32_t)},
+            {2, sizeof(uint32_t) * 2, sizeof(uint32_t)}
+    };
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount = 3;
+    specializationInfo.pMapEntries = specializationMapEntries;
+    specializationInfo.dataSize = sizeof(m_localSize);
+    specializationInfo.pData = m_localSize;
+
+    VkComputePipelineCreateInfo pipelineCreateInfo{};
+    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    VkPipelineShaderStageCreateInfo &stage = pipelineCreateInfo.stage;
+    stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    stage.module = m_shaderModule;
+    stage.pName = "main";
+    stage.pSpecializationInfo = &specializationInfo;
+    pipelineCreateInfo.layout = m_pipelineLayout;
+    m_pipeline = m_device->CreateComputePipeline(pipelineCreateInfo);
+}
+
+void VulkanComputePipeline::Release() {
+    if (m_device) {
+        m_device->DestroyPipeline(m_pipeline);
+        m_device->DestroyShaderModule(m_shaderModule);
+        m_device->DestroyPipelineLayout(m_pipelineLayout);
+    }
+
+    m_device = nullptr;
+    m_pipelineLayout = VK_NULL_HANDLE;
+    m_shaderModule = VK_NULL_HANDLE;
+    m_pipeline = VK_NULL_HANDLE;
+    m_localSize[0] = m_localSize[1] = m_localSize[2] = 1;
+}
+
+void VulkanComputePipeline::Swap(VulkanComputePipeline &other) noexcept {
+    std::swap(m_device, other.m_device);
+    std::swap(m_pipelineLayout, other.m_pipelineLayout);
+    std::swap(m_shaderModule, other.m_shaderModule);
+    std::swap(m_pipeline, other.m_pipeline);
+    std::swap(m_localSize, other.m_localSize);
+}
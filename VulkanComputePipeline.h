@@ -0,0 +1,101 @@
+//
+// Created by andyroiiid on 12/25/2022.
+//
+
+#pragma once
+
+#include "VulkanBase.h"
+
+struct VulkanComputePipelineCreateInfo {
+    VulkanBase *Device = nullptr;
+
+    std::vector<VkDescriptorSetLayout> DescriptorSetLayouts;
+    uint32_t PushConstantSize = 0;
+
+    // the shader should declare "layout (local_size_x_id = 0, local_size_y_id = 1, local_size_z_id = 2) in;"
+    // so that its local size is specialized from LocalSize below
+    const char *Source = nullptr;
+    uint32_t LocalSize[3] = {64, 1, 1};
+};
+
+// number of workgroups needed to cover problemSize invocations
+static inline uint32_t CalcWorkgroupCount(uint32_t problemSize, uint32_t localSize) {
+    return (problemSize + localSize - 1) / localSize;
+}
+
+class VulkanComputePipeline {
+public:
+    VulkanComputePipeline() = default;
+
+    explicit VulkanComputePipeline(const VulkanComputePipelineCreateInfo &createInfo);
+
+    ~VulkanComputePipeline() {
+        Release();
+    }
+
+    VulkanComputePipeline(const VulkanComputePipeline &) = delete;
+
+    VulkanComputePipeline &operator=(const VulkanComputePipeline &) = delete;
+
+    VulkanComputePipeline(VulkanComputePipeline &&other) noexcept {
+        Swap(other);
+    }
+
+    VulkanComputePipeline &operator=(VulkanComputePipeline &&other) noexcept {
+        if (this != &other) {
+            Release();
+            Swap(other);
+        }
+        return *this;
+    }
+
+    void Release();
+
+    void Swap(VulkanComputePipeline &other) noexcept;
+
+    void Bind(VkCommandBuffer commandBuffer) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    }
+
+    void BindDescriptorSet(VkCommandBuffer commandBuffer, VkDescriptorSet descriptorSet, uint32_t setIndex) {
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, setIndex, 1, &descriptorSet, 0, nullptr);
+    }
+
+    template<class T>
+    void PushConstants(VkCommandBuffer commandBuffer, const T &constantsData) {
+        vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(T), &constantsData);
+    }
+
+    void Dispatch(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY = 1, uint32_t groupCountZ = 1) {
+        vkCmdDispatch(commandBuffer, groupCountX, groupCountY, groupCountZ);
+    }
+
+    // dispatches enough workgroups to cover the problem size, the shader must discard out of range invocations
+    void DispatchForSize(VkCommandBuffer commandBuffer, uint32_t sizeX, uint32_t sizeY = 1, uint32_t sizeZ = 1) {
+        Dispatch(
+                commandBuffer,
+                CalcWorkgroupCount(sizeX, m_localSize[0]),
+                CalcWorkgroupCount(sizeY, m_localSize[1]),
+                CalcWorkgroupCount(sizeZ, m_localSize[2])
+        );
+    }
+
+    void DispatchIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset) {
+        vkCmdDispatchIndirect(commandBuffer, buffer, offset);
+    }
+
+private:
+    void CreatePipelineLayout(const VulkanComputePipelineCreateInfo &createInfo);
+
+    void CreateShaderModule(const VulkanComputePipelineCreateInfo &createInfo);
+
+    void CreatePipeline(const VulkanComputePipelineCreateInfo &createInfo);
+
+    VulkanBase *m_device = nullptr;
+
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkShaderModule m_shaderModule = VK_NULL_HANDLE;
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+
+    uint32_t m_localSize[3] = {1, 1, 1};
+};
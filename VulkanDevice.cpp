@@ -5,6 +5,7 @@
 #include "VulkanDevice.h"
 
 #include <set>
+#include <cstring>
 #include <algorithm>
 
 #include "Debug.h"
@@ -18,6 +19,7 @@ VulkanDevice::VulkanDevice(GLFWwindow *window) {
     CreateDevice();
     CreateAllocator();
     CreateDescriptorPool();
+    CreateSamplerDescriptorSetLayout();
 }
 
 static std::vector<const char *> GetEnabledInstanceLayers() {
@@ -233,6 +235,7 @@ void VulkanDevice::SelectPhysicalDeviceAndQueueFamilyIndices() {
                 presentQueueFamilyIndex
         );
         m_physicalDevice = device;
+        m_physicalDeviceProperties = deviceProperties;
         m_graphicsQueueFamilyIndex = graphicsQueueFamilyIndex;
         m_presentQueueFamilyIndex = presentQueueFamilyIndex;
         m_surfaceFormat = PickSurfaceFormat(surfaceFormats);
@@ -245,10 +248,28 @@ void VulkanDevice::SelectPhysicalDeviceAndQueueFamilyIndices() {
     );
 }
 
-static std::vector<const char *> GetEnabledDeviceExtensions() {
-    return {
+static bool IsDeviceExtensionSupported(VkPhysicalDevice physicalDevice, const char *extensionName) {
+    uint32_t numExtensions = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &numExtensions, nullptr);
+    std::vector<VkExtensionProperties> extensions(numExtensions);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &numExtensions, extensions.data());
+    for (const VkExtensionProperties &extension: extensions) {
+        if (strcmp(extension.extensionName, extensionName) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static std::vector<const char *> GetEnabledDeviceExtensions(bool memoryBudget) {
+    std::vector<const char *> extensions{
             VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
+    // lets VMA report the budget of the driver instead of estimating it from the heap sizes
+    if (memoryBudget) {
+        extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+    return extensions;
 }
 
 void VulkanDevice::CreateDevice() {
@@ -264,23 +285,66 @@ void VulkanDevice::CreateDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
-    VkPhysicalDeviceFeatures deviceFeatures{};
-    deviceFeatures.fillModeNonSolid = VK_TRUE;
+    // Vulkan 1.2 features can only be queried and enabled on devices that report 1.2
+    const bool vulkan12 = m_physicalDeviceProperties.apiVersion >= VK_API_VERSION_1_2;
+
+    VkPhysicalDeviceVulkan12Features supportedVulkan12Features{};
+    supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 supportedFeatures{};
+    supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedFeatures.pNext = vulkan12 ? &supportedVulkan12Features : nullptr;
+    vkGetPhysicalDeviceFeatures2(m_physicalDevice, &supportedFeatures);
+
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.drawIndirectCount = supportedVulkan12Features.drawIndirectCount;
+
+    VkPhysicalDeviceFeatures2 deviceFeatures{};
+    deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    deviceFeatures.pNext = vulkan12 ? &vulkan12Features : nullptr;
+    deviceFeatures.features.fillModeNonSolid = VK_TRUE;
+    deviceFeatures.features.multiDrawIndirect = supportedFeatures.features.multiDrawIndirect;
+    deviceFeatures.features.drawIndirectFirstInstance = supportedFeatures.features.drawIndirectFirstInstance;
+    deviceFeatures.features.samplerAnisotropy = supportedFeatures.features.samplerAnisotropy;
+    deviceFeatures.features.imageCubeArray = supportedFeatures.features.imageCubeArray;
+    deviceFeatures.features.textureCompressionBC = supportedFeatures.features.textureCompressionBC;
+    deviceFeatures.features.textureCompressionETC2 = supportedFeatures.features.textureCompressionETC2;
+    deviceFeatures.features.textureCompressionASTC_LDR = supportedFeatures.features.textureCompressionASTC_LDR;
 
     VkDeviceCreateInfo deviceCreateInfo{};
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceCreateInfo.pNext = &deviceFeatures;
     deviceCreateInfo.queueCreateInfoCount = queueCreateInfos.size();
     deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
-    std::vector<const char *> enabledExtensions = GetEnabledDeviceExtensions();
+    m_memoryBudgetEnabled = IsDeviceExtensionSupported(m_physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    std::vector<const char *> enabledExtensions = GetEnabledDeviceExtensions(m_memoryBudgetEnabled);
     deviceCreateInfo.enabledExtensionCount = enabledExtensions.size();
     deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions.data();
-    deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
 
     DebugCheckCriticalVk(
             vkCreateDevice(m_physicalDevice, &deviceCreateInfo, nullptr, &m_device),
             "Failed to create Vulkan logical device."
     );
 
+    m_enabledFeatures = deviceFeatures.features;
+    m_enabledVulkan12Features = vulkan12Features;
+    m_enabledVulkan12Features.pNext = nullptr;
+    DebugInfo(
+            "multiDrawIndirect = {}, drawIndirectFirstInstance = {}, drawIndirectCount = {}, samplerAnisotropy = {}, imageCubeArray = {}",
+            m_enabledFeatures.multiDrawIndirect,
+            m_enabledFeatures.drawIndirectFirstInstance,
+            m_enabledVulkan12Features.drawIndirectCount,
+            m_enabledFeatures.samplerAnisotropy,
+            m_enabledFeatures.imageCubeArray
+    );
+    DebugInfo(
+            "textureCompressionBC = {}, textureCompressionETC2 = {}, textureCompressionASTC_LDR = {}",
+            m_enabledFeatures.textureCompressionBC,
+            m_enabledFeatures.textureCompressionETC2,
+            m_enabledFeatures.textureCompressionASTC_LDR
+    );
+    DebugInfo("memoryBudget = {}", m_memoryBudgetEnabled);
+
     vkGetDeviceQueue(m_device, m_graphicsQueueFamilyIndex, 0, &m_graphicsQueue);
     vkGetDeviceQueue(m_device, m_presentQueueFamilyIndex, 0, &m_presentQueue);
 }
@@ -291,6 +355,9 @@ void VulkanDevice::CreateAllocator() {
     createInfo.device = m_device;
     createInfo.instance = m_instance;
     createInfo.vulkanApiVersion = VK_API_VERSION_1_3;
+    if (m_memoryBudgetEnabled) {
+        createInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    }
     DebugCheckCriticalVk(
             vmaCreateAllocator(&createInfo, &m_allocator),
             "Failed to create Vulkan Memory Allocator."
@@ -325,9 +392,27 @@ void VulkanDevice::CreateDescriptorPool() {
     );
 }
 
+void VulkanDevice::CreateSamplerDescriptorSetLayout() {
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_ALL;
+
+    VkDescriptorSetLayoutCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    createInfo.bindingCount = 1;
+    createInfo.pBindings = &binding;
+    m_samplerDescriptorSetLayout = CreateDescriptorSetLayout(createInfo);
+}
+
 VulkanDevice::~VulkanDevice() {
     WaitIdle();
 
+    for (const auto &[hash, cachedSampler]: m_samplers) {
+        vkDestroySampler(m_device, cachedSampler.Sampler, nullptr);
+    }
+    vkDestroyDescriptorSetLayout(m_device, m_samplerDescriptorSetLayout, nullptr);
     vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
     vmaDestroyAllocator(m_allocator);
     vkDestroyDevice(m_device, nullptr);
@@ -445,6 +530,15 @@ VkPipeline VulkanDevice::CreateGraphicsPipeline(const VkGraphicsPipelineCreateIn
     return pipeline;
 }
 
+VkPipeline VulkanDevice::CreateComputePipeline(const VkComputePipelineCreateInfo &createInfo) {
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    DebugCheckCriticalVk(
+            vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &createInfo, nullptr, &pipeline),
+            "Failed to create Vulkan compute pipeline."
+    );
+    return pipeline;
+}
+
 VkImageView VulkanDevice::CreateImageView(const VkImageViewCreateInfo &createInfo) {
     VkImageView imageView = VK_NULL_HANDLE;
     DebugCheckCriticalVk(
@@ -463,11 +557,20 @@ VkDescriptorSetLayout VulkanDevice::CreateDescriptorSetLayout(const VkDescriptor
     return descriptorSetLayout;
 }
 
-VkDescriptorSet VulkanDevice::AllocateDescriptorSet(VkDescriptorSetLayout descriptorSetLayout) {
+VkDescriptorPool VulkanDevice::CreateDescriptorPool(const VkDescriptorPoolCreateInfo &createInfo) {
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    DebugCheckCriticalVk(
+            vkCreateDescriptorPool(m_device, &createInfo, nullptr, &descriptorPool),
+            "Failed to create Vulkan descriptor pool."
+    );
+    return descriptorPool;
+}
+
+VkDescriptorSet VulkanDevice::AllocateDescriptorSet(VkDescriptorSetLayout descriptorSetLayout, VkDescriptorPool descriptorPool) {
     VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
     VkDescriptorSetAllocateInfo allocateInfo{};
     allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocateInfo.descriptorPool = m_descriptorPool;
+    allocateInfo.descriptorPool = descriptorPool != VK_NULL_HANDLE ? descriptorPool : m_descriptorPool;
     allocateInfo.descriptorSetCount = 1;
     allocateInfo.pSetLayouts = &descriptorSetLayout;
     DebugCheckCriticalVk(
@@ -477,13 +580,29 @@ VkDescriptorSet VulkanDevice::AllocateDescriptorSet(VkDescriptorSetLayout descri
     return descriptorSet;
 }
 
-void VulkanDevice::FreeDescriptorSet(VkDescriptorSet descriptorSet) {
+void VulkanDevice::FreeDescriptorSet(VkDescriptorSet descriptorSet, VkDescriptorPool descriptorPool) {
     DebugCheckCriticalVk(
-            vkFreeDescriptorSets(m_device, m_descriptorPool, 1, &descriptorSet),
+            vkFreeDescriptorSets(m_device, descriptorPool != VK_NULL_HANDLE ? descriptorPool : m_descriptorPool, 1, &descriptorSet),
             "Failed to free Vulkan descriptor set."
     );
 }
 
+void VulkanDevice::GetDeviceLocalMemoryBudget(VkDeviceSize &usage, VkDeviceSize &budget) const {
+    const VkPhysicalDeviceMemoryProperties *memoryProperties = nullptr;
+    vmaGetMemoryProperties(m_allocator, &memoryProperties);
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetHeapBudgets(m_allocator, budgets);
+
+    usage = 0;
+    budget = 0;
+    for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; i++) {
+        if (memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            usage += budgets[i].usage;
+            budget += budgets[i].budget;
+        }
+    }
+}
+
 VkSampler VulkanDevice::CreateSampler(const VkSamplerCreateInfo &createInfo) {
     VkSampler sampler = VK_NULL_HANDLE;
     DebugCheckCriticalVk(
@@ -493,6 +612,123 @@ VkSampler VulkanDevice::CreateSampler(const VkSamplerCreateInfo &createInfo) {
     return sampler;
 }
 
+// every member but sType and pNext, struct padding is never read
+static uint64_t HashSamplerCreateInfo(const VkSamplerCreateInfo &createInfo) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    auto add = [&hash](const auto &member) {
+        const auto *bytes = reinterpret_cast<const uint8_t *>(&member);
+        for (size_t i = 0; i < sizeof(member); i++) {
+            hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+        }
+    };
+    add(createInfo.flags);
+    add(createInfo.magFilter);
+    add(createInfo.minFilter);
+    add(createInfo.mipmapMode);
+    add(createInfo.addressModeU);
+    add(createInfo.addressModeV);
+    add(createInfo.addressModeW);
+    add(createInfo.mipLodBias);
+    add(createInfo.anisotropyEnable);
+    add(createInfo.maxAnisotropy);
+    add(createInfo.compareEnable);
+    add(createInfo.compareOp);
+    add(createInfo.minLod);
+    add(createInfo.maxLod);
+    add(createInfo.borderColor);
+    add(createInfo.unnormalizedCoordinates);
+    return hash;
+}
+
+static bool IsSamplerCreateInfoEqual(const VkSamplerCreateInfo &a, const VkSamplerCreateInfo &b) {
+    return a.flags == b.flags &&
+           a.magFilter == b.magFilter &&
+           a.minFilter == b.minFilter &&
+           a.mipmapMode == b.mipmapMode &&
+           a.addressModeU == b.addressModeU &&
+           a.addressModeV == b.addressModeV &&
+           a.addressModeW == b.addressModeW &&
+           a.mipLodBias == b.mipLodBias &&
+           a.anisotropyEnable == b.anisotropyEnable &&
+           a.maxAnisotropy == b.maxAnisotropy &&
+           a.compareEnable == b.compareEnable &&
+           a.compareOp == b.compareOp &&
+           a.minLod == b.minLod &&
+           a.maxLod == b.maxLod &&
+           a.borderColor == b.borderColor &&
+           a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+}
+
+VkSampler VulkanDevice::GetSampler(const VkSamplerCreateInfo &createInfo) {
+    return FindOrCreateSampler(createInfo).Sampler;
+}
+
+VkDescriptorSet VulkanDevice::GetSamplerDescriptorSet(const VkSamplerCreateInfo &createInfo) {
+    return FindOrCreateSampler(createInfo).DescriptorSet;
+}
+
+VulkanDevice::CachedSampler &VulkanDevice::FindOrCreateSampler(const VkSamplerCreateInfo &createInfo) {
+    DebugCheckCritical(createInfo.pNext == nullptr, "Cached samplers can't have a pNext chain.");
+
+    const uint64_t hash = HashSamplerCreateInfo(createInfo);
+    auto [begin, end] = m_samplers.equal_range(hash);
+    for (auto pair = begin; pair != end; ++pair) {
+        if (IsSamplerCreateInfoEqual(pair->second.CreateInfo, createInfo)) {
+            return pair->second;
+        }
+    }
+
+    DebugCheckCritical(
+            m_samplers.size() < m_physicalDeviceProperties.limits.maxSamplerAllocationCount,
+            "Too many samplers, the device allows {}.",
+            m_physicalDeviceProperties.limits.maxSamplerAllocationCount
+    );
+    CachedSampler &cachedSampler = m_samplers.emplace(hash, CachedSampler{createInfo, CreateSampler(createInfo)})->second;
+    DebugVerbose("Created sampler {} of {}.", m_samplers.size(), m_physicalDeviceProperties.limits.maxSamplerAllocationCount);
+
+    // the set is never rewritten, so images can be swapped under it without touching the sampler
+    cachedSampler.DescriptorSet = AllocateDescriptorSet(m_samplerDescriptorSetLayout);
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.sampler = cachedSampler.Sampler;
+
+    VkWriteDescriptorSet writeDescriptorSet{};
+    writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeDescriptorSet.dstSet = cachedSampler.DescriptorSet;
+    writeDescriptorSet.dstBinding = 0;
+    writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+    writeDescriptorSet.descriptorCount = 1;
+    writeDescriptorSet.pImageInfo = &imageInfo;
+    WriteDescriptorSet(writeDescriptorSet);
+
+    return cachedSampler;
+}
+
+void VulkanDevice::CmdDrawIndexedIndirect(
+        VkCommandBuffer commandBuffer,
+        VkBuffer buffer,
+        VkDeviceSize offset,
+        uint32_t maxDrawCount,
+        VkBuffer countBuffer,
+        VkDeviceSize countOffset
+) {
+    constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+    if (countBuffer != VK_NULL_HANDLE && m_enabledVulkan12Features.drawIndirectCount) {
+        vkCmdDrawIndexedIndirectCount(commandBuffer, buffer, offset, countBuffer, countOffset, maxDrawCount, stride);
+        return;
+    }
+
+    // maxDrawIndirectCount is 1 when multiDrawIndirect is not enabled
+    const uint32_t maxDrawsPerCall = m_enabledFeatures.multiDrawIndirect ? m_physicalDeviceProperties.limits.maxDrawIndirectCount : 1;
+    while (maxDrawCount > 0) {
+        const uint32_t drawCount = std::min(maxDrawCount, maxDrawsPerCall);
+        vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset, drawCount, stride);
+        offset += drawCount * stride;
+        maxDrawCount -= drawCount;
+    }
+}
+
 void VulkanDevice::WaitIdle() {
     DebugCheckCriticalVk(
             vkDeviceWaitIdle(m_device),
@@ -538,3 +774,77 @@ void ResetCommandBuffer(VkCommandBuffer commandBuffer, VkCommandBufferResetFlags
             "Failed to reset Vulkan command buffer."
     );
 }
+
+void CmdBufferBarrier(
+        VkCommandBuffer commandBuffer,
+        VkBuffer buffer,
+        VkPipelineStageFlags srcStageMask,
+        VkAccessFlags srcAccessMask,
+        VkPipelineStageFlags dstStageMask,
+        VkAccessFlags dstAccessMask,
+        VkDeviceSize offset,
+        VkDeviceSize size
+) {
+    VkBufferMemoryBarrier bufferMemoryBarrier{};
+    bufferMemoryBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferMemoryBarrier.srcAccessMask = srcAccessMask;
+    bufferMemoryBarrier.dstAccessMask = dstAccessMask;
+    bufferMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferMemoryBarrier.buffer = buffer;
+    bufferMemoryBarrier.offset = offset;
+    bufferMemoryBarrier.size = size;
+    vkCmdPipelineBarrier(
+            commandBuffer,
+            srcStageMask,
+            dstStageMask,
+            0,
+            0,
+            nullptr,
+            1,
+            &bufferMemoryBarrier,
+            0,
+            nullptr
+    );
+}
+
+void CmdImageBarrier(
+        VkCommandBuffer commandBuffer,
+        VkImage image,
+        VkImageLayout oldLayout,
+        VkImageLayout newLayout,
+        VkPipelineStageFlags srcStageMask,
+        VkAccessFlags srcAccessMask,
+        VkPipelineStageFlags dstStageMask,
+        VkAccessFlags dstAccessMask,
+        uint32_t baseMipLevel,
+        uint32_t levelCount
+) {
+    VkImageMemoryBarrier imageMemoryBarrier{};
+    imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageMemoryBarrier.srcAccessMask = srcAccessMask;
+    imageMemoryBarrier.dstAccessMask = dstAccessMask;
+    imageMemoryBarrier.oldLayout = oldLayout;
+    imageMemoryBarrier.newLayout = newLayout;
+    imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageMemoryBarrier.image = image;
+    VkImageSubresourceRange &subresourceRange = imageMemoryBarrier.subresourceRange;
+    subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    subresourceRange.baseMipLevel = baseMipLevel;
+    subresourceRange.levelCount = levelCount;
+    subresourceRange.baseArrayLayer = 0;
+    subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+    vkCmdPipelineBarrier(
+            commandBuffer,
+            srcStageMask,
+            dstStageMask,
+            0,
+            0,
+            nullptr,
+            0,
+            nullptr,
+            1,
+            &imageMemoryBarrier
+    );
+}
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <vector>
+#include <unordered_map>
 #include <GLFW/glfw3.h>
 #include <vk_mem_alloc.h>
 
@@ -27,6 +28,12 @@ public:
 
     [[nodiscard]] const VkSurfaceFormatKHR &GetSurfaceFormat() const { return m_surfaceFormat; }
 
+    [[nodiscard]] const VkPhysicalDeviceProperties &GetPhysicalDeviceProperties() const { return m_physicalDeviceProperties; }
+
+    [[nodiscard]] const VkPhysicalDeviceFeatures &GetEnabledFeatures() const { return m_enabledFeatures; }
+
+    [[nodiscard]] const VkPhysicalDeviceVulkan12Features &GetEnabledVulkan12Features() const { return m_enabledVulkan12Features; }
+
     VkFence CreateFence(VkFenceCreateFlags flags = 0);
 
     void DestroyFence(VkFence fence) {
@@ -81,6 +88,8 @@ public:
 
     VkPipeline CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo &createInfo);
 
+    VkPipeline CreateComputePipeline(const VkComputePipelineCreateInfo &createInfo);
+
     void DestroyPipeline(VkPipeline pipeline) {
         vkDestroyPipeline(m_device, pipeline, nullptr);
     }
@@ -99,11 +108,36 @@ public:
             const VkExtent2D &extent,
             VkImageUsageFlags imageUsage,
             VmaAllocationCreateFlags flags,
-            VmaMemoryUsage memoryUsage
+            VmaMemoryUsage memoryUsage,
+            uint32_t mipLevels = 1
+    ) {
+        return {m_allocator, format, extent, imageUsage, flags, memoryUsage, mipLevels};
+    }
+
+    VulkanImage CreateImage(
+            VkImageType imageType,
+            VkFormat format,
+            const VkExtent3D &extent,
+            VkImageUsageFlags imageUsage,
+            VmaAllocationCreateFlags flags,
+            VmaMemoryUsage memoryUsage,
+            uint32_t mipLevels = 1,
+            uint32_t arrayLayers = 1,
+            VkImageCreateFlags createFlags = 0
     ) {
-        return {m_allocator, format, extent, imageUsage, flags, memoryUsage};
+        return {m_allocator, imageType, format, extent, imageUsage, flags, memoryUsage, mipLevels, arrayLayers, createFlags};
     }
 
+    [[nodiscard]] VkFormatProperties GetFormatProperties(VkFormat format) const {
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &formatProperties);
+        return formatProperties;
+    }
+
+    // Bytes VMA has allocated and the budget it reports, summed over the device local heaps.
+    // With VK_EXT_memory_budget they come from the driver and include other processes, otherwise VMA estimates them.
+    void GetDeviceLocalMemoryBudget(VkDeviceSize &usage, VkDeviceSize &budget) const;
+
     VkImageView CreateImageView(const VkImageViewCreateInfo &createInfo);
 
     void DestroyImageView(VkImageView imageView) {
@@ -116,9 +150,18 @@ public:
         vkDestroyDescriptorSetLayout(m_device, descriptorSetLayout, nullptr);
     }
 
-    VkDescriptorSet AllocateDescriptorSet(VkDescriptorSetLayout descriptorSetLayout);
+    // for sets that would crowd out the shared pool, createInfo.flags should have VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
+    VkDescriptorPool CreateDescriptorPool(const VkDescriptorPoolCreateInfo &createInfo);
 
-    void FreeDescriptorSet(VkDescriptorSet descriptorSet);
+    void DestroyDescriptorPool(VkDescriptorPool descriptorPool) {
+        vkDestroyDescriptorPool(m_device, descriptorPool, nullptr);
+    }
+
+    // from the shared pool when descriptorPool is VK_NULL_HANDLE
+    VkDescriptorSet AllocateDescriptorSet(VkDescriptorSetLayout descriptorSetLayout, VkDescriptorPool descriptorPool = VK_NULL_HANDLE);
+
+    // descriptorPool is the one the set was allocated from
+    void FreeDescriptorSet(VkDescriptorSet descriptorSet, VkDescriptorPool descriptorPool = VK_NULL_HANDLE);
 
     void WriteDescriptorSet(const VkWriteDescriptorSet &writeDescriptorSet) {
         vkUpdateDescriptorSets(m_device, 1, &writeDescriptorSet, 0, nullptr);
@@ -130,6 +173,30 @@ public:
         vkDestroySampler(m_device, sampler, nullptr);
     }
 
+    // Every call with the same state returns the same sampler, devices only allow maxSamplerAllocationCount of them.
+    // The sampler lives as long as the device and must not be destroyed, createInfo.pNext must be nullptr.
+    VkSampler GetSampler(const VkSamplerCreateInfo &createInfo);
+
+    // A set of GetSamplerDescriptorSetLayout() holding the sampler GetSampler returns for the same state,
+    // written once and shared by every image sampled with it.
+    VkDescriptorSet GetSamplerDescriptorSet(const VkSamplerCreateInfo &createInfo);
+
+    // binding 0 is a VK_DESCRIPTOR_TYPE_SAMPLER visible to all stages
+    [[nodiscard]] VkDescriptorSetLayout GetSamplerDescriptorSetLayout() const { return m_samplerDescriptorSetLayout; }
+
+    [[nodiscard]] size_t GetSamplerCount() const { return m_samplers.size(); }
+
+    // picks vkCmdDrawIndexedIndirectCount / multi-draw / one-by-one depending on enabled features,
+    // without drawIndirectCount the commands past the GPU count must have instanceCount = 0
+    void CmdDrawIndexedIndirect(
+            VkCommandBuffer commandBuffer,
+            VkBuffer buffer,
+            VkDeviceSize offset,
+            uint32_t maxDrawCount,
+            VkBuffer countBuffer = VK_NULL_HANDLE,
+            VkDeviceSize countOffset = 0
+    );
+
     void WaitIdle();
 
     void SubmitToGraphicsQueue(const VkSubmitInfo &submitInfo, VkFence fence);
@@ -151,6 +218,8 @@ protected:
 
     void CreateDescriptorPool();
 
+    void CreateSamplerDescriptorSetLayout();
+
     GLFWwindow *m_window = nullptr;
 
     VkInstance m_instance = VK_NULL_HANDLE;
@@ -159,10 +228,15 @@ protected:
     VkSurfaceKHR m_surface = VK_NULL_HANDLE;
 
     VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties m_physicalDeviceProperties{};
     uint32_t m_graphicsQueueFamilyIndex = 0;
     uint32_t m_presentQueueFamilyIndex = 0;
     VkSurfaceFormatKHR m_surfaceFormat{};
     VkPresentModeKHR m_presentMode{};
+    VkPhysicalDeviceFeatures m_enabledFeatures{};
+    VkPhysicalDeviceVulkan12Features m_enabledVulkan12Features{};
+    // VK_EXT_memory_budget
+    bool m_memoryBudgetEnabled = false;
     VkDevice m_device = VK_NULL_HANDLE;
     VkQueue m_graphicsQueue = VK_NULL_HANDLE;
     VkQueue m_presentQueue = VK_NULL_HANDLE;
@@ -170,6 +244,19 @@ protected:
     VmaAllocator m_allocator = VK_NULL_HANDLE;
 
     VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+
+    VkDescriptorSetLayout m_samplerDescriptorSetLayout = VK_NULL_HANDLE;
+
+    struct CachedSampler {
+        VkSamplerCreateInfo CreateInfo{};
+        VkSampler Sampler = VK_NULL_HANDLE;
+        VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+    };
+
+    CachedSampler &FindOrCreateSampler(const VkSamplerCreateInfo &createInfo);
+
+    // keyed by the hash of the create info, equal hashes are told apart by comparing it
+    std::unordered_multimap<uint64_t, CachedSampler> m_samplers;
 };
 
 void BeginCommandBuffer(VkCommandBuffer commandBuffer, VkCommandBufferUsageFlags flags = 0);
@@ -177,3 +264,28 @@ void BeginCommandBuffer(VkCommandBuffer commandBuffer, VkCommandBufferUsageFlags
 void EndCommandBuffer(VkCommandBuffer commandBuffer);
 
 void ResetCommandBuffer(VkCommandBuffer commandBuffer, VkCommandBufferResetFlags flags = 0);
+
+void CmdBufferBarrier(
+        VkCommandBuffer commandBuffer,
+        VkBuffer buffer,
+        VkPipelineStageFlags srcStageMask,
+        VkAccessFlags srcAccessMask,
+        VkPipelineStageFlags dstStageMask,
+        VkAccessFlags dstAccessMask,
+        VkDeviceSize offset = 0,
+        VkDeviceSize size = VK_WHOLE_SIZE
+);
+
+// layout transition of the color mips [baseMipLevel, baseMipLevel + levelCount) of every layer of an image
+void CmdImageBarrier(
+        VkCommandBuffer commandBuffer,
+        VkImage image,
+        VkImageLayout oldLayout,
+        VkImageLayout newLayout,
+        VkPipelineStageFlags srcStageMask,
+        VkAccessFlags srcAccessMask,
+        VkPipelineStageFlags dstStageMask,
+        VkAccessFlags dstAccessMask,
+        uint32_t baseMipLevel = 0,
+        uint32_t levelCount = VK_REMAINING_MIP_LEVELS
+);
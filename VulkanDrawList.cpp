@@ -0,0 +1,111 @@
+//
+// Created by andyroiiid on 12/24/2022.
+//
+
+#include "VulkanDrawList.h"
+
+#include "Debug.h"
+
+// each indirect buffer holds maxDrawsPerFrame commands followed by one draw count per batch
+static VkDeviceSize GetCountsOffset(uint32_t maxDrawsPerFrame) {
+    return maxDrawsPerFrame * sizeof(VkDrawIndexedIndirectCommand);
+}
+
+VulkanDrawList::VulkanDrawList(VulkanBase *device, uint32_t maxDrawsPerFrame)
+        : m_device(device),
+          m_maxDrawsPerFrame(maxDrawsPerFrame) {
+    const VkDeviceSize size = GetCountsOffset(maxDrawsPerFrame) + maxDrawsPerFrame * sizeof(uint32_t);
+    m_indirectBuffers.reserve(m_device->GetNumBuffering());
+    for (size_t i = 0; i < m_device->GetNumBuffering(); i++) {
+        m_indirectBuffers.push_back(m_device->CreateBuffer(
+                size,
+                VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+                VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
+        ));
+    }
+    m_pendingDraws.reserve(maxDrawsPerFrame);
+}
+
+void VulkanDrawList::Release() {
+    m_device = nullptr;
+    m_maxDrawsPerFrame = 0;
+    m_indirectBuffers.clear();
+    m_currentBuffer = nullptr;
+    m_submittedDraws = 0;
+    m_submittedBatches = 0;
+    m_pendingDraws.clear();
+}
+
+void VulkanDrawList::Swap(VulkanDrawList &other) noexcept {
+    std::swap(m_device, other.m_device);
+    std::swap(m_maxDrawsPerFrame, other.m_maxDrawsPerFrame);
+    std::swap(m_indirectBuffers, other.m_indirectBuffers);
+    std::swap(m_currentBuffer, other.m_currentBuffer);
+    std::swap(m_submittedDraws, other.m_submittedDraws);
+    std::swap(m_submittedBatches, other.m_submittedBatches);
+    std::swap(m_pendingDraws, other.m_pendingDraws);
+}
+
+void VulkanDrawList::Begin(uint32_t bufferingIndex) {
+    m_currentBuffer = &m_indirectBuffers[bufferingIndex];
+    m_submittedDraws = 0;
+    m_submittedBatches = 0;
+    m_pendingDraws.clear();
+}
+
+void VulkanDrawList::AddDraw(const VulkanSubMesh &subMesh, uint32_t instanceCount, uint32_t firstInstance) {
+    if (!DebugCheck(m_submittedDraws + m_pendingDraws.size() < m_maxDrawsPerFrame, "Too many draws in one frame, max = {}.", m_maxDrawsPerFrame)) {
+        return;
+    }
+    if (instanceCount == 0) {
+        return;
+    }
+
+    VkDrawIndexedIndirectCommand &command = m_pendingDraws.emplace_back();
+    command.indexCount = subMesh.IndexCount;
+    command.instanceCount = instanceCount;
+    command.firstIndex = subMesh.FirstIndex;
+    command.vertexOffset = subMesh.VertexOffset;
+    command.firstInstance = firstInstance;
+}
+
+void VulkanDrawList::Submit(VkCommandBuffer commandBuffer) {
+    const auto drawCount = static_cast<uint32_t>(m_pendingDraws.size());
+    if (drawCount == 0) {
+        return;
+    }
+
+    // without drawIndirectFirstInstance the firstInstance of indirect commands must be 0
+    if (!m_device->GetEnabledFeatures().drawIndirectFirstInstance) {
+        for (const VkDrawIndexedIndirectCommand &command: m_pendingDraws) {
+            vkCmdDrawIndexed(commandBuffer, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+        }
+        m_pendingDraws.clear();
+        return;
+    }
+
+    auto mappedData = static_cast<uint8_t *>(m_currentBuffer->GetMappedData());
+
+    const VkDeviceSize commandsOffset = m_submittedDraws * sizeof(VkDrawIndexedIndirectCommand);
+    const VkDeviceSize commandsSize = drawCount * sizeof(VkDrawIndexedIndirectCommand);
+    memcpy(mappedData + commandsOffset, m_pendingDraws.data(), commandsSize);
+    m_currentBuffer->Flush(commandsOffset, commandsSize);
+
+    const VkDeviceSize countOffset = GetCountsOffset(m_maxDrawsPerFrame) + m_submittedBatches * sizeof(uint32_t);
+    memcpy(mappedData + countOffset, &drawCount, sizeof(uint32_t));
+    m_currentBuffer->Flush(countOffset, sizeof(uint32_t));
+
+    m_device->CmdDrawIndexedIndirect(
+            commandBuffer,
+            m_currentBuffer->Get(),
+            commandsOffset,
+            drawCount,
+            m_currentBuffer->Get(),
+            countOffset
+    );
+
+    m_submittedDraws += drawCount;
+    m_submittedBatches++;
+    m_pendingDraws.clear();
+}
@@ -0,0 +1,61 @@
+//
+// Created by andyroiiid on 12/24/2022.
+//
+
+#pragma once
+
+#include "VulkanBase.h"
+#include "VulkanMesh.h"
+
+// Collects VkDrawIndexedIndirectCommand on the CPU and submits them as indirect batches.
+// Every buffering slot owns a persistently mapped indirect buffer, so nothing is reallocated per frame.
+class VulkanDrawList {
+public:
+    VulkanDrawList() = default;
+
+    VulkanDrawList(VulkanBase *device, uint32_t maxDrawsPerFrame);
+
+    ~VulkanDrawList() {
+        Release();
+    }
+
+    VulkanDrawList(const VulkanDrawList &) = delete;
+
+    VulkanDrawList &operator=(const VulkanDrawList &) = delete;
+
+    VulkanDrawList(VulkanDrawList &&other) noexcept {
+        Swap(other);
+    }
+
+    VulkanDrawList &operator=(VulkanDrawList &&other) noexcept {
+        if (this != &other) {
+            Release();
+            Swap(other);
+        }
+        return *this;
+    }
+
+    void Release();
+
+    void Swap(VulkanDrawList &other) noexcept;
+
+    // call once per frame before any AddDraw
+    void Begin(uint32_t bufferingIndex);
+
+    void AddDraw(const VulkanSubMesh &subMesh, uint32_t instanceCount, uint32_t firstInstance);
+
+    // records all draws added since the last Submit as one batch,
+    // the pipeline, vertex buffers and index buffer must already be bound
+    void Submit(VkCommandBuffer commandBuffer);
+
+private:
+    VulkanBase *m_device = nullptr;
+
+    uint32_t m_maxDrawsPerFrame = 0;
+    std::vector<VulkanBuffer> m_indirectBuffers;
+
+    VulkanBuffer *m_currentBuffer = nullptr;
+    uint32_t m_submittedDraws = 0;
+    uint32_t m_submittedBatches = 0;
+    std::vector<VkDrawIndexedIndirectCommand> m_pendingDraws;
+};
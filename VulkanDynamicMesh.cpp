@@ -0,0 +1,195 @@
+//
+// Created by andyroiiid on 1/1/2023.
+//
+
+#include "VulkanDynamicMesh.h"
+
+#include "Debug.h"
+
+VulkanDynamicMesh::VulkanDynamicMesh(VulkanBase *device, size_t vertexSize, uint32_t vertexCapacity, uint32_t indexCapacity)
+        : m_device(device),
+          m_vertexSize(vertexSize) {
+    m_vertexStream.DirtyRanges.resize(m_device->GetNumBuffering());
+    m_indexStream.DirtyRanges.resize(m_device->GetNumBuffering());
+    Reserve(m_vertexStream, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexCapacity * m_vertexSize);
+    Reserve(m_indexStream, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexCapacity * sizeof(uint32_t));
+    m_vertexData.reserve(vertexCapacity * m_vertexSize);
+    m_indexData.reserve(indexCapacity);
+}
+
+void VulkanDynamicMesh::Release() {
+    m_device = nullptr;
+    m_vertexSize = 0;
+    m_vertexData.clear();
+    m_vertexCount = 0;
+    m_vertexStream = {};
+    m_indexData.clear();
+    m_indexCount = 0;
+    m_indexStream = {};
+    m_currentBufferingIndex = 0;
+    m_frameCount = 0;
+    m_retiredBuffers.clear();
+}
+
+void VulkanDynamicMesh::Swap(VulkanDynamicMesh &other) noexcept {
+    std::swap(m_device, other.m_device);
+    std::swap(m_vertexSize, other.m_vertexSize);
+    std::swap(m_vertexData, other.m_vertexData);
+    std::swap(m_vertexCount, other.m_vertexCount);
+    std::swap(m_vertexStream, other.m_vertexStream);
+    std::swap(m_indexData, other.m_indexData);
+    std::swap(m_indexCount, other.m_indexCount);
+    std::swap(m_indexStream, other.m_indexStream);
+    std::swap(m_currentBufferingIndex, other.m_currentBufferingIndex);
+    std::swap(m_frameCount, other.m_frameCount);
+    std::swap(m_retiredBuffers, other.m_retiredBuffers);
+}
+
+void VulkanDynamicMesh::Reserve(Stream &stream, VkBufferUsageFlags usage, VkDeviceSize size) {
+    if (size <= stream.RegionSize) {
+        return;
+    }
+
+    // frames in flight may still read the old buffer
+    if (stream.Buffer.Get() != VK_NULL_HANDLE) {
+        m_retiredBuffers.push_back({std::move(stream.Buffer), m_frameCount});
+    }
+
+    stream.RegionSize = std::max(size, stream.RegionSize * 2);
+    stream.Buffer = m_device->CreateBuffer(
+            stream.RegionSize * m_device->GetNumBuffering(),
+            usage,
+            VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
+    );
+}
+
+void VulkanDynamicMesh::Resize(uint32_t vertexCount, uint32_t indexCount) {
+    const VkDeviceSize oldVertexRegionSize = m_vertexStream.RegionSize;
+    Reserve(m_vertexStream, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexCount * m_vertexSize);
+    if (m_vertexStream.RegionSize != oldVertexRegionSize) {
+        // a new buffer starts empty in every region
+        MarkDirty(m_vertexStream, 0, std::min(m_vertexCount, vertexCount) * m_vertexSize);
+    }
+    m_vertexData.resize(vertexCount * m_vertexSize);
+    m_vertexCount = vertexCount;
+
+    const VkDeviceSize oldIndexRegionSize = m_indexStream.RegionSize;
+    Reserve(m_indexStream, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexCount * sizeof(uint32_t));
+    if (m_indexStream.RegionSize != oldIndexRegionSize) {
+        MarkDirty(m_indexStream, 0, std::min(m_indexCount, indexCount) * sizeof(uint32_t));
+    }
+    m_indexData.resize(indexCount);
+    m_indexCount = indexCount;
+}
+
+void VulkanDynamicMesh::MarkDirty(Stream &stream, VkDeviceSize begin, VkDeviceSize end) {
+    if (begin >= end) {
+        return;
+    }
+    for (DirtyRange &dirtyRange: stream.DirtyRanges) {
+        dirtyRange.Add(begin, end);
+    }
+}
+
+void VulkanDynamicMesh::MarkVerticesDirty(uint32_t firstVertex, uint32_t vertexCount) {
+    if (!DebugCheck(firstVertex + vertexCount <= m_vertexCount, "Vertex range [{}, {}) is out of the mesh's {} vertices.", firstVertex, firstVertex + vertexCount, m_vertexCount)) {
+        return;
+    }
+    MarkDirty(m_vertexStream, firstVertex * m_vertexSize, (firstVertex + vertexCount) * m_vertexSize);
+}
+
+void VulkanDynamicMesh::MarkIndicesDirty(uint32_t firstIndex, uint32_t indexCount) {
+    if (!DebugCheck(firstIndex + indexCount <= m_indexCount, "Index range [{}, {}) is out of the mesh's {} indices.", firstIndex, firstIndex + indexCount, m_indexCount)) {
+        return;
+    }
+    MarkDirty(m_indexStream, firstIndex * sizeof(uint32_t), (firstIndex + indexCount) * sizeof(uint32_t));
+}
+
+void VulkanDynamicMesh::UpdateVertices(uint32_t firstVertex, uint32_t vertexCount, const void *data) {
+    if (!DebugCheck(firstVertex + vertexCount <= m_vertexCount, "Vertex range [{}, {}) is out of the mesh's {} vertices.", firstVertex, firstVertex + vertexCount, m_vertexCount)) {
+        return;
+    }
+    memcpy(m_vertexData.data() + firstVertex * m_vertexSize, data, vertexCount * m_vertexSize);
+    MarkDirty(m_vertexStream, firstVertex * m_vertexSize, (firstVertex + vertexCount) * m_vertexSize);
+}
+
+void VulkanDynamicMesh::UpdateIndices(uint32_t firstIndex, uint32_t indexCount, const uint32_t *data) {
+    if (!DebugCheck(firstIndex + indexCount <= m_indexCount, "Index range [{}, {}) is out of the mesh's {} indices.", firstIndex, firstIndex + indexCount, m_indexCount)) {
+        return;
+    }
+    memcpy(m_indexData.data() + firstIndex, data, indexCount * sizeof(uint32_t));
+    MarkDirty(m_indexStream, firstIndex * sizeof(uint32_t), (firstIndex + indexCount) * sizeof(uint32_t));
+}
+
+void VulkanDynamicMesh::UploadStream(Stream &stream, const uint8_t *data, VkDeviceSize dataSize) {
+    DirtyRange &dirtyRange = stream.DirtyRanges[m_currentBufferingIndex];
+    // the counts may have shrunk since the range was marked
+    const VkDeviceSize end = std::min(dirtyRange.End, dataSize);
+    if (dirtyRange.Begin < end) {
+        const VkDeviceSize offset = m_currentBufferingIndex * stream.RegionSize + dirtyRange.Begin;
+        memcpy(static_cast<uint8_t *>(stream.Buffer.GetMappedData()) + offset, data + dirtyRange.Begin, end - dirtyRange.Begin);
+        stream.Buffer.Flush(offset, end - dirtyRange.Begin);
+    }
+    dirtyRange = {};
+}
+
+void VulkanDynamicMesh::Upload(uint32_t bufferingIndex) {
+    m_currentBufferingIndex = bufferingIndex;
+    m_frameCount++;
+
+    // BeginFrame has waited for this slot's previous frame, so every frame that started before the retirement is done
+    const uint32_t numBuffering = m_device->GetNumBuffering();
+    m_retiredBuffers.erase(
+            std::remove_if(m_retiredBuffers.begin(), m_retiredBuffers.end(), [this, numBuffering](const RetiredBuffer &retiredBuffer) {
+                return m_frameCount >= retiredBuffer.RetiredFrame + numBuffering;
+            }),
+            m_retiredBuffers.end()
+    );
+
+    UploadStream(m_vertexStream, m_vertexData.data(), m_vertexData.size());
+    if (m_indexStream.Buffer.Get() != VK_NULL_HANDLE) {
+        UploadStream(m_indexStream, reinterpret_cast<const uint8_t *>(m_indexData.data()), m_indexData.size() * sizeof(uint32_t));
+    }
+}
+
+void VulkanDynamicMesh::Bind(VkCommandBuffer commandBuffer) {
+    const VkDeviceSize offset = m_currentBufferingIndex * m_vertexStream.RegionSize;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_vertexStream.Buffer.Get(), &offset);
+    if (IsIndexed()) {
+        vkCmdBindIndexBuffer(commandBuffer, m_indexStream.Buffer.Get(), m_currentBufferingIndex * m_indexStream.RegionSize, VK_INDEX_TYPE_UINT32);
+    }
+}
+
+void VulkanDynamicMesh::BindInstanced(VkCommandBuffer commandBuffer, VkBuffer instanceBuffer, VkDeviceSize instanceOffset) {
+    const VkBuffer buffers[] = {m_vertexStream.Buffer.Get(), instanceBuffer};
+    const VkDeviceSize offsets[] = {m_currentBufferingIndex * m_vertexStream.RegionSize, instanceOffset};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 2, buffers, offsets);
+    if (IsIndexed()) {
+        vkCmdBindIndexBuffer(commandBuffer, m_indexStream.Buffer.Get(), m_currentBufferingIndex * m_indexStream.RegionSize, VK_INDEX_TYPE_UINT32);
+    }
+}
+
+void VulkanDynamicMesh::Draw(VkCommandBuffer commandBuffer, uint32_t instanceCount) {
+    if (IsIndexed()) {
+        vkCmdDrawIndexed(commandBuffer, m_indexCount, instanceCount, 0, 0, 0);
+    } else {
+        vkCmdDraw(commandBuffer, m_vertexCount, instanceCount, 0, 0);
+    }
+}
+
+void VulkanDynamicMesh::BindAndDraw(VkCommandBuffer commandBuffer) {
+    if (m_vertexCount == 0) {
+        return;
+    }
+    Bind(commandBuffer);
+    Draw(commandBuffer, 1);
+}
+
+void VulkanDynamicMesh::BindAndDrawInstanced(VkCommandBuffer commandBuffer, VkBuffer instanceBuffer, uint32_t instanceCount, VkDeviceSize instanceOffset) {
+    if (m_vertexCount == 0) {
+        return;
+    }
+    BindInstanced(commandBuffer, instanceBuffer, instanceOffset);
+    Draw(commandBuffer, instanceCount);
+}
@@ -0,0 +1,134 @@
+//
+// Created by andyroiiid on 1/1/2023.
+//
+
+#pragma once
+
+#include <algorithm>
+
+#include "VulkanBase.h"
+#include "VulkanBuffer.h"
+
+// A mesh whose vertices and indices are rewritten from the CPU, for particles, debug geometry and deformation.
+// Every buffering slot owns a region of one persistently mapped vertex buffer and one index buffer,
+// so updating never waits for the GPU or goes through ImmediateSubmit.
+// A CPU copy of the streams is kept and only the ranges changed since a slot was last uploaded are copied into it.
+class VulkanDynamicMesh {
+public:
+    VulkanDynamicMesh() = default;
+
+    VulkanDynamicMesh(VulkanBase *device, size_t vertexSize, uint32_t vertexCapacity, uint32_t indexCapacity = 0);
+
+    ~VulkanDynamicMesh() {
+        Release();
+    }
+
+    VulkanDynamicMesh(const VulkanDynamicMesh &) = delete;
+
+    VulkanDynamicMesh &operator=(const VulkanDynamicMesh &) = delete;
+
+    VulkanDynamicMesh(VulkanDynamicMesh &&other) noexcept {
+        Swap(other);
+    }
+
+    VulkanDynamicMesh &operator=(VulkanDynamicMesh &&other) noexcept {
+        if (this != &other) {
+            Release();
+            Swap(other);
+        }
+        return *this;
+    }
+
+    void Release();
+
+    void Swap(VulkanDynamicMesh &other) noexcept;
+
+    // Sets the number of vertices and indices that are drawn, contents below the old counts are kept.
+    // Capacities grow by doubling, the replaced GPU buffers are freed once no frame in flight can use them.
+    void Resize(uint32_t vertexCount, uint32_t indexCount = 0);
+
+    [[nodiscard]] uint32_t GetVertexCount() const { return m_vertexCount; }
+
+    [[nodiscard]] uint32_t GetIndexCount() const { return m_indexCount; }
+
+    [[nodiscard]] bool IsIndexed() const { return m_indexCount > 0; }
+
+    // CPU copies of the streams, valid until the next Resize, call Mark*Dirty after writing them
+    [[nodiscard]] void *GetVertexData() { return m_vertexData.data(); }
+
+    [[nodiscard]] uint32_t *GetIndexData() { return m_indexData.data(); }
+
+    void MarkVerticesDirty(uint32_t firstVertex, uint32_t vertexCount);
+
+    void MarkIndicesDirty(uint32_t firstIndex, uint32_t indexCount);
+
+    // partial updates, the ranges must be inside the current counts
+    void UpdateVertices(uint32_t firstVertex, uint32_t vertexCount, const void *data);
+
+    void UpdateIndices(uint32_t firstIndex, uint32_t indexCount, const uint32_t *data);
+
+    // Copies the dirty ranges of this buffering slot into its region, call once per frame after all updates and before drawing.
+    void Upload(uint32_t bufferingIndex);
+
+    void Bind(VkCommandBuffer commandBuffer);
+
+    // instanceBuffer is bound to vertex binding 1, see InstanceBase
+    void BindInstanced(VkCommandBuffer commandBuffer, VkBuffer instanceBuffer, VkDeviceSize instanceOffset = 0);
+
+    void BindAndDraw(VkCommandBuffer commandBuffer);
+
+    void BindAndDrawInstanced(VkCommandBuffer commandBuffer, VkBuffer instanceBuffer, uint32_t instanceCount, VkDeviceSize instanceOffset = 0);
+
+private:
+    // byte range [Begin, End) that a buffering slot has not received yet
+    struct DirtyRange {
+        VkDeviceSize Begin = 0;
+        VkDeviceSize End = 0;
+
+        void Add(VkDeviceSize begin, VkDeviceSize end) {
+            if (Begin == End) {
+                Begin = begin;
+                End = end;
+            } else {
+                Begin = std::min(Begin, begin);
+                End = std::max(End, end);
+            }
+        }
+    };
+
+    struct Stream {
+        VulkanBuffer Buffer;
+        // bytes per buffering slot region
+        VkDeviceSize RegionSize = 0;
+        std::vector<DirtyRange> DirtyRanges;
+    };
+
+    struct RetiredBuffer {
+        VulkanBuffer Buffer;
+        uint32_t RetiredFrame;
+    };
+
+    void Reserve(Stream &stream, VkBufferUsageFlags usage, VkDeviceSize size);
+
+    void MarkDirty(Stream &stream, VkDeviceSize begin, VkDeviceSize end);
+
+    void UploadStream(Stream &stream, const uint8_t *data, VkDeviceSize dataSize);
+
+    void Draw(VkCommandBuffer commandBuffer, uint32_t instanceCount);
+
+    VulkanBase *m_device = nullptr;
+    size_t m_vertexSize = 0;
+
+    std::vector<uint8_t> m_vertexData;
+    uint32_t m_vertexCount = 0;
+    Stream m_vertexStream;
+
+    std::vector<uint32_t> m_indexData;
+    uint32_t m_indexCount = 0;
+    Stream m_indexStream;
+
+    uint32_t m_currentBufferingIndex = 0;
+    // number of Upload calls, a buffer retired at frame f is unused after GetNumBuffering() more frames
+    uint32_t m_frameCount = 0;
+    std::vector<RetiredBuffer> m_retiredBuffers;
+};
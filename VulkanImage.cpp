@@ -4,6 +4,8 @@
 
 #include "VulkanImage.h"
 
+#include <algorithm>
+
 #include "Debug.h"
 
 VulkanImage::VulkanImage(
@@ -12,15 +14,33 @@ VulkanImage::VulkanImage(
         const VkExtent2D &extent,
         VkImageUsageFlags imageUsage,
         VmaAllocationCreateFlags flags,
-        VmaMemoryUsage memoryUsage
-) : m_allocator(allocator) {
+        VmaMemoryUsage memoryUsage,
+        uint32_t mipLevels
+) : VulkanImage(allocator, VK_IMAGE_TYPE_2D, format, {extent.width, extent.height, 1}, imageUsage, flags, memoryUsage, mipLevels) {
+}
+
+VulkanImage::VulkanImage(
+        VmaAllocator allocator,
+        VkImageType imageType,
+        VkFormat format,
+        const VkExtent3D &extent,
+        VkImageUsageFlags imageUsage,
+        VmaAllocationCreateFlags flags,
+        VmaMemoryUsage memoryUsage,
+        uint32_t mipLevels,
+        uint32_t arrayLayers,
+        VkImageCreateFlags createFlags
+) : m_allocator(allocator),
+    m_mipLevels(mipLevels),
+    m_arrayLayers(arrayLayers) {
     VkImageCreateInfo imageCreateInfo{};
     imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageCreateInfo.flags = createFlags;
+    imageCreateInfo.imageType = imageType;
     imageCreateInfo.format = format;
-    imageCreateInfo.extent = {extent.width, extent.height, 1};
-    imageCreateInfo.mipLevels = 1;
-    imageCreateInfo.arrayLayers = 1;
+    imageCreateInfo.extent = extent;
+    imageCreateInfo.mipLevels = mipLevels;
+    imageCreateInfo.arrayLayers = arrayLayers;
     imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     imageCreateInfo.usage = imageUsage;
 
@@ -40,10 +60,35 @@ void VulkanImage::Release() {
     m_allocator = VK_NULL_HANDLE;
     m_image = VK_NULL_HANDLE;
     m_allocation = VK_NULL_HANDLE;
+    m_mipLevels = 0;
+    m_arrayLayers = 0;
 }
 
 void VulkanImage::Swap(VulkanImage &other) noexcept {
     std::swap(m_allocator, other.m_allocator);
     std::swap(m_image, other.m_image);
     std::swap(m_allocation, other.m_allocation);
+    std::swap(m_mipLevels, other.m_mipLevels);
+    std::swap(m_arrayLayers, other.m_arrayLayers);
+}
+
+VkDeviceSize VulkanImage::GetAllocationSize() const {
+    if (m_allocation == VK_NULL_HANDLE) {
+        return 0;
+    }
+    VmaAllocationInfo allocationInfo;
+    vmaGetAllocationInfo(m_allocator, m_allocation, &allocationInfo);
+    return allocationInfo.size;
+}
+
+uint32_t VulkanImage::GetFullMipLevels(const VkExtent2D &extent) {
+    return GetFullMipLevels({extent.width, extent.height, 1});
+}
+
+uint32_t VulkanImage::GetFullMipLevels(const VkExtent3D &extent) {
+    uint32_t mipLevels = 1;
+    for (uint32_t size = std::max({extent.width, extent.height, extent.depth}); size > 1; size >>= 1) {
+        mipLevels++;
+    }
+    return mipLevels;
 }
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <vulkan/vulkan.h>
 #include <vk_mem_alloc.h>
 
@@ -17,7 +18,22 @@ public:
             const VkExtent2D &extent,
             VkImageUsageFlags imageUsage,
             VmaAllocationCreateFlags flags,
-            VmaMemoryUsage memoryUsage
+            VmaMemoryUsage memoryUsage,
+            uint32_t mipLevels = 1
+    );
+
+    // 1D, 2D or 3D image, cube maps are 2D images with a multiple of 6 layers and VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT
+    VulkanImage(
+            VmaAllocator allocator,
+            VkImageType imageType,
+            VkFormat format,
+            const VkExtent3D &extent,
+            VkImageUsageFlags imageUsage,
+            VmaAllocationCreateFlags flags,
+            VmaMemoryUsage memoryUsage,
+            uint32_t mipLevels = 1,
+            uint32_t arrayLayers = 1,
+            VkImageCreateFlags createFlags = 0
     );
 
     ~VulkanImage() {
@@ -46,9 +62,23 @@ public:
 
     [[nodiscard]] const VkImage &Get() const { return m_image; }
 
+    [[nodiscard]] uint32_t GetMipLevels() const { return m_mipLevels; }
+
+    [[nodiscard]] uint32_t GetArrayLayers() const { return m_arrayLayers; }
+
+    // bytes of device memory backing the image
+    [[nodiscard]] VkDeviceSize GetAllocationSize() const;
+
+    // levels of a full mip chain down to 1x1
+    static uint32_t GetFullMipLevels(const VkExtent2D &extent);
+
+    static uint32_t GetFullMipLevels(const VkExtent3D &extent);
+
 private:
     VmaAllocator m_allocator = VK_NULL_HANDLE;
 
     VkImage m_image = VK_NULL_HANDLE;
     VmaAllocation m_allocation = VK_NULL_HANDLE;
+    uint32_t m_mipLevels = 0;
+    uint32_t m_arrayLayers = 0;
 };
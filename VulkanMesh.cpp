@@ -5,47 +5,113 @@
 #include "VulkanMesh.h"
 
 VulkanMesh::VulkanMesh(VulkanBase *device, size_t vertexCount, size_t vertexSize, const void *data) {
-    VkDeviceSize size = vertexCount * vertexSize;
+    CreateBuffers(device, vertexCount * vertexSize, data, 0, nullptr);
+    m_vertexCount = vertexCount;
+}
+
+VulkanMesh::VulkanMesh(VulkanBase *device, size_t vertexCount, size_t vertexSize, const void *vertexData, size_t indexCount, const uint32_t *indexData) {
+    CreateBuffers(device, vertexCount * vertexSize, vertexData, indexCount, indexData);
+    m_vertexCount = vertexCount;
+    m_indexCount = indexCount;
+}
 
+void VulkanMesh::CreateBuffers(VulkanBase *device, VkDeviceSize vertexBufferSize, const void *vertexData, size_t indexCount, const uint32_t *indexData) {
+    const VkDeviceSize indexBufferSize = indexCount * sizeof(uint32_t);
+
+    // vertices and indices share one staging buffer and one submission
     VulkanBuffer uploadBuffer = device->CreateBuffer(
-            size,
+            vertexBufferSize + indexBufferSize,
             VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+            VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
             VMA_MEMORY_USAGE_AUTO_PREFER_HOST
     );
-    uploadBuffer.Upload(size, data);
+    auto mappedData = static_cast<uint8_t *>(uploadBuffer.GetMappedData());
+    memcpy(mappedData, vertexData, vertexBufferSize);
+    if (indexBufferSize > 0) {
+        memcpy(mappedData + vertexBufferSize, indexData, indexBufferSize);
+    }
+    uploadBuffer.Flush();
 
     VulkanBuffer vertexBuffer = device->CreateBuffer(
-            size,
+            vertexBufferSize,
             VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
             0,
             VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
     );
 
-    device->ImmediateSubmit([size, &uploadBuffer, &vertexBuffer](VkCommandBuffer cmd) {
+    VulkanBuffer indexBuffer;
+    if (indexBufferSize > 0) {
+        indexBuffer = device->CreateBuffer(
+                indexBufferSize,
+                VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                0,
+                VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
+        );
+    }
+
+    device->ImmediateSubmit([vertexBufferSize, indexBufferSize, &uploadBuffer, &vertexBuffer, &indexBuffer](VkCommandBuffer cmd) {
         VkBufferCopy copy{};
         copy.srcOffset = 0;
         copy.dstOffset = 0;
-        copy.size = size;
+        copy.size = vertexBufferSize;
         vkCmdCopyBuffer(cmd, uploadBuffer.Get(), vertexBuffer.Get(), 1, &copy);
+
+        if (indexBufferSize > 0) {
+            copy.srcOffset = vertexBufferSize;
+            copy.size = indexBufferSize;
+            vkCmdCopyBuffer(cmd, uploadBuffer.Get(), indexBuffer.Get(), 1, &copy);
+        }
     });
 
     m_vertexBuffer = std::move(vertexBuffer);
-    m_vertexCount = vertexCount;
+    m_indexBuffer = std::move(indexBuffer);
 }
 
 void VulkanMesh::Release() {
     m_vertexBuffer = {};
     m_vertexCount = 0;
+    m_indexBuffer = {};
+    m_indexCount = 0;
 }
 
 void VulkanMesh::Swap(VulkanMesh &other) noexcept {
     std::swap(m_vertexBuffer, other.m_vertexBuffer);
     std::swap(m_vertexCount, other.m_vertexCount);
+    std::swap(m_indexBuffer, other.m_indexBuffer);
+    std::swap(m_indexCount, other.m_indexCount);
 }
 
-void VulkanMesh::BindAndDraw(VkCommandBuffer commandBuffer) {
+void VulkanMesh::Bind(VkCommandBuffer commandBuffer) {
     VkDeviceSize offset = 0;
     vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_vertexBuffer.Get(), &offset);
-    vkCmdDraw(commandBuffer, m_vertexCount, 1, 0, 0);
+    if (IsIndexed()) {
+        vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer.Get(), 0, VK_INDEX_TYPE_UINT32);
+    }
+}
+
+void VulkanMesh::BindInstanced(VkCommandBuffer commandBuffer, VkBuffer instanceBuffer, VkDeviceSize instanceOffset) {
+    const VkBuffer buffers[] = {m_vertexBuffer.Get(), instanceBuffer};
+    const VkDeviceSize offsets[] = {0, instanceOffset};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 2, buffers, offsets);
+    if (IsIndexed()) {
+        vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer.Get(), 0, VK_INDEX_TYPE_UINT32);
+    }
+}
+
+void VulkanMesh::Draw(VkCommandBuffer commandBuffer, uint32_t instanceCount) {
+    if (IsIndexed()) {
+        vkCmdDrawIndexed(commandBuffer, m_indexCount, instanceCount, 0, 0, 0);
+    } else {
+        vkCmdDraw(commandBuffer, m_vertexCount, instanceCount, 0, 0);
+    }
+}
+
+void VulkanMesh::BindAndDraw(VkCommandBuffer commandBuffer) {
+    Bind(commandBuffer);
+    Draw(commandBuffer, 1);
+}
+
+void VulkanMesh::BindAndDrawInstanced(VkCommandBuffer commandBuffer, VkBuffer instanceBuffer, uint32_t instanceCount, VkDeviceSize instanceOffset) {
+    BindInstanced(commandBuffer, instanceBuffer, instanceOffset);
+    Draw(commandBuffer, instanceCount);
 }
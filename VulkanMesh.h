@@ -7,12 +7,21 @@
 #include "VulkanBase.h"
 #include "VulkanBuffer.h"
 
+// a range inside a shared vertex/index buffer, matches the vkCmdDrawIndexed parameters
+struct VulkanSubMesh {
+    uint32_t FirstIndex = 0;
+    uint32_t IndexCount = 0;
+    int32_t VertexOffset = 0;
+};
+
 class VulkanMesh {
 public:
     VulkanMesh() = default;
 
     VulkanMesh(VulkanBase *device, size_t vertexCount, size_t vertexSize, const void *data);
 
+    VulkanMesh(VulkanBase *device, size_t vertexCount, size_t vertexSize, const void *vertexData, size_t indexCount, const uint32_t *indexData);
+
     ~VulkanMesh() {
         Release();
     }
@@ -37,9 +46,25 @@ public:
 
     void Swap(VulkanMesh &other) noexcept;
 
+    [[nodiscard]] bool IsIndexed() const { return m_indexCount > 0; }
+
+    void Bind(VkCommandBuffer commandBuffer);
+
+    // instanceBuffer is bound to vertex binding 1, see InstanceBase
+    void BindInstanced(VkCommandBuffer commandBuffer, VkBuffer instanceBuffer, VkDeviceSize instanceOffset = 0);
+
     void BindAndDraw(VkCommandBuffer commandBuffer);
 
+    void BindAndDrawInstanced(VkCommandBuffer commandBuffer, VkBuffer instanceBuffer, uint32_t instanceCount, VkDeviceSize instanceOffset = 0);
+
 private:
+    void CreateBuffers(VulkanBase *device, VkDeviceSize vertexBufferSize, const void *vertexData, size_t indexCount, const uint32_t *indexData);
+
+    void Draw(VkCommandBuffer commandBuffer, uint32_t instanceCount);
+
     VulkanBuffer m_vertexBuffer;
     uint32_t m_vertexCount = 0;
+
+    VulkanBuffer m_indexBuffer;
+    uint32_t m_indexCount = 0;
 };
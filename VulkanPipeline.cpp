@@ -24,8 +24,10 @@ void VulkanPipeline::CreatePipelineLayout(const VulkanPipelineCreateInfo &create
     pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutCreateInfo.setLayoutCount = createInfo.DescriptorSetLayouts.size();
     pipelineLayoutCreateInfo.pSetLayouts = createInfo.DescriptorSetLayouts.data();
-    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
-    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+    if (createInfo.PushConstantSize > 0) {
+        pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+        pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+    }
     m_pipelineLayout = m_device->CreatePipelineLayout(pipelineLayoutCreateInfo);
 }
 
@@ -4,142 +4,438 @@
 
 #include "VulkanTexture.h"
 
-VulkanTexture::VulkanTexture(VulkanBase *device, uint32_t width, uint32_t height, const void *data)
-        : m_device(device) {
-    CreateImage(width, height, data);
+#include <algorithm>
+#include <cstring>
+
+#include "Debug.h"
+#include "GpuTextureCompressor.h"
+
+VulkanTexture::VulkanTexture(VulkanBase *device, uint32_t width, uint32_t height, const void *data, const VulkanTextureOptions &options)
+        : m_device(device),
+          m_format(VK_FORMAT_R8G8B8A8_UNORM) {
+    const TextureMip mip{0, static_cast<uint64_t>(width) * height * 4, width, height};
+    CreateImage(CreateStaging(device, m_format, &mip, 1, data), options.GenerateMips, VK_NULL_HANDLE);
+    CompressImage({width, height}, options);
+    CreateImageView();
+    CreateSampler(options);
+}
+
+VulkanTexture::VulkanTexture(VulkanBase *device, VkFormat format, const TextureMip *mips, uint32_t mipLevels, const void *data, const VulkanTextureOptions &options)
+        : m_device(device),
+          m_format(format) {
+    DebugCheckCritical(IsFormatSupported(device, format), "Texture format {} is not supported by the device.", static_cast<int>(format));
+    CreateImage(CreateStaging(device, format, mips, mipLevels, data), options.GenerateMips, VK_NULL_HANDLE);
+    CreateImageView();
+    CreateSampler(options);
+}
+
+VulkanTexture::VulkanTexture(
+        VulkanBase *device, VkImageViewType viewType, uint32_t width, uint32_t height, uint32_t layers,
+        const void *const *data, const VulkanTextureOptions &options
+) : m_device(device),
+    m_format(VK_FORMAT_R8G8B8A8_UNORM),
+    m_viewType(viewType) {
+    const bool is3D = viewType == VK_IMAGE_VIEW_TYPE_3D;
+    const bool isCube = viewType == VK_IMAGE_VIEW_TYPE_CUBE || viewType == VK_IMAGE_VIEW_TYPE_CUBE_ARRAY;
+    DebugCheckCritical(!isCube || width == height, "Cube textures need square faces.");
+    // the view covers every layer of the image, a single cube is exactly 6 of them
+    DebugCheckCritical(viewType != VK_IMAGE_VIEW_TYPE_CUBE || layers == 6, "Cube textures need 6 layers, got {}.", layers);
+    DebugCheckCritical(
+            viewType != VK_IMAGE_VIEW_TYPE_CUBE_ARRAY || (layers > 0 && layers % 6 == 0),
+            "Cube array textures need a multiple of 6 layers, got {}.", layers
+    );
+    DebugCheckCritical(
+            viewType != VK_IMAGE_VIEW_TYPE_CUBE_ARRAY || device->GetEnabledFeatures().imageCubeArray,
+            "Cube array textures need the imageCubeArray feature."
+    );
+
+    // the slices of a 3D texture follow each other in its only level
+    const uint64_t layerSize = static_cast<uint64_t>(width) * height * 4;
+    std::vector<TextureMip> mips(is3D ? 1 : layers);
+    for (TextureMip &mip: mips) {
+        mip = {0, is3D ? layerSize * layers : layerSize, width, height};
+    }
+    VulkanTextureStaging staging = AllocateStaging(device, m_format, viewType, is3D ? 1 : layers, is3D ? layers : 1, mips.data(), 1);
+    auto *stagingData = static_cast<uint8_t *>(staging.Buffer.GetMappedData());
+    for (uint32_t layer = 0; layer < layers; layer++) {
+        const VkDeviceSize offset = is3D ? staging.Mips[0].Offset + layerSize * layer : staging.Mips[layer].Offset;
+        memcpy(stagingData + offset, data[layer], layerSize);
+    }
+    staging.Buffer.Flush();
+
+    CreateImage(staging, options.GenerateMips, VK_NULL_HANDLE);
+    CreateImageView();
+    CreateSampler(options);
+}
+
+VulkanTexture::VulkanTexture(VulkanBase *device, VkCommandBuffer commandBuffer, const VulkanTextureStaging &staging, const VulkanTextureOptions &options)
+        : m_device(device),
+          m_format(staging.Format),
+          m_viewType(staging.ViewType) {
+    DebugCheckCritical(IsFormatSupported(device, m_format), "Texture format {} is not supported by the device.", static_cast<int>(m_format));
+    CreateImage(staging, options.GenerateMips, commandBuffer);
+    if (commandBuffer == VK_NULL_HANDLE) {
+        CompressImage({staging.Mips[0].Width, staging.Mips[0].Height}, options);
+    }
     CreateImageView();
-    CreateSampler();
+    CreateSampler(options);
 }
 
-void VulkanTexture::CreateImage(uint32_t width, uint32_t height, const void *data) {
-    VkDeviceSize size = width * height * 4;
+VulkanTexture::VulkanTexture(
+        VulkanBase *device, VkCommandBuffer commandBuffer, const VulkanTextureStaging &staging,
+        uint32_t firstMip, const VulkanTexture *previous, const VulkanTextureOptions &options
+) : m_device(device),
+    m_format(staging.Format),
+    m_firstMip(firstMip) {
+    DebugCheckCritical(IsFormatSupported(device, m_format), "Texture format {} is not supported by the device.", static_cast<int>(m_format));
+    CreateResidentImage(staging, firstMip, previous, commandBuffer);
+    CreateImageView();
+    CreateSampler(options);
+}
+
+VulkanTextureStaging VulkanTexture::CreateStaging(VulkanBase *device, VkFormat format, const TextureMip *mips, uint32_t mipLevels, const void *data) {
+    return CreateStaging(device, format, VK_IMAGE_VIEW_TYPE_2D, 1, 1, mips, mipLevels, data);
+}
+
+VulkanTextureStaging VulkanTexture::CreateStaging(
+        VulkanBase *device, VkFormat format, VkImageViewType viewType, uint32_t layers, uint32_t depth,
+        const TextureMip *mips, uint32_t mipLevels, const void *data
+) {
+    VulkanTextureStaging staging = AllocateStaging(device, format, viewType, layers, depth, mips, mipLevels);
+    for (size_t i = 0; i < staging.Mips.size(); i++) {
+        memcpy(
+                static_cast<uint8_t *>(staging.Buffer.GetMappedData()) + staging.Mips[i].Offset,
+                static_cast<const uint8_t *>(data) + mips[i].Offset,
+                mips[i].Size
+        );
+    }
+    staging.Buffer.Flush();
+    return staging;
+}
+
+VulkanTextureStaging VulkanTexture::AllocateStaging(
+        VulkanBase *device, VkFormat format, VkImageViewType viewType, uint32_t layers, uint32_t depth,
+        const TextureMip *mips, uint32_t mipLevels, bool hostReads
+) {
+    VulkanTextureStaging staging;
+    staging.Format = format;
+    staging.ViewType = viewType;
+    staging.Layers = layers;
+    staging.Depth = depth;
 
-    VulkanBuffer uploadBuffer = m_device->CreateBuffer(
+    // every mip starts 16 byte aligned, a multiple of every texel block size
+    staging.Mips.resize(static_cast<size_t>(mipLevels) * layers);
+    VkDeviceSize size = 0;
+    for (size_t i = 0; i < staging.Mips.size(); i++) {
+        staging.Mips[i] = {size, mips[i].Size, mips[i].Width, mips[i].Height};
+        size += (mips[i].Size + 15) & ~VkDeviceSize(15);
+    }
+
+    // reading write combined memory back is very slow
+    staging.Buffer = device->CreateBuffer(
             size,
             VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+            (hostReads ? VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT : VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT) | VMA_ALLOCATION_CREATE_MAPPED_BIT,
             VMA_MEMORY_USAGE_AUTO_PREFER_HOST
     );
-    uploadBuffer.Upload(size, data);
+    return staging;
+}
 
-    VulkanImage image = m_device->CreateImage2D(
-            VK_FORMAT_R8G8B8A8_UNORM,
-            VkExtent2D{width, height},
-            VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+bool VulkanTexture::IsFormatSupported(VulkanBase *device, VkFormat format) {
+    TextureFormatInfo info;
+    if (!GetTextureFormatInfo(format, info)) {
+        return false;
+    }
+
+    const VkPhysicalDeviceFeatures &features = device->GetEnabledFeatures();
+    if (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK && !features.textureCompressionBC) {
+        return false;
+    }
+    if (format >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK && format <= VK_FORMAT_EAC_R11G11_SNORM_BLOCK && !features.textureCompressionETC2) {
+        return false;
+    }
+    if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK && !features.textureCompressionASTC_LDR) {
+        return false;
+    }
+
+    constexpr VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+    return (device->GetFormatProperties(format).optimalTilingFeatures & requiredFeatures) == requiredFeatures;
+}
+
+void VulkanTexture::CreateImage(const VulkanTextureStaging &staging, bool generateMips, VkCommandBuffer commandBuffer) {
+    const TextureMip *mips = staging.Mips.data();
+    const uint32_t uploadedLevels = staging.GetMipLevels();
+    const bool is3D = staging.ViewType == VK_IMAGE_VIEW_TYPE_3D;
+    const bool isCube = staging.ViewType == VK_IMAGE_VIEW_TYPE_CUBE || staging.ViewType == VK_IMAGE_VIEW_TYPE_CUBE_ARRAY;
+    const VkExtent3D extent{mips[0].Width, mips[0].Height, is3D ? staging.Depth : 1};
+
+    // every generated mip is blitted with linear filtering from the one above it
+    constexpr VkFormatFeatureFlags mipFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    uint32_t mipLevels = uploadedLevels;
+    if (generateMips && uploadedLevels == 1) {
+        if ((m_device->GetFormatProperties(m_format).optimalTilingFeatures & mipFeatures) == mipFeatures) {
+            mipLevels = VulkanImage::GetFullMipLevels(extent);
+        } else {
+            DebugWarning("Texture format {} can't be blitted with linear filtering, mips are not generated.", static_cast<int>(m_format));
+        }
+    }
+
+    VulkanImage image = m_device->CreateImage(
+            is3D ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D,
+            m_format,
+            extent,
+            VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | (mipLevels > uploadedLevels ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0),
             0,
-            VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
+            VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+            mipLevels,
+            staging.Layers,
+            isCube ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0
     );
 
-    VkExtent3D extent{width, height, 1};
-
-    m_device->ImmediateSubmit([extent, &uploadBuffer, &image](VkCommandBuffer cmd) {
-        VkImageMemoryBarrier imageMemoryBarrier{};
-        imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        imageMemoryBarrier.srcAccessMask = 0;
-        imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        imageMemoryBarrier.image = image.Get();
-        VkImageSubresourceRange &subresourceRange = imageMemoryBarrier.subresourceRange;
-        subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        subresourceRange.baseMipLevel = 0;
-        subresourceRange.levelCount = 1;
-        subresourceRange.baseArrayLayer = 0;
-        subresourceRange.layerCount = 1;
-        vkCmdPipelineBarrier(
-                cmd,
-                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                VK_PIPELINE_STAGE_TRANSFER_BIT,
-                0,
-                0,
-                nullptr,
-                0,
-                nullptr,
-                1,
-                &imageMemoryBarrier
+    // every level of every layer is uploaded by one copy command
+    std::vector<VkBufferImageCopy> imageCopies(staging.Mips.size());
+    for (uint32_t layer = 0; layer < staging.Layers; layer++) {
+        for (uint32_t level = 0; level < uploadedLevels; level++) {
+            const TextureMip &mip = mips[layer * uploadedLevels + level];
+            VkBufferImageCopy &imageCopy = imageCopies[layer * uploadedLevels + level];
+            imageCopy.bufferOffset = mip.Offset;
+            imageCopy.bufferRowLength = 0;
+            imageCopy.bufferImageHeight = 0;
+            VkImageSubresourceLayers &subresourceLayers = imageCopy.imageSubresource;
+            subresourceLayers.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            subresourceLayers.mipLevel = level;
+            subresourceLayers.baseArrayLayer = layer;
+            subresourceLayers.layerCount = 1;
+            imageCopy.imageExtent = {mip.Width, mip.Height, std::max(extent.depth >> level, 1u)};
+        }
+    }
+
+    auto recordUpload = [uploadedLevels, mipLevels, layers = staging.Layers, &imageCopies, &staging, &image](VkCommandBuffer cmd) {
+        CmdImageBarrier(
+                cmd, image.Get(),
+                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT
         );
 
-        VkBufferImageCopy imageCopy{};
-        imageCopy.bufferOffset = 0;
-        imageCopy.bufferRowLength = 0;
-        imageCopy.bufferImageHeight = 0;
-        VkImageSubresourceLayers &subresourceLayers = imageCopy.imageSubresource;
-        subresourceLayers.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        subresourceLayers.mipLevel = 0;
-        subresourceLayers.baseArrayLayer = 0;
-        subresourceLayers.layerCount = 1;
-        imageCopy.imageExtent = extent;
-        vkCmdCopyBufferToImage(cmd, uploadBuffer.Get(), image.Get(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageCopy);
-
-        imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        vkCmdPipelineBarrier(
-                cmd,
-                VK_PIPELINE_STAGE_TRANSFER_BIT,
-                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                0,
-                0,
-                nullptr,
-                0,
-                nullptr,
-                1,
-                &imageMemoryBarrier
+        vkCmdCopyBufferToImage(cmd, staging.Buffer.Get(), image.Get(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, imageCopies.size(), imageCopies.data());
+
+        // only a single uploaded level is extended into a chain, of every layer at once
+        auto mipWidth = static_cast<int32_t>(imageCopies[0].imageExtent.width);
+        auto mipHeight = static_cast<int32_t>(imageCopies[0].imageExtent.height);
+        auto mipDepth = static_cast<int32_t>(imageCopies[0].imageExtent.depth);
+        for (uint32_t level = uploadedLevels; level < mipLevels; level++) {
+            // the level above is complete, read it while this one is written
+            CmdImageBarrier(
+                    cmd, image.Get(),
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                    level - 1, 1
+            );
+
+            const int32_t nextWidth = std::max(mipWidth / 2, 1);
+            const int32_t nextHeight = std::max(mipHeight / 2, 1);
+            const int32_t nextDepth = std::max(mipDepth / 2, 1);
+            VkImageBlit imageBlit{};
+            imageBlit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, layers};
+            imageBlit.srcOffsets[1] = {mipWidth, mipHeight, mipDepth};
+            imageBlit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, layers};
+            imageBlit.dstOffsets[1] = {nextWidth, nextHeight, nextDepth};
+            vkCmdBlitImage(
+                    cmd,
+                    image.Get(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    image.Get(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    1, &imageBlit,
+                    VK_FILTER_LINEAR
+            );
+            mipWidth = nextWidth;
+            mipHeight = nextHeight;
+            mipDepth = nextDepth;
+        }
+
+        // with generated mips every level but the last one has been a blit source
+        const uint32_t numBlitSources = mipLevels > uploadedLevels ? mipLevels - 1 : 0;
+        if (numBlitSources > 0) {
+            CmdImageBarrier(
+                    cmd, image.Get(),
+                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                    0, numBlitSources
+            );
+        }
+        CmdImageBarrier(
+                cmd, image.Get(),
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                numBlitSources, mipLevels - numBlitSources
         );
-    });
+    };
+    if (commandBuffer != VK_NULL_HANDLE) {
+        recordUpload(commandBuffer);
+    } else {
+        m_device->ImmediateSubmit(recordUpload);
+    }
 
     m_image = std::move(image);
 }
 
+void VulkanTexture::CreateResidentImage(const VulkanTextureStaging &staging, uint32_t firstMip, const VulkanTexture *previous, VkCommandBuffer commandBuffer) {
+    DebugCheckCritical(staging.ViewType == VK_IMAGE_VIEW_TYPE_2D && staging.Layers == 1, "Only 2D textures can have non resident mips.");
+    const TextureMip *mips = staging.Mips.data();
+    const auto numMips = static_cast<uint32_t>(staging.Mips.size());
+    DebugCheckCritical(firstMip < numMips, "Texture has no mip {}.", firstMip);
+
+    // resident images are copied into the next one when their residency changes
+    VulkanImage image = m_device->CreateImage2D(
+            m_format,
+            VkExtent2D{mips[firstMip].Width, mips[firstMip].Height},
+            VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            0,
+            VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+            numMips - firstMip
+    );
+
+    const uint32_t previousFirstMip = previous ? previous->m_firstMip : numMips;
+    std::vector<VkImageCopy> imageCopies;
+    std::vector<VkBufferImageCopy> bufferCopies;
+    for (uint32_t mip = firstMip; mip < numMips; mip++) {
+        if (mip >= previousFirstMip) {
+            VkImageCopy &imageCopy = imageCopies.emplace_back();
+            imageCopy.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip - previousFirstMip, 0, 1};
+            imageCopy.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip - firstMip, 0, 1};
+            imageCopy.extent = {mips[mip].Width, mips[mip].Height, 1};
+        } else {
+            VkBufferImageCopy &bufferCopy = bufferCopies.emplace_back();
+            bufferCopy.bufferOffset = mips[mip].Offset;
+            bufferCopy.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip - firstMip, 0, 1};
+            bufferCopy.imageExtent = {mips[mip].Width, mips[mip].Height, 1};
+        }
+    }
+
+    // commands before this one in submission order may still sample the previous image
+    CmdImageBarrier(
+            commandBuffer, image.Get(),
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT
+    );
+    if (!imageCopies.empty()) {
+        CmdImageBarrier(
+                commandBuffer, previous->m_image.Get(),
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT
+        );
+        vkCmdCopyImage(
+                commandBuffer,
+                previous->m_image.Get(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                image.Get(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                imageCopies.size(), imageCopies.data()
+        );
+        // frames recorded later may still bind the previous image until their descriptor sets are swapped
+        CmdImageBarrier(
+                commandBuffer, previous->m_image.Get(),
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT
+        );
+    }
+    if (!bufferCopies.empty()) {
+        vkCmdCopyBufferToImage(commandBuffer, staging.Buffer.Get(), image.Get(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, bufferCopies.size(), bufferCopies.data());
+    }
+    CmdImageBarrier(
+            commandBuffer, image.Get(),
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT
+    );
+
+    m_image = std::move(image);
+}
+
+void VulkanTexture::CompressImage(const VkExtent2D &extent, const VulkanTextureOptions &options) {
+    // the compressor reads a single layer
+    if (!options.Compressor || m_format != VK_FORMAT_R8G8B8A8_UNORM || m_viewType != VK_IMAGE_VIEW_TYPE_2D) {
+        return;
+    }
+    if (!options.Compressor->CanCompress(options.CompressedFormat)) {
+        DebugWarning("Texture format {} can't be compressed on the GPU, keeping RGBA8.", static_cast<int>(options.CompressedFormat));
+        return;
+    }
+    // the uncompressed image is freed as soon as the blocks are copied out of it
+    m_image = options.Compressor->Compress(m_image, extent, options.CompressedFormat);
+    m_format = options.CompressedFormat;
+}
+
 void VulkanTexture::CreateImageView() {
     VkImageViewCreateInfo imageViewCreateInfo{};
     imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     imageViewCreateInfo.image = m_image.Get();
-    imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    imageViewCreateInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+    imageViewCreateInfo.viewType = m_viewType;
+    imageViewCreateInfo.format = m_format;
     VkImageSubresourceRange &depthImageViewSubresourceRange = imageViewCreateInfo.subresourceRange;
     depthImageViewSubresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     depthImageViewSubresourceRange.baseMipLevel = 0;
-    depthImageViewSubresourceRange.levelCount = 1;
+    depthImageViewSubresourceRange.levelCount = m_image.GetMipLevels();
     depthImageViewSubresourceRange.baseArrayLayer = 0;
-    depthImageViewSubresourceRange.layerCount = 1;
+    depthImageViewSubresourceRange.layerCount = m_image.GetArrayLayers();
     m_imageView = m_device->CreateImageView(imageViewCreateInfo);
 }
 
-void VulkanTexture::CreateSampler() {
+void VulkanTexture::CreateSampler(const VulkanTextureOptions &options) {
+    // formats without linear filtering support can only be sampled with nearest
+    const bool canFilter = m_device->GetFormatProperties(m_format).optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    const bool linear = canFilter && options.Filter != TextureFilter::Nearest;
+    const bool linearMips = canFilter && (options.Filter == TextureFilter::Trilinear || options.Filter == TextureFilter::Anisotropic);
+    const bool anisotropic = linearMips && options.Filter == TextureFilter::Anisotropic && m_device->GetEnabledFeatures().samplerAnisotropy;
+
     VkSamplerCreateInfo samplerCreateInfo{};
     samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
-    samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
-    samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    m_sampler = m_device->CreateSampler(samplerCreateInfo);
+    samplerCreateInfo.magFilter = linear ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+    samplerCreateInfo.minFilter = linear ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+    samplerCreateInfo.mipmapMode = linearMips ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerCreateInfo.addressModeU = options.AddressMode;
+    samplerCreateInfo.addressModeV = options.AddressMode;
+    samplerCreateInfo.addressModeW = options.AddressMode;
+    samplerCreateInfo.anisotropyEnable = anisotropic ? VK_TRUE : VK_FALSE;
+    samplerCreateInfo.maxAnisotropy = anisotropic ? std::min(options.MaxAnisotropy, m_device->GetPhysicalDeviceProperties().limits.maxSamplerAnisotropy) : 1.0f;
+    samplerCreateInfo.minLod = 0.0f;
+    samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
+    m_sampler = m_device->GetSampler(samplerCreateInfo);
+    m_samplerDescriptorSet = m_device->GetSamplerDescriptorSet(samplerCreateInfo);
 }
 
 void VulkanTexture::Release() {
     if (m_device) {
-        m_device->DestroySampler(m_sampler);
         m_device->DestroyImageView(m_imageView);
     }
 
     m_device = nullptr;
+    m_format = VK_FORMAT_UNDEFINED;
+    m_viewType = VK_IMAGE_VIEW_TYPE_2D;
     m_image = {};
+    m_firstMip = 0;
     m_imageView = VK_NULL_HANDLE;
     m_sampler = VK_NULL_HANDLE;
+    m_samplerDescriptorSet = VK_NULL_HANDLE;
 }
 
 void VulkanTexture::Swap(VulkanTexture &other) noexcept {
     std::swap(m_device, other.m_device);
+    std::swap(m_format, other.m_format);
+    std::swap(m_viewType, other.m_viewType);
     std::swap(m_image, other.m_image);
+    std::swap(m_firstMip, other.m_firstMip);
     std::swap(m_imageView, other.m_imageView);
     std::swap(m_sampler, other.m_sampler);
+    std::swap(m_samplerDescriptorSet, other.m_samplerDescriptorSet);
 }
 
 void VulkanTexture::BindToDescriptorSet(VkDescriptorSet descriptorSet, uint32_t binding) {
     VkDescriptorImageInfo imageInfo{};
-    imageInfo.sampler = m_sampler;
     imageInfo.imageView = m_imageView;
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
@@ -147,7 +443,7 @@ void VulkanTexture::BindToDescriptorSet(VkDescriptorSet descriptorSet, uint32_t
     writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     writeDescriptorSet.dstSet = descriptorSet;
     writeDescriptorSet.dstBinding = binding;
-    writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
     writeDescriptorSet.descriptorCount = 1;
     writeDescriptorSet.pImageInfo = &imageInfo;
 
@@ -6,12 +6,86 @@
 
 #include "VulkanBase.h"
 #include "VulkanImage.h"
+#include "TextureFile.h"
+
+class GpuTextureCompressor;
+
+enum class TextureFilter {
+    // no filtering inside or between mips, for pixel art
+    Nearest,
+    // linear inside the closest mip
+    Bilinear,
+    // linear inside and between mips
+    Trilinear,
+    // trilinear with anisotropic filtering when the device supports it
+    Anisotropic
+};
+
+struct VulkanTextureOptions {
+    TextureFilter Filter = TextureFilter::Anisotropic;
+    // when only the top level is given a full mip chain is blitted down from it on the GPU,
+    // block compressed formats can't be blitted to
+    bool GenerateMips = true;
+    // clamped to the device limit
+    float MaxAnisotropy = 16.0f;
+    VkSamplerAddressMode AddressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    // RGBA8 UNORM textures are block compressed into CompressedFormat after their mips are generated when set,
+    // they stay RGBA8 when the compressor can't produce that format
+    GpuTextureCompressor *Compressor = nullptr;
+    VkFormat CompressedFormat = VK_FORMAT_BC7_UNORM_BLOCK;
+};
+
+// Mips copied into a host visible staging buffer, the offsets of Mips are relative to Buffer.
+// Can be created on any thread, VMA synchronizes its allocations internally.
+struct VulkanTextureStaging {
+    VkFormat Format = VK_FORMAT_UNDEFINED;
+    // 2D_ARRAY, CUBE and CUBE_ARRAY textures have Layers layers, cube faces are ordered +X -X +Y -Y +Z -Z.
+    // Every level of a 3D texture holds all of its slices, Depth at the full size level.
+    VkImageViewType ViewType = VK_IMAGE_VIEW_TYPE_2D;
+    uint32_t Layers = 1;
+    uint32_t Depth = 1;
+    // all levels of the first layer, then all levels of the next one
+    std::vector<TextureMip> Mips;
+    VulkanBuffer Buffer;
+
+    [[nodiscard]] uint32_t GetMipLevels() const { return Mips.size() / Layers; }
+};
 
+// 2D, array, cube or 3D texture with its view and sampler.
 class VulkanTexture {
 public:
     VulkanTexture() = default;
 
-    VulkanTexture(VulkanBase *device, uint32_t width, uint32_t height, const void *data);
+    // RGBA8 pixels
+    VulkanTexture(VulkanBase *device, uint32_t width, uint32_t height, const void *data, const VulkanTextureOptions &options = {});
+
+    // Uploads the given mips as they are, mips[0] is the full size level and the offsets are relative to data.
+    // The format must pass IsFormatSupported.
+    VulkanTexture(VulkanBase *device, VkFormat format, const TextureMip *mips, uint32_t mipLevels, const void *data, const VulkanTextureOptions &options = {});
+
+    // Same sized RGBA8 layers, viewType is 2D_ARRAY, CUBE (6 layers) or CUBE_ARRAY (a multiple of 6, needs imageCubeArray)
+    // with data holding one pointer per layer, or 3D with one pointer per slice. Every layer gets the mips options.GenerateMips asks for.
+    VulkanTexture(
+            VulkanBase *device, VkImageViewType viewType, uint32_t width, uint32_t height, uint32_t layers,
+            const void *const *data, const VulkanTextureOptions &options = {}
+    );
+
+    // uploads the file's mip chain without decoding it
+    VulkanTexture(VulkanBase *device, const TextureFile &file, const VulkanTextureOptions &options = {})
+            : VulkanTexture(device, file.GetFormat(), file.GetMips(), file.GetMipLevels(), file.GetData(), options) {}
+
+    // Records the upload into commandBuffer instead of waiting for it, the texture can be sampled by later commands.
+    // staging must be kept alive until commandBuffer has executed. With VK_NULL_HANDLE the upload is submitted and waited for,
+    // options.Compressor is only used then since it waits for the GPU too.
+    VulkanTexture(VulkanBase *device, VkCommandBuffer commandBuffer, const VulkanTextureStaging &staging, const VulkanTextureOptions &options = {});
+
+    // Records the upload of only the mips from firstMip on into commandBuffer, for textures whose finest mips are not resident.
+    // Levels previous holds are copied from its image and the rest from staging, both must be kept alive until commandBuffer has executed.
+    // previous must have been created by this constructor from the same staging.
+    VulkanTexture(
+            VulkanBase *device, VkCommandBuffer commandBuffer, const VulkanTextureStaging &staging,
+            uint32_t firstMip, const VulkanTexture *previous, const VulkanTextureOptions &options = {}
+    );
 
     ~VulkanTexture() {
         Release();
@@ -37,18 +111,67 @@ public:
 
     void Swap(VulkanTexture &other) noexcept;
 
+    // writes the image as a VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, the sampler is bound through GetSamplerDescriptorSet()
     void BindToDescriptorSet(VkDescriptorSet descriptorSet, uint32_t binding);
 
+    // a set of VulkanDevice::GetSamplerDescriptorSetLayout() shared by every texture with the same sampler state
+    [[nodiscard]] VkDescriptorSet GetSamplerDescriptorSet() const { return m_samplerDescriptorSet; }
+
+    [[nodiscard]] uint32_t GetMipLevels() const { return m_image.GetMipLevels(); }
+
+    // the level of the source the first level of the image was uploaded from
+    [[nodiscard]] uint32_t GetFirstMip() const { return m_firstMip; }
+
+    [[nodiscard]] VkFormat GetFormat() const { return m_format; }
+
+    [[nodiscard]] VkImageViewType GetViewType() const { return m_viewType; }
+
+    // 1 for 3D textures
+    [[nodiscard]] uint32_t GetArrayLayers() const { return m_image.GetArrayLayers(); }
+
+    [[nodiscard]] VkDeviceSize GetMemorySize() const { return m_image.GetAllocationSize(); }
+
+    // Whether textures of this format can be created on the device, block compressed formats also need their feature enabled.
+    static bool IsFormatSupported(VulkanBase *device, VkFormat format);
+
+    // mips[0] is the full size level and the offsets are relative to data
+    static VulkanTextureStaging CreateStaging(VulkanBase *device, VkFormat format, const TextureMip *mips, uint32_t mipLevels, const void *data);
+
+    // mips holds mipLevels levels of every layer in the order of VulkanTextureStaging::Mips, the offsets are relative to data.
+    // Every layer and level is copied into one buffer, which is uploaded with a single copy command.
+    static VulkanTextureStaging CreateStaging(
+            VulkanBase *device, VkFormat format, VkImageViewType viewType, uint32_t layers, uint32_t depth,
+            const TextureMip *mips, uint32_t mipLevels, const void *data
+    );
+
+    // The layout of CreateStaging without copying anything, for data written straight into Buffer.GetMappedData() and flushed.
+    // hostReads puts the buffer into cached memory, for writers that read back what they wrote.
+    static VulkanTextureStaging AllocateStaging(
+            VulkanBase *device, VkFormat format, VkImageViewType viewType, uint32_t layers, uint32_t depth,
+            const TextureMip *mips, uint32_t mipLevels, bool hostReads = false
+    );
+
 private:
-    void CreateImage(uint32_t width, uint32_t height, const void *data);
+    // submits and waits for the upload when commandBuffer is VK_NULL_HANDLE
+    void CreateImage(const VulkanTextureStaging &staging, bool generateMips, VkCommandBuffer commandBuffer);
+
+    void CreateResidentImage(const VulkanTextureStaging &staging, uint32_t firstMip, const VulkanTexture *previous, VkCommandBuffer commandBuffer);
+
+    // with options.Compressor, RGBA8 UNORM images are replaced by their block compressed copy
+    void CompressImage(const VkExtent2D &extent, const VulkanTextureOptions &options);
 
     void CreateImageView();
 
-    void CreateSampler();
+    void CreateSampler(const VulkanTextureOptions &options);
 
     VulkanBase *m_device = nullptr;
 
+    VkFormat m_format = VK_FORMAT_UNDEFINED;
+    VkImageViewType m_viewType = VK_IMAGE_VIEW_TYPE_2D;
     VulkanImage m_image;
+    uint32_t m_firstMip = 0;
     VkImageView m_imageView = VK_NULL_HANDLE;
+    // shared by every texture with the same sampler state, owned by the device
     VkSampler m_sampler = VK_NULL_HANDLE;
+    VkDescriptorSet m_samplerDescriptorSet = VK_NULL_HANDLE;
 };